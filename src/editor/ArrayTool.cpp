@@ -0,0 +1,283 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "ArrayTool.hpp"
+#include "Common.hpp"
+
+#include <wx/intl.h>
+#include <wx/propgrid/advprops.h>
+#include <wx/sizer.h>
+
+#include <algorithm>
+#include <random>
+
+ArraySettings::ArraySettings(void)
+	: Mode(MODE_LINEAR), Count(10), Offset(20, 0, 0), Columns(10), Rows(10),
+	  Spacing(20, 20), Radius(100), FaceCentre(true), Seed(1), RandomRotation(true),
+	  MinScale(0.8f), MaxScale(1.2f), AlignToSurface(false)
+{
+}
+
+void ArrayTool::Layout(const ArraySettings& settings, irr::scene::ISceneNode* source,
+	irr::scene::ISceneNode* mapRoot, irr::scene::ISceneManager* sceneMgr,
+	std::vector<ArrayPlacement>& placements)
+{
+	ArrayPlacement placement;
+	placement.Position = source->getPosition();
+	placement.Rotation = source->getRotation();
+	placement.Scale = source->getScale();
+
+	switch (settings.Mode)
+	{
+	case ArraySettings::MODE_LINEAR:
+	{
+		placements.reserve(settings.Count);
+		for (int i = 1; i <= settings.Count; ++i)
+		{
+			ArrayPlacement copy(placement);
+			copy.Position += settings.Offset * (irr::f32)i;
+			placements.push_back(copy);
+		}
+	} break;
+	case ArraySettings::MODE_GRID:
+	{
+		placements.reserve(settings.Columns * settings.Rows);
+		for (int row = 0; row < settings.Rows; ++row)
+		{
+			for (int column = 0; column < settings.Columns; ++column)
+			{
+				if (row == 0 && column == 0)
+					continue; // the source
+
+				ArrayPlacement copy(placement);
+				copy.Position.X += settings.Spacing.X * column;
+				copy.Position.Z += settings.Spacing.Y * row;
+				placements.push_back(copy);
+			}
+		}
+	} break;
+	case ArraySettings::MODE_RADIAL:
+	{
+		// the source is the first place on a circle centred on -X of it
+		irr::core::vector3df centre(placement.Position);
+		centre.X -= settings.Radius;
+
+		placements.reserve(settings.Count);
+		for (int i = 1; i < settings.Count; ++i)
+		{
+			irr::f64 angle = 360.0 * i / settings.Count;
+
+			ArrayPlacement copy(placement);
+			copy.Position.rotateXZBy(angle, centre);
+			if (settings.FaceCentre)
+				copy.Rotation.Y -= (irr::f32)angle; // rotateXZBy turns the other way to a yaw
+			placements.push_back(copy);
+		}
+	} break;
+	case ArraySettings::MODE_SCATTER:
+		Scatter(settings, source, mapRoot, sceneMgr, placements);
+		break;
+	}
+}
+
+void ArrayTool::Scatter(const ArraySettings& settings, irr::scene::ISceneNode* source,
+	irr::scene::ISceneNode* mapRoot, irr::scene::ISceneManager* sceneMgr,
+	std::vector<ArrayPlacement>& placements)
+{
+	// the surfaces are the map's geometry, not its actors or the source
+	irr::scene::IMetaTriangleSelector* surfaces = sceneMgr->createMetaTriangleSelector();
+	irr::core::aabbox3df bounds(source->getTransformedBoundingBox());
+
+	const irr::core::list<irr::scene::ISceneNode*>& children = mapRoot->getChildren();
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin();
+		it != children.end(); ++it)
+	{
+		irr::scene::ISceneNode* node = *it;
+		if (node == source || !node->isVisible() || !(node->getID() & NID_PICKABLE) ||
+			!node->getTriangleSelector() ||
+			node->getType() == irr::scene::ESNT_SKY_BOX ||
+			node->getType() == irr::scene::ESNT_SKY_DOME)
+			continue;
+
+		// actors are picked through their marker
+		bool marker = false;
+		const irr::core::list<irr::scene::ISceneNode*>& markers = node->getChildren();
+		for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = markers.begin();
+			child != markers.end() && !marker; ++child)
+			marker = ((*child)->getID() & NID_NOSAVE) != 0;
+		if (marker)
+			continue;
+
+		surfaces->addTriangleSelector(node->getTriangleSelector());
+		bounds.addInternalBox(node->getTransformedBoundingBox());
+	}
+
+	bool onSurface = surfaces->getTriangleCount() > 0;
+	irr::scene::ISceneCollisionManager* colMgr = sceneMgr->getSceneCollisionManager();
+
+	ArrayPlacement placement;
+	placement.Position = source->getPosition();
+	placement.Rotation = source->getRotation();
+	placement.Scale = source->getScale();
+
+	std::mt19937 random(settings.Seed);
+	std::uniform_real_distribution<irr::f32> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<irr::f32> scale(
+		std::min(settings.MinScale, settings.MaxScale),
+		std::max(settings.MinScale, settings.MaxScale));
+
+	// a miss costs a sample, so give up on a circle that is mostly empty
+	placements.reserve(settings.Count);
+	int attempts = settings.Count * 4;
+	while ((int)placements.size() < settings.Count && attempts-- > 0)
+	{
+		// even over the disc
+		irr::f32 r = settings.Radius * sqrtf(unit(random));
+		irr::f32 theta = unit(random) * irr::core::PI * 2.0f;
+
+		ArrayPlacement copy(placement);
+		copy.Position.X += r * cosf(theta);
+		copy.Position.Z += r * sinf(theta);
+
+		irr::f32 yaw = settings.RandomRotation ? unit(random) * 360.0f : 0.0f;
+		copy.Scale *= scale(random);
+
+		if (onSurface)
+		{
+			irr::core::line3df ray(copy.Position.X, bounds.MaxEdge.Y + 1.0f, copy.Position.Z,
+				copy.Position.X, bounds.MinEdge.Y - 1.0f, copy.Position.Z);
+
+			irr::core::vector3df hit;
+			irr::core::triangle3df triangle;
+			irr::scene::ISceneNode* node = nullptr;
+			if (!colMgr->getCollisionPoint(ray, surfaces, hit, triangle, node))
+				continue;
+
+			copy.Position = hit;
+
+			if (settings.AlignToSurface)
+			{
+				irr::core::vector3df normal = triangle.getNormal().normalize();
+				if (normal.Y < 0)
+					normal = -normal;
+
+				// turn about the source's up first, then tilt onto the surface
+				irr::core::quaternion tilt;
+				tilt.rotationFromTo(irr::core::vector3df(0, 1, 0), normal);
+
+				irr::core::matrix4 turn;
+				turn.setRotationDegrees(copy.Rotation + irr::core::vector3df(0, yaw, 0));
+				copy.Rotation = (tilt.getMatrix() * turn).getRotationDegrees();
+				yaw = 0;
+			}
+		}
+
+		copy.Rotation.Y += yaw;
+		placements.push_back(copy);
+	}
+
+	surfaces->drop();
+}
+
+ArraySettings ArrayDialog::s_Settings;
+
+ArrayDialog::ArrayDialog(wxWindow* parent, const wxString& source)
+	: wxDialog(parent, wxID_ANY, wxString::Format(_("Array %s"), source))
+{
+	wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->SetMinSize(360, 420);
+
+	m_Properties = new wxPropertyGrid(this, wxID_ANY, wxDefaultPosition,
+		wxDefaultSize, wxPG_SPLITTER_AUTO_CENTER | wxPG_DEFAULT_STYLE);
+	sizer->Add(m_Properties, wxSizerFlags(9).Expand());
+
+	wxArrayString modes;
+	modes.Add(_("Linear"));
+	modes.Add(_("Grid"));
+	modes.Add(_("Radial"));
+	modes.Add(_("Scatter"));
+	m_Mode = m_Properties->Append(new wxEnumProperty(_("Mode"), wxT("Mode"), modes,
+		wxArrayInt(), s_Settings.Mode));
+	m_Count = m_Properties->Append(new wxIntProperty(_("Count"), wxT("Count"), s_Settings.Count));
+
+	m_Categories[ArraySettings::MODE_LINEAR] = m_Properties->Append(new wxPropertyCategory(_("Linear")));
+	m_Properties->Append(new wxFloatProperty(_("Offset X"), wxT("OffsetX"), s_Settings.Offset.X));
+	m_Properties->Append(new wxFloatProperty(_("Offset Y"), wxT("OffsetY"), s_Settings.Offset.Y));
+	m_Properties->Append(new wxFloatProperty(_("Offset Z"), wxT("OffsetZ"), s_Settings.Offset.Z));
+
+	m_Categories[ArraySettings::MODE_GRID] = m_Properties->Append(new wxPropertyCategory(_("Grid")));
+	m_Properties->Append(new wxIntProperty(_("Columns"), wxT("Columns"), s_Settings.Columns));
+	m_Properties->Append(new wxIntProperty(_("Rows"), wxT("Rows"), s_Settings.Rows));
+	m_Properties->Append(new wxFloatProperty(_("Column spacing"), wxT("SpacingX"), s_Settings.Spacing.X));
+	m_Properties->Append(new wxFloatProperty(_("Row spacing"), wxT("SpacingZ"), s_Settings.Spacing.Y));
+
+	m_Categories[ArraySettings::MODE_RADIAL] = m_Properties->Append(new wxPropertyCategory(_("Radial")));
+	m_Properties->Append(new wxFloatProperty(_("Radius"), wxT("RadialRadius"), s_Settings.Radius));
+	m_Properties->Append(new wxBoolProperty(_("Face the centre"), wxT("FaceCentre"), s_Settings.FaceCentre));
+
+	m_Categories[ArraySettings::MODE_SCATTER] = m_Properties->Append(new wxPropertyCategory(_("Scatter")));
+	m_Properties->Append(new wxFloatProperty(_("Radius"), wxT("ScatterRadius"), s_Settings.Radius));
+	m_Properties->Append(new wxIntProperty(_("Seed"), wxT("Seed"), s_Settings.Seed));
+	m_Properties->Append(new wxBoolProperty(_("Random rotation"), wxT("RandomRotation"), s_Settings.RandomRotation));
+	m_Properties->Append(new wxFloatProperty(_("Minimum scale"), wxT("MinScale"), s_Settings.MinScale));
+	m_Properties->Append(new wxFloatProperty(_("Maximum scale"), wxT("MaxScale"), s_Settings.MaxScale));
+	m_Properties->Append(new wxBoolProperty(_("Align to surface"), wxT("AlignToSurface"), s_Settings.AlignToSurface));
+
+	m_Properties->SetPropertyAttributeAll(wxPG_BOOL_USE_CHECKBOX, true);
+	ShowMode(s_Settings.Mode);
+
+	wxSizer* buttons = CreateButtonSizer(wxOK | wxCANCEL);
+	sizer->Add(buttons, wxSizerFlags(1).Expand().Border(wxALL));
+
+	SetSizerAndFit(sizer);
+
+	Bind(wxEVT_BUTTON, &ArrayDialog::OnOKEvent, this, wxID_OK);
+	m_Properties->Bind(wxEVT_PG_CHANGED, &ArrayDialog::OnPropertyChanged, this);
+}
+
+void ArrayDialog::ShowMode(int mode)
+{
+	for (int i = 0; i < 4; ++i)
+		m_Properties->HideProperty(m_Categories[i], i != mode);
+
+	// the grid's size is its rows and columns
+	m_Properties->HideProperty(m_Count, mode == ArraySettings::MODE_GRID);
+}
+
+void ArrayDialog::OnOKEvent(wxCommandEvent& event)
+{
+	s_Settings.Mode = (ArraySettings::MODE)m_Mode->GetValue().GetLong();
+	s_Settings.Count = std::max(1L, m_Count->GetValue().GetLong());
+
+	s_Settings.Offset.X = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("OffsetX"));
+	s_Settings.Offset.Y = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("OffsetY"));
+	s_Settings.Offset.Z = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("OffsetZ"));
+
+	s_Settings.Columns = std::max(1, m_Properties->GetPropertyValueAsInt(wxT("Columns")));
+	s_Settings.Rows = std::max(1, m_Properties->GetPropertyValueAsInt(wxT("Rows")));
+	s_Settings.Spacing.X = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("SpacingX"));
+	s_Settings.Spacing.Y = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("SpacingZ"));
+
+	if (s_Settings.Mode == ArraySettings::MODE_RADIAL)
+		s_Settings.Radius = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("RadialRadius"));
+	else
+		s_Settings.Radius = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("ScatterRadius"));
+	s_Settings.FaceCentre = m_Properties->GetPropertyValueAsBool(wxT("FaceCentre"));
+
+	s_Settings.Seed = m_Properties->GetPropertyValueAsInt(wxT("Seed"));
+	s_Settings.RandomRotation = m_Properties->GetPropertyValueAsBool(wxT("RandomRotation"));
+	s_Settings.MinScale = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("MinScale"));
+	s_Settings.MaxScale = (irr::f32)m_Properties->GetPropertyValueAsDouble(wxT("MaxScale"));
+	s_Settings.AlignToSurface = m_Properties->GetPropertyValueAsBool(wxT("AlignToSurface"));
+
+	event.Skip(); // let the dialog close
+}
+
+void ArrayDialog::OnPropertyChanged(wxPropertyGridEvent& event)
+{
+	if (event.GetProperty() == m_Mode)
+		ShowMode(m_Mode->GetValue().GetLong());
+}
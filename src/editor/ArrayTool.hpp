@@ -0,0 +1,87 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <wx/dialog.h>
+#include <wx/propgrid/propgrid.h>
+
+#include "irrlicht.h"
+
+#include <vector>
+
+// Where one copy of an arrayed entity goes, relative to the map root
+struct ArrayPlacement
+{
+	irr::core::vector3df Position;
+	irr::core::vector3df Rotation;
+	irr::core::vector3df Scale;
+};
+
+struct ArraySettings
+{
+	enum MODE
+	{
+		MODE_LINEAR,
+		MODE_GRID,
+		MODE_RADIAL,
+		MODE_SCATTER,
+	};
+
+	MODE Mode;
+	int Count;                     // copies, or the places around the circle
+
+	irr::core::vector3df Offset;   // linear
+	int Columns, Rows;             // grid, along X and Z
+	irr::core::vector2df Spacing;
+	irr::f32 Radius;               // radial and scatter
+	bool FaceCentre;               // radial
+
+	int Seed;                      // scatter
+	bool RandomRotation;
+	irr::f32 MinScale, MaxScale;
+	bool AlignToSurface;
+
+	ArraySettings(void);
+};
+
+// Lays out the copies of a node. The source keeps its place and isn't one
+// of the placements.
+class ArrayTool
+{
+public:
+	static void Layout(const ArraySettings& settings, irr::scene::ISceneNode* source,
+		irr::scene::ISceneNode* mapRoot, irr::scene::ISceneManager* sceneMgr,
+		std::vector<ArrayPlacement>& placements);
+
+private:
+	// Scatter drops the copies onto the map's geometry below the circle
+	static void Scatter(const ArraySettings& settings, irr::scene::ISceneNode* source,
+		irr::scene::ISceneNode* mapRoot, irr::scene::ISceneManager* sceneMgr,
+		std::vector<ArrayPlacement>& placements);
+};
+
+class ArrayDialog : public wxDialog
+{
+private:
+	wxPropertyGrid* m_Properties;
+	wxPGProperty* m_Mode;
+	wxPGProperty* m_Count;
+	wxPGProperty* m_Categories[4]; // one per mode
+
+	static ArraySettings s_Settings; // what was used last time
+
+public:
+	ArrayDialog(wxWindow* parent, const wxString& source);
+
+	const ArraySettings& GetSettings(void) const { return s_Settings; }
+
+private:
+	void ShowMode(int mode);
+
+	void OnOKEvent(wxCommandEvent& event);
+	void OnPropertyChanged(wxPropertyGridEvent& event);
+};
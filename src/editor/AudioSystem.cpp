@@ -14,9 +14,12 @@
 #include <wx/log.h>
 #include <wx/mstream.h>
 
-#include <vector>
-#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 struct AudioSystem::StreamData
 {
@@ -55,26 +58,232 @@ static ma_result wx_tell_proc(ma_decoder* /*pDecoder*/, ma_int64* pCursor, void*
     return MA_SUCCESS;
 }
 
+// Sizes for the streaming path. The ring holds roughly half a second of
+// output, and the decoder thread refills it a chunk at a time.
+static const ma_uint32 OUTPUT_CHANNELS = 2;
+static const ma_uint32 OUTPUT_RATE = 44100;
+static const size_t RING_FRAMES = 32768;
+static const size_t DECODE_CHUNK_FRAMES = 4096;
+static const size_t STREAM_SCRATCH_FRAMES = 1024;
+
+// Sounds up to this length are decoded once and kept in the clip cache
+static const ma_uint64 CLIP_MAX_FRAMES = OUTPUT_RATE * 10;
+static const size_t DEFAULT_CLIP_CACHE_BYTES = 64 * 1024 * 1024;
+
+// PcmRingBuffer Implementation
+PcmRingBuffer::PcmRingBuffer()
+    : m_channels(0), m_capacity(0), m_readPos(0), m_writePos(0)
+{
+}
+
+void PcmRingBuffer::allocate(size_t frames, size_t channels)
+{
+    size_t capacity = 1;
+    while (capacity < frames)
+        capacity <<= 1;
+
+    m_capacity = capacity;
+    m_channels = channels;
+    m_samples.assign(m_capacity * m_channels, 0.0f);
+    reset();
+}
+
+void PcmRingBuffer::reset()
+{
+    m_readPos.store(0);
+    m_writePos.store(0);
+}
+
+size_t PcmRingBuffer::availableRead() const
+{
+    return m_writePos.load(std::memory_order_acquire) - m_readPos.load(std::memory_order_relaxed);
+}
+
+size_t PcmRingBuffer::availableWrite() const
+{
+    return m_capacity - (m_writePos.load(std::memory_order_relaxed) - m_readPos.load(std::memory_order_acquire));
+}
+
+size_t PcmRingBuffer::write(const float* frames, size_t frameCount)
+{
+    size_t writePos = m_writePos.load(std::memory_order_relaxed);
+    size_t readPos = m_readPos.load(std::memory_order_acquire);
+    size_t count = std::min(frameCount, m_capacity - (writePos - readPos));
+
+    // copy in at most two pieces, wrapping at the end of the storage
+    size_t offset = writePos & (m_capacity - 1);
+    size_t first = std::min(count, m_capacity - offset);
+    std::memcpy(&m_samples[offset * m_channels], frames, first * m_channels * sizeof(float));
+    if (count > first)
+        std::memcpy(&m_samples[0], frames + first * m_channels, (count - first) * m_channels * sizeof(float));
+
+    m_writePos.store(writePos + count, std::memory_order_release);
+    return count;
+}
+
+size_t PcmRingBuffer::read(float* frames, size_t frameCount)
+{
+    size_t readPos = m_readPos.load(std::memory_order_relaxed);
+    size_t writePos = m_writePos.load(std::memory_order_acquire);
+    size_t count = std::min(frameCount, writePos - readPos);
+
+    size_t offset = readPos & (m_capacity - 1);
+    size_t first = std::min(count, m_capacity - offset);
+    std::memcpy(frames, &m_samples[offset * m_channels], first * m_channels * sizeof(float));
+    if (count > first)
+        std::memcpy(frames + first * m_channels, &m_samples[0], (count - first) * m_channels * sizeof(float));
+
+    m_readPos.store(readPos + count, std::memory_order_release);
+    return count;
+}
+
 // Device data callback for miniaudio
-static void dataCallback(ma_device* pDevice, void* pOutput, const void* /*pInput*/, ma_uint32 frameCount)
+void AudioSystem::dataCallback(ma_device* pDevice, void* pOutput, const void* /*pInput*/, uint32_t frameCount)
 {
     auto* self = static_cast<AudioSystem*>(pDevice->pUserData);
-    if (!self || !self->m_decoder)
+    if (!self)
     {
-        std::memset(pOutput, 0, frameCount * sizeof(float) * 2);
+        std::memset(pOutput, 0, frameCount * sizeof(float) * OUTPUT_CHANNELS);
         return;
     }
-    ma_decoder_read_pcm_frames(self->m_decoder.get(), pOutput, frameCount, nullptr);
+    self->mix(static_cast<float*>(pOutput), frameCount);
+}
+
+void AudioSystem::mix(float* output, uint32_t frameCount)
+{
+    // m_inCallback lets the UI thread wait until we've let go of a voice
+    m_inCallback.store(true);
+
+    std::memset(output, 0, frameCount * sizeof(float) * OUTPUT_CHANNELS);
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        Voice& voice = m_voices[i];
+        if (voice.state.load() != VOICE_PLAYING)
+            continue;
+
+        const float left = voice.gainLeft.load(std::memory_order_relaxed);
+        const float right = voice.gainRight.load(std::memory_order_relaxed);
+
+        if (voice.streamed)
+        {
+            // pull from the ring through a preallocated scratch buffer
+            size_t mixed = 0;
+            bool dry = false;
+            while (mixed < frameCount)
+            {
+                size_t wanted = std::min<size_t>(frameCount - mixed, STREAM_SCRATCH_FRAMES);
+                size_t got = m_ring.read(m_streamScratch.data(), wanted);
+
+                float* out = output + mixed * OUTPUT_CHANNELS;
+                for (size_t f = 0; f < got; ++f)
+                {
+                    out[f * 2] += m_streamScratch[f * 2] * left;
+                    out[f * 2 + 1] += m_streamScratch[f * 2 + 1] * right;
+                }
+
+                mixed += got;
+                if (got < wanted)
+                {
+                    dry = true;
+                    break;
+                }
+            }
+
+            if (dry)
+            {
+                // running dry before the decoder reached the end is an underrun
+                if (!m_decodeFinished.load(std::memory_order_acquire))
+                    m_underruns.fetch_add(1, std::memory_order_relaxed);
+                else if (m_ring.availableRead() == 0)
+                {
+                    int expected = VOICE_PLAYING;
+                    voice.state.compare_exchange_strong(expected, VOICE_DONE);
+                }
+            }
+        }
+        else
+        {
+            size_t count = std::min<size_t>(frameCount, voice.frameCount - voice.cursor);
+            const float* in = voice.samples + voice.cursor * OUTPUT_CHANNELS;
+            for (size_t f = 0; f < count; ++f)
+            {
+                output[f * 2] += in[f * 2] * left;
+                output[f * 2 + 1] += in[f * 2 + 1] * right;
+            }
+
+            voice.cursor += count;
+            if (voice.cursor >= voice.frameCount)
+            {
+                int expected = VOICE_PLAYING;
+                voice.state.compare_exchange_strong(expected, VOICE_DONE);
+            }
+        }
+    }
+
+    m_inCallback.store(false);
+}
+
+void AudioSystem::decodeLoop()
+{
+    // all inflating and decoding happens here, never on the audio thread
+    std::vector<float> chunk(DECODE_CHUNK_FRAMES * OUTPUT_CHANNELS);
+
+    while (!m_stopDecoding.load())
+    {
+        size_t space = m_ring.availableWrite();
+        if (space < DECODE_CHUNK_FRAMES)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        ma_uint64 framesRead = 0;
+        ma_result result = ma_decoder_read_pcm_frames(m_decoder.get(), chunk.data(),
+            DECODE_CHUNK_FRAMES, &framesRead);
+        if (framesRead > 0)
+            m_ring.write(chunk.data(), (size_t)framesRead);
+
+        if (result != MA_SUCCESS || framesRead < DECODE_CHUNK_FRAMES)
+            break; // end of stream or decode error
+    }
+
+    m_decodeFinished.store(true, std::memory_order_release);
 }
 
 // AudioSystem Implementation
 AudioSystem::AudioSystem()
+    : m_device(nullptr), m_initialized(false), m_inCallback(false),
+      m_streamVoice(-1), m_stopDecoding(false), m_decodeFinished(true),
+      m_underruns(0), m_reportedUnderruns(0),
+      m_clipCacheBytes(0), m_clipCacheBudget(DEFAULT_CLIP_CACHE_BYTES),
+      m_spatialPreview(false), m_listenerRight(1, 0, 0),
+      m_minDistance(50.0f), m_maxDistance(1000.0f)
 {
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        Voice& voice = m_voices[i];
+        voice.state.store(VOICE_FREE);
+        voice.streamed = false;
+        voice.samples = nullptr;
+        voice.frameCount = 0;
+        voice.cursor = 0;
+        voice.gainLeft.store(0.0f);
+        voice.gainRight.store(0.0f);
+        voice.generation = 0;
+        voice.gain = 1.0f;
+        voice.pan = 0.0f;
+        voice.spatial = false;
+    }
+
+    m_ring.allocate(RING_FRAMES, OUTPUT_CHANNELS);
+    m_streamScratch.resize(STREAM_SCRATCH_FRAMES * OUTPUT_CHANNELS);
     initDevice();
 }
 
 AudioSystem::~AudioSystem()
 {
+    stopSound();
     shutdownDevice();
 }
 
@@ -85,8 +294,8 @@ void AudioSystem::initDevice()
 
     ma_device_config config = ma_device_config_init(ma_device_type_playback);
     config.playback.format = ma_format_f32;
-    config.playback.channels = 2;
-    config.sampleRate = 44100;
+    config.playback.channels = OUTPUT_CHANNELS;
+    config.sampleRate = OUTPUT_RATE;
     config.dataCallback = dataCallback;
     config.pUserData = this;
     m_device = new ma_device;
@@ -113,95 +322,581 @@ void AudioSystem::shutdownDevice()
     m_initialized = false;
 }
 
-void AudioSystem::playSound(const wxString& location)
+int AudioSystem::playSound(const wxString& location, float gain, float pan)
+{
+    return startVoice(location, gain, pan, false, irr::core::vector3df());
+}
+
+int AudioSystem::playSoundAt(const wxString& location, const irr::core::vector3df& position, float gain)
+{
+    return startVoice(location, gain, 0.0f, true, position);
+}
+
+int AudioSystem::startVoice(const wxString& location, float gain, float pan, bool spatial,
+    const irr::core::vector3df& position)
 {
     if (!m_initialized)
+        return -1;
+
+    update(); // reclaim anything that finished on its own
+
+    std::shared_ptr<DecodedClip> clip = findClip(location);
+    std::unique_ptr<StreamData> streamData;
+    std::unique_ptr<ma_decoder> decoder;
+
+    if (!clip)
+    {
+        if (!openStream(location, streamData, decoder))
+            return -1;
+
+        // short sounds are decoded once and cached, long ones are streamed
+        ma_uint64 length = 0;
+        if (ma_decoder_get_length_in_pcm_frames(decoder.get(), &length) == MA_SUCCESS &&
+            length > 0 && length <= CLIP_MAX_FRAMES)
+        {
+            clip.reset(new DecodedClip);
+            clip->location = location;
+            clip->samples.resize((size_t)length * OUTPUT_CHANNELS);
+
+            ma_uint64 framesRead = 0;
+            ma_decoder_read_pcm_frames(decoder.get(), clip->samples.data(), length, &framesRead);
+            clip->frameCount = (size_t)framesRead;
+            clip->samples.resize(clip->frameCount * OUTPUT_CHANNELS);
+
+            ma_decoder_uninit(decoder.get());
+            decoder.reset();
+            streamData.reset();
+
+            if (clip->frameCount == 0)
+            {
+                wxLogWarning(_("Failed to decode file: %s"), location.c_str());
+                return -1;
+            }
+
+            cacheClip(clip);
+        }
+    }
+
+    // only one voice streams at a time, a new stream replaces the old one
+    if (!clip && m_streamVoice != -1)
+        stopIndex(m_streamVoice);
+
+    int index = findFreeVoice();
+    if (index == -1)
+    {
+        wxLogWarning(_("No free voices to play %s"), location.c_str());
+        if (decoder)
+            ma_decoder_uninit(decoder.get());
+        return -1;
+    }
+
+    Voice& voice = m_voices[index];
+    voice.generation = (voice.generation + 1) & 0x7FFFFF;
+    voice.gain = gain;
+    voice.pan = pan;
+    voice.spatial = spatial;
+    voice.position = position;
+    voice.cursor = 0;
+    updateVoiceGain(voice);
+
+    if (clip)
+    {
+        voice.streamed = false;
+        voice.clip = clip;
+        voice.samples = clip->samples.data();
+        voice.frameCount = clip->frameCount;
+    }
+    else
+    {
+        voice.streamed = true;
+        voice.clip.reset();
+        voice.samples = nullptr;
+        voice.frameCount = 0;
+
+        // nothing is reading the ring while no voice streams, so it's safe to rewind
+        m_decoder = std::move(decoder);
+        m_streamData = std::move(streamData);
+        m_ring.reset();
+        m_underruns.store(0);
+        m_reportedUnderruns = 0;
+        m_stopDecoding.store(false);
+        m_decodeFinished.store(false);
+        m_streamVoice = index;
+
+        m_decodeThread = std::thread(&AudioSystem::decodeLoop, this);
+
+        // let the decoder get a head start so playback doesn't open with an underrun
+        for (int i = 0; i < 50 && m_ring.availableRead() < DECODE_CHUNK_FRAMES &&
+            !m_decodeFinished.load(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    voice.state.store(VOICE_PLAYING);
+    return (int)(voice.generation << 8) | index;
+}
+
+int AudioSystem::findFreeVoice() const
+{
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (m_voices[i].state.load() == VOICE_FREE)
+            return i;
+    }
+
+    return -1;
+}
+
+int AudioSystem::voiceIndex(int voice) const
+{
+    if (voice < 0)
+        return -1;
+
+    int index = voice & 0xFF;
+    if (index >= MAX_VOICES || m_voices[index].generation != ((uint32_t)voice >> 8))
+        return -1; // stale handle
+
+    return index;
+}
+
+void AudioSystem::waitForCallback()
+{
+    while (m_inCallback.load())
+        std::this_thread::yield();
+}
+
+void AudioSystem::releaseVoice(int index)
+{
+    Voice& voice = m_voices[index];
+
+    if (voice.streamed)
+    {
+        m_stopDecoding.store(true);
+        if (m_decodeThread.joinable())
+            m_decodeThread.join();
+
+        reportUnderruns(); // flush any pending report for this stream
+
+        if (m_decoder)
+        {
+            ma_decoder_uninit(m_decoder.get());
+            m_decoder.reset();
+        }
+        m_streamData.reset();
+        m_streamVoice = -1;
+    }
+
+    voice.streamed = false;
+    voice.samples = nullptr;
+    voice.frameCount = 0;
+    voice.clip.reset();
+    voice.state.store(VOICE_FREE);
+}
+
+void AudioSystem::stopVoice(int voice)
+{
+    int index = voiceIndex(voice);
+    if (index != -1)
+        stopIndex(index);
+}
+
+void AudioSystem::stopIndex(int index)
+{
+    int expected = VOICE_PLAYING;
+    if (m_voices[index].state.compare_exchange_strong(expected, VOICE_STOPPING))
+        waitForCallback();
+
+    if (m_voices[index].state.load() != VOICE_FREE)
+        releaseVoice(index);
+}
+
+void AudioSystem::stopSound()
+{
+    bool stopping = false;
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        int expected = VOICE_PLAYING;
+        if (m_voices[i].state.compare_exchange_strong(expected, VOICE_STOPPING))
+            stopping = true;
+    }
+
+    if (stopping)
+        waitForCallback();
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (m_voices[i].state.load() != VOICE_FREE)
+            releaseVoice(i);
+    }
+}
+
+bool AudioSystem::isPlaying(int voice) const
+{
+    int index = voiceIndex(voice);
+    return index != -1 && m_voices[index].state.load() == VOICE_PLAYING;
+}
+
+void AudioSystem::setVoiceGain(int voice, float gain)
+{
+    int index = voiceIndex(voice);
+    if (index == -1)
+        return;
+
+    m_voices[index].gain = gain;
+    updateVoiceGain(m_voices[index]);
+}
+
+void AudioSystem::setVoicePan(int voice, float pan)
+{
+    int index = voiceIndex(voice);
+    if (index == -1)
+        return;
+
+    m_voices[index].pan = irr::core::clamp(pan, -1.0f, 1.0f);
+    updateVoiceGain(m_voices[index]);
+}
+
+void AudioSystem::setVoicePosition(int voice, const irr::core::vector3df& position)
+{
+    int index = voiceIndex(voice);
+    if (index == -1)
+        return;
+
+    m_voices[index].position = position;
+    updateVoiceGain(m_voices[index]);
+}
+
+void AudioSystem::setListener(const irr::core::vector3df& position, const irr::core::vector3df& target,
+    const irr::core::vector3df& up)
+{
+    m_listenerPosition = position;
+
+    // Irrlicht is left handed, so up x forward points to the right
+    irr::core::vector3df forward(target - position);
+    forward.normalize();
+    m_listenerRight = up.crossProduct(forward);
+    m_listenerRight.normalize();
+
+    if (!m_spatialPreview)
         return;
 
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (m_voices[i].spatial && m_voices[i].state.load() == VOICE_PLAYING)
+            updateVoiceGain(m_voices[i]);
+    }
+}
+
+void AudioSystem::setSpatialPreview(bool enable)
+{
+    m_spatialPreview = enable;
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (m_voices[i].spatial && m_voices[i].state.load() != VOICE_FREE)
+            updateVoiceGain(m_voices[i]);
+    }
+}
+
+bool AudioSystem::isSpatialPreview() const
+{
+    return m_spatialPreview;
+}
+
+void AudioSystem::setAttenuationRange(float minDistance, float maxDistance)
+{
+    m_minDistance = std::max(minDistance, 0.001f);
+    m_maxDistance = std::max(maxDistance, m_minDistance);
+}
+
+void AudioSystem::updateVoiceGain(Voice& voice)
+{
+    float gain = voice.gain;
+    float pan = voice.pan;
+
+    if (voice.spatial && m_spatialPreview)
+    {
+        irr::core::vector3df offset(voice.position - m_listenerPosition);
+        float distance = offset.getLength();
+
+        // inverse distance rolloff, faded to silence at the far edge
+        float attenuation = 1.0f;
+        if (distance >= m_maxDistance)
+            attenuation = 0.0f;
+        else if (distance > m_minDistance)
+        {
+            attenuation = m_minDistance / distance;
+            attenuation *= 1.0f - (distance - m_minDistance) / (m_maxDistance - m_minDistance);
+        }
+        gain *= attenuation;
+
+        if (distance > 0.0001f)
+            pan = irr::core::clamp(offset.dotProduct(m_listenerRight) / distance, -1.0f, 1.0f);
+    }
+
+    // constant power pan
+    float angle = (pan + 1.0f) * irr::core::PI * 0.25f;
+    voice.gainLeft.store(gain * cosf(angle), std::memory_order_relaxed);
+    voice.gainRight.store(gain * sinf(angle), std::memory_order_relaxed);
+}
+
+bool AudioSystem::openStream(const wxString& location, std::unique_ptr<StreamData>& streamData,
+    std::unique_ptr<ma_decoder>& decoder)
+{
     // Open file via wxFileSystem (supports zip, etc)
     wxFileSystem fileSystem;
     std::unique_ptr<wxFSFile> fsFile(fileSystem.OpenFile(location));
     if (!fsFile)
     {
         wxLogWarning(_("Failed to open file: %s"), location.c_str());
-        return;
+        return false;
     }
 
     std::unique_ptr<wxInputStream> stream(fsFile->DetachStream());
     if (!stream)
     {
         wxLogWarning(_("Failed to open file: %s"), location.c_str());
-        return;
+        return false;
     }
 
     // Prepare stream data for miniaudio
-    m_streamData.reset(new StreamData());
-    m_streamData->stream = std::move(stream);
-    m_streamData->location = location;
+    streamData.reset(new StreamData());
+    streamData->stream = std::move(stream);
+    streamData->location = location;
 
     // Setup decoder config
-    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, 2, 44100);
-    m_decoder.reset(new ma_decoder);
-    if (ma_decoder_init(wx_read_proc, wx_seek_proc, m_streamData.get(), &decoderConfig, m_decoder.get()) != MA_SUCCESS)
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, OUTPUT_CHANNELS, OUTPUT_RATE);
+    decoder.reset(new ma_decoder);
+    if (ma_decoder_init(wx_read_proc, wx_seek_proc, streamData.get(), &decoderConfig, decoder.get()) != MA_SUCCESS)
     {
-        m_decoder.reset();
-        m_streamData.reset();
-        return;
+        wxLogWarning(_("Failed to initialize decoder for file: %s"), location.c_str());
+        decoder.reset();
+        streamData.reset();
+        return false;
     }
 
-    // No need to set device callback or user data here; already set in initDevice().
-    // Just update m_decoder and the callback will use the new decoder.
+    return true;
 }
 
-void AudioSystem::stopSound()
+std::shared_ptr<AudioSystem::DecodedClip> AudioSystem::findClip(const wxString& location)
+{
+    std::map<wxString, cliplist_t::iterator>::iterator i = m_clipIndex.find(location);
+    if (i == m_clipIndex.end())
+        return std::shared_ptr<DecodedClip>();
+
+    // move to the front as the most recently used
+    m_clipCache.splice(m_clipCache.begin(), m_clipCache, i->second);
+    return *i->second;
+}
+
+void AudioSystem::cacheClip(const std::shared_ptr<DecodedClip>& clip)
 {
-    if (m_decoder)
+    m_clipCache.push_front(clip);
+    m_clipIndex[clip->location] = m_clipCache.begin();
+    m_clipCacheBytes += clip->samples.size() * sizeof(float);
+    trimClipCache();
+}
+
+void AudioSystem::trimClipCache()
+{
+    // voices hold their own reference, so evicting a playing clip is safe
+    while (m_clipCacheBytes > m_clipCacheBudget && m_clipCache.size() > 1)
     {
-        ma_decoder_uninit(m_decoder.get());
-        m_decoder.reset();
+        const std::shared_ptr<DecodedClip>& oldest = m_clipCache.back();
+        m_clipCacheBytes -= oldest->samples.size() * sizeof(float);
+        m_clipIndex.erase(oldest->location);
+        m_clipCache.pop_back();
     }
 }
 
+void AudioSystem::setClipCacheBudget(size_t bytes)
+{
+    m_clipCacheBudget = bytes;
+    trimClipCache();
+}
+
+void AudioSystem::clearClipCache()
+{
+    m_clipCache.clear();
+    m_clipIndex.clear();
+    m_clipCacheBytes = 0;
+}
+
 void AudioSystem::update()
 {
-    // No-op for now. Could be used for polling or cleanup if needed.
+    // the callback never touches a finished voice again, so reclaim directly
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (m_voices[i].state.load() == VOICE_DONE)
+            releaseVoice(i);
+    }
+
+    reportUnderruns();
+}
+
+void AudioSystem::reportUnderruns()
+{
+    uint32_t underruns = m_underruns.load(std::memory_order_relaxed);
+    if (underruns != m_reportedUnderruns)
+    {
+        wxLogWarning(_("Audio underrun while playing %s (%u total)"),
+            m_streamData ? m_streamData->location : wxString(), underruns);
+        m_reportedUnderruns = underruns;
+    }
 }
 
-void AudioSystem::getSoundMetadata(const wxString& location, uint32_t& sampleRate, uint32_t& channels)
+uint32_t AudioSystem::getUnderrunCount() const
 {
-    sampleRate = 0;
-    channels = 0;
+    return m_underruns.load(std::memory_order_relaxed);
+}
 
+bool AudioSystem::getSoundMetadata(const wxString& location, SoundMetadata& metadata)
+{
     // Open file via wxFileSystem (supports zip, etc)
     wxFileSystem fileSystem;
     std::unique_ptr<wxFSFile> fsFile(fileSystem.OpenFile(location));
     if (!fsFile)
     {
         wxLogWarning(_("Failed to open file: %s"), location.c_str());
-        return;
+        return false;
     }
 
-    std::unique_ptr<wxInputStream> stream(fsFile->DetachStream());
+    wxInputStream* stream = fsFile->GetStream();
     if (!stream)
     {
         wxLogWarning(_("Failed to open file: %s"), location.c_str());
-        return;
+        return false;
     }
 
-    m_streamData.reset(new StreamData());
-    m_streamData->stream = std::move(stream);
-    m_streamData->location = location;
+    wxMemoryOutputStream buffer;
+    stream->Read(buffer);
 
-    // Get the sound metadata
-    ma_decoder decoder;
-    if (ma_decoder_init(wx_read_proc, wx_seek_proc, m_streamData.get(), nullptr, &decoder) != MA_SUCCESS)
+    wxStreamBuffer* data = buffer.GetOutputStreamBuffer();
+    if (!decodeMetadata(data->GetBufferStart(), data->GetIntPosition(), metadata))
     {
         wxLogWarning(_("Failed to initialize decoder for file: %s"), location.c_str());
-        return;
+        return false;
     }
 
-    sampleRate = decoder.outputSampleRate;
-    channels = decoder.outputChannels;
+    return true;
+}
+
+bool AudioSystem::decodeMetadata(const void* data, size_t size, SoundMetadata& metadata)
+{
+    metadata = SoundMetadata();
+
+    // a null config keeps the source's native rate, channels and sample format
+    ma_decoder decoder;
+    if (ma_decoder_init_memory(data, size, nullptr, &decoder) != MA_SUCCESS)
+        return false;
+
+    ma_format sampleFormat = ma_format_unknown;
+    ma_uint32 channels = 0, sampleRate = 0;
+    ma_decoder_get_data_format(&decoder, &sampleFormat, &channels, &sampleRate, nullptr, 0);
+    metadata.sampleRate = sampleRate;
+    metadata.channels = channels;
+
+    ma_uint64 length = 0;
+    if (sampleRate > 0 && ma_decoder_get_length_in_pcm_frames(&decoder, &length) == MA_SUCCESS)
+        metadata.duration = (double)length / sampleRate;
+
     ma_decoder_uninit(&decoder);
-    m_streamData.reset();
+
+    // miniaudio doesn't report the container, so sniff it from the header
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    wxString container(wxT("MP3"));
+    if (size >= 4 && std::memcmp(bytes, "RIFF", 4) == 0)
+        container = wxT("WAV");
+    else if (size >= 4 && std::memcmp(bytes, "fLaC", 4) == 0)
+        container = wxT("FLAC");
+    else if (size >= 4 && std::memcmp(bytes, "OggS", 4) == 0)
+        container = wxT("OGG");
+
+    metadata.format = wxString::Format(wxT("%s %s"), container, ma_get_format_name(sampleFormat));
+    return true;
+}
+
+static inline int8_t quantizePeak(float value)
+{
+    float scaled = value * 127.0f;
+    scaled = scaled < -127.0f ? -127.0f : (scaled > 127.0f ? 127.0f : scaled);
+    return (int8_t)lrintf(scaled);
+}
+
+bool AudioSystem::computePeaks(const void* data, size_t size, SoundPeaks& peaks)
+{
+    peaks = SoundPeaks();
+
+    // mono mixdown at the native rate is all the envelope needs
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, 0);
+    ma_decoder decoder;
+    if (ma_decoder_init_memory(data, size, &config, &decoder) != MA_SUCCESS)
+        return false;
+
+    peaks.sampleRate = decoder.outputSampleRate;
+
+    // decode a whole number of buckets at a time so they never straddle reads
+    static const size_t PEAKS_PER_READ = 64;
+    std::vector<float> chunk(PEAKS_PER_READ * SoundPeaks::FRAMES_PER_PEAK);
+    std::vector<int8_t> base;
+
+    for (;;)
+    {
+        ma_uint64 framesRead = 0;
+        ma_decoder_read_pcm_frames(&decoder, chunk.data(), chunk.size(), &framesRead);
+        if (framesRead == 0)
+            break;
+
+        peaks.frameCount += framesRead;
+
+        for (size_t first = 0; first < framesRead; first += SoundPeaks::FRAMES_PER_PEAK)
+        {
+            size_t count = std::min<size_t>(SoundPeaks::FRAMES_PER_PEAK, (size_t)framesRead - first);
+            const float* samples = &chunk[first];
+
+            // branch-free reduction so the compiler can vectorize it
+            float low = samples[0], high = samples[0];
+            for (size_t i = 1; i < count; ++i)
+            {
+                low = samples[i] < low ? samples[i] : low;
+                high = samples[i] > high ? samples[i] : high;
+            }
+
+            base.push_back(quantizePeak(low));
+            base.push_back(quantizePeak(high));
+        }
+
+        if (framesRead < chunk.size())
+            break;
+    }
+
+    ma_decoder_uninit(&decoder);
+
+    if (base.empty())
+        return false;
+
+    peaks.levels.push_back(base);
+
+    // each level up merges neighbouring pairs of the one below
+    while (peaks.levels.back().size() / 2 > SoundPeaks::MIN_PEAKS)
+    {
+        const std::vector<int8_t>& below = peaks.levels.back();
+        size_t pairs = below.size() / 2;
+
+        std::vector<int8_t> level(((pairs + 1) / 2) * 2);
+        for (size_t i = 0; i < pairs / 2; ++i)
+        {
+            level[i * 2] = std::min(below[i * 4], below[i * 4 + 2]);
+            level[i * 2 + 1] = std::max(below[i * 4 + 1], below[i * 4 + 3]);
+        }
+
+        if (pairs & 1)
+        {
+            level[level.size() - 2] = below[below.size() - 2];
+            level[level.size() - 1] = below[below.size() - 1];
+        }
+
+        peaks.levels.push_back(level);
+    }
+
+    return true;
 }
@@ -7,40 +7,235 @@
 #pragma once
 
 #include <wx/string.h>
+
+#include <vector3d.h>
+
+#include <atomic>
+#include <list>
+#include <map>
 #include <memory>
+#include <thread>
+#include <vector>
 
 // Forward declaration for miniaudio types
 struct ma_device;
 struct ma_decoder;
 
+// Lock-free single-producer/single-consumer ring of interleaved PCM frames.
+// The decoder thread is the only writer and the device callback the only reader.
+class PcmRingBuffer
+{
+private:
+    std::vector<float> m_samples;
+    size_t m_channels;
+    size_t m_capacity; // in frames, always a power of two
+    std::atomic<size_t> m_readPos;
+    std::atomic<size_t> m_writePos;
+
+public:
+    PcmRingBuffer();
+
+    // Allocates storage for at least 'frames' frames. Not thread safe.
+    void allocate(size_t frames, size_t channels);
+
+    // Discards any buffered frames. Only call while neither side is active.
+    void reset();
+
+    size_t availableRead() const;
+    size_t availableWrite() const;
+
+    // Returns the number of frames actually transferred
+    size_t write(const float* frames, size_t frameCount);
+    size_t read(float* frames, size_t frameCount);
+};
+
+// Basic facts about a sound, as shown in the sound browser
+struct SoundMetadata
+{
+    uint32_t sampleRate;
+    uint32_t channels;
+    double duration; // seconds, 0 if unknown
+    wxString format; // container and sample format, e.g. "WAV s16"
+
+    SoundMetadata() : sampleRate(0), channels(0), duration(0.0) {}
+};
+
+// Multi-resolution min/max envelope of a sound, mixed down to mono. Level 0
+// holds one min/max pair per FRAMES_PER_PEAK frames and each level above it
+// halves the resolution, so a waveform can be drawn at any zoom cheaply.
+struct SoundPeaks
+{
+    enum
+    {
+        FRAMES_PER_PEAK = 256,
+        MIN_PEAKS = 64, // stop building levels below this many pairs
+    };
+
+    uint32_t sampleRate;
+    uint64_t frameCount;
+    std::vector<std::vector<int8_t>> levels; // interleaved min, max scaled to +-127
+
+    SoundPeaks() : sampleRate(0), frameCount(0) {}
+};
+
 class AudioSystem
 {
 public:
     struct StreamData;
-    std::unique_ptr<ma_decoder> m_decoder;
+
+    // A short sound decoded up front into the output format
+    struct DecodedClip
+    {
+        wxString location;
+        std::vector<float> samples; // interleaved stereo
+        size_t frameCount;
+    };
+
+    enum
+    {
+        MAX_VOICES = 16
+    };
 
 private:
+    enum VoiceState
+    {
+        VOICE_FREE = 0,  // owned by the UI thread
+        VOICE_PLAYING,   // being mixed by the device callback
+        VOICE_STOPPING,  // UI thread asked the callback to let go
+        VOICE_DONE,      // callback reached the end, waiting to be reclaimed
+    };
+
+    struct Voice
+    {
+        std::atomic<int> state;
+
+        // read by the callback while playing, only written while free
+        bool streamed;
+        const float* samples;
+        size_t frameCount;
+        size_t cursor;
+
+        // effective per-channel gain, written by the UI thread at any time
+        std::atomic<float> gainLeft;
+        std::atomic<float> gainRight;
+
+        // UI thread only
+        uint32_t generation;
+        float gain;
+        float pan;
+        bool spatial;
+        irr::core::vector3df position;
+        std::shared_ptr<DecodedClip> clip; // keeps 'samples' alive
+    };
+
     ma_device* m_device;
-    std::unique_ptr<StreamData> m_streamData;
     bool m_initialized;
 
+    Voice m_voices[MAX_VOICES];
+    std::atomic<bool> m_inCallback;
+
+    // slot of the single streamed voice, for sounds too long to keep decoded
+    int m_streamVoice;
+    std::unique_ptr<ma_decoder> m_decoder;
+    std::unique_ptr<StreamData> m_streamData;
+    PcmRingBuffer m_ring;
+    std::vector<float> m_streamScratch;
+    std::thread m_decodeThread;
+    std::atomic<bool> m_stopDecoding;
+    std::atomic<bool> m_decodeFinished;
+    std::atomic<uint32_t> m_underruns;
+    uint32_t m_reportedUnderruns;
+
+    // LRU cache of decoded clips, most recently used at the front
+    typedef std::list<std::shared_ptr<DecodedClip>> cliplist_t;
+    cliplist_t m_clipCache;
+    std::map<wxString, cliplist_t::iterator> m_clipIndex;
+    size_t m_clipCacheBytes;
+    size_t m_clipCacheBudget;
+
+    // 3D preview
+    bool m_spatialPreview;
+    irr::core::vector3df m_listenerPosition;
+    irr::core::vector3df m_listenerRight;
+    float m_minDistance;
+    float m_maxDistance;
+
 public:
     AudioSystem();
     ~AudioSystem();
 
     // Plays a sound from the given wxFileSystem location (can be in zip or on disk)
-    void playSound(const wxString& location);
+    // alongside anything already playing. Returns a voice handle, or -1 on failure.
+    int playSound(const wxString& location, float gain = 1.0f, float pan = 0.0f);
+
+    // Plays a sound positioned in the map; it's only attenuated while 3D preview is on
+    int playSoundAt(const wxString& location, const irr::core::vector3df& position, float gain = 1.0f);
+
+    // Stops a single voice
+    void stopVoice(int voice);
 
-    // Stops the currently playing sound
+    // Stops every playing voice
     void stopSound();
 
-    // Optional: call to update audio system if needed
+    bool isPlaying(int voice) const;
+
+    void setVoiceGain(int voice, float gain);
+    void setVoicePan(int voice, float pan); // -1 (left) to 1 (right)
+    void setVoicePosition(int voice, const irr::core::vector3df& position);
+
+    // Listener for the 3D preview, normally the 3D view camera
+    void setListener(const irr::core::vector3df& position, const irr::core::vector3df& target,
+        const irr::core::vector3df& up);
+    void setSpatialPreview(bool enable);
+    bool isSpatialPreview() const;
+    void setAttenuationRange(float minDistance, float maxDistance);
+
+    // Decoded clip cache budget in bytes
+    void setClipCacheBudget(size_t bytes);
+    void clearClipCache();
+
+    // Reclaims finished voices and reports underruns; call periodically from the UI thread
     void update();
 
+    // Number of callback periods the streamed voice ran dry since it started
+    uint32_t getUnderrunCount() const;
+
     // Get the sound metadata
-    void getSoundMetadata(const wxString& location, uint32_t& sampleRate, uint32_t& channels);
+    bool getSoundMetadata(const wxString& location, SoundMetadata& metadata);
+
+    // Reads metadata from an encoded sound already in memory. Uses its own
+    // decoder, so it's safe to call from any thread.
+    static bool decodeMetadata(const void* data, size_t size, SoundMetadata& metadata);
+
+    // Decodes an encoded sound in memory and builds its peak pyramid. Can be
+    // slow for long sounds, so run it off the UI thread.
+    static bool computePeaks(const void* data, size_t size, SoundPeaks& peaks);
 
 private:
     void initDevice();
     void shutdownDevice();
+
+    int startVoice(const wxString& location, float gain, float pan, bool spatial,
+        const irr::core::vector3df& position);
+    int findFreeVoice() const;
+    int voiceIndex(int voice) const;
+    void releaseVoice(int index);
+    void stopIndex(int index);
+    void waitForCallback();
+    void updateVoiceGain(Voice& voice);
+    void reportUnderruns();
+
+    bool openStream(const wxString& location, std::unique_ptr<StreamData>& streamData,
+        std::unique_ptr<ma_decoder>& decoder);
+    std::shared_ptr<DecodedClip> findClip(const wxString& location);
+    void cacheClip(const std::shared_ptr<DecodedClip>& clip);
+    void trimClipCache();
+
+    // Decoder thread entry, keeps the ring buffer topped up
+    void decodeLoop();
+
+    // Device callback body, mixes voices without allocating or blocking
+    void mix(float* output, uint32_t frameCount);
+
+    static void dataCallback(ma_device* pDevice, void* pOutput, const void* pInput, uint32_t frameCount);
 };
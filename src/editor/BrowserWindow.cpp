@@ -9,10 +9,12 @@
 #include "Component.hpp"
 #include "Convert.hpp"
 #include "FSHandler.hpp"
+#include "MappedFile.hpp"
 
 #include <wx/artprov.h>
 #include <wx/busyinfo.h>
 #include <wx/choicdlg.h>
+#include <wx/dcbuffer.h>
 #include <wx/dcclient.h>
 #include <wx/filedlg.h>
 #include <wx/filefn.h>
@@ -22,11 +24,15 @@
 #include <wx/msgdlg.h>
 #include <wx/mstream.h>
 #include <wx/propgrid/propgrid.h>
+#include <wx/settings.h>
 #include <wx/sizer.h>
 #include <wx/sstream.h>
 #include <wx/wfstream.h>
 #include <wx/zipstrm.h>
 
+#include <algorithm>
+#include <functional>
+
 BrowserWindow::packagelist_t BrowserWindow::ms_Packages;
 BrowserWindow::definitionlist_t BrowserWindow::ms_Definitions;
 
@@ -107,6 +113,11 @@ wxString BrowserWindow::GetActorDefinition(const wxString& name)
 	return m_Actors->GetDefinition(name);
 }
 
+std::shared_ptr<const ActorTemplate> BrowserWindow::GetActorTemplate(const wxString& name)
+{
+	return m_Actors->GetTemplate(name);
+}
+
 const wxString& BrowserWindow::GetMesh(void)
 {
 	return m_Meshes->GetSelection();
@@ -117,6 +128,16 @@ const wxString& BrowserWindow::GetMeshDefinition(void)
 	return m_Meshes->GetDefinition();
 }
 
+const wxString& BrowserWindow::GetSound(void)
+{
+	return m_Sounds->GetSelection();
+}
+
+std::shared_ptr<AudioSystem> BrowserWindow::GetAudioSystem(void)
+{
+	return m_Sounds->GetAudioSystem();
+}
+
 void BrowserWindow::AddPackage(const wxString& path)
 {
 	for (packagelist_t::iterator i = ms_Packages.begin();
@@ -595,22 +616,29 @@ public:
 	}
 };
 
+// the XML kept for editing an actor definition
+static wxString ActorDefinitionText(const wxXmlNode* actor)
+{
+	wxXmlDocument doc;
+	doc.SetRoot(new wxXmlNode(*actor));
+	wxStringOutputStream stream;
+	doc.Save(stream);
+	return stream.GetString();
+}
+
 class ActorItemData : public wxTreeItemData
 {
 public:
 	wxString Definition;
+	std::shared_ptr<ActorTemplate> Template;
 	wxString SourceFile;
 	bool FromPackage;
 
 public:
-	ActorItemData(wxXmlNode* actor, const wxString& sourceFile, bool fromPackage)
-		: SourceFile(sourceFile), FromPackage(fromPackage)
+	ActorItemData(const wxString& definition, const std::shared_ptr<ActorTemplate>& actor,
+		const wxString& sourceFile, bool fromPackage)
+		: Definition(definition), Template(actor), SourceFile(sourceFile), FromPackage(fromPackage)
 	{
-		wxXmlDocument doc;
-		doc.SetRoot(new wxXmlNode(*actor));
-		wxStringOutputStream stream;
-		doc.Save(stream);
-		Definition = stream.GetString();
 	}
 
 	~ActorItemData(void)
@@ -986,6 +1014,9 @@ public:
 ActorBrowser::ActorBrowser(wxWindow* parent)
 	: wxPanel(parent)
 {
+	m_DefinitionCache.reset(new DefinitionCache(CacheFileName(wxT("definitions.cache"))));
+	m_DefinitionCache->Load();
+
 	// create the toolbar
 	wxToolBar* tools = new wxToolBar(this, wxID_ANY, wxDefaultPosition,
 		wxDefaultSize, wxTB_FLAT | wxTB_HORIZONTAL);
@@ -1033,6 +1064,7 @@ ActorBrowser::ActorBrowser(wxWindow* parent)
 
 ActorBrowser::~ActorBrowser(void)
 {
+	m_DefinitionCache.reset();
 }
 
 const wxString& ActorBrowser::GetSelection(void)
@@ -1053,6 +1085,19 @@ wxString ActorBrowser::GetDefinition(const wxString& name)
 	return wxEmptyString;
 }
 
+std::shared_ptr<const ActorTemplate> ActorBrowser::GetTemplate(const wxString& name)
+{
+	wxTreeItemId actorId = FindItem(name, m_Root);
+	if (actorId.IsOk())
+	{
+		ActorItemData* data = dynamic_cast<ActorItemData*>(m_Tree->GetItemData(actorId));
+		if (data)
+			return data->Template;
+	}
+
+	return nullptr;
+}
+
 bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 {
 	if (!preload)
@@ -1078,6 +1123,17 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 		if (!preload)
 			BrowserWindow::ms_Packages.push_back(path);
 
+		// the compiled definitions are reused until the package changes
+		wxInt64 modified = (wxInt64)wxFileModificationTime(path);
+		const DefinitionCache::recordlist_t* cached = m_DefinitionCache->Find(path, modified);
+		if (cached)
+		{
+			AddCachedDefinitions(*cached, path, true);
+			return true;
+		}
+
+		DefinitionCache::recordlist_t records;
+
 		wxZipEntry* entry = zipStream.GetNextEntry();
 		while (entry)
 		{
@@ -1086,13 +1142,6 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 			// find all the actor files in the package
 			if (entryPath.GetExt().CmpNoCase(wxT("actor")) == 0)
 			{
-				wxString packagePath(path);
-				if (wxFileName(packagePath).GetExt().CmpNoCase(wxT("zip")) == 0)
-					packagePath.Append(wxT("#zip:"));
-				else if (wxFileName(packagePath).GetExt().CmpNoCase(wxT("mpk")) == 0)
-					packagePath.Append(wxT(":"));
-				packagePath.append(entryPath.GetFullPath());
-
 				wxStringOutputStream stream;
 				zipStream.Read(stream);
 				if (stream.IsOk())
@@ -1102,7 +1151,13 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 					if (doc.IsOk() &&
 						doc.GetRoot()->GetName().CompareTo(wxT("actor"), wxString::ignoreCase) == 0)
 					{
-						AddActor(doc, path, true);
+						DefinitionCache::Record record;
+						record.IsActor = true;
+						record.Actor.reset(new ActorTemplate);
+						record.Actor->Compile(doc.GetRoot());
+						record.Name = record.Actor->Name;
+						record.Definition = ActorDefinitionText(doc.GetRoot());
+						records.push_back(record);
 					}
 					else
 						wxLogWarning(_("Invalid actor definition file: %s"), entryPath.GetFullPath());
@@ -1111,13 +1166,6 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 			else if (entryPath.GetExt().CmpNoCase(wxT("component")) == 0)
 			{
 				// we process components here as well
-				wxString packagePath(path);
-				if (wxFileName(packagePath).GetExt().CmpNoCase(wxT("zip")) == 0)
-					packagePath.Append(wxT("#zip:"));
-				else if (wxFileName(packagePath).GetExt().CmpNoCase(wxT("mpk")) == 0)
-					packagePath.Append(wxT(":"));
-				packagePath.append(entryPath.GetFullPath());
-
 				wxStringOutputStream stream;
 				zipStream.Read(stream);
 				if (stream.IsOk())
@@ -1127,7 +1175,10 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 					if (doc.IsOk() &&
 						doc.GetRoot()->GetName().CompareTo(wxT("component"), wxString::ignoreCase) == 0)
 					{
-						ComponentFactory::RegisterComponent(doc.GetRoot()->GetAttribute(wxT("name")), doc);
+						DefinitionCache::Record record;
+						record.Name = doc.GetRoot()->GetAttribute(wxT("name"));
+						record.Component.AddChildren(doc.GetRoot());
+						records.push_back(record);
 					}
 					else
 						wxLogWarning(_("Invalid component definition file: %s"), entryPath.GetFullPath());
@@ -1137,6 +1188,9 @@ bool ActorBrowser::LoadPackage(const wxString& path, bool preload)
 			entry->UnRef();
 			entry = zipStream.GetNextEntry();
 		}
+
+		m_DefinitionCache->Store(path, modified, records);
+		AddCachedDefinitions(records, path, true);
 	}
 
 	return true;
@@ -1155,6 +1209,16 @@ bool ActorBrowser::LoadDefinition(const wxString& path, bool preload)
 	}
 
 	wxFileName fn(path);
+	wxInt64 modified = (wxInt64)wxFileModificationTime(fn.GetFullPath());
+	const DefinitionCache::recordlist_t* cached = m_DefinitionCache->Find(fn.GetFullPath(), modified);
+	if (cached)
+	{
+		AddCachedDefinitions(*cached, path, false);
+		if (!preload)
+			BrowserWindow::ms_Definitions.push_back(path);
+		return true;
+	}
+
 	wxXmlDocument doc;
 	if (!doc.Load(fn.GetFullPath()))
 	{
@@ -1162,19 +1226,29 @@ bool ActorBrowser::LoadDefinition(const wxString& path, bool preload)
 		return false;
 	}
 
+	DefinitionCache::Record record;
 	if (fn.GetExt().CmpNoCase(wxT("actor")) == 0 &&
 		doc.GetRoot()->GetName().CompareTo(wxT("actor"), wxString::ignoreCase) == 0)
 	{
-		AddActor(doc, path, false);
+		record.IsActor = true;
+		record.Actor.reset(new ActorTemplate);
+		record.Actor->Compile(doc.GetRoot());
+		record.Name = record.Actor->Name;
+		record.Definition = ActorDefinitionText(doc.GetRoot());
 	}
 	else if (fn.GetExt().CmpNoCase(wxT("component")) == 0 &&
 		doc.GetRoot()->GetName().CompareTo(wxT("component"), wxString::ignoreCase) == 0)
 	{
-		ComponentFactory::RegisterComponent(doc.GetRoot()->GetAttribute(wxT("name")), doc);
+		record.Name = doc.GetRoot()->GetAttribute(wxT("name"));
+		record.Component.AddChildren(doc.GetRoot());
 	}
 	else
 		return true; // we don't process this file
 
+	DefinitionCache::recordlist_t records(1, record);
+	m_DefinitionCache->Store(fn.GetFullPath(), modified, records);
+	AddCachedDefinitions(records, path, false);
+
 	if (!preload)
 		BrowserWindow::ms_Definitions.push_back(path);
 
@@ -1314,46 +1388,65 @@ void ActorBrowser::AddActor(const wxXmlDocument& definition, const wxString& sou
 	wxXmlNode* actor = definition.GetRoot();
 	if (actor->GetName().CompareTo(wxT("actor"), wxString::ignoreCase) == 0)
 	{
-		wxString category = actor->GetAttribute(wxT("category"));
-		wxTreeItemId categoryId = FindItem(category, m_Root);
-		if (!categoryId.IsOk())
-		{
-			m_Categories.Add(category);
-			categoryId = m_Tree->AppendItem(m_Root, category);
-			m_Tree->SortChildren(m_Root);
-		}
+		std::shared_ptr<ActorTemplate> compiled(new ActorTemplate);
+		compiled->Compile(actor);
+		AddActor(compiled, ActorDefinitionText(actor), sourceFile, fromPackage);
+	}
+}
 
-		// try to find the actor first, maybe it already exists and we are updating it
-		wxString name = actor->GetAttribute(wxT("name"));
-		wxTreeItemId actorId = FindItem(name, categoryId);
-		if (actorId.IsOk())
+void ActorBrowser::AddActor(const std::shared_ptr<ActorTemplate>& actor, const wxString& definition,
+	const wxString& sourceFile, bool fromPackage)
+{
+	wxString category = actor->Category;
+	wxTreeItemId categoryId = FindItem(category, m_Root);
+	if (!categoryId.IsOk())
+	{
+		m_Categories.Add(category);
+		categoryId = m_Tree->AppendItem(m_Root, category);
+		m_Tree->SortChildren(m_Root);
+	}
+
+	// try to find the actor first, maybe it already exists and we are updating it
+	wxString name = actor->Name;
+	wxTreeItemId actorId = FindItem(name, categoryId);
+	if (actorId.IsOk())
+	{
+		// updating
+		ActorItemData* data = dynamic_cast<ActorItemData*>(m_Tree->GetItemData(actorId));
+		if (data)
 		{
-			// updating
-			ActorItemData* data = dynamic_cast<ActorItemData*>(m_Tree->GetItemData(actorId));
-			if (data)
-			{
-				wxStringOutputStream stream;
-				definition.Save(stream);
-				data->Definition = stream.GetString();
-				data->SourceFile = sourceFile;
-				data->FromPackage = fromPackage;
-			}
-			else
-				m_Tree->SetItemData(actorId, new ActorItemData(actor, sourceFile, fromPackage));
-			
-			// append an asterisk to the name to indicate that it has been modified
-			m_Tree->SetItemText(actorId, name + wxT("*"));
-			m_Tree->EnsureVisible(actorId);
+			data->Definition = definition;
+			data->Template = actor;
+			data->SourceFile = sourceFile;
+			data->FromPackage = fromPackage;
 		}
 		else
-		{
-			actorId = m_Tree->AppendItem(categoryId, name);
-			m_Tree->SetItemData(actorId, new ActorItemData(actor, sourceFile, fromPackage));
-			m_Tree->EnsureVisible(actorId);
+			m_Tree->SetItemData(actorId, new ActorItemData(definition, actor, sourceFile, fromPackage));
+		
+		// append an asterisk to the name to indicate that it has been modified
+		m_Tree->SetItemText(actorId, name + wxT("*"));
+		m_Tree->EnsureVisible(actorId);
+	}
+	else
+	{
+		actorId = m_Tree->AppendItem(categoryId, name);
+		m_Tree->SetItemData(actorId, new ActorItemData(definition, actor, sourceFile, fromPackage));
+		m_Tree->EnsureVisible(actorId);
 
-			m_ItemPaths[actorId] = sourceFile;
-			BrowserWindow::ms_Definitions.push_back(sourceFile);
-		}
+		m_ItemPaths[actorId] = sourceFile;
+		BrowserWindow::ms_Definitions.push_back(sourceFile);
+	}
+}
+
+void ActorBrowser::AddCachedDefinitions(const DefinitionCache::recordlist_t& records,
+	const wxString& sourceFile, bool fromPackage)
+{
+	for (DefinitionCache::recordlist_t::const_iterator i = records.begin(); i != records.end(); ++i)
+	{
+		if (i->IsActor)
+			AddActor(i->Actor, i->Definition, sourceFile, fromPackage);
+		else
+			ComponentFactory::RegisterComponent(i->Name, i->Component);
 	}
 }
 
@@ -1380,9 +1473,228 @@ wxTreeItemId ActorBrowser::FindItem(const wxString& name, wxTreeItemId& start)
 	return wxTreeItemId(); // not found
 }
 
+// support archives made on any platform
+static bool IsSoundEntry(const wxString& entryPath)
+{
+	return entryPath.StartsWith(wxT("sounds/")) ||
+		entryPath.StartsWith(wxT("sounds\\")) ||
+		entryPath.StartsWith(wxT("music/")) ||
+		entryPath.StartsWith(wxT("music\\"));
+}
+
+// Reads a whole package entry, or a loose file when entry is empty. Safe on any thread.
+static bool ReadSoundData(const wxString& package, const wxString& entry, wxMemoryOutputStream& buffer)
+{
+	wxFileInputStream inStream(package);
+	if (!inStream.IsOk())
+		return false;
+
+	if (entry.empty())
+	{
+		inStream.Read(buffer);
+		return buffer.GetLength() > 0;
+	}
+
+	wxZipInputStream zipStream(inStream);
+	if (!zipStream.IsOk())
+		return false;
+
+	bool found = false;
+	wxZipEntry* zipEntry = zipStream.GetNextEntry();
+	while (zipEntry && !found)
+	{
+		if (zipEntry->GetName() == entry)
+		{
+			zipStream.Read(buffer);
+			found = true;
+		}
+
+		delete zipEntry;
+		zipEntry = found ? nullptr : zipStream.GetNextEntry();
+	}
+
+	delete zipEntry;
+	return found && buffer.GetLength() > 0;
+}
+
+WaveformView::WaveformView(wxWindow* parent)
+	: wxPanel(parent, wxID_ANY, wxDefaultPosition, wxSize(-1, 96), wxBORDER_SUNKEN),
+	m_Zoom(1.0), m_FirstFrame(0.0), m_DragX(-1)
+{
+	SetBackgroundStyle(wxBG_STYLE_PAINT);
+
+	Bind(wxEVT_PAINT, &WaveformView::OnPaint, this);
+	Bind(wxEVT_SIZE, &WaveformView::OnSize, this);
+	Bind(wxEVT_MOUSEWHEEL, &WaveformView::OnMouseWheel, this);
+	Bind(wxEVT_LEFT_DOWN, &WaveformView::OnLeftDown, this);
+	Bind(wxEVT_LEFT_UP, &WaveformView::OnLeftUp, this);
+	Bind(wxEVT_MOTION, &WaveformView::OnMotion, this);
+	Bind(wxEVT_LEFT_DCLICK, &WaveformView::OnLeftDClick, this);
+}
+
+void WaveformView::SetPeaks(const std::shared_ptr<SoundPeaks>& peaks)
+{
+	m_Peaks = peaks;
+	m_Message.clear();
+	m_Zoom = 1.0;
+	m_FirstFrame = 0.0;
+	Refresh();
+}
+
+void WaveformView::SetMessage(const wxString& message)
+{
+	m_Peaks.reset();
+	m_Message = message;
+	Refresh();
+}
+
+double WaveformView::GetFramesPerPixel(void) const
+{
+	int width = std::max(GetClientSize().GetWidth(), 1);
+	return (double)m_Peaks->frameCount / m_Zoom / width;
+}
+
+void WaveformView::ClampView(void)
+{
+	if (!m_Peaks)
+		return;
+
+	// no point zooming in past a handful of level 0 peaks across the view
+	int width = std::max(GetClientSize().GetWidth(), 1);
+	double maxZoom = (double)m_Peaks->frameCount / (width * (SoundPeaks::FRAMES_PER_PEAK / 8.0));
+	m_Zoom = std::max(1.0, std::min(m_Zoom, std::max(maxZoom, 1.0)));
+
+	double visible = (double)m_Peaks->frameCount / m_Zoom;
+	m_FirstFrame = std::max(0.0, std::min(m_FirstFrame, (double)m_Peaks->frameCount - visible));
+}
+
+void WaveformView::OnPaint(wxPaintEvent& event)
+{
+	wxAutoBufferedPaintDC dc(this);
+	dc.SetBackground(wxBrush(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW)));
+	dc.Clear();
+
+	wxSize size(GetClientSize());
+	int middle = size.GetHeight() / 2;
+
+	if (!m_Peaks || m_Peaks->frameCount == 0 || m_Peaks->levels.empty())
+	{
+		if (!m_Message.empty())
+		{
+			dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_GRAYTEXT));
+			wxSize extent(dc.GetTextExtent(m_Message));
+			dc.DrawText(m_Message, (size.GetWidth() - extent.GetWidth()) / 2,
+				middle - extent.GetHeight() / 2);
+		}
+
+		return;
+	}
+
+	// coarsest level that still has at least one peak per pixel
+	double framesPerPixel = GetFramesPerPixel();
+	size_t level = 0;
+	while (level + 1 < m_Peaks->levels.size() &&
+		((double)SoundPeaks::FRAMES_PER_PEAK * (2u << level)) <= framesPerPixel)
+		++level;
+
+	const std::vector<int8_t>& peaks = m_Peaks->levels[level];
+	size_t peakCount = peaks.size() / 2;
+	double framesPerPeak = (double)SoundPeaks::FRAMES_PER_PEAK * (1u << level);
+	double scale = (middle - 1) / 127.0;
+
+	dc.SetPen(wxPen(wxSystemSettings::GetColour(wxSYS_COLOUR_BTNSHADOW)));
+	dc.DrawLine(0, middle, size.GetWidth(), middle);
+
+	dc.SetPen(wxPen(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHT)));
+	for (int x = 0; x < size.GetWidth(); ++x)
+	{
+		double start = m_FirstFrame + x * framesPerPixel;
+		size_t first = (size_t)(start / framesPerPeak);
+		size_t last = std::max(first + 1, (size_t)((start + framesPerPixel) / framesPerPeak));
+		if (first >= peakCount)
+			break;
+		last = std::min(last, peakCount);
+
+		int8_t low = peaks[first * 2];
+		int8_t high = peaks[first * 2 + 1];
+		for (size_t i = first + 1; i < last; ++i)
+		{
+			low = std::min(low, peaks[i * 2]);
+			high = std::max(high, peaks[i * 2 + 1]);
+		}
+
+		dc.DrawLine(x, middle - (int)(high * scale), x, middle - (int)(low * scale) + 1);
+	}
+
+	if (m_Peaks->sampleRate > 0)
+	{
+		double seconds = framesPerPixel * size.GetWidth() / m_Peaks->sampleRate;
+		dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_GRAYTEXT));
+		dc.DrawText(wxString::Format(_("%.2fs"), seconds), 2, 0);
+	}
+}
+
+void WaveformView::OnSize(wxSizeEvent& event)
+{
+	ClampView();
+	Refresh();
+	event.Skip();
+}
+
+void WaveformView::OnMouseWheel(wxMouseEvent& event)
+{
+	if (!m_Peaks)
+		return;
+
+	// keep the frame under the cursor where it is
+	double anchor = m_FirstFrame + event.GetX() * GetFramesPerPixel();
+	m_Zoom *= event.GetWheelRotation() > 0 ? 1.25 : 0.8;
+	ClampView();
+
+	m_FirstFrame = anchor - event.GetX() * GetFramesPerPixel();
+	ClampView();
+	Refresh();
+}
+
+void WaveformView::OnLeftDown(wxMouseEvent& event)
+{
+	m_DragX = event.GetX();
+	CaptureMouse();
+}
+
+void WaveformView::OnLeftUp(wxMouseEvent& event)
+{
+	m_DragX = -1;
+	if (HasCapture())
+		ReleaseMouse();
+}
+
+void WaveformView::OnMotion(wxMouseEvent& event)
+{
+	if (m_DragX < 0 || !m_Peaks || !event.LeftIsDown())
+		return;
+
+	m_FirstFrame -= (event.GetX() - m_DragX) * GetFramesPerPixel();
+	m_DragX = event.GetX();
+	ClampView();
+	Refresh();
+}
+
+void WaveformView::OnLeftDClick(wxMouseEvent& event)
+{
+	m_Zoom = 1.0;
+	m_FirstFrame = 0.0;
+	Refresh();
+}
+
 SoundBrowser::SoundBrowser(wxWindow* parent)
-	: wxPanel(parent)
+	: wxPanel(parent), m_ScanGeneration(0), m_PendingScans(0)
 {
+	m_MetadataCache.reset(new SoundMetadataCache(CacheFileName(wxT("sounds.cache"))));
+	m_MetadataCache->Load();
+	m_PeakCache.reset(new SoundPeakCache(wxT("peaks")));
+	m_Workers.reset(new WorkerPool);
+
 	wxFileSystem fs;
 
 	// create the toolbar
@@ -1419,11 +1731,16 @@ SoundBrowser::SoundBrowser(wxWindow* parent)
 	m_List->AppendColumn(_("Type"));
 	m_List->AppendColumn(_("Channels"));
 	m_List->AppendColumn(_("Frequency"));
+	m_List->AppendColumn(_("Duration"));
+	m_List->AppendColumn(_("Format"));
 	m_List->AppendColumn(_("Package"));
 
+	m_Waveform = new WaveformView(this);
+
 	wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 	sizer->Add(tools, wxSizerFlags(1).Expand());
 	sizer->Add(m_List, wxSizerFlags(9).Expand());
+	sizer->Add(m_Waveform, wxSizerFlags(3).Expand());
 	this->SetSizerAndFit(sizer);
 
 	Bind(wxEVT_MENU, &SoundBrowser::OnToolAdd, this, wxID_NEW);
@@ -1432,10 +1749,15 @@ SoundBrowser::SoundBrowser(wxWindow* parent)
 	Bind(wxEVT_MENU, &SoundBrowser::OnToolStop, this, MENU_STOPSOUND);
 	Bind(wxEVT_MENU, &SoundBrowser::OnToolRefresh, this, wxID_REFRESH);
 	m_List->Bind(wxEVT_LIST_ITEM_ACTIVATED, &SoundBrowser::OnItemActivate, this);
+	m_List->Bind(wxEVT_LIST_ITEM_SELECTED, &SoundBrowser::OnItemSelected, this);
 }
 
 SoundBrowser::~SoundBrowser(void)
 {
+	// let running jobs bail out early, then wait for the workers
+	++m_ScanGeneration;
+	m_Workers.reset();
+	m_MetadataCache.reset();
 }
 
 void SoundBrowser::SetAudioSystem(std::shared_ptr<AudioSystem>& audioSystem)
@@ -1455,6 +1777,16 @@ void SoundBrowser::SetAudioSystem(std::shared_ptr<AudioSystem>& audioSystem)
 	}
 }
 
+std::shared_ptr<AudioSystem> SoundBrowser::GetAudioSystem(void)
+{
+	return m_AudioSystem;
+}
+
+const wxString& SoundBrowser::GetSelection(void)
+{
+	return m_Selection;
+}
+
 bool SoundBrowser::LoadPackage(const wxString& path, bool preload)
 {
 	if (!preload)
@@ -1478,19 +1810,24 @@ bool SoundBrowser::LoadPackage(const wxString& path, bool preload)
 			return false;
 		}
 
+		wxString package(_path.GetFullPath());
+		wxInt64 modified = SoundMetadataCache::GetModified(package);
+
+		// anything not in the cache is read on the worker pool afterwards
+		std::vector<ScanTarget> targets;
+		long ordinal = 0;
+
+		m_List->Freeze();
+
 		wxZipEntry* entry = zipStream.GetNextEntry();
 		while (entry)
 		{
 			wxString entryPath(entry->GetName());
 
-			// support archives made on any platform
-			if (entryPath.StartsWith(wxT("sounds/")) ||
-				entryPath.StartsWith(wxT("sounds\\")) ||
-				entryPath.StartsWith(wxT("music/")) ||
-				entryPath.StartsWith(wxT("music\\")))
+			if (IsSoundEntry(entryPath))
 			{
 				// build the full path
-				wxString sndPath(_path.GetFullPath());
+				wxString sndPath(package);
 				if (_path.GetExt().CmpNoCase(wxT("zip")) == 0)
 					sndPath.append(wxT("#zip"));
 				// else if (path.GetExt().CmpNoCase(wxT("mpk")) == 0)
@@ -1503,6 +1840,8 @@ bool SoundBrowser::LoadPackage(const wxString& path, bool preload)
 				long index = m_List->InsertItem(m_List->GetItemCount(), entry->GetName());
 				m_List->SetItemData(index, -1);
 				m_ItemPaths[index] = sndPath;
+				m_ItemSources[index].package = package;
+				m_ItemSources[index].entry = entryPath;
 
 				wxFileName fn(entry->GetName());
 				wxFileType* mimeType = wxTheMimeTypesManager->GetFileTypeFromExtension(fn.GetExt());
@@ -1519,22 +1858,234 @@ bool SoundBrowser::LoadPackage(const wxString& path, bool preload)
 				else
 					m_List->SetItem(index, COL_TYPE, _("Unknown"));
 
-				// get the meta data for the item
-				uint32_t sampleRate, channels;
-				m_AudioSystem->getSoundMetadata(sndPath, sampleRate, channels);
-				m_List->SetItem(index, COL_CHANNELS, wxString::Format(_("%d"), channels));
-				m_List->SetItem(index, COL_FREQ, wxString::Format(_("%d"), sampleRate));
-				m_List->SetItem(index, COL_PACKAGE, _path.GetFullPath());
+				m_List->SetItem(index, COL_PACKAGE, package);
+
+				SoundMetadata metadata;
+				if (m_MetadataCache->Find(package, entryPath, modified, metadata))
+					SetItemMetadata(index, metadata);
+				else
+				{
+					ScanTarget target;
+					target.ordinal = ordinal;
+					target.index = index;
+					targets.push_back(target);
+				}
+
+				++ordinal;
 			}
 
-			entry->UnRef();
+			delete entry;
 			entry = zipStream.GetNextEntry();
 		}
+
+		m_List->Thaw();
+
+		ScanPackage(package, modified, targets);
 	}
 
 	return true;
 }
 
+void SoundBrowser::ScanPackage(const wxString& package, wxInt64 modified,
+	const std::vector<ScanTarget>& targets)
+{
+	if (targets.empty())
+		return;
+
+	// contiguous runs, a couple per worker so a slow run doesn't hold up the rest
+	size_t jobCount = std::min(targets.size(), m_Workers->GetThreadCount() * 2);
+	size_t perJob = (targets.size() + jobCount - 1) / jobCount;
+
+	for (size_t first = 0; first < targets.size(); first += perJob)
+	{
+		size_t last = std::min(first + perJob, targets.size());
+		std::vector<ScanTarget> batch(targets.begin() + first, targets.begin() + last);
+
+		++m_PendingScans;
+		m_Workers->Submit(std::bind(&SoundBrowser::ScanJob, this, package, modified,
+			m_ScanGeneration.load(), batch));
+	}
+}
+
+void SoundBrowser::ScanJob(const wxString& package, wxInt64 modified, int generation,
+	const std::vector<ScanTarget>& targets)
+{
+	// runs on a worker; every job has its own package stream and decoder
+	static const size_t RESULTS_PER_POST = 32;
+
+	std::vector<ScanResult> results;
+
+	// stored entries are decoded in place instead of being read out of the stream
+	std::shared_ptr<MappedArchive> archive = MappedArchive::Open(package);
+
+	wxFileInputStream inStream(package);
+	wxZipInputStream zipStream(inStream);
+	if (inStream.IsOk() && zipStream.IsOk())
+	{
+		long ordinal = 0;
+		size_t next = 0;
+
+		wxZipEntry* entry = zipStream.GetNextEntry();
+		while (entry && next < targets.size() && m_ScanGeneration.load() == generation)
+		{
+			if (IsSoundEntry(entry->GetName()))
+			{
+				if (ordinal == targets[next].ordinal)
+				{
+					ScanResult result;
+					result.index = targets[next].index;
+					result.entry = entry->GetName();
+
+					// a failed decode is cached too, so it isn't retried every time
+					size_t size = 0;
+					const irr::u8* mapped = archive ? archive->Find(result.entry, size) : nullptr;
+					if (mapped)
+						AudioSystem::decodeMetadata(mapped, size, result.metadata);
+					else
+					{
+						wxMemoryOutputStream buffer;
+						zipStream.Read(buffer);
+						wxStreamBuffer* data = buffer.GetOutputStreamBuffer();
+
+						AudioSystem::decodeMetadata(data->GetBufferStart(), data->GetIntPosition(),
+							result.metadata);
+					}
+
+					results.push_back(result);
+					++next;
+
+					if (results.size() >= RESULTS_PER_POST)
+					{
+						CallAfter([=] { OnScanResults(generation, package, modified, results, false); });
+						results.clear();
+					}
+				}
+
+				++ordinal;
+			}
+
+			delete entry;
+			entry = zipStream.GetNextEntry();
+		}
+
+		delete entry;
+	}
+
+	CallAfter([=] { OnScanResults(generation, package, modified, results, true); });
+}
+
+void SoundBrowser::OnScanResults(int generation, const wxString& package, wxInt64 modified,
+	const std::vector<ScanResult>& results, bool done)
+{
+	if (generation != m_ScanGeneration.load())
+		return; // the list has been rebuilt since
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		m_MetadataCache->Store(package, results[i].entry, modified, results[i].metadata);
+		SetItemMetadata(results[i].index, results[i].metadata);
+	}
+
+	if (done && --m_PendingScans == 0)
+		m_MetadataCache->Save();
+}
+
+void SoundBrowser::CancelScans(void)
+{
+	++m_ScanGeneration;
+	m_Workers->Cancel();
+	m_PendingScans = 0;
+	m_PendingPeaks.clear();
+	m_MetadataCache->Save();
+}
+
+void SoundBrowser::SetItemMetadata(long index, const SoundMetadata& metadata)
+{
+	m_List->SetItem(index, COL_CHANNELS, wxString::Format(_("%d"), metadata.channels));
+	m_List->SetItem(index, COL_FREQ, wxString::Format(_("%d"), metadata.sampleRate));
+
+	int minutes = (int)(metadata.duration / 60.0);
+	m_List->SetItem(index, COL_DURATION, wxString::Format(wxT("%d:%04.1f"), minutes,
+		metadata.duration - minutes * 60.0));
+	m_List->SetItem(index, COL_FORMAT, metadata.format);
+}
+
+void SoundBrowser::ShowPeaks(long index)
+{
+	itemsource_t::iterator source = m_ItemSources.find(index);
+	if (source == m_ItemSources.end())
+	{
+		m_Waveform->SetMessage(wxEmptyString);
+		return;
+	}
+
+	wxInt64 modified = SoundMetadataCache::GetModified(source->second.package);
+	std::shared_ptr<SoundPeaks> peaks = m_PeakCache->Find(source->second.package,
+		source->second.entry, modified);
+	if (peaks)
+	{
+		m_Waveform->SetPeaks(peaks);
+		return;
+	}
+
+	m_Waveform->SetMessage(_("Building waveform..."));
+
+	// built once per sound; the result is cached on disk for later sessions
+	const wxString& location = m_ItemPaths[index];
+	if (m_PendingPeaks.insert(location).second)
+		m_Workers->Submit(std::bind(&SoundBrowser::PeakJob, this, location, source->second, modified));
+}
+
+void SoundBrowser::PeakJob(const wxString& location, const ItemSource& source, wxInt64 modified)
+{
+	// runs on a worker
+	std::shared_ptr<SoundPeaks> peaks;
+
+	// sounds stored uncompressed are decoded straight from the mapped package
+	std::shared_ptr<MappedArchive> archive;
+	if (!source.entry.empty())
+		archive = MappedArchive::Open(source.package);
+
+	size_t size = 0;
+	const irr::u8* mapped = archive ? archive->Find(source.entry, size) : nullptr;
+
+	wxMemoryOutputStream buffer;
+	if (mapped)
+	{
+		peaks.reset(new SoundPeaks);
+		if (!AudioSystem::computePeaks(mapped, size, *peaks))
+			peaks.reset();
+	}
+	else if (ReadSoundData(source.package, source.entry, buffer))
+	{
+		wxStreamBuffer* data = buffer.GetOutputStreamBuffer();
+
+		peaks.reset(new SoundPeaks);
+		if (!AudioSystem::computePeaks(data->GetBufferStart(), data->GetIntPosition(), *peaks))
+			peaks.reset();
+	}
+
+	CallAfter([=] { OnPeaksReady(location, source, modified, peaks); });
+}
+
+void SoundBrowser::OnPeaksReady(const wxString& location, const ItemSource& source, wxInt64 modified,
+	const std::shared_ptr<SoundPeaks>& peaks)
+{
+	if (m_PendingPeaks.erase(location) == 0)
+		return; // cancelled by a refresh
+
+	if (peaks)
+		m_PeakCache->Store(source.package, source.entry, modified, *peaks);
+
+	if (location != m_Selection)
+		return;
+
+	if (peaks)
+		m_Waveform->SetPeaks(peaks);
+	else
+		m_Waveform->SetMessage(_("No waveform available"));
+}
+
 void SoundBrowser::OnToolAdd(wxCommandEvent& event)
 {
 	wxFileDialog openDialog(this,
@@ -1546,9 +2097,9 @@ void SoundBrowser::OnToolAdd(wxCommandEvent& event)
 
 	wxFileName soundPath(openDialog.GetPath());
 	// get the meta data for the item
-	uint32_t sampleRate, channels;
-	m_AudioSystem->getSoundMetadata(soundPath.GetFullPath(), sampleRate, channels);
-	if (sampleRate == 0 || channels == 0)
+	SoundMetadata metadata;
+	if (!m_AudioSystem->getSoundMetadata(soundPath.GetFullPath(), metadata) ||
+		metadata.sampleRate == 0 || metadata.channels == 0)
 	{
 		wxLogWarning(_("Failed to get sound metadata for: %s"), soundPath.GetFullPath());
 		return;
@@ -1557,6 +2108,7 @@ void SoundBrowser::OnToolAdd(wxCommandEvent& event)
 	long index = m_List->InsertItem(m_List->GetItemCount(), soundPath.GetName());
 	m_List->SetItemData(index, -1);
 	m_ItemPaths[index] = soundPath.GetFullPath();
+	m_ItemSources[index].package = soundPath.GetFullPath();
 
 	wxFileType* mimeType = wxTheMimeTypesManager->GetFileTypeFromExtension(soundPath.GetExt());
 	if (mimeType)
@@ -1572,8 +2124,7 @@ void SoundBrowser::OnToolAdd(wxCommandEvent& event)
 	else
 		m_List->SetItem(index, COL_TYPE, _("Unknown"));
 
-	m_List->SetItem(index, COL_CHANNELS, wxString::Format(_("%d"), channels));
-	m_List->SetItem(index, COL_FREQ, wxString::Format(_("%d"), sampleRate));
+	SetItemMetadata(index, metadata);
 	m_List->SetItem(index, COL_PACKAGE, soundPath.GetFullPath());
 }
 
@@ -1600,10 +2151,7 @@ void SoundBrowser::OnToolPlay(wxCommandEvent& event)
 {
 	long index = m_List->GetFocusedItem();
 	if (index != -1)
-	{
-		m_AudioSystem->stopSound(); // stop any currently playing sound
-		m_AudioSystem->playSound(m_ItemPaths[index]);
-	}
+		m_AudioSystem->playSound(m_ItemPaths[index]); // layered over anything already playing
 }
 
 void SoundBrowser::OnToolStop(wxCommandEvent& event)
@@ -1616,8 +2164,13 @@ void SoundBrowser::OnToolRefresh(wxCommandEvent& event)
 	if (m_AudioSystem == nullptr)
 		return;
 
+	CancelScans();
+
 	m_List->DeleteAllItems();
 	m_ItemPaths.clear();
+	m_ItemSources.clear();
+	m_Selection.clear();
+	m_Waveform->SetMessage(wxEmptyString);
 
 	for (BrowserWindow::packagelist_t::iterator i = BrowserWindow::ms_Packages.begin();
 		i != BrowserWindow::ms_Packages.end(); ++i)
@@ -1630,10 +2183,13 @@ void SoundBrowser::OnItemActivate(wxListEvent& event)
 {
 	long index = event.GetIndex();
 	if (index != -1)
-	{
-		m_AudioSystem->stopSound(); // stop any currently playing sound
-		m_AudioSystem->playSound(m_ItemPaths[index]);
-	}
+		m_AudioSystem->playSound(m_ItemPaths[index]); // layered over anything already playing
+}
+
+void SoundBrowser::OnItemSelected(wxListEvent& event)
+{
+	m_Selection = m_ItemPaths[event.GetIndex()];
+	ShowPeaks(event.GetIndex());
 }
 
 MeshBrowser::MeshBrowser(wxWindow* parent)
@@ -19,13 +19,19 @@
 #include <wx/treectrl.h>
 #include <wx/xml/xml.h>
 
+#include <atomic>
 #include <list>
 #include <map>
+#include <memory>
+#include <set>
 #include <vector>
 
 #include "irrlicht.h"
 
 #include "AudioSystem.hpp"
+#include "Definition.hpp"
+#include "SoundCache.hpp"
+#include "WorkerPool.hpp"
 
 class TextureBrowser;
 class ActorBrowser;
@@ -123,6 +129,13 @@ public:
 	 */
 	wxString GetActorDefinition(const wxString& name);
 
+	/**
+	 * @brief Get the compiled template of an actor
+	 * @param name The name of the actor
+	 * @return The actor template, or null if the actor is unknown
+	 */
+	std::shared_ptr<const ActorTemplate> GetActorTemplate(const wxString& name);
+
 	/**
 	 * @brief Get the selected mesh
 	 * @return The selected mesh name
@@ -135,6 +148,18 @@ public:
 	 */
 	const wxString& GetMeshDefinition(void);
 
+	/**
+	 * @brief Get the selected sound
+	 * @return The selected sound location
+	 */
+	const wxString& GetSound(void);
+
+	/**
+	 * @brief Get the audio system
+	 * @return Shared pointer to the audio system
+	 */
+	std::shared_ptr<AudioSystem> GetAudioSystem(void);
+
 	/**
 	 * @brief Add a package to the browser
 	 * @param path The path to the package
@@ -221,12 +246,15 @@ private:
 
 	wxString m_Selected;
 
+	std::unique_ptr<DefinitionCache> m_DefinitionCache;
+
 public:
 	ActorBrowser(wxWindow* parent);
 	~ActorBrowser(void);
 
 	const wxString& GetSelection(void);
 	wxString GetDefinition(const wxString& name);
+	std::shared_ptr<const ActorTemplate> GetTemplate(const wxString& name);
 
 private:
 	bool LoadPackage(const wxString& path, bool preload = false);
@@ -242,9 +270,44 @@ private:
 
 private:
 	void AddActor(const wxXmlDocument& definition, const wxString& sourceFile, bool fromPackage);
+	void AddActor(const std::shared_ptr<ActorTemplate>& actor, const wxString& definition,
+		const wxString& sourceFile, bool fromPackage);
+	void AddCachedDefinitions(const DefinitionCache::recordlist_t& records, const wxString& sourceFile,
+		bool fromPackage);
 	wxTreeItemId FindItem(const wxString& name, wxTreeItemId& start);
 };
 
+// Draws a sound's peak pyramid, picking the level that matches the zoom so
+// nothing has to be decoded again. Wheel zooms, dragging pans.
+class WaveformView : public wxPanel
+{
+private:
+	std::shared_ptr<SoundPeaks> m_Peaks;
+	wxString m_Message;
+
+	double m_Zoom;       // 1 shows the whole sound
+	double m_FirstFrame; // left edge of the view
+	int m_DragX;
+
+public:
+	WaveformView(wxWindow* parent);
+
+	void SetPeaks(const std::shared_ptr<SoundPeaks>& peaks);
+	void SetMessage(const wxString& message); // shown instead of a waveform
+
+private:
+	double GetFramesPerPixel(void) const;
+	void ClampView(void);
+
+	void OnPaint(wxPaintEvent& event);
+	void OnSize(wxSizeEvent& event);
+	void OnMouseWheel(wxMouseEvent& event);
+	void OnLeftDown(wxMouseEvent& event);
+	void OnLeftUp(wxMouseEvent& event);
+	void OnMotion(wxMouseEvent& event);
+	void OnLeftDClick(wxMouseEvent& event);
+};
+
 class SoundBrowser : public wxPanel
 {
 private:
@@ -254,26 +317,80 @@ private:
 		COL_TYPE,
 		COL_CHANNELS,
 		COL_FREQ,
+		COL_DURATION,
+		COL_FORMAT,
 		COL_PACKAGE
 	};
 
+	// a package entry whose metadata still has to be read
+	struct ScanTarget
+	{
+		long ordinal; // position among the package's sound entries
+		long index;   // list item
+	};
+
+	struct ScanResult
+	{
+		long index;
+		wxString entry;
+		SoundMetadata metadata;
+	};
+
+	// where a list item's data lives; entry is empty for loose files
+	struct ItemSource
+	{
+		wxString package;
+		wxString entry;
+	};
+
 private:
 	wxListView* m_List;
+	WaveformView* m_Waveform;
 
 	typedef std::map<long, wxString> itempath_t;
 	itempath_t m_ItemPaths;
 
+	typedef std::map<long, ItemSource> itemsource_t;
+	itemsource_t m_ItemSources;
+
 	std::shared_ptr<AudioSystem> m_AudioSystem;
 
+	wxString m_Selection;
+
+	std::unique_ptr<SoundMetadataCache> m_MetadataCache;
+	std::unique_ptr<WorkerPool> m_Workers;
+	std::atomic<int> m_ScanGeneration; // bumped to abandon scans in flight
+	int m_PendingScans;
+
+	std::unique_ptr<SoundPeakCache> m_PeakCache;
+	std::set<wxString> m_PendingPeaks; // locations with a peak job queued
+
 public:
 	SoundBrowser(wxWindow* parent);
 	~SoundBrowser(void);
 
 	void SetAudioSystem(std::shared_ptr<AudioSystem>& audioSystem);
+	std::shared_ptr<AudioSystem> GetAudioSystem(void);
+
+	const wxString& GetSelection(void);
 
 private:
 	bool LoadPackage(const wxString& path, bool preload = false);
 
+	void ScanPackage(const wxString& package, wxInt64 modified, const std::vector<ScanTarget>& targets);
+	void ScanJob(const wxString& package, wxInt64 modified, int generation,
+		const std::vector<ScanTarget>& targets);
+	void OnScanResults(int generation, const wxString& package, wxInt64 modified,
+		const std::vector<ScanResult>& results, bool done);
+	void CancelScans(void);
+
+	void SetItemMetadata(long index, const SoundMetadata& metadata);
+
+	void ShowPeaks(long index);
+	void PeakJob(const wxString& location, const ItemSource& source, wxInt64 modified);
+	void OnPeaksReady(const wxString& location, const ItemSource& source, wxInt64 modified,
+		const std::shared_ptr<SoundPeaks>& peaks);
+
 	void OnToolAdd(wxCommandEvent& event);
 	void OnToolOpen(wxCommandEvent& event);
 	void OnToolPlay(wxCommandEvent& event);
@@ -281,6 +398,7 @@ private:
 	void OnToolRefresh(wxCommandEvent& event);
 
 	void OnItemActivate(wxListEvent& event);
+	void OnItemSelected(wxListEvent& event);
 };
 
 class MeshBrowser : public wxPanel
@@ -0,0 +1,390 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Clipboard.hpp"
+#include "Map.hpp"
+
+#include <wx/clipbrd.h>
+
+#include <string.h>
+
+static const irr::u32 CLIP_MAGIC = 0x504c434d; // 'MCLP'
+static const irr::u32 CLIP_VERSION = 1;
+
+class BlobWriter
+{
+private:
+	std::vector<irr::u8>& m_Data;
+
+public:
+	BlobWriter(std::vector<irr::u8>& data)
+		: m_Data(data)
+	{
+	}
+
+	void Write(const void* value, size_t size)
+	{
+		const irr::u8* bytes = static_cast<const irr::u8*>(value);
+		m_Data.insert(m_Data.end(), bytes, bytes + size);
+	}
+
+	void WriteU32(irr::u32 value) { Write(&value, sizeof(value)); }
+	void WriteS32(irr::s32 value) { Write(&value, sizeof(value)); }
+	void WriteF32(irr::f32 value) { Write(&value, sizeof(value)); }
+
+	void WriteString(const irr::c8* value)
+	{
+		irr::u32 length = (irr::u32)strlen(value);
+		WriteU32(length);
+		Write(value, length);
+	}
+
+	void WriteAttributes(irr::io::IAttributes* attributes)
+	{
+		irr::u32 count = attributes ? attributes->getAttributeCount() : 0;
+		WriteU32(count);
+
+		for (irr::u32 i = 0; i < count; ++i)
+		{
+			irr::io::E_ATTRIBUTE_TYPE type = attributes->getAttributeType(i);
+			m_Data.push_back((irr::u8)type);
+			WriteString(attributes->getAttributeName(i));
+
+			// the common types go in binary, the rest as the text irrlicht parses
+			switch (type)
+			{
+			case irr::io::EAT_INT:
+				WriteS32(attributes->getAttributeAsInt(i));
+				break;
+			case irr::io::EAT_FLOAT:
+				WriteF32(attributes->getAttributeAsFloat(i));
+				break;
+			case irr::io::EAT_BOOL:
+				m_Data.push_back(attributes->getAttributeAsBool(i) ? 1 : 0);
+				break;
+			case irr::io::EAT_COLOR:
+				WriteU32(attributes->getAttributeAsColor(i).color);
+				break;
+			case irr::io::EAT_COLORF:
+			{
+				irr::video::SColorf color = attributes->getAttributeAsColorf(i);
+				WriteF32(color.r); WriteF32(color.g); WriteF32(color.b); WriteF32(color.a);
+			} break;
+			case irr::io::EAT_VECTOR3D:
+			{
+				irr::core::vector3df vec = attributes->getAttributeAsVector3d(i);
+				WriteF32(vec.X); WriteF32(vec.Y); WriteF32(vec.Z);
+			} break;
+			case irr::io::EAT_VECTOR2D:
+			{
+				irr::core::vector2df vec = attributes->getAttributeAsVector2d(i);
+				WriteF32(vec.X); WriteF32(vec.Y);
+			} break;
+			case irr::io::EAT_POSITION2D:
+			{
+				irr::core::position2di pos = attributes->getAttributeAsPosition2d(i);
+				WriteS32(pos.X); WriteS32(pos.Y);
+			} break;
+			case irr::io::EAT_DIMENSION2D:
+			{
+				irr::core::dimension2du dim = attributes->getAttributeAsDimension2d(i);
+				WriteU32(dim.Width); WriteU32(dim.Height);
+			} break;
+			default:
+				WriteString(attributes->getAttributeAsString(i).c_str());
+				break;
+			}
+		}
+	}
+};
+
+class BlobReader
+{
+private:
+	const std::vector<irr::u8>& m_Data;
+	size_t m_Offset;
+	bool m_Ok;
+
+public:
+	BlobReader(const std::vector<irr::u8>& data)
+		: m_Data(data), m_Offset(0), m_Ok(true)
+	{
+	}
+
+	bool IsOk(void) const { return m_Ok; }
+
+	bool Read(void* value, size_t size)
+	{
+		if (!m_Ok || m_Data.size() - m_Offset < size)
+		{
+			m_Ok = false;
+			memset(value, 0, size);
+			return false;
+		}
+
+		memcpy(value, &m_Data[m_Offset], size);
+		m_Offset += size;
+		return true;
+	}
+
+	irr::u8 ReadU8(void) { irr::u8 value; Read(&value, sizeof(value)); return value; }
+	irr::u32 ReadU32(void) { irr::u32 value; Read(&value, sizeof(value)); return value; }
+	irr::s32 ReadS32(void) { irr::s32 value; Read(&value, sizeof(value)); return value; }
+	irr::f32 ReadF32(void) { irr::f32 value; Read(&value, sizeof(value)); return value; }
+
+	irr::core::stringc ReadString(void)
+	{
+		irr::u32 length = ReadU32();
+		if (!m_Ok || m_Data.size() - m_Offset < length)
+		{
+			m_Ok = false;
+			return irr::core::stringc();
+		}
+
+		irr::core::stringc value(reinterpret_cast<const irr::c8*>(&m_Data[m_Offset]), length);
+		m_Offset += length;
+		return value;
+	}
+
+	void ReadAttributes(irr::io::IAttributes* attributes)
+	{
+		irr::u32 count = ReadU32();
+		for (irr::u32 i = 0; i < count && m_Ok; ++i)
+		{
+			irr::io::E_ATTRIBUTE_TYPE type = (irr::io::E_ATTRIBUTE_TYPE)ReadU8();
+			irr::core::stringc name = ReadString();
+
+			switch (type)
+			{
+			case irr::io::EAT_INT:
+				attributes->addInt(name.c_str(), ReadS32());
+				break;
+			case irr::io::EAT_FLOAT:
+				attributes->addFloat(name.c_str(), ReadF32());
+				break;
+			case irr::io::EAT_BOOL:
+				attributes->addBool(name.c_str(), ReadU8() != 0);
+				break;
+			case irr::io::EAT_COLOR:
+				attributes->addColor(name.c_str(), irr::video::SColor(ReadU32()));
+				break;
+			case irr::io::EAT_COLORF:
+			{
+				irr::video::SColorf color;
+				color.r = ReadF32(); color.g = ReadF32(); color.b = ReadF32(); color.a = ReadF32();
+				attributes->addColorf(name.c_str(), color);
+			} break;
+			case irr::io::EAT_VECTOR3D:
+			{
+				irr::core::vector3df vec;
+				vec.X = ReadF32(); vec.Y = ReadF32(); vec.Z = ReadF32();
+				attributes->addVector3d(name.c_str(), vec);
+			} break;
+			case irr::io::EAT_VECTOR2D:
+			{
+				irr::core::vector2df vec;
+				vec.X = ReadF32(); vec.Y = ReadF32();
+				attributes->addVector2d(name.c_str(), vec);
+			} break;
+			case irr::io::EAT_POSITION2D:
+			{
+				irr::core::position2di pos;
+				pos.X = ReadS32(); pos.Y = ReadS32();
+				attributes->addPosition2d(name.c_str(), pos);
+			} break;
+			case irr::io::EAT_DIMENSION2D:
+			{
+				irr::core::dimension2du dim;
+				dim.Width = ReadU32(); dim.Height = ReadU32();
+				attributes->addDimension2d(name.c_str(), dim);
+			} break;
+			default:
+			{
+				irr::core::stringc value = ReadString();
+				if (AddDefault(attributes, type, name.c_str()))
+					attributes->setAttribute((irr::s32)attributes->getAttributeCount() - 1, value.c_str());
+			} break;
+			}
+		}
+	}
+
+private:
+	// an attribute of the right type, so setting it from text parses it
+	static bool AddDefault(irr::io::IAttributes* attributes, irr::io::E_ATTRIBUTE_TYPE type,
+		const irr::c8* name)
+	{
+		switch (type)
+		{
+		case irr::io::EAT_STRING: attributes->addString(name, ""); break;
+		case irr::io::EAT_ENUM: attributes->addEnum(name, "", nullptr); break;
+		case irr::io::EAT_TEXTURE: attributes->addTexture(name, nullptr); break;
+		case irr::io::EAT_RECT: attributes->addRect(name, irr::core::recti()); break;
+		case irr::io::EAT_MATRIX: attributes->addMatrix(name, irr::core::matrix4()); break;
+		case irr::io::EAT_QUATERNION: attributes->addQuaternion(name, irr::core::quaternion()); break;
+		case irr::io::EAT_BBOX: attributes->addBox3d(name, irr::core::aabbox3df()); break;
+		case irr::io::EAT_PLANE: attributes->addPlane3d(name, irr::core::plane3df()); break;
+		case irr::io::EAT_TRIANGLE3D: attributes->addTriangle3d(name, irr::core::triangle3df()); break;
+		case irr::io::EAT_LINE2D: attributes->addLine2d(name, irr::core::line2df()); break;
+		case irr::io::EAT_LINE3D: attributes->addLine3d(name, irr::core::line3df()); break;
+		case irr::io::EAT_BINARY: attributes->addBinary(name, nullptr, 0); break;
+		default: return false; // pointers and arrays don't survive the copy
+		}
+
+		return true;
+	}
+};
+
+const wxDataFormat& EntityClipboard::GetFormat(void)
+{
+	static const wxDataFormat format(wxT("application/x-manifold-entities"));
+	return format;
+}
+
+bool EntityClipboard::Copy(std::shared_ptr<Map>& map, const selection_t& selection)
+{
+	std::vector<irr::u8> data;
+	Encode(map, selection, data);
+
+	wxClipboardLocker locker;
+	if (!locker)
+		return false;
+
+	wxCustomDataObject* object = new wxCustomDataObject(GetFormat());
+	object->SetData(data.size(), &data[0]);
+	return wxTheClipboard->SetData(object);
+}
+
+bool EntityClipboard::Get(std::vector<irr::u8>& data)
+{
+	wxClipboardLocker locker;
+	if (!locker || !wxTheClipboard->IsSupported(GetFormat()))
+		return false;
+
+	wxCustomDataObject object(GetFormat());
+	if (!wxTheClipboard->GetData(object) || object.GetSize() == 0)
+		return false;
+
+	const irr::u8* bytes = static_cast<const irr::u8*>(object.GetData());
+	data.assign(bytes, bytes + object.GetSize());
+	return true;
+}
+
+void EntityClipboard::Encode(std::shared_ptr<Map>& map, const selection_t& selection,
+	std::vector<irr::u8>& data)
+{
+	irr::scene::ISceneManager* sceneMgr = map->GetSceneMgr();
+
+	BlobWriter writer(data);
+	writer.WriteU32(CLIP_MAGIC);
+	writer.WriteU32(CLIP_VERSION);
+
+	size_t countOffset = data.size();
+	irr::u32 count = 0;
+	writer.WriteU32(count);
+
+	for (selection_t::const_iterator node = selection.begin();
+		node != selection.end(); ++node)
+	{
+		wxString name((*node)->getName());
+		irr::core::stringc type;
+		irr::io::IAttributes* attributes = sceneMgr->getFileSystem()->createEmptyAttributes();
+		irr::core::array<irr::io::IAttributes*> materials;
+		irr::core::array<irr::io::IAttributes*> animators;
+		if (map->SerializeEntity(*node, type, attributes, materials, animators))
+		{
+			writer.WriteString(name.utf8_str());
+			writer.WriteString(type.c_str());
+			writer.WriteAttributes(attributes);
+
+			writer.WriteU32(materials.size());
+			for (irr::u32 i = 0; i < materials.size(); ++i)
+				writer.WriteAttributes(materials[i]);
+
+			writer.WriteU32(animators.size());
+			for (irr::u32 i = 0; i < animators.size(); ++i)
+				writer.WriteAttributes(animators[i]);
+
+			writer.WriteAttributes(map->GetAttributes(name));
+			++count;
+		}
+
+		for (irr::u32 i = 0; i < materials.size(); ++i)
+			materials[i]->drop();
+		for (irr::u32 i = 0; i < animators.size(); ++i)
+			animators[i]->drop();
+		attributes->drop();
+	}
+
+	memcpy(&data[countOffset], &count, sizeof(count));
+}
+
+bool EntityClipboard::Decode(const std::vector<irr::u8>& data, irr::scene::ISceneManager* sceneMgr,
+	entities_t& entities)
+{
+	BlobReader reader(data);
+	if (reader.ReadU32() != CLIP_MAGIC || reader.ReadU32() != CLIP_VERSION)
+		return false;
+
+	irr::io::IFileSystem* fileSystem = sceneMgr->getFileSystem();
+	irr::video::IVideoDriver* videoDriver = sceneMgr->getVideoDriver();
+
+	irr::u32 count = reader.ReadU32();
+	for (irr::u32 e = 0; e < count && reader.IsOk(); ++e)
+	{
+		Entity entity;
+		entity.Name = wxString::FromUTF8(reader.ReadString().c_str());
+		entity.Type = reader.ReadString();
+		entity.Attributes = fileSystem->createEmptyAttributes(videoDriver);
+		entity.UserData = fileSystem->createEmptyAttributes(videoDriver);
+		entities.push_back(entity);
+
+		Entity& added = entities.back();
+		reader.ReadAttributes(added.Attributes);
+
+		irr::u32 materials = reader.ReadU32();
+		for (irr::u32 i = 0; i < materials && reader.IsOk(); ++i)
+		{
+			added.Materials.push_back(fileSystem->createEmptyAttributes(videoDriver));
+			reader.ReadAttributes(added.Materials.getLast());
+		}
+
+		irr::u32 animators = reader.ReadU32();
+		for (irr::u32 i = 0; i < animators && reader.IsOk(); ++i)
+		{
+			added.Animators.push_back(fileSystem->createEmptyAttributes(videoDriver));
+			reader.ReadAttributes(added.Animators.getLast());
+		}
+
+		reader.ReadAttributes(added.UserData);
+	}
+
+	if (!reader.IsOk())
+	{
+		for (size_t i = 0; i < entities.size(); ++i)
+		{
+			for (irr::u32 j = 0; j < entities[i].Materials.size(); ++j)
+				entities[i].Materials[j]->drop();
+			for (irr::u32 j = 0; j < entities[i].Animators.size(); ++j)
+				entities[i].Animators[j]->drop();
+		}
+
+		Drop(entities);
+		return false;
+	}
+
+	return true;
+}
+
+void EntityClipboard::Drop(entities_t& entities)
+{
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		entities[i].Attributes->drop();
+		entities[i].UserData->drop();
+	}
+
+	entities.clear();
+}
@@ -0,0 +1,58 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <wx/dataobj.h>
+#include <wx/string.h>
+
+#include "irrlicht.h"
+
+#include <memory>
+#include <vector>
+
+class Map;
+
+// Map entities on the system clipboard, so they can be moved between maps
+// open in different editor processes. They're written as a compact binary
+// blob under a private format that only the editor reads.
+class EntityClipboard
+{
+public:
+	typedef std::vector<irr::scene::ISceneNode*> selection_t;
+
+	// One entity as the serializers see it
+	struct Entity
+	{
+		wxString Name;
+		irr::core::stringc Type;
+		irr::io::IAttributes* Attributes;
+		irr::core::array<irr::io::IAttributes*> Materials;
+		irr::core::array<irr::io::IAttributes*> Animators;
+		irr::io::IAttributes* UserData;
+	};
+
+	typedef std::vector<Entity> entities_t;
+
+	static const wxDataFormat& GetFormat(void);
+
+	// Put the entities on the clipboard
+	static bool Copy(std::shared_ptr<Map>& map, const selection_t& selection);
+
+	// The blob on the clipboard, false if it holds no entities
+	static bool Get(std::vector<irr::u8>& data);
+
+	static void Encode(std::shared_ptr<Map>& map, const selection_t& selection,
+		std::vector<irr::u8>& data);
+
+	// False if the blob is damaged or from a different version. The caller
+	// drops the attribute sets with Drop(), CreateEntity takes the materials
+	// and animators.
+	static bool Decode(const std::vector<irr::u8>& data, irr::scene::ISceneManager* sceneMgr,
+		entities_t& entities);
+
+	static void Drop(entities_t& entities);
+};
@@ -0,0 +1,513 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "CollisionShape.hpp"
+#include "MappedFile.hpp"
+#include "../extend/TerrainSceneNode.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+static const irr::u32 COL_MAGIC = 0x4c4f434d; // 'MCOL'
+static const irr::u32 COL_VERSION = 1;
+
+// magic, version, source triangles, node count, triangle count
+static const size_t COL_HEADER_SIZE = 5 * sizeof(irr::u32);
+
+CollisionShape::CollisionShape(void)
+	: m_Nodes(nullptr), m_NodeCount(0), m_Triangles(nullptr), m_TriangleCount(0),
+	  m_File(nullptr)
+{
+}
+
+CollisionShape::~CollisionShape(void)
+{
+	if (m_File)
+		m_File->drop();
+}
+
+struct BuildTriangle
+{
+	CollisionShape::Triangle Tri;
+	irr::core::vector3df Centre;
+};
+
+struct CompareCentre
+{
+	int Axis;
+
+	bool operator()(const BuildTriangle& a, const BuildTriangle& b) const
+	{
+		return (&a.Centre.X)[Axis] < (&b.Centre.X)[Axis];
+	}
+};
+
+static void BuildNode(std::vector<BuildTriangle>& tris, irr::u32 first, irr::u32 count,
+	std::vector<CollisionShape::Node>& nodes)
+{
+	irr::u32 index = (irr::u32)nodes.size();
+	nodes.push_back(CollisionShape::Node());
+
+	irr::core::aabbox3df bounds(irr::core::vector3df(tris[first].Tri.V[0], tris[first].Tri.V[1], tris[first].Tri.V[2]));
+	irr::core::aabbox3df centres(tris[first].Centre);
+	for (irr::u32 i = first; i < first + count; ++i)
+	{
+		for (int v = 0; v < 9; v += 3)
+			bounds.addInternalPoint(tris[i].Tri.V[v], tris[i].Tri.V[v + 1], tris[i].Tri.V[v + 2]);
+		centres.addInternalPoint(tris[i].Centre);
+	}
+
+	CollisionShape::Node& node = nodes[index];
+	node.Min[0] = bounds.MinEdge.X; node.Min[1] = bounds.MinEdge.Y; node.Min[2] = bounds.MinEdge.Z;
+	node.Max[0] = bounds.MaxEdge.X; node.Max[1] = bounds.MaxEdge.Y; node.Max[2] = bounds.MaxEdge.Z;
+
+	if (count <= CollisionShape::LEAF_SIZE)
+	{
+		node.Start = first;
+		node.Count = count;
+		return;
+	}
+
+	// split at the median along the widest spread of centres
+	irr::core::vector3df extent = centres.getExtent();
+	CompareCentre compare;
+	compare.Axis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+
+	irr::u32 half = count / 2;
+	std::nth_element(tris.begin() + first, tris.begin() + first + half,
+		tris.begin() + first + count, compare);
+
+	BuildNode(tris, first, half, nodes);
+
+	// the vector may have grown, so don't hold on to node
+	nodes[index].Start = (irr::u32)nodes.size();
+	nodes[index].Count = 0;
+	BuildNode(tris, first + half, count - half, nodes);
+}
+
+static void WriteU32(std::vector<irr::u8>& data, size_t offset, irr::u32 value)
+{
+	memcpy(&data[offset], &value, sizeof(value));
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::Build(irr::scene::IMesh* mesh)
+{
+	std::vector<BuildTriangle> tris;
+	for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+	{
+		irr::scene::IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+		irr::u32 indexCount = buffer->getIndexCount();
+		bool wide = buffer->getIndexType() == irr::video::EIT_32BIT;
+		const irr::u16* indices16 = buffer->getIndices();
+		const irr::u32* indices32 = reinterpret_cast<const irr::u32*>(indices16);
+
+		for (irr::u32 i = 0; i + 2 < indexCount; i += 3)
+		{
+			BuildTriangle tri;
+			for (int v = 0; v < 3; ++v)
+			{
+				const irr::core::vector3df& p = buffer->getPosition(wide ? indices32[i + v] : indices16[i + v]);
+				tri.Tri.V[v * 3] = p.X;
+				tri.Tri.V[v * 3 + 1] = p.Y;
+				tri.Tri.V[v * 3 + 2] = p.Z;
+			}
+			tri.Centre.set((tri.Tri.V[0] + tri.Tri.V[3] + tri.Tri.V[6]) / 3.0f,
+				(tri.Tri.V[1] + tri.Tri.V[4] + tri.Tri.V[7]) / 3.0f,
+				(tri.Tri.V[2] + tri.Tri.V[5] + tri.Tri.V[8]) / 3.0f);
+			tris.push_back(tri);
+		}
+	}
+
+	if (tris.empty())
+		return std::shared_ptr<const CollisionShape>();
+
+	std::vector<Node> nodes;
+	BuildNode(tris, 0, (irr::u32)tris.size(), nodes);
+
+	// lay it out as the sidecar, the shape then points into its own copy
+	std::shared_ptr<CollisionShape> shape(new CollisionShape);
+	std::vector<irr::u8>& data = shape->m_Data;
+	data.resize(COL_HEADER_SIZE + nodes.size() * sizeof(Node) + tris.size() * sizeof(Triangle));
+
+	irr::u32 sourceTriangles = CountTriangles(mesh);
+	WriteU32(data, 0, COL_MAGIC);
+	WriteU32(data, 4, COL_VERSION);
+	WriteU32(data, 8, sourceTriangles);
+	WriteU32(data, 12, (irr::u32)nodes.size());
+	WriteU32(data, 16, (irr::u32)tris.size());
+	memcpy(&data[COL_HEADER_SIZE], &nodes[0], nodes.size() * sizeof(Node));
+
+	size_t offset = COL_HEADER_SIZE + nodes.size() * sizeof(Node);
+	for (size_t i = 0; i < tris.size(); ++i, offset += sizeof(Triangle))
+		memcpy(&data[offset], &tris[i].Tri, sizeof(Triangle));
+
+	shape->Attach(&data[0], data.size(), sourceTriangles);
+	return shape;
+}
+
+std::shared_ptr<const CollisionShape> CollisionShape::Load(irr::io::IReadFile* file, irr::u32 sourceTriangles)
+{
+	std::shared_ptr<CollisionShape> shape(new CollisionShape);
+
+	// a mapped, stored sidecar is page aligned and can be used as it is
+	MappedReadFile* mapped = dynamic_cast<MappedReadFile*>(file);
+	if (mapped && (reinterpret_cast<size_t>(mapped->getData()) % sizeof(irr::u32)) == 0)
+	{
+		if (!shape->Attach(mapped->getData(), mapped->getSize(), sourceTriangles))
+			return std::shared_ptr<const CollisionShape>();
+
+		shape->m_File = file;
+		file->grab();
+		return shape;
+	}
+
+	shape->m_Data.resize(file->getSize());
+	if (shape->m_Data.empty() ||
+		file->read(&shape->m_Data[0], (irr::u32)shape->m_Data.size()) != (irr::s32)shape->m_Data.size() ||
+		!shape->Attach(&shape->m_Data[0], shape->m_Data.size(), sourceTriangles))
+		return std::shared_ptr<const CollisionShape>();
+
+	return shape;
+}
+
+bool CollisionShape::Attach(const irr::u8* data, size_t size, irr::u32 sourceTriangles)
+{
+	if (size < COL_HEADER_SIZE)
+		return false;
+
+	const irr::u32* header = reinterpret_cast<const irr::u32*>(data);
+	if (header[0] != COL_MAGIC || header[1] != COL_VERSION || header[2] != sourceTriangles)
+		return false;
+
+	irr::u32 nodeCount = header[3];
+	irr::u32 triangleCount = header[4];
+	if (nodeCount == 0 || size != COL_HEADER_SIZE + (size_t)nodeCount * sizeof(Node) +
+		(size_t)triangleCount * sizeof(Triangle))
+		return false;
+
+	const Node* nodes = reinterpret_cast<const Node*>(data + COL_HEADER_SIZE);
+	for (irr::u32 i = 0; i < nodeCount; ++i)
+	{
+		// leaves must stay within the triangles, inner nodes point forward
+		if (nodes[i].Count ? nodes[i].Start + (size_t)nodes[i].Count > triangleCount :
+			(nodes[i].Start <= i + 1 || nodes[i].Start >= nodeCount))
+			return false;
+	}
+
+	m_Nodes = nodes;
+	m_NodeCount = nodeCount;
+	m_Triangles = reinterpret_cast<const Triangle*>(data + COL_HEADER_SIZE + (size_t)nodeCount * sizeof(Node));
+	m_TriangleCount = triangleCount;
+	return true;
+}
+
+irr::core::aabbox3df CollisionShape::GetBounds(void) const
+{
+	return irr::core::aabbox3df(m_Nodes[0].Min[0], m_Nodes[0].Min[1], m_Nodes[0].Min[2],
+		m_Nodes[0].Max[0], m_Nodes[0].Max[1], m_Nodes[0].Max[2]);
+}
+
+static bool Overlaps(const CollisionShape::Node& node, const irr::core::aabbox3df& box)
+{
+	return node.Min[0] <= box.MaxEdge.X && node.Max[0] >= box.MinEdge.X &&
+		node.Min[1] <= box.MaxEdge.Y && node.Max[1] >= box.MinEdge.Y &&
+		node.Min[2] <= box.MaxEdge.Z && node.Max[2] >= box.MinEdge.Z;
+}
+
+// slab test of the segment against the node's box
+static bool Crosses(const CollisionShape::Node& node, const irr::core::vector3df& start,
+	const irr::core::vector3df& dir)
+{
+	irr::f32 tMin = 0.0f;
+	irr::f32 tMax = 1.0f;
+	const irr::f32* s = &start.X;
+	const irr::f32* d = &dir.X;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (irr::core::iszero(d[axis]))
+		{
+			if (s[axis] < node.Min[axis] || s[axis] > node.Max[axis])
+				return false;
+			continue;
+		}
+
+		irr::f32 inv = 1.0f / d[axis];
+		irr::f32 t1 = (node.Min[axis] - s[axis]) * inv;
+		irr::f32 t2 = (node.Max[axis] - s[axis]) * inv;
+		if (t1 > t2)
+			irr::core::swap(t1, t2);
+
+		tMin = irr::core::max_(tMin, t1);
+		tMax = irr::core::min_(tMax, t2);
+		if (tMin > tMax)
+			return false;
+	}
+
+	return true;
+}
+
+void CollisionShape::Query(const irr::core::aabbox3df& box, std::vector<irr::u32>& triangles) const
+{
+	irr::u32 stack[64];
+	irr::u32 depth = 0;
+	stack[depth++] = 0;
+
+	while (depth)
+	{
+		const Node& node = m_Nodes[stack[--depth]];
+		if (!Overlaps(node, box))
+			continue;
+
+		if (node.Count)
+		{
+			for (irr::u32 i = node.Start; i < node.Start + node.Count; ++i)
+				triangles.push_back(i);
+		}
+		else if (depth + 2 <= 64)
+		{
+			stack[depth++] = node.Start;
+			stack[depth++] = (irr::u32)(&node - m_Nodes) + 1;
+		}
+	}
+}
+
+void CollisionShape::Query(const irr::core::line3df& line, std::vector<irr::u32>& triangles) const
+{
+	irr::core::vector3df dir = line.end - line.start;
+
+	irr::u32 stack[64];
+	irr::u32 depth = 0;
+	stack[depth++] = 0;
+
+	while (depth)
+	{
+		const Node& node = m_Nodes[stack[--depth]];
+		if (!Crosses(node, line.start, dir))
+			continue;
+
+		if (node.Count)
+		{
+			for (irr::u32 i = node.Start; i < node.Start + node.Count; ++i)
+				triangles.push_back(i);
+		}
+		else if (depth + 2 <= 64)
+		{
+			stack[depth++] = node.Start;
+			stack[depth++] = (irr::u32)(&node - m_Nodes) + 1;
+		}
+	}
+}
+
+irr::core::triangle3df CollisionShape::GetTriangle(irr::u32 index) const
+{
+	const irr::f32* v = m_Triangles[index].V;
+	return irr::core::triangle3df(irr::core::vector3df(v[0], v[1], v[2]),
+		irr::core::vector3df(v[3], v[4], v[5]), irr::core::vector3df(v[6], v[7], v[8]));
+}
+
+irr::u32 CollisionShape::CountTriangles(irr::scene::IMesh* mesh)
+{
+	irr::u32 count = 0;
+	for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		count += mesh->getMeshBuffer(b)->getIndexCount() / 3;
+
+	return count;
+}
+
+CollisionSelector::CollisionSelector(const std::shared_ptr<const CollisionShape>& shape,
+	irr::scene::ISceneNode* node)
+	: m_Shape(shape), m_Node(node)
+{
+	// like the engine's selectors, the node isn't grabbed; it owns the selector
+}
+
+irr::s32 CollisionSelector::getTriangleCount() const
+{
+	return (irr::s32)m_Shape->GetTriangleCount();
+}
+
+void CollisionSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+	irr::s32& outTriangleCount, const irr::core::matrix4* transform) const
+{
+	std::vector<irr::u32> indices;
+	m_Shape->Query(m_Shape->GetBounds(), indices);
+	Output(indices, triangles, arraySize, outTriangleCount, transform);
+}
+
+void CollisionSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+	irr::s32& outTriangleCount, const irr::core::aabbox3d<irr::f32>& box,
+	const irr::core::matrix4* transform) const
+{
+	// bring the box into the mesh's space
+	irr::core::matrix4 inverse;
+	irr::core::aabbox3df localBox(box);
+	if (m_Node && m_Node->getAbsoluteTransformation().getInverse(inverse))
+		inverse.transformBoxEx(localBox);
+
+	std::vector<irr::u32> indices;
+	m_Shape->Query(localBox, indices);
+	Output(indices, triangles, arraySize, outTriangleCount, transform);
+}
+
+void CollisionSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+	irr::s32& outTriangleCount, const irr::core::line3d<irr::f32>& line,
+	const irr::core::matrix4* transform) const
+{
+	irr::core::line3df localLine(line);
+	irr::core::matrix4 inverse;
+	if (m_Node && m_Node->getAbsoluteTransformation().getInverse(inverse))
+	{
+		inverse.transformVect(localLine.start);
+		inverse.transformVect(localLine.end);
+	}
+
+	std::vector<irr::u32> indices;
+	m_Shape->Query(localLine, indices);
+	Output(indices, triangles, arraySize, outTriangleCount, transform);
+}
+
+void CollisionSelector::Output(const std::vector<irr::u32>& indices, irr::core::triangle3df* triangles,
+	irr::s32 arraySize, irr::s32& outTriangleCount, const irr::core::matrix4* transform) const
+{
+	irr::core::matrix4 mat;
+	if (transform)
+		mat = *transform;
+	if (m_Node)
+		mat *= m_Node->getAbsoluteTransformation();
+
+	irr::s32 count = irr::core::min_((irr::s32)indices.size(), arraySize);
+	for (irr::s32 i = 0; i < count; ++i)
+	{
+		irr::core::triangle3df tri = m_Shape->GetTriangle(indices[i]);
+		mat.transformVect(triangles[i].pointA, tri.pointA);
+		mat.transformVect(triangles[i].pointB, tri.pointB);
+		mat.transformVect(triangles[i].pointC, tri.pointC);
+	}
+
+	outTriangleCount = count;
+}
+
+irr::scene::ISceneNode* CollisionSelector::getSceneNodeForTriangle(irr::u32 triangleIndex) const
+{
+	return m_Node;
+}
+
+irr::u32 CollisionSelector::getSelectorCount() const
+{
+	return 1;
+}
+
+irr::scene::ITriangleSelector* CollisionSelector::getSelector(irr::u32 index)
+{
+	return index == 0 ? this : nullptr;
+}
+
+const irr::scene::ITriangleSelector* CollisionSelector::getSelector(irr::u32 index) const
+{
+	return index == 0 ? this : nullptr;
+}
+
+CollisionCache::CollisionCache(void)
+	: m_SceneMgr(nullptr)
+{
+}
+
+CollisionCache::~CollisionCache(void)
+{
+	Clear();
+}
+
+void CollisionCache::SetSceneMgr(irr::scene::ISceneManager* sceneMgr)
+{
+	if (sceneMgr != m_SceneMgr)
+		Clear();
+
+	m_SceneMgr = sceneMgr;
+}
+
+std::shared_ptr<const CollisionShape> CollisionCache::GetShape(irr::scene::IMesh* mesh)
+{
+	// only meshes loaded from files are shared, generated ones are unique
+	irr::scene::IMeshCache* meshCache = m_SceneMgr->getMeshCache();
+	irr::s32 cacheIndex = -1;
+	for (irr::u32 i = 0; i < meshCache->getMeshCount() && cacheIndex < 0; ++i)
+	{
+		irr::scene::IAnimatedMesh* source = meshCache->getMeshByIndex(i);
+		if (source == mesh || source->getMesh(0) == mesh)
+			cacheIndex = (irr::s32)i;
+	}
+
+	if (cacheIndex < 0)
+		return CollisionShape::Build(mesh);
+
+	shapemap_t::iterator cached = m_Shapes.find(mesh);
+	if (cached != m_Shapes.end())
+	{
+		std::shared_ptr<const CollisionShape> shape = cached->second.lock();
+		if (shape)
+			return shape;
+	}
+	else
+		mesh->grab();
+
+	// packages carry a prebuilt one next to the mesh
+	std::shared_ptr<const CollisionShape> shape;
+	irr::io::path sidecarName(meshCache->getMeshName(cacheIndex).getPath());
+	sidecarName += ".col";
+
+	irr::io::IReadFile* sidecar = m_SceneMgr->getFileSystem()->createAndOpenFile(sidecarName);
+	if (sidecar)
+	{
+		shape = CollisionShape::Load(sidecar, CollisionShape::CountTriangles(mesh));
+		sidecar->drop();
+	}
+
+	if (!shape)
+		shape = CollisionShape::Build(mesh);
+
+	m_Shapes[mesh] = shape;
+	return shape;
+}
+
+irr::scene::ITriangleSelector* CollisionCache::CreateSelector(irr::scene::ISceneNode* node)
+{
+	irr::scene::IMesh* mesh = nullptr;
+	if (node->getType() == irr::scene::ESNT_MESH || node->getType() == irr::scene::ESNT_CUBE ||
+		node->getType() == irr::scene::ESNT_SPHERE)
+		mesh = static_cast<irr::scene::IMeshSceneNode*>(node)->getMesh();
+	else if (node->getType() == irr::scene::ESNT_ANIMATED_MESH)
+	{
+		// an animated model's triangles change with the frame
+		irr::scene::IAnimatedMesh* animatedMesh = static_cast<irr::scene::IAnimatedMeshSceneNode*>(node)->getMesh();
+		if (animatedMesh && animatedMesh->getFrameCount() > 1)
+			return m_SceneMgr->createTriangleSelector(animatedMesh, node);
+		if (animatedMesh)
+			mesh = animatedMesh->getMesh(0);
+	}
+	else if (node->getType() == (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+	{
+		// the heightfield is its own acceleration structure
+		return static_cast<TerrainSceneNode*>(node)->createTriangleSelector();
+	}
+
+	if (mesh)
+	{
+		std::shared_ptr<const CollisionShape> shape = GetShape(mesh);
+		if (shape)
+			return new CollisionSelector(shape, node);
+	}
+
+	return m_SceneMgr->createTriangleSelectorFromBoundingBox(node);
+}
+
+void CollisionCache::Clear(void)
+{
+	for (shapemap_t::iterator shape = m_Shapes.begin(); shape != m_Shapes.end(); ++shape)
+		shape->first->drop();
+
+	m_Shapes.clear();
+}
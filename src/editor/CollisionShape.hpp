@@ -0,0 +1,127 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// Bounding volume hierarchy over the triangles of a mesh, in the mesh's own
+// space. It's immutable once built, so every node using the mesh shares one.
+// The layout is the same in memory as in the <mesh>.col package sidecar, so a
+// sidecar that is stored uncompressed is used straight from the mapping.
+class CollisionShape
+{
+public:
+	enum { LEAF_SIZE = 8 };
+
+	struct Node
+	{
+		irr::f32 Min[3];
+		irr::f32 Max[3];
+		irr::u32 Start; // first triangle of a leaf, or the right child
+		irr::u32 Count; // triangles in a leaf, 0 for an inner node
+	};
+
+	struct Triangle
+	{
+		irr::f32 V[9];
+	};
+
+private:
+	const Node* m_Nodes;
+	irr::u32 m_NodeCount;
+	const Triangle* m_Triangles;
+	irr::u32 m_TriangleCount;
+
+	std::vector<irr::u8> m_Data;    // when built or copied
+	irr::io::IReadFile* m_File;     // when used in place
+
+public:
+	~CollisionShape(void);
+
+	// Null for an empty mesh
+	static std::shared_ptr<const CollisionShape> Build(irr::scene::IMesh* mesh);
+
+	// Null if the sidecar is damaged or was built from a different mesh
+	static std::shared_ptr<const CollisionShape> Load(irr::io::IReadFile* file, irr::u32 sourceTriangles);
+
+	const std::vector<irr::u8>& GetData(void) const { return m_Data; }
+
+	irr::u32 GetTriangleCount(void) const { return m_TriangleCount; }
+	irr::core::aabbox3df GetBounds(void) const;
+
+	// Triangles overlapping a box or crossing a line, all in the mesh's space
+	void Query(const irr::core::aabbox3df& box, std::vector<irr::u32>& triangles) const;
+	void Query(const irr::core::line3df& line, std::vector<irr::u32>& triangles) const;
+
+	irr::core::triangle3df GetTriangle(irr::u32 index) const;
+
+	static irr::u32 CountTriangles(irr::scene::IMesh* mesh);
+
+private:
+	CollisionShape(void);
+	bool Attach(const irr::u8* data, size_t size, irr::u32 sourceTriangles);
+};
+
+// A node's view of a shared shape; the node's transform is applied per query
+class CollisionSelector : public irr::scene::ITriangleSelector
+{
+private:
+	std::shared_ptr<const CollisionShape> m_Shape;
+	irr::scene::ISceneNode* m_Node;
+
+public:
+	CollisionSelector(const std::shared_ptr<const CollisionShape>& shape, irr::scene::ISceneNode* node);
+
+	irr::s32 getTriangleCount() const;
+
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::matrix4* transform = 0) const;
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::aabbox3d<irr::f32>& box,
+		const irr::core::matrix4* transform = 0) const;
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::line3d<irr::f32>& line,
+		const irr::core::matrix4* transform = 0) const;
+
+	irr::scene::ISceneNode* getSceneNodeForTriangle(irr::u32 triangleIndex) const;
+	irr::u32 getSelectorCount() const;
+	irr::scene::ITriangleSelector* getSelector(irr::u32 index);
+	const irr::scene::ITriangleSelector* getSelector(irr::u32 index) const;
+
+private:
+	void Output(const std::vector<irr::u32>& indices, irr::core::triangle3df* triangles,
+		irr::s32 arraySize, irr::s32& outTriangleCount, const irr::core::matrix4* transform) const;
+};
+
+// One shape per mesh, read from the package sidecar when there is one
+class CollisionCache
+{
+private:
+	irr::scene::ISceneManager* m_SceneMgr;
+
+	typedef std::map<irr::scene::IMesh*, std::weak_ptr<const CollisionShape>> shapemap_t;
+	shapemap_t m_Shapes; // the meshes are held so their address can't be reused
+
+public:
+	CollisionCache(void);
+	~CollisionCache(void);
+
+	void SetSceneMgr(irr::scene::ISceneManager* sceneMgr);
+
+	// Null if the mesh is empty
+	std::shared_ptr<const CollisionShape> GetShape(irr::scene::IMesh* mesh);
+
+	// The selector for a node: shared for static meshes, the node's bounds otherwise
+	irr::scene::ITriangleSelector* CreateSelector(irr::scene::ISceneNode* node);
+
+private:
+	void Clear(void);
+};
@@ -4,16 +4,22 @@
 * Copyright (c) 2023 James Kinnaird
 */
 
+#include "Clipboard.hpp"
 #include "Commands.hpp"
 #include "Component.hpp"
 #include "Convert.hpp"
 #include "../extend/CylinderSceneNode.hpp"
 #include "../extend/PathSceneNode.hpp"
 #include "../extend/PlaneSceneNode.hpp"
+#include "../extend/TerrainSceneNode.hpp"
 
+#include <wx/hashmap.h>
 #include <wx/log.h>
 #include <wx/sstream.h>
 
+#include <map>
+#include <unordered_set>
+
 AddNodeCommand::AddNodeCommand(TOOLID toolId,
 	ExplorerPanel* explorerPanel,
 	irr::scene::ISceneManager* sceneMgr,
@@ -22,7 +28,7 @@ AddNodeCommand::AddNodeCommand(TOOLID toolId,
 	const wxString& name)
 	: m_ToolId(toolId), m_ExplorerPanel(explorerPanel),
 	  m_SceneMgr(sceneMgr), m_MapRoot(mapRoot), 
-	  m_Map(map), m_Position(position), m_Name(name)
+	  m_Map(map), m_Position(position), m_Name(name), m_Node(nullptr)
 {
 	// handle TOOL_ACTOR
 	if (m_ToolId == TOOL_ACTOR)
@@ -52,7 +58,7 @@ AddNodeCommand::AddNodeCommand(const wxString& nodeType,
 	const wxString& name)
 	: m_ExplorerPanel(explorerPanel),
 	m_SceneMgr(sceneMgr), m_MapRoot(mapRoot),
-	m_Map(map), m_Name(name)
+	m_Map(map), m_Name(name), m_Node(nullptr)
 {
 	// convert from nodeType string to TOOLID
 	if (nodeType.CmpNoCase("cube") == 0)
@@ -63,7 +69,7 @@ AddNodeCommand::AddNodeCommand(const wxString& nodeType,
 		m_ToolId = TOOL_SPHERE;
 	else if (nodeType.CmpNoCase("plane") == 0)
 		m_ToolId = TOOL_PLANE;
-	else if (nodeType.CmpNoCase("terrain") == 0)
+	else if (nodeType.CmpNoCase("chunkterrain") == 0)
 		m_ToolId = TOOL_TERRAIN;
 	else if (nodeType.CmpNoCase("skydome") == 0)
 		m_ToolId = TOOL_SKYBOX;
@@ -99,13 +105,15 @@ bool AddNodeCommand::CanUndo(void) const
 bool AddNodeCommand::Do(void)
 {
 	irr::scene::IMeshSceneNode* node = nullptr;
-	//irr::scene::ITerrainSceneNode* terrain = nullptr;
+	irr::scene::ISceneNode* terrain = nullptr;
 	irr::scene::ISceneNode* skybox = nullptr;
+	std::shared_ptr<const ActorTemplate> actorComponents; // added once the entity exists
 
 	irr::io::IAttributes* attribs = m_SceneMgr->getFileSystem()->createEmptyAttributes(nullptr);
 
 	bool isGeometry = false;
 	bool isActor = false;
+	m_Node = nullptr;
 
 	switch (m_ToolId)
 	{
@@ -131,18 +139,8 @@ bool AddNodeCommand::Do(void)
 	} break;
 	case TOOL_TERRAIN:
 	{
-		//terrain = m_SceneMgr->addTerrainSceneNode("", m_Parent, NID_PICKABLE,
-		//	irr::core::vector3df(), irr::core::vector3df(), irr::core::vector3df(1),
-		//	irr::video::SColor(255, 255, 255, 255), 5, irr::scene::ETPS_17, 0, true);
-
-		//irr::video::IImage* baseHeightmap = m_SceneMgr->getVideoDriver()->createImage(
-		//	irr::video::ECF_R8G8B8, irr::core::dimension2du(512, 512));
-		//irr::video::IImage* baseTexture = m_SceneMgr->getVideoDriver()->createImageFromFile(
-		//	"../resource/textures/default.jpg");
-		//mesh = m_SceneMgr->getGeometryCreator()->createTerrainMesh(baseTexture,
-		//	baseHeightmap, irr::core::dimension2df(1, 1), 255, m_SceneMgr->getVideoDriver(),
-		//	irr::core::dimension2du(1, 1));
-		//attribs->addString("meshType", "terrain");
+		terrain = m_SceneMgr->addSceneNode("chunkterrain", m_MapRoot);
+		terrain->setID(NID_PICKABLE);
 		isGeometry = true;
 	} break;
 	case TOOL_SKYBOX:
@@ -174,6 +172,7 @@ bool AddNodeCommand::Do(void)
 			marker);
 		start->setTriangleSelector(selector);
 		selector->drop();
+		m_Node = start;
 		isActor = true;
 	} break;
 	case TOOL_LIGHT:
@@ -200,6 +199,7 @@ bool AddNodeCommand::Do(void)
 		light->setTriangleSelector(selector);
 		selector->drop();
 
+		m_Node = light;
 		isActor = true;
 	} break;
 	case TOOL_PATHNODE:
@@ -228,154 +228,24 @@ bool AddNodeCommand::Do(void)
 		pathNode->setTriangleSelector(selector);
 		selector->drop();
 
+		m_Node = pathNode;
 		isActor = true;
 	} break;
 	case TOOL_ACTOR:
 	{
-		// get the actor definition
-		wxString definition = m_ExplorerPanel->GetBrowser()->GetActorDefinition(m_Actor);
-		wxStringInputStream stream(definition);
-		wxXmlDocument doc(stream);
-		wxXmlNode* actorDefinition = doc.GetRoot();
-		if (!actorDefinition)
+		// get the compiled actor definition
+		std::shared_ptr<const ActorTemplate> actor = m_ExplorerPanel->GetBrowser()->GetActorTemplate(m_Actor);
+		if (!actor)
 			return false;
 
-		// get the mesh and texture
-		wxString mesh;
-		wxString texture;
-		std::map<irr::core::stringc, irr::io::IAttributes*> components;
-
 		// figure out the type of actor
-		wxString type = actorDefinition->GetAttribute("type");
-		if (type.CmpNoCase("Model") == 0)
+		if (actor->Type.CmpNoCase("Model") == 0)
 		{
-			wxXmlNode* child = actorDefinition->GetChildren();
-			if (!child)
-				return false;
-
-			while (child)
-			{
-				if (child->GetName().CmpNoCase("properties") == 0)
-				{
-					wxXmlNode* property = child->GetChildren();
-					while (property)
-					{
-						if (property->GetName().CmpNoCase("string") == 0)
-						{
-							if (property->HasAttribute("Mesh"))
-								mesh = property->GetAttribute("Mesh");
-							else if (property->HasAttribute("Texture"))
-								texture = property->GetAttribute("Texture");
-							else // add the attribute as user data
-							{
-								wxXmlAttribute* attribute = property->GetAttributes();
-								if (attribute) // we only have one attribute
-								{
-									wxString key = attribute->GetName();
-									wxString value = attribute->GetValue();
-									attribs->addString(key.c_str().AsChar(), value.c_str().AsChar());
-								}
-							}
-						}
-						else if (property->GetName().CmpNoCase("float") == 0)
-						{
-							wxXmlAttribute* attribute = property->GetAttributes();
-							if (attribute) // we only have one attribute
-							{
-								wxString key = attribute->GetName();
-								wxString value = attribute->GetValue();
-								attribs->addFloat(key.c_str().AsChar(), valueToFloat(value));
-							}
-						}
-						else if (property->GetName().CmpNoCase("int") == 0)
-						{
-							wxXmlAttribute* attribute = property->GetAttributes();
-							if (attribute) // we only have one attribute
-							{
-								wxString key = attribute->GetName();
-								wxString value = attribute->GetValue();
-								attribs->addInt(key.c_str().AsChar(), valueToInt(value));
-							}
-						}
-						else if (property->GetName().CmpNoCase("vec2") == 0)
-						{
-							wxXmlAttribute* attribute = property->GetAttributes();
-							if (attribute) // we only have one attribute
-							{
-								wxString key = attribute->GetName();
-								wxString value = attribute->GetValue();
-								attribs->addVector2d(key.c_str().AsChar(), valueToVec2(value));
-							}
-						}
-						else if (property->GetName().CmpNoCase("vec3") == 0)
-						{
-							wxXmlAttribute* attribute = property->GetAttributes();
-							if (attribute) // we only have one attribute
-							{
-								wxString key = attribute->GetName();
-								wxString value = attribute->GetValue();
-								attribs->addVector3d(key.c_str().AsChar(), valueToVec3(value));
-							}
-						}
-						
-						property = property->GetNext();
-					}
-				}
-				else if (child->GetName().CmpNoCase("components") == 0)
-				{
-					wxXmlNode* component = child->GetChildren();
-					while (component)
-					{
-						if (component->GetName().CmpNoCase("component") == 0)
-						{
-							wxXmlAttribute* attribute = component->GetAttributes();
-							wxString componentName = attribute->GetValue();
-							
-							// create attributes
-							irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes(nullptr);
-							wxXmlNode* property = component->GetChildren();
-							while (property)
-							{
-								wxXmlAttribute* attribute = property->GetAttributes();
-								wxString key = attribute->GetName();
-								wxString value = attribute->GetValue();
-								if (property->GetName().CmpNoCase("int") == 0)
-								{
-									attributes->addInt(key.c_str(), valueToInt(value));
-								}
-								else if (property->GetName().CmpNoCase("float") == 0)
-								{
-									attributes->addFloat(key.c_str(), valueToFloat(value));
-								}
-								else if (property->GetName().CmpNoCase("string") == 0)
-								{
-									attributes->addString(key.c_str().AsChar(), value.c_str().AsChar());
-								}
-								else if (property->GetName().CmpNoCase("vec2") == 0)
-								{
-									attributes->addVector2d(key.c_str(), valueToVec2(value));
-								}
-								else if (property->GetName().CmpNoCase("vec3") == 0)
-								{
-									attributes->addVector3d(key.c_str(), valueToVec3(value));
-								}
-
-								property = property->GetNext();
-							}
-
-							// add to the component map
-							components[componentName.c_str().AsChar()] = attributes;
-						}
-
-						component = component->GetNext();
-					}
-				}
-			
-				child = child->GetNext();
-			}
+			// custom properties become user data
+			actor->Properties.Apply(attribs);
 
 			// add a model actor
-			irr::scene::IAnimatedMesh* animatedMesh = m_SceneMgr->getMesh(mesh.c_str().AsChar());
+			irr::scene::IAnimatedMesh* animatedMesh = m_SceneMgr->getMesh(actor->Mesh.c_str().AsChar());
 			if (!animatedMesh)
 				return false;
 
@@ -387,17 +257,16 @@ bool AddNodeCommand::Do(void)
 			model->setMaterialFlag(irr::video::EMF_LIGHTING, false);
 
 			// set the texture
-			if (!texture.IsEmpty())
+			if (!actor->Texture.IsEmpty())
 				model->setMaterialTexture(0, m_SceneMgr->getVideoDriver()->getTexture(
-			 		texture.c_str().AsChar()));
+			 		actor->Texture.c_str().AsChar()));
 			else
 				model->setMaterialTexture(0, m_SceneMgr->getVideoDriver()->getTexture(
 			 		"editor.mpk:textures/default.jpg"));
 
 			if (!model->getTriangleSelector())
 			{
-				irr::scene::ITriangleSelector* selector = m_SceneMgr->createTriangleSelector(
-					model->getMesh(), model);
+				irr::scene::ITriangleSelector* selector = m_Map->CreateTriangleSelector(model);
 				if (selector)
 				{
 					model->setTriangleSelector(selector);
@@ -405,21 +274,8 @@ bool AddNodeCommand::Do(void)
 				}
 			}
 
-			// add the components
-			for (std::map<irr::core::stringc, irr::io::IAttributes*>::iterator it = components.begin();
-				it != components.end(); ++it)
-			{
-				// irr::scene::ISceneNodeAnimator* anim = new Component(
-				// 	ComponentFactory::HashComponentName(it->first.c_str()), it->second);
-				irr::scene::ISceneNodeAnimator* anim = m_SceneMgr->createSceneNodeAnimator(it->first.c_str());
-				if (anim)
-				{
-					anim->deserializeAttributes(it->second);
-					model->addAnimator(anim);
-				}
-
-				it->second->drop();
-			}
+			m_Node = model;
+			actorComponents = actor;
 		}
 
 		isActor = true;
@@ -433,6 +289,7 @@ bool AddNodeCommand::Do(void)
 			true);
 
 		sceneNode->setName(m_Name.c_str());
+		m_Node = sceneNode;
 		isActor = true;
 	} break;
 	case TOOL_MESH:
@@ -489,14 +346,15 @@ bool AddNodeCommand::Do(void)
 
 			if (!node->getTriangleSelector())
 			{
-				irr::scene::ITriangleSelector* selector = m_SceneMgr->createTriangleSelector(
-					node->getMesh(), node);
+				irr::scene::ITriangleSelector* selector = m_Map->CreateTriangleSelector(node);
 				if (selector)
 				{
 					node->setTriangleSelector(selector);
 					selector->drop();
 				}
 			}
+
+			m_Node = node;
 		}
 		else
 			return false;
@@ -517,6 +375,7 @@ bool AddNodeCommand::Do(void)
 
 	if (node)
 	{
+		m_Node = node;
 		node->setName(m_Name.c_str());
 		node->setPosition(m_Position);
 		node->setMaterialFlag(irr::video::EMF_LIGHTING, false);
@@ -525,8 +384,7 @@ bool AddNodeCommand::Do(void)
 
 		if (!node->getTriangleSelector())
 		{
-			irr::scene::ITriangleSelector* selector = m_SceneMgr->createTriangleSelector(
-				node->getMesh(), node);
+			irr::scene::ITriangleSelector* selector = m_Map->CreateTriangleSelector(node);
 			if (selector)
 			{
 				node->setTriangleSelector(selector);
@@ -535,35 +393,49 @@ bool AddNodeCommand::Do(void)
 		}
 	}
 
-	//if (terrain)
-	//{
-	//	terrain->setName(m_Name.c_str());
-	//	terrain->setMaterialFlag(irr::video::EMF_LIGHTING, false);
-	//	terrain->setMaterialTexture(0, m_SceneMgr->getVideoDriver()->getTexture(
-	//		"../resource/textures/default.jpg"));
-
-	//	if (!terrain->getTriangleSelector())
-	//	{
-	//		irr::scene::ITriangleSelector* selector = m_SceneMgr->createTriangleSelector(
-	//			terrain->getMesh(), terrain);
-	//		terrain->setTriangleSelector(selector);
-	//		selector->drop();
-	//	}
-
-	//	irr::io::IAttributes* attribs = m_SceneMgr->getFileSystem()->createEmptyAttributes(nullptr);
-	//	m_Map->AddEntity(m_Name, attribs);
-	//	m_ExplorerPanel->AddGeometry(m_Name);
-	//	return true;
-	//}
+	if (terrain)
+	{
+		m_Node = terrain;
+
+		// centre the heightfield on the position
+		const irr::core::aabbox3df& box = terrain->getBoundingBox();
+		terrain->setName(m_Name.c_str());
+		terrain->setPosition(m_Position - irr::core::vector3df(box.getCenter().X, 0, box.getCenter().Z));
+		terrain->setMaterialFlag(irr::video::EMF_LIGHTING, false);
+		terrain->setMaterialTexture(0, m_SceneMgr->getVideoDriver()->getTexture(
+			"editor.mpk:textures/default.jpg"));
+
+		irr::scene::ITriangleSelector* selector = m_Map->CreateTriangleSelector(terrain);
+		if (selector)
+		{
+			terrain->setTriangleSelector(selector);
+			selector->drop();
+		}
+	}
 
 	if (skybox)
 	{
+		m_Node = skybox;
 		skybox->setName(m_Name.c_str());
 		skybox->setMaterialFlag(irr::video::EMF_LIGHTING, false);
 	}
 
 	m_Map->AddEntity(m_Name, attribs);
 
+	if (actorComponents)
+	{
+		// the store fills in the component defaults, then apply the actor's overrides
+		for (ActorTemplate::componentlist_t::const_iterator it = actorComponents->Components.begin();
+			it != actorComponents->Components.end(); ++it)
+		{
+			irr::io::IAttributes* component = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+			component->addString("Type", it->first.c_str());
+			it->second.Apply(component);
+			m_Map->SetEntityComponent(m_Name, component);
+			component->drop();
+		}
+	}
+
 	if (isGeometry)
 		m_ExplorerPanel->AddGeometry(m_Name);
 	if (isActor)
@@ -948,6 +820,219 @@ bool ResizeNodeCommand::Undo(void)
 	return Do(); // we store the previous details in Do()
 }
 
+ChangeTerrainCommand::ChangeTerrainCommand(irr::scene::ISceneNode* node,
+	const irr::c8* attribute, const wxString& value)
+	: m_SceneMgr(node->getSceneManager()), m_Name(node->getName()),
+	m_Attribute(attribute), m_Value(value), m_Saved(false), m_Width(0), m_Depth(0),
+	m_Modified(false)
+{
+}
+
+ChangeTerrainCommand::~ChangeTerrainCommand(void)
+{
+}
+
+bool ChangeTerrainCommand::CanUndo(void) const
+{
+	return true;
+}
+
+bool ChangeTerrainCommand::Do(void)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(m_Name);
+	if (!node || node->getType() != (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		return false;
+
+	TerrainSceneNode* terrain = static_cast<TerrainSceneNode*>(node);
+
+	// these reload the heightfield, so keep the one being replaced
+	bool reloads = m_Attribute == "Heightmap" || m_Attribute == "Size";
+	irr::u32 width = 0, depth = 0;
+	std::vector<irr::f32> heights;
+	bool modified = false;
+	if (reloads)
+		terrain->getHeightfield(width, depth, heights, modified);
+
+	irr::io::IAttributes* attribs = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+	node->serializeAttributes(attribs);
+
+	// swap the values, Undo runs this again
+	wxString oldValue(attribs->getAttributeAsString(m_Attribute.c_str()).c_str());
+	attribs->setAttribute(m_Attribute.c_str(), m_Value.c_str().AsChar());
+	m_Value = oldValue;
+
+	node->deserializeAttributes(attribs);
+	attribs->drop();
+
+	if (reloads)
+	{
+		// put back what this side had before the last swap
+		if (m_Saved)
+			terrain->setHeightfield(m_Width, m_Depth, m_Heights, m_Modified);
+
+		m_Saved = true;
+		m_Width = width;
+		m_Depth = depth;
+		m_Heights.swap(heights);
+		m_Modified = modified;
+	}
+
+	// the selector reads the heightfield, but its size may have changed
+	irr::scene::ITriangleSelector* selector = terrain->createTriangleSelector();
+	node->setTriangleSelector(selector);
+	selector->drop();
+
+	return true;
+}
+
+wxString ChangeTerrainCommand::GetName(void) const
+{
+	return _("Change terrain");
+}
+
+bool ChangeTerrainCommand::Undo(void)
+{
+	return Do();
+}
+
+SculptTerrainCommand::SculptTerrainCommand(irr::scene::ISceneNode* node)
+	: m_SceneMgr(node->getSceneManager()), m_Name(node->getName())
+{
+}
+
+SculptTerrainCommand::~SculptTerrainCommand(void)
+{
+}
+
+bool SculptTerrainCommand::CanUndo(void) const
+{
+	return true;
+}
+
+bool SculptTerrainCommand::Do(void)
+{
+	// stored while sculpting, so this is only reached on redo
+	return Restore(m_After);
+}
+
+wxString SculptTerrainCommand::GetName(void) const
+{
+	return _("Sculpt terrain");
+}
+
+bool SculptTerrainCommand::Undo(void)
+{
+	return Restore(m_Before);
+}
+
+bool SculptTerrainCommand::Apply(const irr::core::vector3df& point, irr::f32 radius, irr::f32 strength)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(m_Name);
+	if (!node || node->getType() != (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		return false;
+
+	TerrainSceneNode* terrain = static_cast<TerrainSceneNode*>(node);
+
+	std::vector<irr::u32> chunks;
+	terrain->getChunksInRect(terrain->getBrushRect(point, radius), chunks);
+	for (std::vector<irr::u32>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+	{
+		if (m_Before.find(*chunk) == m_Before.end())
+			terrain->getHeights(terrain->getChunkRect(*chunk), m_Before[*chunk]);
+	}
+
+	terrain->sculpt(point, radius, strength);
+	return true;
+}
+
+void SculptTerrainCommand::Finish(void)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(m_Name);
+	if (!node || node->getType() != (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		return;
+
+	TerrainSceneNode* terrain = static_cast<TerrainSceneNode*>(node);
+	for (chunks_t::iterator chunk = m_Before.begin(); chunk != m_Before.end(); ++chunk)
+		terrain->getHeights(terrain->getChunkRect(chunk->first), m_After[chunk->first]);
+}
+
+bool SculptTerrainCommand::Restore(const chunks_t& chunks)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(m_Name);
+	if (!node || node->getType() != (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		return false;
+
+	TerrainSceneNode* terrain = static_cast<TerrainSceneNode*>(node);
+	for (chunks_t::const_iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+		terrain->setHeights(terrain->getChunkRect(chunk->first), chunk->second);
+
+	return true;
+}
+
+BakeLightingCommand::BakeLightingCommand(std::shared_ptr<Map>& map,
+	const Lightmapper::lightmaps_t& lightmaps)
+	: m_Map(map)
+{
+	for (Lightmapper::lightmaps_t::const_iterator i = lightmaps.begin(); i != lightmaps.end(); ++i)
+	{
+		irr::video::ITexture* before = m_Map->GetLightmap(i->first);
+		if (before)
+			before->grab();
+		m_Before[i->first] = before;
+
+		irr::video::ITexture* after = m_Map->CreateLightmap(i->first, i->second);
+		if (after)
+		{
+			after->grab();
+			m_After[i->first] = after;
+		}
+	}
+}
+
+BakeLightingCommand::~BakeLightingCommand(void)
+{
+	for (textures_t::iterator i = m_Before.begin(); i != m_Before.end(); ++i)
+	{
+		if (i->second)
+			i->second->drop();
+	}
+
+	for (textures_t::iterator i = m_After.begin(); i != m_After.end(); ++i)
+		i->second->drop();
+}
+
+bool BakeLightingCommand::CanUndo(void) const
+{
+	return true;
+}
+
+bool BakeLightingCommand::Do(void)
+{
+	for (textures_t::iterator i = m_After.begin(); i != m_After.end(); ++i)
+		m_Map->SetLightmap(i->first, i->second);
+
+	return true;
+}
+
+wxString BakeLightingCommand::GetName(void) const
+{
+	return _("Recompute lighting");
+}
+
+bool BakeLightingCommand::Undo(void)
+{
+	for (textures_t::iterator i = m_Before.begin(); i != m_Before.end(); ++i)
+		m_Map->SetLightmap(i->first, i->second);
+
+	return true;
+}
+
+void BakeLightingCommand::Update(void)
+{
+	for (textures_t::iterator i = m_After.begin(); i != m_After.end(); ++i)
+		m_Map->UpdateLightmap(i->first);
+}
+
 ChangeColorCommand::ChangeColorCommand(COLOR_TYPE type, irr::scene::ISceneNode* node,
 	irr::u32 material, const irr::video::SColorf& color)
 	: m_SceneMgr(node->getSceneManager()), m_Type(type), 
@@ -1298,6 +1383,12 @@ DeleteNodeCommand::DeleteNodeCommand(ExplorerPanel* explorerPanel,
 
 DeleteNodeCommand::~DeleteNodeCommand(void)
 {
+	for (componentmap_t::iterator item = m_Components.begin();
+		item != m_Components.end(); ++item)
+	{
+		for (irr::u32 i = 0; i < item->second.size(); ++i)
+			item->second[i]->drop();
+	}
 }
 
 bool DeleteNodeCommand::CanUndo(void) const
@@ -1311,6 +1402,7 @@ bool DeleteNodeCommand::Do(void)
 	opts.Filename = ".";
 	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
 
+	m_ExplorerPanel->BeginUpdate();
 	for (selection_t::iterator item = m_Selection.begin();
 		item != m_Selection.end(); ++item)
 	{
@@ -1356,10 +1448,19 @@ bool DeleteNodeCommand::Do(void)
 			}
 		}
 
+		// the components go with the entity, keep them for undo
+		irr::core::array<irr::io::IAttributes*>& components = m_Components[(*item)];
+		for (irr::u32 i = 0; i < components.size(); ++i)
+			components[i]->drop();
+		components.clear();
+		m_Map->GetEntityComponents((*item), components);
+
 		m_Map->RemoveEntity((*item));
 		node->remove();
 	}
 
+	m_ExplorerPanel->EndUpdate();
+
 	return true;
 }
 
@@ -1374,6 +1475,7 @@ bool DeleteNodeCommand::Undo(void)
 	opts.Filename = ".";
 	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
 
+	m_ExplorerPanel->BeginUpdate();
 	for (selection_t::iterator item = m_Selection.begin();
 		item != m_Selection.end(); ++item)
 	{
@@ -1394,9 +1496,7 @@ bool DeleteNodeCommand::Undo(void)
 			// set the triangle selector
 			if (node->getType() != irr::scene::ESNT_SKY_DOME)
 			{
-				irr::scene::IMeshSceneNode* meshNode = static_cast<irr::scene::IMeshSceneNode*>(node);
-				irr::scene::ITriangleSelector* selector = m_SceneMgr->createTriangleSelector(
-					meshNode->getMesh(), meshNode);
+				irr::scene::ITriangleSelector* selector = m_Map->CreateTriangleSelector(node);
 				node->setTriangleSelector(selector);
 				selector->drop();
 			}
@@ -1438,11 +1538,314 @@ bool DeleteNodeCommand::Undo(void)
 		}
 
 		m_Map->AddEntity((*item), _item->second);
+
+		componentmap_t::iterator components = m_Components.find((*item));
+		if (components != m_Components.end())
+		{
+			for (irr::u32 i = 0; i < components->second.size(); ++i)
+				m_Map->SetEntityComponent((*item), components->second[i]);
+		}
 	}
 
+	m_ExplorerPanel->EndUpdate();
+
 	return true;
 }
 
+PasteNodesCommand::PasteNodesCommand(ExplorerPanel* explorerPanel,
+	irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* mapRoot,
+	std::shared_ptr<Map>& map, const std::vector<irr::u8>& data)
+	: m_ExplorerPanel(explorerPanel), m_SceneMgr(sceneMgr), m_MapRoot(mapRoot),
+	  m_Map(map), m_Data(data)
+{
+}
+
+bool PasteNodesCommand::CanUndo(void) const
+{
+	return true;
+}
+
+bool PasteNodesCommand::Do(void)
+{
+	EntityClipboard::entities_t entities;
+	if (!EntityClipboard::Decode(m_Data, m_SceneMgr, entities))
+	{
+		wxLogWarning(_("The clipboard contents can't be read by this version of the editor"));
+		return false;
+	}
+
+	// name the copies after the originals, minus their number, all reserved
+	// together
+	if (m_Names.size() != entities.size())
+	{
+		std::vector<wxString> bases;
+		bases.reserve(entities.size());
+		for (size_t i = 0; i < entities.size(); ++i)
+		{
+			wxString base(entities[i].Name);
+			while (!base.IsEmpty() && wxIsdigit(base.Last()))
+				base.RemoveLast();
+
+			bases.push_back(base);
+		}
+
+		m_Names.clear();
+		m_Map->NextNames(bases, m_Names);
+	}
+
+	std::map<irr::core::stringc, irr::core::stringc> renamed;
+	for (size_t i = 0; i < entities.size(); ++i)
+		renamed[entities[i].Name.c_str().AsChar()] = m_Names[i].c_str().AsChar();
+
+	m_Pasted.clear();
+	m_Nodes.clear();
+	std::vector<PathSceneNode*> paths;
+
+	m_ExplorerPanel->BeginUpdate();
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		EntityClipboard::Entity& entity = entities[i];
+		entity.Attributes->setAttribute("Name", m_Names[i].c_str().AsChar());
+
+		// keep the links inside the pasted path, drop the ones leaving it
+		static const irr::c8* links[] = { "NextNode", "PrevNode" };
+		for (size_t l = 0; l < sizeof(links) / sizeof(links[0]); ++l)
+		{
+			if (!entity.Attributes->existsAttribute(links[l]))
+				continue;
+
+			std::map<irr::core::stringc, irr::core::stringc>::iterator link =
+				renamed.find(entity.Attributes->getAttributeAsString(links[l]));
+			entity.Attributes->setAttribute(links[l],
+				link != renamed.end() ? link->second.c_str() : "");
+		}
+
+		irr::scene::ISceneNode* node = m_Map->CreateEntity(entity.Type, m_Names[i],
+			entity.Attributes, entity.Materials, entity.Animators, entity.UserData,
+			m_ExplorerPanel);
+		if (!node)
+		{
+			wxLogWarning(_("Unable to paste %s, its type is unknown"), entity.Name);
+			continue;
+		}
+
+		m_Pasted.push_back(m_Names[i]);
+		m_Nodes.push_back(node);
+		if (node->getType() == ESNT_PATHNODE)
+			paths.push_back(dynamic_cast<PathSceneNode*>(node));
+	}
+	m_ExplorerPanel->EndUpdate();
+
+	// the links can only be drawn once both ends exist
+	for (size_t i = 0; i < paths.size(); ++i)
+		paths[i]->drawLink(true);
+
+	EntityClipboard::Drop(entities);
+	return !m_Pasted.empty();
+}
+
+wxString PasteNodesCommand::GetName(void) const
+{
+	return _("Paste");
+}
+
+bool PasteNodesCommand::Undo(void)
+{
+	std::unordered_set<wxString, wxStringHash, wxStringEqual> pasted(
+		m_Pasted.begin(), m_Pasted.end());
+
+	// one pass over the map instead of a scene search per entity; the nodes
+	// from Do may have been replaced by a later delete and its undo
+	std::vector<irr::scene::ISceneNode*> nodes;
+	const irr::core::list<irr::scene::ISceneNode*>& children = m_MapRoot->getChildren();
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin();
+		it != children.end(); ++it)
+	{
+		if (pasted.find(wxString((*it)->getName())) != pasted.end())
+			nodes.push_back(*it);
+	}
+
+	for (size_t i = 0; i < nodes.size(); ++i)
+		nodes[i]->remove();
+
+	m_ExplorerPanel->BeginUpdate();
+	for (selection_t::iterator item = m_Pasted.begin();
+		item != m_Pasted.end(); ++item)
+	{
+		if (m_ExplorerPanel->IsGeometry((*item)))
+			m_ExplorerPanel->RemoveGeometry((*item));
+		else if (m_ExplorerPanel->IsActor((*item)))
+			m_ExplorerPanel->RemoveActor((*item));
+
+		m_Map->RemoveEntity((*item));
+	}
+	m_ExplorerPanel->EndUpdate();
+
+	m_Pasted.clear();
+	m_Nodes.clear();
+	return true;
+}
+
+const PasteNodesCommand::selection_t& PasteNodesCommand::GetPasted(void) const
+{
+	return m_Pasted;
+}
+
+const std::vector<irr::scene::ISceneNode*>& PasteNodesCommand::GetPastedNodes(void) const
+{
+	return m_Nodes;
+}
+
+ArrayNodeCommand::ArrayNodeCommand(ExplorerPanel* explorerPanel,
+	irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* mapRoot,
+	std::shared_ptr<Map>& map, const wxString& source,
+	const std::vector<ArrayPlacement>& placements)
+	: m_ExplorerPanel(explorerPanel), m_SceneMgr(sceneMgr), m_MapRoot(mapRoot),
+	  m_Map(map), m_Source(source), m_Placements(placements)
+{
+}
+
+bool ArrayNodeCommand::CanUndo(void) const
+{
+	return true;
+}
+
+bool ArrayNodeCommand::Do(void)
+{
+	irr::scene::ISceneNode* source = m_SceneMgr->getSceneNodeFromName(
+		m_Source.c_str().AsChar(), m_MapRoot);
+	if (!source || m_Placements.empty())
+		return false;
+
+	bool isActor = m_ExplorerPanel->IsActor(m_Source);
+
+	// the names are reserved together, named after the source minus its number
+	if (m_Names.size() != m_Placements.size())
+	{
+		wxString base(m_Source);
+		while (!base.IsEmpty() && wxIsdigit(base.Last()))
+			base.RemoveLast();
+
+		m_Names.clear();
+		m_Map->NextNames(base, m_Placements.size(), m_Names);
+	}
+
+	// the source's data is read once for all the copies
+	irr::io::IAttributes* userData = m_Map->GetAttributes(m_Source);
+	irr::core::array<irr::io::IAttributes*> components;
+	m_Map->GetEntityComponents(m_Source, components);
+
+	m_Copies.clear();
+	m_ExplorerPanel->BeginUpdate();
+	for (size_t i = 0; i < m_Placements.size(); ++i)
+	{
+		// a clone shares the source's mesh and copies its materials
+		irr::scene::ISceneNode* node = source->clone(m_MapRoot, m_SceneMgr);
+		if (!node)
+		{
+			wxLogWarning(_("%s can't be copied"), m_Source);
+			break;
+		}
+
+		node->setName(m_Names[i].c_str().AsChar());
+		node->setPosition(m_Placements[i].Position);
+		node->setRotation(m_Placements[i].Rotation);
+		node->setScale(m_Placements[i].Scale);
+		node->setDebugDataVisible(irr::scene::EDS_OFF);
+
+		// the selector can't be the source's, it holds the node it transforms by
+		irr::scene::ISceneNode* marker = nullptr;
+		const irr::core::list<irr::scene::ISceneNode*>& children = node->getChildren();
+		for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = children.begin();
+			child != children.end() && !marker; ++child)
+		{
+			if ((*child)->getID() & NID_NOSAVE)
+				marker = *child;
+		}
+
+		irr::scene::ITriangleSelector* selector = nullptr;
+		if (marker)
+		{
+			wxString markerName(m_Names[i]);
+			markerName.append(wxT("_marker"));
+			marker->setName(markerName.c_str().AsChar());
+			selector = m_SceneMgr->createTriangleSelectorFromBoundingBox(marker);
+		}
+		else
+			selector = m_Map->CreateTriangleSelector(node);
+
+		node->setTriangleSelector(selector);
+		if (selector)
+			selector->drop();
+
+		irr::io::IAttributes* attribs = m_SceneMgr->getFileSystem()->createEmptyAttributes(nullptr);
+		if (userData)
+			Map::CopyAttributes(attribs, userData);
+		m_Map->AddEntity(m_Names[i], attribs);
+
+		for (irr::u32 c = 0; c < components.size(); ++c)
+			m_Map->SetEntityComponent(m_Names[i], components[c]);
+
+		if (isActor)
+			m_ExplorerPanel->AddActor(m_Names[i]);
+		else
+			m_ExplorerPanel->AddGeometry(m_Names[i]);
+
+		m_Copies.push_back(m_Names[i]);
+	}
+	m_ExplorerPanel->EndUpdate();
+
+	for (irr::u32 c = 0; c < components.size(); ++c)
+		components[c]->drop();
+
+	return !m_Copies.empty();
+}
+
+wxString ArrayNodeCommand::GetName(void) const
+{
+	return wxString::Format(_("Array %s"), m_Source);
+}
+
+bool ArrayNodeCommand::Undo(void)
+{
+	std::unordered_set<wxString, wxStringHash, wxStringEqual> copies(
+		m_Copies.begin(), m_Copies.end());
+
+	// one pass over the map instead of a scene search per copy
+	std::vector<irr::scene::ISceneNode*> nodes;
+	const irr::core::list<irr::scene::ISceneNode*>& children = m_MapRoot->getChildren();
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin();
+		it != children.end(); ++it)
+	{
+		if (copies.find(wxString((*it)->getName())) != copies.end())
+			nodes.push_back(*it);
+	}
+
+	for (size_t i = 0; i < nodes.size(); ++i)
+		nodes[i]->remove();
+
+	m_ExplorerPanel->BeginUpdate();
+	for (selection_t::iterator item = m_Copies.begin();
+		item != m_Copies.end(); ++item)
+	{
+		if (m_ExplorerPanel->IsGeometry((*item)))
+			m_ExplorerPanel->RemoveGeometry((*item));
+		else if (m_ExplorerPanel->IsActor((*item)))
+			m_ExplorerPanel->RemoveActor((*item));
+
+		m_Map->RemoveEntity((*item));
+	}
+	m_ExplorerPanel->EndUpdate();
+
+	m_Copies.clear();
+	return true;
+}
+
+const ArrayNodeCommand::selection_t& ArrayNodeCommand::GetCopies(void) const
+{
+	return m_Copies;
+}
+
 UpdatePathNameCommand::UpdatePathNameCommand(irr::scene::ISceneManager* sceneMgr,
 	const wxString& pathNode, const wxString& pathName)
 	: m_SceneMgr(sceneMgr), m_PathNode(pathNode), m_PathName(pathName)
@@ -1702,54 +2105,71 @@ bool UpdateComponentAttributeCommand::Do(void)
 	if (node == nullptr)
 		return false;
 
-	// look up the animator
+	// components live in the map's store, anything else is a real animator
 	irr::io::IAttributes* attribs = m_Map->GetSceneMgr()->getFileSystem()->createEmptyAttributes();
-	const irr::scene::ISceneNodeAnimatorList animators = node->getAnimators();
-	for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animators.begin();
-		i != animators.end(); ++i)
+	ComponentStore& store = m_Map->GetComponentStore();
+	EntityHandle handle = m_Map->GetEntityHandle(m_SceneNode);
+	irr::scene::ISceneNodeAnimator* animator = nullptr;
+	if (!store.Read(handle, m_Component, attribs))
 	{
-		if ((*i)->getType() == m_Component)
+		const irr::scene::ISceneNodeAnimatorList animators = node->getAnimators();
+		for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animators.begin();
+			i != animators.end(); ++i)
 		{
-			(*i)->serializeAttributes(attribs);
-
-			wxString oldValue;
-
-			switch (m_Type)
+			if ((*i)->getType() == m_Component)
 			{
-			case irr::io::EAT_INT:
-				oldValue = wxString::Format("%d", attribs->getAttributeAsInt(m_Attribute.c_str().AsChar()));
-				attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToInt(m_Value));
-				break;
-			case irr::io::EAT_FLOAT:
-				oldValue = wxString::Format("%g", attribs->getAttributeAsFloat(m_Attribute.c_str().AsChar()));
-				attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToFloat(m_Value));
+				animator = (*i);
 				break;
-			case irr::io::EAT_STRING:
-				oldValue = wxString::Format("%s", attribs->getAttributeAsString(m_Attribute.c_str().AsChar()).c_str());
-				attribs->setAttribute(m_Attribute.c_str().AsChar(), m_Value.c_str().AsChar());
-				break;
-			case irr::io::EAT_VECTOR3D:
-			{
-				irr::core::vector3df vec = attribs->getAttributeAsVector3d(m_Attribute.c_str().AsChar());
-				oldValue = wxString::Format("%g; %g; %g", vec.X, vec.Y, vec.Z);
-				attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToVec3(m_Value));
-			} break;
-			case irr::io::EAT_VECTOR2D:
-			{
-				irr::core::vector2df vec = attribs->getAttributeAsVector2d(m_Attribute.c_str().AsChar());
-				oldValue = wxString::Format("%g; %g", vec.X, vec.Y);
-				attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToVec2(m_Value));
-			} break;
 			}
+		}
 
-			// write the attribute back to the animator
-			(*i)->deserializeAttributes(attribs);
-
-			m_Value = oldValue; // for undo
-			break;
+		if (!animator)
+		{
+			attribs->drop();
+			return true;
 		}
+
+		animator->serializeAttributes(attribs);
 	}
 
+	wxString oldValue;
+
+	switch (m_Type)
+	{
+	case irr::io::EAT_INT:
+		oldValue = wxString::Format("%d", attribs->getAttributeAsInt(m_Attribute.c_str().AsChar()));
+		attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToInt(m_Value));
+		break;
+	case irr::io::EAT_FLOAT:
+		oldValue = wxString::Format("%g", attribs->getAttributeAsFloat(m_Attribute.c_str().AsChar()));
+		attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToFloat(m_Value));
+		break;
+	case irr::io::EAT_STRING:
+		oldValue = wxString::Format("%s", attribs->getAttributeAsString(m_Attribute.c_str().AsChar()).c_str());
+		attribs->setAttribute(m_Attribute.c_str().AsChar(), m_Value.c_str().AsChar());
+		break;
+	case irr::io::EAT_VECTOR3D:
+	{
+		irr::core::vector3df vec = attribs->getAttributeAsVector3d(m_Attribute.c_str().AsChar());
+		oldValue = wxString::Format("%g; %g; %g", vec.X, vec.Y, vec.Z);
+		attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToVec3(m_Value));
+	} break;
+	case irr::io::EAT_VECTOR2D:
+	{
+		irr::core::vector2df vec = attribs->getAttributeAsVector2d(m_Attribute.c_str().AsChar());
+		oldValue = wxString::Format("%g; %g", vec.X, vec.Y);
+		attribs->setAttribute(m_Attribute.c_str().AsChar(), valueToVec2(m_Value));
+	} break;
+	}
+
+	// write the attribute back
+	if (animator)
+		animator->deserializeAttributes(attribs);
+	else
+		store.Write(handle, m_Component, attribs);
+
+	m_Value = oldValue; // for undo
+
 	attribs->drop();
 
 	return true;
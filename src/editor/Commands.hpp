@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "ArrayTool.hpp"
 #include "Common.hpp"
 #include "ExplorerPanel.hpp"
 #include "Map.hpp"
@@ -14,7 +15,9 @@
 #include "irrlicht.h"
 
 #include <list>
+#include <map>
 #include <memory>
+#include <vector>
 
 class AddNodeCommand : public wxCommand
 {
@@ -28,6 +31,7 @@ protected:
 	wxString m_Name;
 	wxString m_Actor;
 	wxString m_Mesh;
+	irr::scene::ISceneNode* m_Node; // made by the last Do
 	
 public:
 	AddNodeCommand(TOOLID toolId,
@@ -49,6 +53,9 @@ public:
 	bool Do(void);
 	wxString GetName(void) const;
 	bool Undo(void);
+
+	// The entity's node, valid until the map next changes
+	irr::scene::ISceneNode* GetNode(void) const { return m_Node; }
 };
 
 class TranslateNodeCommand : public wxCommand
@@ -151,6 +158,87 @@ public:
 	bool Undo(void);
 };
 
+// changes one of a terrain's settings, rebuilding its heightfield
+class ChangeTerrainCommand : public wxCommand
+{
+private:
+	irr::scene::ISceneManager* m_SceneMgr;
+	wxString m_Name;
+	irr::core::stringc m_Attribute;
+	wxString m_Value;
+
+	// the heightfield the other side of the change had, so sculpting isn't
+	// lost to the reload when the heightmap or size is undone
+	bool m_Saved;
+	irr::u32 m_Width, m_Depth;
+	std::vector<irr::f32> m_Heights;
+	bool m_Modified;
+
+public:
+	ChangeTerrainCommand(irr::scene::ISceneNode* node,
+		const irr::c8* attribute, const wxString& value);
+	virtual ~ChangeTerrainCommand(void);
+
+	bool CanUndo(void) const;
+	bool Do(void);
+	wxString GetName(void) const;
+	bool Undo(void);
+};
+
+// one stroke of the sculpt tool; the chunks are snapshot as the brush first
+// touches them so undo only restores what the stroke changed
+class SculptTerrainCommand : public wxCommand
+{
+private:
+	typedef std::map<irr::u32, std::vector<irr::f32>> chunks_t;
+
+	irr::scene::ISceneManager* m_SceneMgr;
+	wxString m_Name;
+	chunks_t m_Before;
+	chunks_t m_After;
+
+public:
+	SculptTerrainCommand(irr::scene::ISceneNode* node);
+	virtual ~SculptTerrainCommand(void);
+
+	bool CanUndo(void) const;
+	bool Do(void);
+	wxString GetName(void) const;
+	bool Undo(void);
+
+	// applies a dab of the brush, storing the chunks it's about to change
+	bool Apply(const irr::core::vector3df& point, irr::f32 radius, irr::f32 strength);
+
+	// the stroke is done, keep the result for redo
+	void Finish(void);
+
+private:
+	bool Restore(const chunks_t& chunks);
+};
+
+// the lightmaps of a bake, the ones they replace are kept for undo
+class BakeLightingCommand : public wxCommand
+{
+private:
+	typedef std::map<wxString, irr::video::ITexture*> textures_t;
+
+	std::shared_ptr<Map> m_Map;
+	textures_t m_Before;
+	textures_t m_After;
+
+public:
+	BakeLightingCommand(std::shared_ptr<Map>& map, const Lightmapper::lightmaps_t& lightmaps);
+	virtual ~BakeLightingCommand(void);
+
+	bool CanUndo(void) const;
+	bool Do(void);
+	wxString GetName(void) const;
+	bool Undo(void);
+
+	// shows what the bake has drawn into the images so far
+	void Update(void);
+};
+
 class ChangeColorCommand : public wxCommand
 {
 public:
@@ -261,6 +349,9 @@ private:
 	itemmap_t m_Actors;
 	itemmap_t m_Materials;
 
+	typedef std::map<wxString, irr::core::array<irr::io::IAttributes*>> componentmap_t;
+	componentmap_t m_Components;
+
 	typedef std::map<wxString, irr::scene::ESCENE_NODE_TYPE> typemap_t;
 	typemap_t m_Type;
 
@@ -278,6 +369,76 @@ public:
 	bool Undo(void);
 };
 
+// Entities from the clipboard, renamed so they don't collide with the map's
+class PasteNodesCommand : public wxCommand
+{
+public:
+	typedef std::list<wxString> selection_t;
+
+private:
+	ExplorerPanel* m_ExplorerPanel;
+	irr::scene::ISceneManager* m_SceneMgr;
+	irr::scene::ISceneNode* m_MapRoot;
+	std::shared_ptr<Map> m_Map;
+
+	std::vector<irr::u8> m_Data;
+	std::vector<wxString> m_Names; // kept so a redo gives the same names
+
+	selection_t m_Pasted;
+	std::vector<irr::scene::ISceneNode*> m_Nodes; // made by the last Do
+
+public:
+	PasteNodesCommand(ExplorerPanel* explorerPanel,
+		irr::scene::ISceneManager* sceneMgr,
+		irr::scene::ISceneNode* mapRoot,
+		std::shared_ptr<Map>& map,
+		const std::vector<irr::u8>& data);
+
+	bool CanUndo(void) const;
+	bool Do(void);
+	wxString GetName(void) const;
+	bool Undo(void);
+
+	const selection_t& GetPasted(void) const;
+
+	// The pasted nodes, valid until the map next changes
+	const std::vector<irr::scene::ISceneNode*>& GetPastedNodes(void) const;
+};
+
+// Copies of one entity, made together and undone together
+class ArrayNodeCommand : public wxCommand
+{
+public:
+	typedef std::list<wxString> selection_t;
+
+private:
+	ExplorerPanel* m_ExplorerPanel;
+	irr::scene::ISceneManager* m_SceneMgr;
+	irr::scene::ISceneNode* m_MapRoot;
+	std::shared_ptr<Map> m_Map;
+
+	wxString m_Source;
+	std::vector<ArrayPlacement> m_Placements;
+	std::vector<wxString> m_Names; // kept so a redo gives the same names
+
+	selection_t m_Copies;
+
+public:
+	ArrayNodeCommand(ExplorerPanel* explorerPanel,
+		irr::scene::ISceneManager* sceneMgr,
+		irr::scene::ISceneNode* mapRoot,
+		std::shared_ptr<Map>& map,
+		const wxString& source,
+		const std::vector<ArrayPlacement>& placements);
+
+	bool CanUndo(void) const;
+	bool Do(void);
+	wxString GetName(void) const;
+	bool Undo(void);
+
+	const selection_t& GetCopies(void) const;
+};
+
 class UpdatePathNameCommand : public wxCommand
 {
 private:
@@ -36,6 +36,8 @@ enum TOOLID : int
     TOOL_SOUNDBROWSER,
     TOOL_MESHBROWSER,
     TOOL_CALCLIGHTING,
+    TOOL_BUILDNAVMESH,
+    TOOL_CHECKNAVIGATION,
     TOOL_PLAYMAP,
 
     MENU_NEW_MAP,
@@ -48,7 +50,12 @@ enum TOOLID : int
     MENU_ALIGNBOTTOM,
 
     MENU_SETTEXTURE,
+    MENU_ARRAY,
+    MENU_SCULPT,
     MENU_FREELOOK,
+    MENU_RESOLUTIONAUTO,
+    MENU_RESOLUTIONFULL,
+    MENU_RESOLUTIONHALF,
 
     MENU_BUILDPROJECT,
     MENU_CLEANPROJECT,
@@ -66,6 +73,8 @@ enum TOOLID : int
 
     MENU_PLAYSOUND,
     MENU_STOPSOUND,
+    MENU_PREVIEWSOUND,
+    MENU_SPATIALSOUND,
 
     MENU_ADDPROPERTY,
     MENU_ADDCOMPONENT,
@@ -5,7 +5,6 @@
 */
 
 #include "Component.hpp"
-#include "Convert.hpp"
 
 #include <wx/log.h>
 
@@ -134,7 +133,8 @@ void Component::serializeAttributes(irr::io::IAttributes *out,
 }
 
 irr::core::array<ComponentFactory::ComponentType> ComponentFactory::ms_SupportedComponentTypes;
-std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, wxXmlDocument> ComponentFactory::ms_ComponentDefinitions;
+TypeRegistry<irr::u32> ComponentFactory::ms_TypeIndex;
+std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, AttributeTemplate> ComponentFactory::ms_ComponentDefinitions;
 
 ComponentFactory::ComponentFactory(irr::scene::ISceneManager* sceneMgr)
     : m_SceneMgr(sceneMgr)
@@ -154,67 +154,20 @@ irr::scene::ISceneNodeAnimator* ComponentFactory::createSceneNodeAnimator(irr::s
     Component* anim = nullptr;
 
     // find the component type
-    for (irr::u32 i = 0; i < ms_SupportedComponentTypes.size(); ++i)
+    if (ms_TypeIndex.find((irr::u32)type))
     {
-        if (ms_SupportedComponentTypes[i].Type == type)
-        {
-            irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes();
-            anim = new Component(ms_SupportedComponentTypes[i].Type, attributes);
-            attributes->drop(); // grabbed by the component
-            break;
-        }
+        irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+        anim = new Component(type, attributes);
+        attributes->drop(); // grabbed by the component
     }
 
     if (anim)
     {
-        // read the component definition, if it exists
-        if (ms_ComponentDefinitions.find(type) != ms_ComponentDefinitions.end())
-        {
-            wxXmlDocument definition = ms_ComponentDefinitions[type];
-            wxXmlNode* attributes = definition.GetRoot()->GetChildren();
-            while (attributes)
-            {
-                // each attribute has a single key and value
-                wxXmlAttribute* attribute = attributes->GetAttributes();
-                wxString key = attribute->GetName();
-                wxString value = attribute->GetValue();
-
-                if (attributes->GetName().CompareTo(wxT("int"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addInt(key.c_str(), valueToInt(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("float"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addFloat(key.c_str(), valueToFloat(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("string"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addString(key.c_str().AsChar(), value.c_str().AsChar());
-                }
-                else if (attributes->GetName().CompareTo(wxT("bool"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addBool(key.c_str(), valueToBool(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("color"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addColor(key.c_str(), valueToColor(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("vec2"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addVector2d(key.c_str(), valueToVec2(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("vec3"), wxString::ignoreCase) == 0)
-                {
-                    anim->m_Attributes->addVector3d(key.c_str(), valueToVec3(value));
-                }
-                else if (attributes->GetName().CompareTo(wxT("texture"), wxString::ignoreCase) == 0)
-                {
-                    // anim->m_Attributes->addTexture(key.c_str(), value.c_str());
-                }
-
-                attributes = attributes->GetNext();
-            }
-        }
+        // copy in the compiled defaults, if the component has a definition
+        std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, AttributeTemplate>::const_iterator definition =
+            ms_ComponentDefinitions.find(type);
+        if (definition != ms_ComponentDefinitions.end())
+            definition->second.Apply(anim->m_Attributes);
 
         if (target)
             target->addAnimator(anim);
@@ -252,57 +205,48 @@ const irr::c8* ComponentFactory::getCreateableSceneNodeAnimatorTypeName(irr::u32
 
 const irr::c8* ComponentFactory::getCreateableSceneNodeAnimatorTypeName(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const
 {
-	for (irr::u32 i = 0; i < ms_SupportedComponentTypes.size(); ++i)
-	{
-		if (ms_SupportedComponentTypes[i].Type == type)
-			return ms_SupportedComponentTypes[i].TypeName.c_str();
-	}
+	const irr::u32* index = ms_TypeIndex.find((irr::u32)type);
+	if (index)
+		return ms_SupportedComponentTypes[*index].TypeName.c_str();
 
 	return nullptr;
 }
 
-// FNV1a hash found here: https://create.stephan-brumme.com/fnv-hash/
-inline uint32_t fnv1a(uint8_t byte, uint32_t hash)
-{
-    return (byte ^ hash) * 0x01000193;
-}
-
-inline uint32_t fnv1a_hash(const char* text, uint32_t hash)
-{
-    while (*text)
-        hash = fnv1a((uint8_t)*text++, hash);
-    return hash;
-}
-
 irr::scene::ESCENE_NODE_ANIMATOR_TYPE ComponentFactory::HashComponentName(const wxString& name)
 {
-    // create 32-bit hash of name
-    uint32_t hash = fnv1a_hash(name.c_str().AsChar(), 0x811c9dc5);
-    return (irr::scene::ESCENE_NODE_ANIMATOR_TYPE)hash;
+    // create 32-bit FNV-1a hash of name
+    return (irr::scene::ESCENE_NODE_ANIMATOR_TYPE)TypeRegistry<irr::u32>::hashName(name.c_str().AsChar());
 }
 
-void ComponentFactory::RegisterComponent(const wxString& name, const wxXmlDocument& definition)
+void ComponentFactory::RegisterComponent(const wxString& name, const AttributeTemplate& definition)
 {
+    // if the type already exists, don't add it
     irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = HashComponentName(name);
-    for (irr::u32 i = 0; i < ms_SupportedComponentTypes.size(); ++i)
-    {
-        // if the type already exists, don't add it
-        if (ms_SupportedComponentTypes[i].Type == type)
-            return;
-    }
+    if (ms_TypeIndex.find((irr::u32)type))
+        return;
 
     // add the new component type
+    ms_TypeIndex.insert((irr::u32)type, ms_SupportedComponentTypes.size());
     ms_SupportedComponentTypes.push_back(ComponentType(type, name));
     ms_ComponentDefinitions[type] = definition;
 }
 
+const AttributeTemplate* ComponentFactory::GetDefinition(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+    std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, AttributeTemplate>::const_iterator definition =
+        ms_ComponentDefinitions.find(type);
+    if (definition != ms_ComponentDefinitions.end())
+        return &definition->second;
+
+    return nullptr;
+}
+
 irr::scene::ESCENE_NODE_ANIMATOR_TYPE ComponentFactory::getTypeFromName(const irr::c8* name) const
 {
-    for (irr::u32 i = 0; i < ms_SupportedComponentTypes.size(); ++i)
-    {
-        if (ms_SupportedComponentTypes[i].TypeName == name)
-            return ms_SupportedComponentTypes[i].Type;
-    }
+    // component types are the hash of their name, the name still has to match
+    const irr::u32* index = ms_TypeIndex.find(TypeRegistry<irr::u32>::hashName(name));
+    if (index && ms_SupportedComponentTypes[*index].TypeName == name)
+        return ms_SupportedComponentTypes[*index].Type;
 
     return irr::scene::ESNAT_UNKNOWN;
 }
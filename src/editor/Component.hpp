@@ -10,7 +10,9 @@
 
 #include <irrlicht.h>
 #include <wx/string.h>
-#include <wx/xml/xml.h>
+
+#include "Definition.hpp"
+#include "../extend/TypeRegistry.hpp"
 
 class Component : public irr::scene::ISceneNodeAnimator
 {
@@ -56,7 +58,8 @@ private:
     };
 
     static irr::core::array<ComponentType> ms_SupportedComponentTypes;
-    static std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, wxXmlDocument> ms_ComponentDefinitions;
+    static TypeRegistry<irr::u32> ms_TypeIndex; // index into ms_SupportedComponentTypes by type
+    static std::map<irr::scene::ESCENE_NODE_ANIMATOR_TYPE, AttributeTemplate> ms_ComponentDefinitions;
 
 public:
     ComponentFactory(irr::scene::ISceneManager* sceneMgr);
@@ -75,7 +78,10 @@ public:
     const irr::c8* getCreateableSceneNodeAnimatorTypeName(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const;
 
     static irr::scene::ESCENE_NODE_ANIMATOR_TYPE HashComponentName(const wxString& name);
-    static void RegisterComponent(const wxString& name, const wxXmlDocument& definition);
+    static void RegisterComponent(const wxString& name, const AttributeTemplate& definition);
+
+    // The registered defaults of a component type, or null if it isn't one
+    static const AttributeTemplate* GetDefinition(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
 
 private:
     irr::scene::ESCENE_NODE_ANIMATOR_TYPE getTypeFromName(const irr::c8* name) const;
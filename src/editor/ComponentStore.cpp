@@ -0,0 +1,241 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "ComponentStore.hpp"
+#include "Component.hpp"
+
+#include <algorithm>
+
+bool ComponentStore::Add(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	const AttributeTemplate* definition = ComponentFactory::GetDefinition(type);
+	if (!definition || Has(entity, type))
+		return false;
+
+	Table& table = GetTable(type);
+
+	// make sure every default has a column
+	const std::vector<AttributeTemplate::Value>& defaults = definition->GetValues();
+	for (size_t i = 0; i < defaults.size(); ++i)
+	{
+		if (FindColumn(table, defaults[i].Name.c_str()) < 0)
+			AddColumn(table, defaults[i].Name.c_str(), defaults[i].Type);
+	}
+
+	irr::u32 row = (irr::u32)table.Rows.size();
+	table.Rows.push_back(entity);
+	table.RowIndex.insert(entity, row);
+	table.Cells.resize(table.Cells.size() + table.Columns.size());
+
+	AttributeValue* cells = &table.Cells[row * table.Columns.size()];
+	for (size_t i = 0; i < defaults.size(); ++i)
+	{
+		irr::s32 column = FindColumn(table, defaults[i].Name.c_str());
+		if (table.Columns[column].Type == defaults[i].Type)
+			cells[column] = defaults[i];
+	}
+
+	m_EntityTypes[entity].push_back(type);
+	return true;
+}
+
+void ComponentStore::Remove(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	Table* table = FindTable(type);
+	if (!table)
+		return;
+
+	const irr::u32* row = table->RowIndex.find(entity);
+	if (!row)
+		return;
+
+	RemoveRow(*table, *row);
+
+	entitytypes_t::iterator types = m_EntityTypes.find(entity);
+	if (types != m_EntityTypes.end())
+	{
+		types->second.erase(std::remove(types->second.begin(), types->second.end(), type),
+			types->second.end());
+		if (types->second.empty())
+			m_EntityTypes.erase(types);
+	}
+}
+
+void ComponentStore::RemoveEntity(EntityHandle entity)
+{
+	entitytypes_t::iterator types = m_EntityTypes.find(entity);
+	if (types == m_EntityTypes.end())
+		return;
+
+	for (size_t i = 0; i < types->second.size(); ++i)
+	{
+		Table* table = FindTable(types->second[i]);
+		const irr::u32* row = table ? table->RowIndex.find(entity) : nullptr;
+		if (row)
+			RemoveRow(*table, *row);
+	}
+
+	m_EntityTypes.erase(types);
+}
+
+void ComponentStore::Clear(void)
+{
+	m_Tables.clear();
+	m_TableIndex.clear();
+	m_EntityTypes.clear();
+}
+
+bool ComponentStore::Has(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const
+{
+	const Table* table = FindTable(type);
+	return table && table->RowIndex.find(entity);
+}
+
+const std::vector<irr::scene::ESCENE_NODE_ANIMATOR_TYPE>* ComponentStore::GetTypes(EntityHandle entity) const
+{
+	entitytypes_t::const_iterator types = m_EntityTypes.find(entity);
+	if (types == m_EntityTypes.end())
+		return nullptr;
+
+	return &types->second;
+}
+
+bool ComponentStore::Read(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type,
+	irr::io::IAttributes* out) const
+{
+	const Table* table = FindTable(type);
+	const irr::u32* row = table ? table->RowIndex.find(entity) : nullptr;
+	if (!row)
+		return false;
+
+	const AttributeValue* cells = &table->Cells[*row * table->Columns.size()];
+	for (size_t i = 0; i < table->Columns.size(); ++i)
+		cells[i].Set(out, table->Columns[i].Name.c_str(), table->Columns[i].Type, false);
+
+	return true;
+}
+
+bool ComponentStore::Write(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type,
+	irr::io::IAttributes* in)
+{
+	Table* table = FindTable(type);
+	const irr::u32* row = table ? table->RowIndex.find(entity) : nullptr;
+	if (!row)
+		return false;
+
+	irr::u32 rowIndex = *row;
+	for (irr::u32 i = 0; i < in->getAttributeCount(); ++i)
+	{
+		const irr::c8* name = in->getAttributeName(i);
+		irr::io::E_ATTRIBUTE_TYPE attributeType = in->getAttributeType(i);
+
+		irr::s32 column = FindColumn(*table, name);
+		if (column < 0)
+		{
+			// the type name is how components are saved, it's not data
+			if (!AttributeValue::IsSupported(attributeType) || strcmp(name, "Type") == 0)
+				continue;
+
+			column = (irr::s32)AddColumn(*table, name, attributeType);
+		}
+
+		// keep the column's type, IAttributes converts between them
+		table->Cells[rowIndex * table->Columns.size() + column].Get(in, (irr::s32)i,
+			table->Columns[column].Type);
+	}
+
+	return true;
+}
+
+ComponentStore::Table* ComponentStore::FindTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	const irr::u32* index = m_TableIndex.find((irr::u32)type);
+	return index ? &m_Tables[*index] : nullptr;
+}
+
+const ComponentStore::Table* ComponentStore::FindTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const
+{
+	const irr::u32* index = m_TableIndex.find((irr::u32)type);
+	return index ? &m_Tables[*index] : nullptr;
+}
+
+ComponentStore::Table& ComponentStore::GetTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	Table* table = FindTable(type);
+	if (table)
+		return *table;
+
+	m_TableIndex.insert((irr::u32)type, (irr::u32)m_Tables.size());
+	m_Tables.push_back(Table());
+	m_Tables.back().Type = type;
+	return m_Tables.back();
+}
+
+irr::s32 ComponentStore::FindColumn(const Table& table, const irr::c8* name)
+{
+	const irr::u32* column = table.ColumnIndex.find(TypeRegistry<irr::u32>::hashName(name));
+	if (column && table.Columns[*column].Name == name)
+		return (irr::s32)*column;
+
+	// a hash collision, rare enough to just look
+	for (size_t i = 0; i < table.Columns.size(); ++i)
+	{
+		if (table.Columns[i].Name == name)
+			return (irr::s32)i;
+	}
+
+	return -1;
+}
+
+irr::u32 ComponentStore::AddColumn(Table& table, const irr::c8* name, irr::io::E_ATTRIBUTE_TYPE type)
+{
+	irr::u32 column = (irr::u32)table.Columns.size();
+
+	Column newColumn;
+	newColumn.Name = name;
+	newColumn.Type = type;
+	table.Columns.push_back(newColumn);
+
+	irr::u32 hash = TypeRegistry<irr::u32>::hashName(name);
+	if (!table.ColumnIndex.find(hash))
+		table.ColumnIndex.insert(hash, column);
+
+	// widen the existing rows, schema changes are rare
+	if (!table.Rows.empty())
+	{
+		size_t oldStride = column;
+		std::vector<AttributeValue> cells(table.Rows.size() * table.Columns.size());
+		for (size_t row = 0; row < table.Rows.size(); ++row)
+		{
+			for (size_t i = 0; i < oldStride; ++i)
+				cells[row * table.Columns.size() + i] = table.Cells[row * oldStride + i];
+		}
+
+		table.Cells.swap(cells);
+	}
+
+	return column;
+}
+
+void ComponentStore::RemoveRow(Table& table, irr::u32 row)
+{
+	// move the last row into the gap to keep the table dense
+	size_t stride = table.Columns.size();
+	irr::u32 last = (irr::u32)table.Rows.size() - 1;
+
+	table.RowIndex.erase(table.Rows[row]);
+	if (row != last)
+	{
+		for (size_t i = 0; i < stride; ++i)
+			table.Cells[row * stride + i] = table.Cells[last * stride + i];
+
+		table.Rows[row] = table.Rows[last];
+		table.RowIndex.insert(table.Rows[row], row);
+	}
+
+	table.Rows.pop_back();
+	table.Cells.resize(table.Rows.size() * stride);
+}
@@ -0,0 +1,79 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "Definition.hpp"
+#include "../extend/TypeRegistry.hpp"
+
+#include <irrlicht.h>
+
+#include <map>
+#include <vector>
+
+typedef irr::u32 EntityHandle;
+
+// Component data for every entity in a map, kept out of the scene graph so
+// the components cost nothing while rendering. Each component type has its
+// own table with one contiguous row of values per entity that has it.
+class ComponentStore
+{
+private:
+	struct Column
+	{
+		irr::core::stringc Name;
+		irr::io::E_ATTRIBUTE_TYPE Type;
+	};
+
+	struct Table
+	{
+		irr::scene::ESCENE_NODE_ANIMATOR_TYPE Type;
+		std::vector<Column> Columns;
+		TypeRegistry<irr::u32> ColumnIndex;  // name hash -> column
+		std::vector<EntityHandle> Rows;      // owner of each row
+		std::vector<AttributeValue> Cells;   // row major, Rows.size() * Columns.size()
+		TypeRegistry<irr::u32> RowIndex;     // entity -> row
+	};
+
+	std::vector<Table> m_Tables;
+	TypeRegistry<irr::u32> m_TableIndex; // type -> table
+
+	// component types of each entity, in the order they were added
+	typedef std::map<EntityHandle, std::vector<irr::scene::ESCENE_NODE_ANIMATOR_TYPE>> entitytypes_t;
+	entitytypes_t m_EntityTypes;
+
+public:
+	// Adds a component filled with its registered defaults. Returns false if
+	// the type isn't a registered component or the entity already has it.
+	bool Add(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+
+	void Remove(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+	void RemoveEntity(EntityHandle entity);
+	void Clear(void);
+
+	bool Has(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const;
+
+	// The entity's component types, in the order they were added
+	const std::vector<irr::scene::ESCENE_NODE_ANIMATOR_TYPE>* GetTypes(EntityHandle entity) const;
+
+	// Appends the component's values to 'out'
+	bool Read(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type,
+		irr::io::IAttributes* out) const;
+
+	// Updates the component from 'in', adding columns for attributes the
+	// table hasn't seen yet. Attributes of unsupported types are skipped.
+	bool Write(EntityHandle entity, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type,
+		irr::io::IAttributes* in);
+
+private:
+	Table* FindTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+	const Table* FindTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type) const;
+	Table& GetTable(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+
+	static irr::s32 FindColumn(const Table& table, const irr::c8* name);
+	static irr::u32 AddColumn(Table& table, const irr::c8* name, irr::io::E_ATTRIBUTE_TYPE type);
+	static void RemoveRow(Table& table, irr::u32 row);
+};
@@ -0,0 +1,495 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Definition.hpp"
+#include "Convert.hpp"
+
+#include <wx/log.h>
+#include <wx/wfstream.h>
+
+static const wxUint32 CACHE_MAGIC = 0x4346444D; // 'MDFC'
+static const wxUint32 CACHE_VERSION = 1;
+
+static void WriteStringc(wxDataOutputStream& data, const irr::core::stringc& value)
+{
+	data.WriteString(wxString::FromUTF8(value.c_str()));
+}
+
+static irr::core::stringc ReadStringc(wxDataInputStream& data)
+{
+	return irr::core::stringc(data.ReadString().utf8_str().data());
+}
+
+void AttributeValue::Get(irr::io::IAttributes* in, irr::s32 index, irr::io::E_ATTRIBUTE_TYPE type)
+{
+	switch (type)
+	{
+	case irr::io::EAT_INT:
+		Int = in->getAttributeAsInt(index);
+		break;
+	case irr::io::EAT_FLOAT:
+		Float = in->getAttributeAsFloat(index);
+		break;
+	case irr::io::EAT_STRING:
+		String = in->getAttributeAsString(index);
+		break;
+	case irr::io::EAT_BOOL:
+		Bool = in->getAttributeAsBool(index);
+		break;
+	case irr::io::EAT_COLOR:
+		Color = in->getAttributeAsColor(index);
+		break;
+	case irr::io::EAT_VECTOR2D:
+		Vec2 = in->getAttributeAsVector2d(index);
+		break;
+	case irr::io::EAT_VECTOR3D:
+		Vec3 = in->getAttributeAsVector3d(index);
+		break;
+	default:
+		break;
+	}
+}
+
+void AttributeValue::Set(irr::io::IAttributes* out, const irr::c8* name, irr::io::E_ATTRIBUTE_TYPE type,
+	bool replace) const
+{
+	switch (type)
+	{
+	case irr::io::EAT_INT:
+		if (replace)
+			out->setAttribute(name, Int);
+		else
+			out->addInt(name, Int);
+		break;
+	case irr::io::EAT_FLOAT:
+		if (replace)
+			out->setAttribute(name, Float);
+		else
+			out->addFloat(name, Float);
+		break;
+	case irr::io::EAT_STRING:
+		if (replace)
+			out->setAttribute(name, String.c_str());
+		else
+			out->addString(name, String.c_str());
+		break;
+	case irr::io::EAT_BOOL:
+		if (replace)
+			out->setAttribute(name, Bool);
+		else
+			out->addBool(name, Bool);
+		break;
+	case irr::io::EAT_COLOR:
+		if (replace)
+			out->setAttribute(name, Color);
+		else
+			out->addColor(name, Color);
+		break;
+	case irr::io::EAT_VECTOR2D:
+		if (replace)
+			out->setAttribute(name, Vec2);
+		else
+			out->addVector2d(name, Vec2);
+		break;
+	case irr::io::EAT_VECTOR3D:
+		if (replace)
+			out->setAttribute(name, Vec3);
+		else
+			out->addVector3d(name, Vec3);
+		break;
+	default:
+		break;
+	}
+}
+
+bool AttributeValue::IsSupported(irr::io::E_ATTRIBUTE_TYPE type)
+{
+	switch (type)
+	{
+	case irr::io::EAT_INT:
+	case irr::io::EAT_FLOAT:
+	case irr::io::EAT_STRING:
+	case irr::io::EAT_BOOL:
+	case irr::io::EAT_COLOR:
+	case irr::io::EAT_VECTOR2D:
+	case irr::io::EAT_VECTOR3D:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool AttributeTemplate::Add(const wxXmlNode* property)
+{
+	// each property has a single key and value
+	const wxXmlAttribute* attribute = property->GetAttributes();
+	if (!attribute)
+		return false;
+
+	Value value;
+	value.Name = attribute->GetName().utf8_str().data();
+
+	const wxString& tag = property->GetName();
+	const wxString& text = attribute->GetValue();
+	if (tag.CmpNoCase(wxT("int")) == 0)
+	{
+		value.Type = irr::io::EAT_INT;
+		value.Int = valueToInt(text);
+	}
+	else if (tag.CmpNoCase(wxT("float")) == 0)
+	{
+		value.Type = irr::io::EAT_FLOAT;
+		value.Float = valueToFloat(text);
+	}
+	else if (tag.CmpNoCase(wxT("string")) == 0)
+	{
+		value.Type = irr::io::EAT_STRING;
+		value.String = text.utf8_str().data();
+	}
+	else if (tag.CmpNoCase(wxT("bool")) == 0)
+	{
+		value.Type = irr::io::EAT_BOOL;
+		value.Bool = valueToBool(text);
+	}
+	else if (tag.CmpNoCase(wxT("color")) == 0)
+	{
+		value.Type = irr::io::EAT_COLOR;
+		value.Color = valueToColor(text);
+	}
+	else if (tag.CmpNoCase(wxT("vec2")) == 0)
+	{
+		value.Type = irr::io::EAT_VECTOR2D;
+		value.Vec2 = valueToVec2(text);
+	}
+	else if (tag.CmpNoCase(wxT("vec3")) == 0)
+	{
+		value.Type = irr::io::EAT_VECTOR3D;
+		value.Vec3 = valueToVec3(text);
+	}
+	else
+		return false; // e.g. texture, not supported yet
+
+	m_Values.push_back(value);
+	return true;
+}
+
+void AttributeTemplate::AddChildren(const wxXmlNode* parent)
+{
+	const wxXmlNode* property = parent->GetChildren();
+	while (property)
+	{
+		if (property->GetType() == wxXML_ELEMENT_NODE)
+			Add(property);
+
+		property = property->GetNext();
+	}
+}
+
+void AttributeTemplate::Apply(irr::io::IAttributes* out, bool replace) const
+{
+	for (std::vector<Value>::const_iterator i = m_Values.begin(); i != m_Values.end(); ++i)
+		i->Set(out, i->Name.c_str(), i->Type, replace);
+}
+
+void AttributeTemplate::Write(wxDataOutputStream& data) const
+{
+	data.Write32((wxUint32)m_Values.size());
+	for (std::vector<Value>::const_iterator i = m_Values.begin(); i != m_Values.end(); ++i)
+	{
+		data.Write32((wxUint32)i->Type);
+		WriteStringc(data, i->Name);
+
+		switch (i->Type)
+		{
+		case irr::io::EAT_INT:
+			data.Write32((wxUint32)i->Int);
+			break;
+		case irr::io::EAT_FLOAT:
+			data.WriteFloat(i->Float);
+			break;
+		case irr::io::EAT_STRING:
+			WriteStringc(data, i->String);
+			break;
+		case irr::io::EAT_BOOL:
+			data.Write8(i->Bool ? 1 : 0);
+			break;
+		case irr::io::EAT_COLOR:
+			data.Write32(i->Color.color);
+			break;
+		case irr::io::EAT_VECTOR2D:
+			data.WriteFloat(i->Vec2.X);
+			data.WriteFloat(i->Vec2.Y);
+			break;
+		case irr::io::EAT_VECTOR3D:
+			data.WriteFloat(i->Vec3.X);
+			data.WriteFloat(i->Vec3.Y);
+			data.WriteFloat(i->Vec3.Z);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+bool AttributeTemplate::Read(wxDataInputStream& data)
+{
+	m_Values.clear();
+
+	wxUint32 count = data.Read32();
+	for (wxUint32 i = 0; i < count; ++i)
+	{
+		Value value;
+		value.Type = (irr::io::E_ATTRIBUTE_TYPE)data.Read32();
+		value.Name = ReadStringc(data);
+
+		switch (value.Type)
+		{
+		case irr::io::EAT_INT:
+			value.Int = (irr::s32)data.Read32();
+			break;
+		case irr::io::EAT_FLOAT:
+			value.Float = data.ReadFloat();
+			break;
+		case irr::io::EAT_STRING:
+			value.String = ReadStringc(data);
+			break;
+		case irr::io::EAT_BOOL:
+			value.Bool = data.Read8() != 0;
+			break;
+		case irr::io::EAT_COLOR:
+			value.Color.color = data.Read32();
+			break;
+		case irr::io::EAT_VECTOR2D:
+			value.Vec2.X = data.ReadFloat();
+			value.Vec2.Y = data.ReadFloat();
+			break;
+		case irr::io::EAT_VECTOR3D:
+			value.Vec3.X = data.ReadFloat();
+			value.Vec3.Y = data.ReadFloat();
+			value.Vec3.Z = data.ReadFloat();
+			break;
+		default:
+			return false; // not something we wrote
+		}
+
+		m_Values.push_back(value);
+	}
+
+	return data.IsOk();
+}
+
+bool ActorTemplate::Compile(const wxXmlNode* actor)
+{
+	if (!actor || actor->GetName().CmpNoCase(wxT("actor")) != 0)
+		return false;
+
+	Name = actor->GetAttribute(wxT("name"));
+	Category = actor->GetAttribute(wxT("category"));
+	Type = actor->GetAttribute(wxT("type"));
+
+	const wxXmlNode* child = actor->GetChildren();
+	while (child)
+	{
+		if (child->GetName().CmpNoCase(wxT("properties")) == 0)
+		{
+			const wxXmlNode* property = child->GetChildren();
+			while (property)
+			{
+				// the mesh and texture are part of the actor, not user data
+				if (property->GetName().CmpNoCase(wxT("string")) == 0 && property->HasAttribute(wxT("Mesh")))
+					Mesh = property->GetAttribute(wxT("Mesh"));
+				else if (property->GetName().CmpNoCase(wxT("string")) == 0 && property->HasAttribute(wxT("Texture")))
+					Texture = property->GetAttribute(wxT("Texture"));
+				else if (property->GetType() == wxXML_ELEMENT_NODE)
+					Properties.Add(property);
+
+				property = property->GetNext();
+			}
+		}
+		else if (child->GetName().CmpNoCase(wxT("components")) == 0)
+		{
+			const wxXmlNode* component = child->GetChildren();
+			while (component)
+			{
+				const wxXmlAttribute* attribute = component->GetAttributes();
+				if (component->GetName().CmpNoCase(wxT("component")) == 0 && attribute)
+				{
+					Components.push_back(componentlist_t::value_type(
+						irr::core::stringc(attribute->GetValue().utf8_str().data()), AttributeTemplate()));
+					Components.back().second.AddChildren(component);
+				}
+
+				component = component->GetNext();
+			}
+		}
+
+		child = child->GetNext();
+	}
+
+	return true;
+}
+
+void ActorTemplate::Write(wxDataOutputStream& data) const
+{
+	data.WriteString(Name);
+	data.WriteString(Category);
+	data.WriteString(Type);
+	data.WriteString(Mesh);
+	data.WriteString(Texture);
+	Properties.Write(data);
+
+	data.Write32((wxUint32)Components.size());
+	for (componentlist_t::const_iterator i = Components.begin(); i != Components.end(); ++i)
+	{
+		WriteStringc(data, i->first);
+		i->second.Write(data);
+	}
+}
+
+bool ActorTemplate::Read(wxDataInputStream& data)
+{
+	Name = data.ReadString();
+	Category = data.ReadString();
+	Type = data.ReadString();
+	Mesh = data.ReadString();
+	Texture = data.ReadString();
+	if (!Properties.Read(data))
+		return false;
+
+	Components.clear();
+	wxUint32 count = data.Read32();
+	for (wxUint32 i = 0; i < count && data.IsOk(); ++i)
+	{
+		Components.push_back(componentlist_t::value_type(ReadStringc(data), AttributeTemplate()));
+		if (!Components.back().second.Read(data))
+			return false;
+	}
+
+	return data.IsOk();
+}
+
+DefinitionCache::DefinitionCache(const wxFileName& fileName)
+	: m_FileName(fileName), m_Dirty(false)
+{
+}
+
+DefinitionCache::~DefinitionCache(void)
+{
+	Save();
+}
+
+bool DefinitionCache::Load(void)
+{
+	m_Sources.clear();
+	m_Dirty = false;
+
+	if (!m_FileName.FileExists())
+		return false;
+
+	wxFileInputStream file(m_FileName.GetFullPath());
+	if (!file.IsOk())
+		return false;
+
+	wxDataInputStream data(file);
+	if (data.Read32() != CACHE_MAGIC || data.Read32() != CACHE_VERSION)
+	{
+		wxLogWarning(_("Ignoring outdated definition cache: %s"), m_FileName.GetFullPath());
+		return false;
+	}
+
+	wxUint32 sourceCount = data.Read32();
+	for (wxUint32 i = 0; i < sourceCount && file.IsOk(); ++i)
+	{
+		wxString key = data.ReadString();
+
+		Source source;
+		source.Modified = (wxInt64)data.Read64();
+
+		bool valid = true;
+		wxUint32 recordCount = data.Read32();
+		for (wxUint32 j = 0; j < recordCount && valid; ++j)
+		{
+			Record record;
+			record.IsActor = data.Read8() != 0;
+			record.Name = data.ReadString();
+			if (record.IsActor)
+			{
+				record.Definition = data.ReadString();
+				record.Actor.reset(new ActorTemplate);
+				valid = record.Actor->Read(data);
+			}
+			else
+				valid = record.Component.Read(data);
+
+			source.Records.push_back(record);
+		}
+
+		if (!valid || !file.IsOk())
+			break; // truncated or corrupt, keep what we have
+
+		m_Sources[key] = source;
+	}
+
+	return true;
+}
+
+bool DefinitionCache::Save(void)
+{
+	if (!m_Dirty)
+		return true;
+
+	wxFileOutputStream file(m_FileName.GetFullPath());
+	if (!file.IsOk())
+	{
+		wxLogWarning(_("Failed to write definition cache: %s"), m_FileName.GetFullPath());
+		return false;
+	}
+
+	wxDataOutputStream data(file);
+	data.Write32(CACHE_MAGIC);
+	data.Write32(CACHE_VERSION);
+	data.Write32((wxUint32)m_Sources.size());
+
+	for (sources_t::const_iterator i = m_Sources.begin(); i != m_Sources.end(); ++i)
+	{
+		data.WriteString(i->first);
+		data.Write64((wxUint64)i->second.Modified);
+		data.Write32((wxUint32)i->second.Records.size());
+
+		for (recordlist_t::const_iterator j = i->second.Records.begin(); j != i->second.Records.end(); ++j)
+		{
+			data.Write8(j->IsActor ? 1 : 0);
+			data.WriteString(j->Name);
+			if (j->IsActor)
+			{
+				data.WriteString(j->Definition);
+				j->Actor->Write(data);
+			}
+			else
+				j->Component.Write(data);
+		}
+	}
+
+	m_Dirty = false;
+	return file.IsOk();
+}
+
+const DefinitionCache::recordlist_t* DefinitionCache::Find(const wxString& source, wxInt64 modified) const
+{
+	sources_t::const_iterator i = m_Sources.find(source);
+	if (i == m_Sources.end() || i->second.Modified != modified)
+		return nullptr;
+
+	return &i->second.Records;
+}
+
+void DefinitionCache::Store(const wxString& source, wxInt64 modified, const recordlist_t& records)
+{
+	Source& cached = m_Sources[source];
+	cached.Modified = modified;
+	cached.Records = records;
+	m_Dirty = true;
+}
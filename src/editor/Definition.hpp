@@ -0,0 +1,139 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <irrlicht.h>
+#include <wx/datstrm.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <wx/xml/xml.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// The value of one attribute, which member is used depends on its type
+struct AttributeValue
+{
+	irr::s32 Int;
+	irr::f32 Float;
+	bool Bool;
+	irr::video::SColor Color;
+	irr::core::vector2df Vec2;
+	irr::core::vector3df Vec3;
+	irr::core::stringc String;
+
+	AttributeValue(void) : Int(0), Float(0), Bool(false) {}
+
+	// Reads attribute 'index' of 'in', converting it to 'type' if needed
+	void Get(irr::io::IAttributes* in, irr::s32 index, irr::io::E_ATTRIBUTE_TYPE type);
+
+	// Adds the value to 'out', or overwrites an existing one if 'replace' is set
+	void Set(irr::io::IAttributes* out, const irr::c8* name, irr::io::E_ATTRIBUTE_TYPE type,
+		bool replace) const;
+
+	// Types a value can hold
+	static bool IsSupported(irr::io::E_ATTRIBUTE_TYPE type);
+};
+
+// Typed attribute defaults compiled from a definition's property elements,
+// e.g. <float Speed="2.5"/>. Applying them is a straight copy, nothing is
+// parsed or compared by name.
+class AttributeTemplate
+{
+public:
+	struct Value : public AttributeValue
+	{
+		irr::io::E_ATTRIBUTE_TYPE Type;
+		irr::core::stringc Name;
+
+		Value(void) : Type(irr::io::EAT_UNKNOWN) {}
+	};
+
+private:
+	std::vector<Value> m_Values;
+
+public:
+	// Compiles a single property element; returns false for unsupported ones
+	bool Add(const wxXmlNode* property);
+
+	// Compiles every property element under the node
+	void AddChildren(const wxXmlNode* parent);
+
+	// Copies the defaults into 'out'. New attributes are appended unless
+	// 'replace' is set, which overwrites ones that already exist instead.
+	void Apply(irr::io::IAttributes* out, bool replace = false) const;
+
+	bool IsEmpty(void) const { return m_Values.empty(); }
+	const std::vector<Value>& GetValues(void) const { return m_Values; }
+
+	void Write(wxDataOutputStream& data) const;
+	bool Read(wxDataInputStream& data);
+};
+
+// An actor definition compiled once when its package or file is loaded
+struct ActorTemplate
+{
+	wxString Name;
+	wxString Category;
+	wxString Type;
+	wxString Mesh;
+	wxString Texture;
+
+	AttributeTemplate Properties; // custom properties, become the entity's user data
+
+	typedef std::vector<std::pair<irr::core::stringc, AttributeTemplate>> componentlist_t;
+	componentlist_t Components; // per-actor overrides of the component defaults
+
+	bool Compile(const wxXmlNode* actor);
+
+	void Write(wxDataOutputStream& data) const;
+	bool Read(wxDataInputStream& data);
+};
+
+// Persistent catalog of compiled definitions, keyed by the package or loose
+// file they came from. A source is only reused while its modification time
+// matches, so a warm start never builds an XML DOM.
+class DefinitionCache
+{
+public:
+	struct Record
+	{
+		bool IsActor;
+		wxString Name;
+		wxString Definition; // actor XML, still needed for editing
+		std::shared_ptr<ActorTemplate> Actor;
+		AttributeTemplate Component;
+
+		Record(void) : IsActor(false) {}
+	};
+
+	typedef std::vector<Record> recordlist_t;
+
+private:
+	struct Source
+	{
+		wxInt64 Modified;
+		recordlist_t Records;
+	};
+
+	typedef std::map<wxString, Source> sources_t;
+	sources_t m_Sources;
+
+	wxFileName m_FileName;
+	bool m_Dirty;
+
+public:
+	DefinitionCache(const wxFileName& fileName);
+	~DefinitionCache(void);
+
+	bool Load(void);
+	bool Save(void);
+
+	const recordlist_t* Find(const wxString& source, wxInt64 modified) const;
+	void Store(const wxString& source, wxInt64 modified, const recordlist_t& records);
+};
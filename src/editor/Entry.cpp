@@ -27,6 +27,7 @@
 #include "MpkFSHandler.hpp"
 #include "PropertyPanel.hpp"
 #include "Serialize.hpp"
+#include "VirtualFS.hpp"
 
 // @TODO: enable GPU acceleration under MSW
 //#if defined(__WXMSW__)
@@ -82,10 +83,13 @@ public:
 
 			wxFileSystem::AddHandler(new wxArchiveFSHandler);
 			wxFileSystem::AddHandler(new wxFilterFSHandler);
-			FolderFSHandler* folderHandler = new FolderFSHandler;
-			wxFileSystem::AddHandler(folderHandler);
-			MpkFSHandler* mpkHandler = new MpkFSHandler;
-			wxFileSystem::AddHandler(mpkHandler);
+			wxFileSystem::AddHandler(new FolderFSHandler);
+			wxFileSystem::AddHandler(new MpkFSHandler);
+
+			// packages that ship with the editor come first
+			VirtualFS::Get().MountFolder(wxStandardPaths::Get().GetDataDir(), VirtualFS::MOUNT_PACKAGES);
+			VirtualFS::Get().MountFolder(wxFileName(wxStandardPaths::Get().GetExecutablePath()).GetPath(),
+				VirtualFS::MOUNT_PACKAGES);
 
 			ISerializerFactory::AddSerializer(wxT("irr"),
 				std::shared_ptr<ISerializerFactory>(new SerializerFactory<IrrSave, IrrLoad>(
@@ -150,8 +154,7 @@ public:
 					if (dir.IsOpened())
 					{
 						// register the folder
-						folderHandler->MountFolder(path);
-						mpkHandler->AddSearchPath(path);
+						VirtualFS::Get().MountFolder(path);
 
 						wxString filename;
 						bool cont = dir.GetFirst(&filename, wxEmptyString, wxDIR_FILES);
@@ -160,7 +163,10 @@ public:
 							wxFileName fn(path, filename);
 							if (fn.GetExt().CmpNoCase(wxT("mpk")) == 0 ||
 								fn.GetExt().CmpNoCase(wxT("zip")) == 0)
+							{
+								VirtualFS::Get().MountArchive(fn.GetFullPath());
 								BrowserWindow::AddPackage(fn.GetFullPath());
+							}
 							else if (fn.GetExt().CmpNoCase(wxT("actor")) == 0 ||
 								fn.GetExt().CmpNoCase(wxT("component")) == 0 ||
 								fn.GetExt().CmpNoCase(wxT("prefab")) == 0)
@@ -203,8 +209,21 @@ public:
 		return false;
 	}
 
+	void OnEventLoopEnter(wxEventLoopBase* loop)
+	{
+		// the file system watcher needs a running event loop
+		if (loop->IsMain())
+			VirtualFS::Get().StartWatching();
+
+		wxApp::OnEventLoopEnter(loop);
+	}
+
 	int OnExit(void)
 	{
+		// the watcher needs the event loop and its backend, which don't
+		// survive until the file system's static is destroyed
+		VirtualFS::Get().StopWatching();
+
 		// clean up the config file
 		delete wxConfigBase::Set(nullptr);
 
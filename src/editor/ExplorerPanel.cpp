@@ -11,24 +11,70 @@
 
 #include <wx/sizer.h>
 
+#include <algorithm>
+
+// Virtual list over the explorer's groups, rows are built only when shown
+class ExplorerList : public wxListCtrl
+{
+private:
+	ExplorerPanel* m_Panel;
+
+public:
+	ExplorerList(ExplorerPanel* panel)
+		: wxListCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+			wxLC_REPORT | wxLC_VIRTUAL),
+		  m_Panel(panel)
+	{
+	}
+
+protected:
+	wxString OnGetItemText(long item, long column) const wxOVERRIDE
+	{
+		return m_Panel->GetRowText(item);
+	}
+
+	wxItemAttr* OnGetItemAttr(long item) const wxOVERRIDE
+	{
+		int group;
+		if (m_Panel->GetRowItem(item, group) < 0)
+			return &m_Panel->m_HeaderAttr;
+
+		return nullptr;
+	}
+};
+
 ExplorerPanel::ExplorerPanel(wxWindow* parent, wxCommandProcessor& cmdProc,
 	BrowserWindow* browser)
 	: wxPanel(parent), m_Commands(cmdProc), m_Browser(browser), m_ViewPanel(nullptr),
-	  m_Explorer(nullptr), m_SceneMgr(nullptr), m_Changing(false)
+	  m_Explorer(nullptr), m_Updating(0), m_SyncPending(false),
+	  m_SceneMgr(nullptr), m_Changing(false)
 {
-	m_Explorer = new wxTreeCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize,
-		wxTR_HAS_BUTTONS | wxTR_MULTIPLE);
-	m_Root = m_Explorer->AddRoot(_("untitled"));
-	m_GeometryRoot = m_Explorer->InsertItem(m_Root, 0, _("Geometry"));
-	m_ActorRoot = m_Explorer->InsertItem(m_Root, 1, _("Actors"));
-	m_Explorer->Expand(m_Root);
+	m_Groups[GROUP_GEOMETRY].Label = _("Geometry");
+	m_Groups[GROUP_ACTOR].Label = _("Actors");
+	for (int i = 0; i < GROUP_COUNT; ++i)
+	{
+		m_Groups[i].Sorted = true;
+		m_Groups[i].Expanded = true;
+	}
+
+	m_Explorer = new ExplorerList(this);
+	m_Explorer->AppendColumn(_("untitled"));
+
+	wxFont font(m_Explorer->GetFont());
+	font.MakeBold();
+	m_HeaderAttr.SetFont(font);
 
 	wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 	sizer->Add(m_Explorer, wxSizerFlags(1).Expand());
 	this->SetSizerAndFit(sizer);
 
-	Bind(wxEVT_TREE_SEL_CHANGED, &ExplorerPanel::OnSelectionChanged, this);
-	Bind(wxEVT_TREE_ITEM_RIGHT_CLICK, &ExplorerPanel::OnItemRightClick, this);
+	RefreshRows();
+
+	Bind(wxEVT_LIST_ITEM_SELECTED, &ExplorerPanel::OnSelectionChanged, this);
+	Bind(wxEVT_LIST_ITEM_DESELECTED, &ExplorerPanel::OnSelectionChanged, this);
+	Bind(wxEVT_LIST_ITEM_ACTIVATED, &ExplorerPanel::OnItemActivated, this);
+	Bind(wxEVT_LIST_ITEM_RIGHT_CLICK, &ExplorerPanel::OnItemRightClick, this);
+	m_Explorer->Bind(wxEVT_SIZE, &ExplorerPanel::OnSize, this);
 }
 
 ExplorerPanel::~ExplorerPanel(void)
@@ -44,6 +90,7 @@ void ExplorerPanel::SetViewPanel(ViewPanel* viewPanel)
 	Bind(wxEVT_MENU, &ViewPanel::OnEditDelete, m_ViewPanel, wxID_DELETE);
 
 	Bind(wxEVT_MENU, &ViewPanel::OnMenuSetTexture, m_ViewPanel, MENU_SETTEXTURE);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuArray, m_ViewPanel, MENU_ARRAY);
 }
 
 BrowserWindow* ExplorerPanel::GetBrowser(void)
@@ -58,30 +105,50 @@ void ExplorerPanel::SetSceneManager(irr::scene::ISceneManager* sceneMgr)
 
 void ExplorerPanel::SetMapName(const wxString& name)
 {
-	m_Explorer->SetItemText(m_Root, name);
+	wxListItem column;
+	column.SetMask(wxLIST_MASK_TEXT);
+	column.SetText(name);
+	m_Explorer->SetColumn(0, column);
 }
 
 void ExplorerPanel::Clear(void)
 {
-	m_Explorer->DeleteChildren(m_GeometryRoot);
-	m_Explorer->DeleteChildren(m_ActorRoot);
+	for (int i = 0; i < GROUP_COUNT; ++i)
+	{
+		m_Groups[i].Names.clear();
+		m_Groups[i].Sorted = true;
+	}
+
+	m_Entities.clear();
+	m_Selected.clear();
+	RefreshRows();
 }
 
 void ExplorerPanel::SelectItem(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_Root);
-	if (item.IsOk())
+	if (m_Entities.find(name) == m_Entities.end())
+		return;
+
+	m_Selected.insert(name);
+	if (m_Updating)
+		return; // applied by EndUpdate()
+
+	long row = FindRow(name, true);
+	if (row >= 0)
 	{
-		m_Explorer->SelectItem(item);
-		m_Explorer->EnsureVisible(item);
+		SetRowSelected(row, true);
+		m_Explorer->EnsureVisible(row);
 	}
 }
 
 void ExplorerPanel::UnselectItem(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_Root);
-	if (item.IsOk())
-		m_Explorer->UnselectItem(item);
+	if (m_Selected.erase(name) == 0 || m_Updating)
+		return;
+
+	long row = FindRow(name, false);
+	if (row >= 0)
+		SetRowSelected(row, false);
 }
 
 void ExplorerPanel::UnselectAll(void)
@@ -89,97 +156,287 @@ void ExplorerPanel::UnselectAll(void)
 	if (m_Changing)
 		return;
 
-	m_Explorer->UnselectAll();
+	m_Selected.clear();
+	if (!m_Updating)
+		SetRowSelected(-1, false);
+}
+
+void ExplorerPanel::BeginUpdate(void)
+{
+	++m_Updating;
+}
+
+void ExplorerPanel::EndUpdate(void)
+{
+	if (m_Updating == 0 || --m_Updating > 0)
+		return;
+
+	for (int i = 0; i < GROUP_COUNT; ++i)
+		SortGroup(i);
+
+	RefreshRows();
 }
 
 void ExplorerPanel::AddGeometry(const wxString& name)
 {
-	m_Explorer->AppendItem(m_GeometryRoot, name);
-	m_Explorer->SortChildren(m_GeometryRoot);
-	m_Explorer->Expand(m_GeometryRoot);
+	AddItem(GROUP_GEOMETRY, name);
 }
 
 void ExplorerPanel::RemoveGeometry(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_GeometryRoot);
-	if (item.IsOk())
-		m_Explorer->Delete(item);
+	RemoveItem(GROUP_GEOMETRY, name);
 }
 
 bool ExplorerPanel::IsGeometry(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_GeometryRoot);
-	if (item.IsOk())
-		return true;
-
-	return false;
+	groupmap_t::const_iterator entity = m_Entities.find(name);
+	return entity != m_Entities.end() && entity->second == GROUP_GEOMETRY;
 }
 
 void ExplorerPanel::AddActor(const wxString& name)
 {
-	m_Explorer->AppendItem(m_ActorRoot, name);
-	m_Explorer->SortChildren(m_ActorRoot);
-	m_Explorer->Expand(m_ActorRoot);
+	AddItem(GROUP_ACTOR, name);
 }
 
 void ExplorerPanel::RemoveActor(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_ActorRoot);
-	if (item.IsOk())
-		m_Explorer->Delete(item);
+	RemoveItem(GROUP_ACTOR, name);
 }
 
 bool ExplorerPanel::IsActor(const wxString& name)
 {
-	wxTreeItemId item = FindItem(name, m_ActorRoot);
-	if (item.IsOk())
-		return true;
+	groupmap_t::const_iterator entity = m_Entities.find(name);
+	return entity != m_Entities.end() && entity->second == GROUP_ACTOR;
+}
+
+void ExplorerPanel::AddItem(int group, const wxString& name)
+{
+	if (!m_Entities.emplace(name, group).second)
+		return; // already listed
+
+	if (m_ViewPanel)
+		m_ViewPanel->EntityAdded(name);
+
+	Group& items = m_Groups[group];
+	if (m_Updating)
+	{
+		// sorted once when the update ends
+		items.Names.push_back(name);
+		items.Sorted = false;
+		return;
+	}
+
+	SortGroup(group);
+	items.Names.insert(std::lower_bound(items.Names.begin(), items.Names.end(), name),
+		name);
+	items.Expanded = true;
+	RefreshRows();
+}
+
+void ExplorerPanel::RemoveItem(int group, const wxString& name)
+{
+	groupmap_t::iterator entity = m_Entities.find(name);
+	if (entity == m_Entities.end() || entity->second != group)
+		return;
+
+	m_Entities.erase(entity);
+	m_Selected.erase(name);
+
+	if (m_ViewPanel)
+		m_ViewPanel->EntityRemoved(name);
+
+	Group& items = m_Groups[group];
+	SortGroup(group);
+	std::vector<wxString>::iterator item = std::lower_bound(items.Names.begin(),
+		items.Names.end(), name);
+	if (item != items.Names.end() && *item == name)
+		items.Names.erase(item);
+
+	RefreshRows();
+}
+
+void ExplorerPanel::SortGroup(int group)
+{
+	Group& items = m_Groups[group];
+	if (items.Sorted)
+		return;
+
+	std::sort(items.Names.begin(), items.Names.end());
+	items.Sorted = true;
+}
+
+long ExplorerPanel::FindRow(const wxString& name, bool expand)
+{
+	groupmap_t::const_iterator entity = m_Entities.find(name);
+	if (entity == m_Entities.end())
+		return -1;
+
+	long row = 0;
+	for (int i = 0; i < entity->second; ++i)
+	{
+		row += 1;
+		if (m_Groups[i].Expanded)
+			row += (long)m_Groups[i].Names.size();
+	}
+
+	Group& items = m_Groups[entity->second];
+	if (!items.Expanded)
+	{
+		if (!expand)
+			return -1;
+
+		items.Expanded = true;
+		RefreshRows();
+	}
+
+	SortGroup(entity->second);
+	std::vector<wxString>::const_iterator item = std::lower_bound(items.Names.begin(),
+		items.Names.end(), name);
+	if (item == items.Names.end() || *item != name)
+		return -1;
+
+	return row + 1 + (long)(item - items.Names.begin());
+}
+
+long ExplorerPanel::GetRowItem(long row, int& group) const
+{
+	for (group = 0; group < GROUP_COUNT; ++group)
+	{
+		if (row == 0)
+			return -1; // the header
+
+		row -= 1;
+		long count = m_Groups[group].Expanded ? (long)m_Groups[group].Names.size() : 0;
+		if (row < count)
+			return row;
+
+		row -= count;
+	}
+
+	group = GROUP_COUNT;
+	return -1;
+}
+
+wxString ExplorerPanel::GetRowText(long row) const
+{
+	int group;
+	long item = GetRowItem(row, group);
+	if (group >= GROUP_COUNT)
+		return wxEmptyString;
+
+	const Group& items = m_Groups[group];
+	if (item >= 0)
+		return items.Names[item];
 
-	return false;
+	return wxString::Format(wxT("%s %s (%lu)"), items.Expanded ? wxT("-") : wxT("+"),
+		items.Label, (unsigned long)items.Names.size());
 }
 
-wxTreeItemId ExplorerPanel::FindItem(const wxString& name, wxTreeItemId& start)
+void ExplorerPanel::RefreshRows(void)
 {
-	wxTreeItemIdValue cookie;
-	wxTreeItemId item = m_Explorer->GetFirstChild(start, cookie);
-	while (item.IsOk())
+	if (m_Updating)
+		return;
+
+	long count = 0;
+	for (int i = 0; i < GROUP_COUNT; ++i)
 	{
-		wxString itemName = m_Explorer->GetItemText(item);
-		if (itemName == name)
-			return item;
+		count += 1;
+		if (m_Groups[i].Expanded)
+			count += (long)m_Groups[i].Names.size();
+	}
+
+	m_Explorer->SetItemCount(count);
 
-		item = m_Explorer->GetNextSibling(item);
+	// rows have moved, put the selection back where the names now are
+	SetRowSelected(-1, false);
+	for (nameset_t::const_iterator name = m_Selected.begin();
+		name != m_Selected.end(); ++name)
+	{
+		long row = FindRow(*name, false);
+		if (row >= 0)
+			SetRowSelected(row, true);
 	}
 
-	return wxTreeItemId(); // not found
+	m_Explorer->Refresh();
+}
+
+void ExplorerPanel::SetRowSelected(long row, bool select)
+{
+	bool changing = m_Changing;
+	m_Changing = true;
+	m_Explorer->SetItemState(row, select ? wxLIST_STATE_SELECTED : 0,
+		wxLIST_STATE_SELECTED);
+	m_Changing = changing;
 }
 
-void ExplorerPanel::OnSelectionChanged(wxTreeEvent& event)
+void ExplorerPanel::SyncSelection(void)
 {
+	m_SyncPending = false;
+	if (!m_ViewPanel || !m_SceneMgr)
+		return;
+
 	m_Changing = true;
 
 	m_ViewPanel->ClearSelection();
+	m_Selected.clear();
 
-	wxArrayTreeItemIds selection;
-	size_t count = m_Explorer->GetSelections(selection);
-	for (size_t i = 0; i < count; ++i)
+	long row = m_Explorer->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+	while (row >= 0)
 	{
-		irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(
-			m_Explorer->GetItemText(selection[i]).c_str());
-		if (node)
-			m_ViewPanel->AddToSelection(node, true);
+		int group;
+		long item = GetRowItem(row, group);
+		if (item >= 0)
+		{
+			const wxString& name = m_Groups[group].Names[item];
+			irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(
+				name.c_str());
+			if (node)
+			{
+				m_Selected.insert(name);
+				m_ViewPanel->AddToSelection(node, true);
+			}
+		}
+
+		row = m_Explorer->GetNextItem(row, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
 	}
 
 	m_Changing = false;
 }
 
-void ExplorerPanel::OnItemRightClick(wxTreeEvent& event)
+void ExplorerPanel::OnSelectionChanged(wxListEvent& event)
+{
+	if (m_Changing)
+		return;
+
+	// a range selection sends one event per row, sync once for all of them
+	if (!m_SyncPending)
+	{
+		m_SyncPending = true;
+		CallAfter(&ExplorerPanel::SyncSelection);
+	}
+}
+
+void ExplorerPanel::OnItemActivated(wxListEvent& event)
+{
+	int group;
+	if (GetRowItem(event.GetIndex(), group) >= 0 || group >= GROUP_COUNT)
+		return;
+
+	m_Groups[group].Expanded = !m_Groups[group].Expanded;
+	RefreshRows();
+}
+
+void ExplorerPanel::OnSize(wxSizeEvent& event)
+{
+	m_Explorer->SetColumnWidth(0, m_Explorer->GetClientSize().x);
+	event.Skip();
+}
+
+void ExplorerPanel::OnItemRightClick(wxListEvent& event)
 {
 	// make sure it's not a control item
-	wxTreeItemId item = event.GetItem();
-	if (item == m_Root ||
-		item == m_GeometryRoot ||
-		item == m_ActorRoot)
+	int group;
+	if (GetRowItem(event.GetIndex(), group) < 0)
 		return;
 
 	// popup menu
@@ -188,6 +445,8 @@ void ExplorerPanel::OnItemRightClick(wxTreeEvent& event)
 	popupMenu.Append(wxID_COPY);
 	popupMenu.Append(wxID_PASTE);
 	popupMenu.Append(wxID_DELETE);
+	popupMenu.AppendSeparator();
+	popupMenu.Append(MENU_ARRAY, _("Array..."));
 
 	const wxString& texture = m_Browser->GetTexture();
 	if (!texture.empty())
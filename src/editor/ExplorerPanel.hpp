@@ -11,11 +11,17 @@
 #include "ViewPanel.hpp"
 
 #include <wx/cmdproc.h>
+#include <wx/hashmap.h>
+#include <wx/listctrl.h>
 #include <wx/panel.h>
-#include <wx/treectrl.h>
 
 #include "irrlicht.h"
 
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ExplorerList;
 class ViewPanel;
 
 /**
@@ -25,18 +31,49 @@ class ViewPanel;
  * The ExplorerPanel class provides a tree view panel for managing scene
  * objects and their hierarchy. It supports object selection, property
  * editing, and scene organization.
+ *
+ * The entities are kept in a sorted array per group and shown through a
+ * virtual list, so only the visible rows are ever built. Each group has a
+ * collapsible header row.
  */
 class ExplorerPanel : public wxPanel
 {
+	friend class ExplorerList;
+
 private:
+	enum
+	{
+		GROUP_GEOMETRY = 0,
+		GROUP_ACTOR,
+		GROUP_COUNT
+	};
+
+	/**
+	 * @struct Group
+	 * @brief The entities shown under one header row
+	 */
+	struct Group
+	{
+		wxString Label;                 ///< Header text
+		std::vector<wxString> Names;    ///< Entity names, sorted unless updating
+		bool Sorted;                    ///< False while names are appended unsorted
+		bool Expanded;                  ///< Whether the names are shown
+	};
+
+	typedef std::unordered_map<wxString, int, wxStringHash, wxStringEqual> groupmap_t;
+	typedef std::unordered_set<wxString, wxStringHash, wxStringEqual> nameset_t;
+
 	wxCommandProcessor& m_Commands;
 	BrowserWindow* m_Browser;
 	ViewPanel* m_ViewPanel;
 
-	wxTreeCtrl* m_Explorer;
-	wxTreeItemId m_Root;
-	wxTreeItemId m_GeometryRoot;
-	wxTreeItemId m_ActorRoot;
+	ExplorerList* m_Explorer;
+	Group m_Groups[GROUP_COUNT];
+	groupmap_t m_Entities;          ///< Entity name to group
+	nameset_t m_Selected;           ///< Selected entities, kept across row changes
+	wxItemAttr m_HeaderAttr;        ///< Style of the header rows
+	int m_Updating;                 ///< Nested BeginUpdate() count
+	bool m_SyncPending;             ///< Selection sync queued for the next idle
 
 	irr::scene::ISceneManager* m_SceneMgr;
 
@@ -103,6 +140,16 @@ public:
 	 */
 	void UnselectAll(void);
 
+	/**
+	 * @brief Start a bulk change, entities are sorted and shown once it ends
+	 */
+	void BeginUpdate(void);
+
+	/**
+	 * @brief End a bulk change started with BeginUpdate()
+	 */
+	void EndUpdate(void);
+
 	/**
 	 * @brief Add a geometry node
 	 * @param name The name of the geometry
@@ -143,22 +190,86 @@ public:
 
 private:
 	/**
-	 * @brief Find an item in the tree
-	 * @param name The name of the item to find
-	 * @param start The starting tree item ID
-	 * @return The tree item ID for the found item
+	 * @brief Add an entity to a group
+	 * @param group The group index
+	 * @param name The name of the entity
+	 */
+	void AddItem(int group, const wxString& name);
+
+	/**
+	 * @brief Remove an entity from a group
+	 * @param group The group index
+	 * @param name The name of the entity
+	 */
+	void RemoveItem(int group, const wxString& name);
+
+	/**
+	 * @brief Sort a group that had names appended during an update
+	 * @param group The group index
+	 */
+	void SortGroup(int group);
+
+	/**
+	 * @brief Find the row showing an entity
+	 * @param name The name of the entity
+	 * @param expand Expand the entity's group if it's collapsed
+	 * @return The row, or -1 if the entity isn't shown
+	 */
+	long FindRow(const wxString& name, bool expand);
+
+	/**
+	 * @brief Resolve a row to its group and entity
+	 * @param row The row
+	 * @param group Receives the group index
+	 * @return The entity index in the group, or -1 for a header row
+	 */
+	long GetRowItem(long row, int& group) const;
+
+	/**
+	 * @brief Get the text shown in a row
+	 * @param row The row
+	 * @return The row text
+	 */
+	wxString GetRowText(long row) const;
+
+	/**
+	 * @brief Update the row count and reapply the selection after a change
+	 */
+	void RefreshRows(void);
+
+	/**
+	 * @brief Set the selection state of a row without notifying the view
+	 * @param row The row
+	 * @param select Whether the row is selected
+	 */
+	void SetRowSelected(long row, bool select);
+
+	/**
+	 * @brief Push the list selection to the view panel
+	 */
+	void SyncSelection(void);
+
+	/**
+	 * @brief Handle list item selection changed events
+	 * @param event The list event
+	 */
+	void OnSelectionChanged(wxListEvent& event);
+
+	/**
+	 * @brief Handle list item activation, toggles the group headers
+	 * @param event The list event
 	 */
-	wxTreeItemId FindItem(const wxString& name, wxTreeItemId& start);
+	void OnItemActivated(wxListEvent& event);
 
 	/**
-	 * @brief Handle tree item selection changed events
-	 * @param event The tree event
+	 * @brief Handle list item right-click events
+	 * @param event The list event
 	 */
-	void OnSelectionChanged(wxTreeEvent& event);
+	void OnItemRightClick(wxListEvent& event);
 
 	/**
-	 * @brief Handle tree item right-click events
-	 * @param event The tree event
+	 * @brief Handle size events, keeps the column at the panel width
+	 * @param event The size event
 	 */
-	void OnItemRightClick(wxTreeEvent& event);
+	void OnSize(wxSizeEvent& event);
 };
@@ -4,11 +4,14 @@
 * Copyright (c) 2023 James Kinnaird
 */
 
+#include "Common.hpp"
 #include "FSHandler.hpp"
+#include "MappedFile.hpp"
+#include "VirtualFS.hpp"
 
-#include <wx/config.h>
 #include <wx/filename.h>
 #include <wx/log.h>
+#include <wx/stdpaths.h>
 
 FolderFSHandler::FolderFSHandler(void)
 {
@@ -18,14 +21,9 @@ FolderFSHandler::~FolderFSHandler(void)
 {
 }
 
-void FolderFSHandler::MountFolder(const wxString& path)
-{
-	m_Folders.Add(path);
-}
-
 bool FolderFSHandler::CanOpen(const wxString& location)
 {
-	wxString path = m_Folders.FindValidPath(location);
+	wxString path = VirtualFS::Get().ResolveFile(location);
 	return !path.empty();
 }
 
@@ -33,7 +31,10 @@ wxFSFile* FolderFSHandler::OpenFile(wxFileSystem& fs, const wxString& location)
 {
 	wxFSFile* result = nullptr;
 
-	wxString path = m_Folders.FindValidPath(location);
+	wxString path = VirtualFS::Get().ResolveFile(location);
+	if (path.empty())
+		return nullptr;
+
 	wxFileInputStream* stream = new wxFileInputStream(path);
 	if (!stream->IsOk())
 		delete stream;
@@ -72,10 +73,21 @@ wxBitmap BitmapFromFS(wxFileSystem& fileSystem, const wxString& location, wxBitm
 	return wxBitmap();
 }
 
+wxFileName CacheFileName(const wxString& fullName, const wxString& subDir)
+{
+	wxFileName cachePath(wxStandardPaths::Get().GetUserDir(wxStandardPaths::Dir_Cache), wxT(""));
+	cachePath.AppendDir(wxT(APP_NAME));
+	if (!subDir.empty())
+		cachePath.AppendDir(subDir);
+	if (!cachePath.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		wxLogWarning(_("Failed to create cache folder: %s"), cachePath.GetPath());
+
+	cachePath.SetFullName(fullName);
+	return cachePath;
+}
+
 irr::io::IReadFile* IrrFSHandler::createAndOpenFile(const irr::io::path& filename)
 {
-	wxFileSystem fileSystem;
-	
 	wxString filePath(filename.c_str());
 
 	// check if the location is a zip file
@@ -84,36 +96,40 @@ irr::io::IReadFile* IrrFSHandler::createAndOpenFile(const irr::io::path& filenam
 	{
 		wxString zipFile = filePath.BeforeLast(wxT(':'));
 		wxString fileName = filePath.AfterLast(wxT(':'));
+
+		// entries stored uncompressed are read straight from the mapped package
+		std::shared_ptr<MappedArchive> archive = MappedArchive::Open(zipFile);
+		irr::io::IReadFile* mapped = archive ? archive->CreateReadFile(fileName, filename) : nullptr;
+		if (mapped)
+			return mapped;
+
 		filePath = zipFile + wxT("#zip:") + fileName;
 	}
+	else if (filePath.Contains(wxT(".mpk:")) || filePath.Contains(wxT(".mmp:")))
+	{
+		wxString package = filePath.BeforeLast(wxT(':'));
+		wxString packagePath = VirtualFS::Get().ResolvePackage(package);
+
+		std::shared_ptr<MappedArchive> archive = MappedArchive::Open(
+			packagePath.empty() ? package : packagePath);
+		irr::io::IReadFile* mapped = archive ?
+			archive->CreateReadFile(filePath.AfterLast(wxT(':')), filename) : nullptr;
+		if (mapped)
+			return mapped;
+	}
 	else
 	{
-		// work through known search paths
-		wxString entry;
-		long cookie;
-		wxConfigBase* config = wxConfigBase::Get();
-		wxConfigPathChanger paths(config, wxT("/Paths/"));
-		if (config->GetFirstEntry(entry, cookie))
-		{
-			do
-			{
-				wxString path = config->Read(entry);
-				if (path.IsEmpty())
-					continue;
-
-				wxString baseFileName = filePath.AfterLast(wxT('/'));
-				wxString fullPath = path + wxT('/') + baseFileName;
-				wxFileName fn(fullPath);
-				if (fn.FileExists())
-				{
-					filePath = fullPath;
-					break;
-				}
-			} while (config->GetNextEntry(entry, cookie));
-		}
+		// look for the file by name in the mounted folders
+		wxString fullPath = VirtualFS::Get().ResolveFile(filePath.AfterLast(wxT('/')));
+		if (!fullPath.empty())
+			filePath = fullPath;
+
+		irr::io::IReadFile* mapped = MappedArchive::OpenFile(filePath, filename);
+		if (mapped)
+			return mapped;
 	}
 
-	wxFSFile* f = fileSystem.OpenFile(filePath);
+	wxFSFile* f = m_FileSystem.OpenFile(filePath);
 	if (f)
 	{
 		IrrReadFile* ret = new IrrReadFile(filename, f->DetachStream());
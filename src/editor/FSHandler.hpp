@@ -7,23 +7,20 @@
 #pragma once
 
 #include <wx/bitmap.h>
+#include <wx/filename.h>
 #include <wx/filesys.h>
 #include <wx/fs_filter.h>
 #include <wx/wfstream.h>
 
 #include "irrlicht.h"
 
+// opens loose files from the folders mounted in the VirtualFS
 class FolderFSHandler : public wxFileSystemHandler
 {
-private:
-	wxPathList m_Folders;
-
 public:
 	FolderFSHandler(void);
 	~FolderFSHandler(void);
 
-	void MountFolder(const wxString& path);
-
 	bool CanOpen(const wxString& location);
 	wxFSFile* OpenFile(wxFileSystem& fs, const wxString& location);
 };
@@ -31,6 +28,10 @@ public:
 wxImage ImageFromFS(wxFileSystem& fileSystem, const wxString& location, wxBitmapType type = wxBITMAP_TYPE_ANY);
 wxBitmap BitmapFromFS(wxFileSystem& fileSystem, const wxString& location, wxBitmapType type = wxBITMAP_TYPE_ANY);
 
+// Location of a file in the per-user editor cache folder (or a sub folder of it),
+// which is created on demand
+wxFileName CacheFileName(const wxString& fullName, const wxString& subDir = wxEmptyString);
+
 class IrrFSHandler : public irr::io::IFileArchive
 {
 public:
@@ -61,6 +62,9 @@ public:
 		}
 	};
 
+private:
+	wxFileSystem m_FileSystem;
+
 public:
 	IrrFSHandler(void) {}
 	~IrrFSHandler(void) {}
@@ -0,0 +1,934 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Common.hpp"
+#include "Lightmapper.hpp"
+#include "Map.hpp"
+
+#include "CDynamicMeshBuffer.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+LightmapMeshes::LightmapMeshes(void)
+{
+}
+
+LightmapMeshes::~LightmapMeshes(void)
+{
+	Clear();
+}
+
+irr::scene::IMesh* LightmapMeshes::Get(irr::scene::IMesh* source)
+{
+	if (m_Sources.find(source) != m_Sources.end())
+		return source; // already a copy
+
+	meshmap_t::iterator it = m_Unwrapped.find(source);
+	if (it != m_Unwrapped.end())
+		return it->second;
+
+	irr::scene::IMesh* mesh = Unwrap(source);
+	if (!mesh)
+		return nullptr;
+
+	source->grab();
+	m_Unwrapped[source] = mesh;
+	m_Sources[mesh] = source;
+	return mesh;
+}
+
+irr::scene::IMesh* LightmapMeshes::GetSource(irr::scene::IMesh* mesh)
+{
+	meshmap_t::iterator it = m_Sources.find(mesh);
+	return it != m_Sources.end() ? it->second : nullptr;
+}
+
+void LightmapMeshes::Clear(void)
+{
+	for (meshmap_t::iterator it = m_Unwrapped.begin(); it != m_Unwrapped.end(); ++it)
+	{
+		it->first->drop();
+		it->second->drop();
+	}
+
+	m_Unwrapped.clear();
+	m_Sources.clear();
+}
+
+namespace
+{
+	struct UnwrapTriangle
+	{
+		irr::u32 Buffer;
+		irr::u32 Index[3];
+		irr::u32 Chart;
+	};
+
+	struct Chart
+	{
+		int Axis;           // 0-2, the axis the chart is projected along
+		irr::core::vector2df Min, Max;
+		irr::core::vector2df Offset; // where it's packed
+	};
+
+	irr::u32 FindRoot(std::vector<irr::u32>& parents, irr::u32 i)
+	{
+		while (parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+
+		return i;
+	}
+
+	irr::core::vector2df Project(const irr::core::vector3df& p, int axis)
+	{
+		switch (axis)
+		{
+		case 0: return irr::core::vector2df(p.Z, p.Y);
+		case 1: return irr::core::vector2df(p.X, p.Z);
+		default: return irr::core::vector2df(p.X, p.Y);
+		}
+	}
+
+	irr::u32 GetIndex(irr::scene::IMeshBuffer* buffer, irr::u32 i)
+	{
+		if (buffer->getIndexType() == irr::video::EIT_32BIT)
+			return reinterpret_cast<const irr::u32*>(buffer->getIndices())[i];
+		return buffer->getIndices()[i];
+	}
+
+	// every vertex type starts with the standard layout
+	const irr::video::S3DVertex& GetVertex(irr::scene::IMeshBuffer* buffer, irr::u32 i)
+	{
+		return *reinterpret_cast<const irr::video::S3DVertex*>(
+			static_cast<const irr::u8*>(buffer->getVertices()) +
+			i * irr::video::getVertexPitchFromType(buffer->getVertexType()));
+	}
+
+	// shelf packing, false if the charts don't fit the side
+	bool Pack(std::vector<Chart>& charts, const std::vector<irr::u32>& order,
+		irr::f32 side, irr::f32 padding)
+	{
+		irr::f32 x = 0, y = 0, shelf = 0;
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			Chart& chart = charts[order[i]];
+			irr::core::vector2df size = chart.Max - chart.Min + irr::core::vector2df(padding * 2.0f);
+			if (x + size.X > side && x > 0)
+			{
+				x = 0;
+				y += shelf;
+				shelf = 0;
+			}
+
+			if (x + size.X > side || y + size.Y > side)
+				return false;
+
+			chart.Offset.set(x + padding, y + padding);
+			x += size.X;
+			shelf = irr::core::max_(shelf, size.Y);
+		}
+
+		return true;
+	}
+}
+
+irr::scene::IMesh* LightmapMeshes::Unwrap(irr::scene::IMesh* source)
+{
+	irr::core::aabbox3df bounds = source->getBoundingBox();
+	irr::f32 extent = irr::core::max_(bounds.getExtent().X, bounds.getExtent().Y, bounds.getExtent().Z);
+	irr::f32 weld = irr::core::max_(extent * 1.0e-5f, 1.0e-6f);
+
+	// weld the vertices by position so the charts cross the buffers' seams
+	struct KeyHash
+	{
+		size_t operator()(const irr::core::vector3di& k) const
+		{
+			return ((size_t)k.X * 73856093) ^ ((size_t)k.Y * 19349663) ^ ((size_t)k.Z * 83492791);
+		}
+	};
+	std::unordered_map<irr::core::vector3di, irr::u32, KeyHash> welded;
+	std::vector<std::vector<irr::u32>> weldIds(source->getMeshBufferCount());
+
+	std::vector<UnwrapTriangle> tris;
+	std::vector<int> axes;
+	for (irr::u32 b = 0; b < source->getMeshBufferCount(); ++b)
+	{
+		irr::scene::IMeshBuffer* buffer = source->getMeshBuffer(b);
+		weldIds[b].resize(buffer->getVertexCount());
+		for (irr::u32 v = 0; v < buffer->getVertexCount(); ++v)
+		{
+			const irr::core::vector3df& p = buffer->getPosition(v);
+			irr::core::vector3di key((irr::s32)floorf(p.X / weld + 0.5f),
+				(irr::s32)floorf(p.Y / weld + 0.5f), (irr::s32)floorf(p.Z / weld + 0.5f));
+			weldIds[b][v] = welded.insert(std::make_pair(key, (irr::u32)welded.size())).first->second;
+		}
+
+		for (irr::u32 i = 0; i + 2 < buffer->getIndexCount(); i += 3)
+		{
+			UnwrapTriangle tri;
+			tri.Buffer = b;
+			for (int v = 0; v < 3; ++v)
+				tri.Index[v] = GetIndex(buffer, i + v);
+			tri.Chart = 0;
+
+			// split the axes by sign, or the faces on either side would overlap
+			irr::core::vector3df normal = irr::core::triangle3df(buffer->getPosition(tri.Index[0]),
+				buffer->getPosition(tri.Index[1]), buffer->getPosition(tri.Index[2])).getNormal();
+			irr::core::vector3df a(fabsf(normal.X), fabsf(normal.Y), fabsf(normal.Z));
+			int axis = a.X >= a.Y && a.X >= a.Z ? 0 : (a.Y >= a.Z ? 1 : 2);
+			axes.push_back(axis * 2 + ((&normal.X)[axis] < 0 ? 1 : 0));
+			tris.push_back(tri);
+		}
+	}
+
+	if (tris.empty())
+		return nullptr;
+
+	// join the triangles sharing an edge and an axis
+	std::vector<irr::u32> parents(tris.size());
+	for (size_t i = 0; i < tris.size(); ++i)
+		parents[i] = (irr::u32)i;
+
+	std::unordered_map<irr::u64, irr::u32> edges;
+	for (size_t t = 0; t < tris.size(); ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			irr::u32 a = weldIds[tris[t].Buffer][tris[t].Index[e]];
+			irr::u32 b = weldIds[tris[t].Buffer][tris[t].Index[(e + 1) % 3]];
+			if (a == b)
+				continue;
+
+			irr::u64 key = ((irr::u64)irr::core::min_(a, b) << 32) | irr::core::max_(a, b);
+			std::unordered_map<irr::u64, irr::u32>::iterator other = edges.find(key);
+			if (other == edges.end())
+				edges[key] = (irr::u32)t;
+			else if (axes[other->second] == axes[t])
+				parents[FindRoot(parents, (irr::u32)t)] = FindRoot(parents, other->second);
+		}
+	}
+
+	// the bounds of each chart in its plane
+	std::vector<Chart> charts;
+	std::unordered_map<irr::u32, irr::u32> chartIds;
+	for (size_t t = 0; t < tris.size(); ++t)
+	{
+		irr::u32 root = FindRoot(parents, (irr::u32)t);
+		std::unordered_map<irr::u32, irr::u32>::iterator id = chartIds.find(root);
+		if (id == chartIds.end())
+		{
+			id = chartIds.insert(std::make_pair(root, (irr::u32)charts.size())).first;
+			Chart chart;
+			chart.Axis = axes[t] / 2;
+			chart.Min = chart.Max = Project(source->getMeshBuffer(tris[t].Buffer)->getPosition(
+				tris[t].Index[0]), chart.Axis);
+			charts.push_back(chart);
+		}
+
+		tris[t].Chart = id->second;
+		Chart& chart = charts[id->second];
+		for (int v = 0; v < 3; ++v)
+		{
+			irr::core::vector2df p = Project(source->getMeshBuffer(tris[t].Buffer)->getPosition(
+				tris[t].Index[v]), chart.Axis);
+			chart.Min.set(irr::core::min_(chart.Min.X, p.X), irr::core::min_(chart.Min.Y, p.Y));
+			chart.Max.set(irr::core::max_(chart.Max.X, p.X), irr::core::max_(chart.Max.Y, p.Y));
+		}
+	}
+
+	// tallest first, growing the square until everything fits
+	irr::f32 area = 0;
+	irr::f32 minSize = irr::core::max_(extent * 1.0e-3f, 1.0e-6f);
+	for (size_t c = 0; c < charts.size(); ++c)
+	{
+		charts[c].Max.X = irr::core::max_(charts[c].Max.X, charts[c].Min.X + minSize);
+		charts[c].Max.Y = irr::core::max_(charts[c].Max.Y, charts[c].Min.Y + minSize);
+		area += (charts[c].Max.X - charts[c].Min.X) * (charts[c].Max.Y - charts[c].Min.Y);
+	}
+
+	std::vector<irr::u32> order(charts.size());
+	for (size_t c = 0; c < charts.size(); ++c)
+		order[c] = (irr::u32)c;
+	std::sort(order.begin(), order.end(), [&charts](irr::u32 a, irr::u32 b)
+	{
+		return charts[a].Max.Y - charts[a].Min.Y > charts[b].Max.Y - charts[b].Min.Y;
+	});
+
+	irr::f32 side = sqrtf(area) * 1.15f;
+	for (size_t c = 0; c < charts.size(); ++c)
+	{
+		side = irr::core::max_(side, charts[c].Max.X - charts[c].Min.X,
+			charts[c].Max.Y - charts[c].Min.Y);
+	}
+
+	// about two texels of a 128 texel lightmap between the charts
+	while (!Pack(charts, order, side, side / 128.0f))
+		side *= 1.1f;
+
+	// a vertex is copied for each chart it's in
+	irr::scene::SMesh* mesh = new irr::scene::SMesh;
+	for (irr::u32 b = 0; b < source->getMeshBufferCount(); ++b)
+	{
+		irr::scene::IMeshBuffer* buffer = source->getMeshBuffer(b);
+
+		std::vector<irr::video::S3DVertex2TCoords> vertices;
+		std::vector<irr::u32> indices;
+		std::unordered_map<irr::u64, irr::u32> copies;
+		for (size_t t = 0; t < tris.size(); ++t)
+		{
+			if (tris[t].Buffer != b)
+				continue;
+
+			const Chart& chart = charts[tris[t].Chart];
+			for (int v = 0; v < 3; ++v)
+			{
+				irr::u64 key = ((irr::u64)tris[t].Chart << 32) | tris[t].Index[v];
+				std::unordered_map<irr::u64, irr::u32>::iterator copy = copies.find(key);
+				if (copy == copies.end())
+				{
+					const irr::video::S3DVertex& vertex = GetVertex(buffer, tris[t].Index[v]);
+					irr::core::vector2df uv = (Project(vertex.Pos, chart.Axis) - chart.Min + chart.Offset) / side;
+					vertices.push_back(irr::video::S3DVertex2TCoords(vertex.Pos, vertex.Normal,
+						vertex.Color, vertex.TCoords, uv));
+					copy = copies.insert(std::make_pair(key, (irr::u32)vertices.size() - 1)).first;
+				}
+
+				indices.push_back(copy->second);
+			}
+		}
+
+		irr::scene::CDynamicMeshBuffer* out = new irr::scene::CDynamicMeshBuffer(irr::video::EVT_2TCOORDS,
+			vertices.size() > 0xffff ? irr::video::EIT_32BIT : irr::video::EIT_16BIT);
+		out->getVertexBuffer().reallocate((irr::u32)vertices.size());
+		for (size_t v = 0; v < vertices.size(); ++v)
+			out->getVertexBuffer().push_back(vertices[v]);
+		out->getIndexBuffer().reallocate((irr::u32)indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+			out->getIndexBuffer().push_back(indices[i]);
+
+		out->getMaterial() = buffer->getMaterial();
+		out->setHardwareMappingHint(irr::scene::EHM_STATIC);
+		out->recalculateBoundingBox();
+		mesh->addMeshBuffer(out);
+		out->drop();
+	}
+
+	mesh->recalculateBoundingBox();
+	return mesh;
+}
+
+Lightmapper::Settings::Settings(void)
+	: TexelsPerUnit(2.0f), MinSize(16), MaxSize(512), Samples(32), Reflectance(0.5f)
+{
+}
+
+Lightmapper::Lightmapper(std::shared_ptr<Map>& map, const Settings& settings)
+	: m_SceneMgr(map->GetSceneMgr()), m_Map(map), m_Settings(settings),
+	  m_SceneSize(1.0f), m_Bias(0.01f), m_Stage(STAGE_DONE),
+	  m_NextTile(0), m_DoneTiles(0), m_Cancel(false)
+{
+}
+
+Lightmapper::~Lightmapper(void)
+{
+	Cancel();
+
+	for (size_t r = 0; r < m_Receivers.size(); ++r)
+		m_Receivers[r].Mesh->drop();
+
+	for (lightmaps_t::iterator it = m_Lightmaps.begin(); it != m_Lightmaps.end(); ++it)
+		it->second->drop();
+}
+
+bool Lightmapper::Start(irr::scene::ISceneNode* mapRoot)
+{
+	irr::video::SColorf ambient = m_SceneMgr->getAmbientLight();
+	m_Ambient.set(ambient.r, ambient.g, ambient.b);
+
+	// world space triangles of everything that casts a shadow
+	std::vector<irr::core::triangle3df> triangles;
+	m_Map->GetStaticTriangles(triangles);
+
+	irr::scene::CDynamicMeshBuffer* occluders = new irr::scene::CDynamicMeshBuffer(
+		irr::video::EVT_STANDARD, irr::video::EIT_32BIT);
+	occluders->getVertexBuffer().reallocate((irr::u32)triangles.size() * 3);
+	occluders->getIndexBuffer().reallocate((irr::u32)triangles.size() * 3);
+	for (size_t t = 0; t < triangles.size(); ++t)
+	{
+		irr::u32 base = occluders->getVertexBuffer().size();
+		occluders->getVertexBuffer().push_back(irr::video::S3DVertex(triangles[t].pointA,
+			irr::core::vector3df(), irr::video::SColor(), irr::core::vector2df()));
+		occluders->getVertexBuffer().push_back(irr::video::S3DVertex(triangles[t].pointB,
+			irr::core::vector3df(), irr::video::SColor(), irr::core::vector2df()));
+		occluders->getVertexBuffer().push_back(irr::video::S3DVertex(triangles[t].pointC,
+			irr::core::vector3df(), irr::video::SColor(), irr::core::vector2df()));
+		occluders->getIndexBuffer().push_back(base);
+		occluders->getIndexBuffer().push_back(base + 1);
+		occluders->getIndexBuffer().push_back(base + 2);
+	}
+
+	const irr::scene::ISceneNodeList& children = mapRoot->getChildren();
+	for (irr::scene::ISceneNodeList::ConstIterator i = children.begin(); i != children.end(); ++i)
+	{
+		irr::scene::ISceneNode* node = *i;
+		if (!node->isVisible() || (node->getID() & NID_NOSAVE))
+			continue;
+
+		if (node->getType() == irr::scene::ESNT_LIGHT)
+		{
+			const irr::video::SLight& data = static_cast<irr::scene::ILightSceneNode*>(node)->getLightData();
+
+			Light light;
+			light.Type = data.Type;
+			light.Position = node->getAbsolutePosition();
+			light.Direction.set(0, 0, 1);
+			node->getAbsoluteTransformation().rotateVect(light.Direction);
+			light.Direction.normalize();
+			light.Diffuse.set(data.DiffuseColor.r, data.DiffuseColor.g, data.DiffuseColor.b);
+			light.Attenuation = data.Attenuation;
+			light.Radius = data.Radius;
+			light.CosOuter = cosf(data.OuterCone * irr::core::DEGTORAD);
+			light.CosInner = cosf(data.InnerCone * irr::core::DEGTORAD);
+			light.Falloff = data.Falloff;
+			light.Shadows = data.CastShadows;
+			m_Lights.push_back(light);
+
+			m_Ambient += irr::core::vector3df(data.AmbientColor.r, data.AmbientColor.g, data.AmbientColor.b);
+			continue;
+		}
+
+		// only plain static meshes can take the second set of coordinates
+		if (node->getType() != irr::scene::ESNT_MESH || !node->getChildren().empty())
+			continue;
+
+		irr::scene::IMesh* mesh = m_Map->GetLightmapMesh(node);
+		if (!mesh)
+			continue;
+
+		Receiver receiver;
+		receiver.Name = node->getName();
+		receiver.Mesh = mesh;
+		receiver.Transform = node->getAbsoluteTransformation();
+		irr::core::matrix4 inverse;
+		receiver.Transform.getInverse(inverse);
+		receiver.NormalTransform = inverse.getTransposed();
+
+		// size the lightmap by the surface it covers
+		irr::f32 area = 0;
+		for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		{
+			irr::scene::IMeshBuffer* buffer = mesh->getMeshBuffer(b);
+			for (irr::u32 t = 0; t + 2 < buffer->getIndexCount(); t += 3)
+			{
+				irr::core::vector3df p[3];
+				for (int v = 0; v < 3; ++v)
+				{
+					p[v] = buffer->getPosition(GetIndex(buffer, t + v));
+					receiver.Transform.transformVect(p[v]);
+				}
+				area += 0.5f * (p[1] - p[0]).crossProduct(p[2] - p[0]).getLength();
+			}
+		}
+
+		irr::u32 wanted = (irr::u32)ceilf(sqrtf(area) * m_Settings.TexelsPerUnit * 1.5f);
+		receiver.Size = m_Settings.MinSize;
+		while (receiver.Size < wanted && receiver.Size < m_Settings.MaxSize)
+			receiver.Size *= 2;
+
+		receiver.Image = m_SceneMgr->getVideoDriver()->createImage(irr::video::ECF_A8R8G8B8,
+			irr::core::dimension2du(receiver.Size, receiver.Size));
+		receiver.Image->fill(irr::video::SColor(255, 0, 0, 0));
+		m_Lightmaps[receiver.Name] = receiver.Image;
+
+		mesh->grab();
+		m_Receivers.push_back(receiver);
+	}
+
+	// the whole map in one hierarchy
+	irr::scene::SMesh* scene = new irr::scene::SMesh;
+	scene->addMeshBuffer(occluders);
+	occluders->drop();
+	m_Scene = CollisionShape::Build(scene);
+	scene->drop();
+
+	if (m_Scene)
+		m_SceneSize = irr::core::max_(m_Scene->GetBounds().getExtent().getLength(), 1.0f);
+
+	// a quarter of a texel off the surface keeps it from shadowing itself
+	m_Bias = irr::core::max_(0.25f / m_Settings.TexelsPerUnit, 0.001f);
+
+	if (m_Receivers.empty())
+		return false;
+
+	m_Workers.reset(new WorkerPool);
+	Begin(STAGE_PREPARE);
+	return true;
+}
+
+bool Lightmapper::Poll(void)
+{
+	if (m_Stage == STAGE_DONE || m_Cancel)
+		return false;
+
+	if (m_DoneTiles < m_Tiles.size())
+	{
+		Publish();
+		return true;
+	}
+
+	// the workers mustn't still be looking at the tiles when they change
+	m_Workers->Wait();
+	Publish();
+
+	switch (m_Stage)
+	{
+	case STAGE_PREPARE:
+		Begin(STAGE_DIRECT);
+		return true;
+	case STAGE_DIRECT:
+		if (m_Settings.Samples > 0 && m_Settings.Reflectance > 0 && m_Scene)
+		{
+			Begin(STAGE_INDIRECT);
+			return true;
+		}
+		break;
+	default:
+		break;
+	}
+
+	// fill the gaps around the charts so filtering doesn't pull in black
+	for (size_t r = 0; r < m_Receivers.size(); ++r)
+		Dilate(m_Receivers[r]);
+
+	m_Stage = STAGE_DONE;
+	return false;
+}
+
+void Lightmapper::Cancel(void)
+{
+	m_Cancel = true;
+
+	if (m_Workers)
+	{
+		m_Workers->Cancel();
+		m_Workers->Wait();
+	}
+}
+
+int Lightmapper::GetProgress(void) const
+{
+	if (m_Tiles.empty())
+		return 100;
+
+	return (int)((irr::u64)m_DoneTiles * 100 / m_Tiles.size());
+}
+
+void Lightmapper::Begin(STAGE stage)
+{
+	m_Stage = stage;
+	m_Tiles.clear();
+	m_Finished.clear();
+
+	for (size_t r = 0; r < m_Receivers.size(); ++r)
+	{
+		Tile tile;
+		tile.Receiver = (irr::u32)r;
+		if (stage == STAGE_PREPARE)
+		{
+			tile.First = tile.Count = 0;
+			m_Tiles.push_back(tile);
+			continue;
+		}
+
+		irr::u32 texels = (irr::u32)m_Receivers[r].Texels.size();
+		for (tile.First = 0; tile.First < texels; tile.First += TILE_TEXELS)
+		{
+			tile.Count = irr::core::min_((irr::u32)TILE_TEXELS, texels - tile.First);
+			m_Tiles.push_back(tile);
+		}
+	}
+
+	m_NextTile = 0;
+	m_DoneTiles = 0;
+
+	// each worker takes the next tile when it finishes one, so a slow tile
+	// doesn't hold up the rest
+	for (size_t i = 0; i < m_Workers->GetThreadCount(); ++i)
+		m_Workers->Submit([this]() { Work(); });
+}
+
+void Lightmapper::Work(void)
+{
+	std::vector<irr::u32> candidates;
+
+	while (!m_Cancel)
+	{
+		irr::u32 index = m_NextTile++;
+		if (index >= m_Tiles.size())
+			break;
+
+		const Tile& tile = m_Tiles[index];
+		Receiver& receiver = m_Receivers[tile.Receiver];
+		switch (m_Stage)
+		{
+		case STAGE_PREPARE:
+			Prepare(receiver);
+			break;
+		case STAGE_DIRECT:
+			LightDirect(receiver, tile, candidates);
+			break;
+		case STAGE_INDIRECT:
+			LightIndirect(receiver, tile, candidates);
+			break;
+		default:
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_FinishedMutex);
+			m_Finished.push_back(index);
+		}
+		++m_DoneTiles;
+	}
+}
+
+void Lightmapper::Publish(void)
+{
+	std::vector<irr::u32> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_FinishedMutex);
+		finished.swap(m_Finished);
+	}
+
+	if (m_Stage == STAGE_PREPARE)
+		return;
+
+	for (size_t t = 0; t < finished.size(); ++t)
+	{
+		const Tile& tile = m_Tiles[finished[t]];
+		Receiver& receiver = m_Receivers[tile.Receiver];
+		for (irr::u32 i = tile.First; i < tile.First + tile.Count; ++i)
+		{
+			irr::u32 index = receiver.Texels[i].Index;
+			receiver.Image->setPixel(index % receiver.Size, index / receiver.Size, receiver.Colors[i]);
+		}
+	}
+}
+
+void Lightmapper::Prepare(Receiver& receiver)
+{
+	std::vector<bool> covered(receiver.Size * receiver.Size, false);
+	irr::f32 size = (irr::f32)receiver.Size;
+
+	for (irr::u32 b = 0; b < receiver.Mesh->getMeshBufferCount(); ++b)
+	{
+		irr::scene::IMeshBuffer* buffer = receiver.Mesh->getMeshBuffer(b);
+		if (buffer->getVertexType() != irr::video::EVT_2TCOORDS)
+			continue;
+
+		const irr::video::S3DVertex2TCoords* vertices =
+			static_cast<const irr::video::S3DVertex2TCoords*>(buffer->getVertices());
+		for (irr::u32 t = 0; t + 2 < buffer->getIndexCount(); t += 3)
+		{
+			const irr::video::S3DVertex2TCoords* v[3];
+			irr::core::vector2df uv[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				v[i] = &vertices[GetIndex(buffer, t + i)];
+				uv[i] = v[i]->TCoords2 * size;
+			}
+
+			irr::f32 area = (uv[1].X - uv[0].X) * (uv[2].Y - uv[0].Y) - (uv[1].Y - uv[0].Y) * (uv[2].X - uv[0].X);
+			if (irr::core::iszero(area))
+				continue;
+
+			irr::s32 x0 = irr::core::max_(0, (irr::s32)floorf(irr::core::min_(uv[0].X, uv[1].X, uv[2].X)));
+			irr::s32 y0 = irr::core::max_(0, (irr::s32)floorf(irr::core::min_(uv[0].Y, uv[1].Y, uv[2].Y)));
+			irr::s32 x1 = irr::core::min_((irr::s32)receiver.Size - 1, (irr::s32)ceilf(irr::core::max_(uv[0].X, uv[1].X, uv[2].X)));
+			irr::s32 y1 = irr::core::min_((irr::s32)receiver.Size - 1, (irr::s32)ceilf(irr::core::max_(uv[0].Y, uv[1].Y, uv[2].Y)));
+
+			for (irr::s32 y = y0; y <= y1; ++y)
+			{
+				for (irr::s32 x = x0; x <= x1; ++x)
+				{
+					irr::u32 index = y * receiver.Size + x;
+					if (covered[index])
+						continue;
+
+					// barycentric weights of the texel centre
+					irr::core::vector2df p(x + 0.5f, y + 0.5f);
+					irr::f32 w[3];
+					for (int i = 0; i < 3; ++i)
+					{
+						const irr::core::vector2df& a = uv[(i + 1) % 3];
+						const irr::core::vector2df& c = uv[(i + 2) % 3];
+						w[i] = ((c.X - a.X) * (p.Y - a.Y) - (c.Y - a.Y) * (p.X - a.X)) / area;
+					}
+
+					if (w[0] < 0 || w[1] < 0 || w[2] < 0)
+						continue;
+
+					Texel texel;
+					texel.Index = index;
+					texel.Position = v[0]->Pos * w[0] + v[1]->Pos * w[1] + v[2]->Pos * w[2];
+					receiver.Transform.transformVect(texel.Position);
+					texel.Normal = v[0]->Normal * w[0] + v[1]->Normal * w[1] + v[2]->Normal * w[2];
+					receiver.NormalTransform.rotateVect(texel.Normal);
+					texel.Normal.normalize();
+
+					covered[index] = true;
+					receiver.Texels.push_back(texel);
+				}
+			}
+		}
+	}
+
+	receiver.Direct.assign(receiver.Texels.size(), irr::core::vector3df(0));
+	receiver.Colors.assign(receiver.Texels.size(), irr::video::SColor(255, 0, 0, 0));
+}
+
+void Lightmapper::LightDirect(Receiver& receiver, const Tile& tile, std::vector<irr::u32>& candidates)
+{
+	for (irr::u32 i = tile.First; i < tile.First + tile.Count && !m_Cancel; ++i)
+	{
+		const Texel& texel = receiver.Texels[i];
+		receiver.Direct[i] = Direct(texel.Position + texel.Normal * m_Bias, texel.Normal, candidates);
+		Store(receiver, i, receiver.Direct[i]);
+	}
+}
+
+void Lightmapper::LightIndirect(Receiver& receiver, const Tile& tile, std::vector<irr::u32>& candidates)
+{
+	for (irr::u32 i = tile.First; i < tile.First + tile.Count && !m_Cancel; ++i)
+	{
+		const Texel& texel = receiver.Texels[i];
+		irr::core::vector3df origin = texel.Position + texel.Normal * m_Bias;
+
+		// a frame around the normal for the hemisphere
+		irr::core::vector3df tangent = fabsf(texel.Normal.Y) < 0.99f ?
+			irr::core::vector3df(0, 1, 0).crossProduct(texel.Normal) :
+			irr::core::vector3df(1, 0, 0).crossProduct(texel.Normal);
+		tangent.normalize();
+		irr::core::vector3df bitangent = texel.Normal.crossProduct(tangent);
+
+		// the same texel gets the same rays every bake
+		irr::u32 seed = (irr::u32)(texel.Index * 2654435761u) ^ (tile.Receiver * 40503u) ^ 0x9e3779b9u;
+
+		irr::core::vector3df bounce;
+		for (irr::u32 s = 0; s < m_Settings.Samples; ++s)
+		{
+			seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+			irr::f32 u1 = (seed & 0xffffff) / 16777216.0f;
+			seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+			irr::f32 u2 = (seed & 0xffffff) / 16777216.0f;
+
+			// cosine weighted, so the samples only need averaging
+			irr::f32 r = sqrtf(u1);
+			irr::f32 phi = 2.0f * irr::core::PI * u2;
+			irr::core::vector3df dir = tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) +
+				texel.Normal * sqrtf(irr::core::max_(0.0f, 1.0f - u1));
+
+			irr::core::vector3df hit, normal;
+			if (!Trace(origin, origin + dir * m_SceneSize, hit, normal, candidates))
+				continue;
+
+			if (normal.dotProduct(dir) > 0)
+				normal = -normal;
+			bounce += Direct(hit + normal * m_Bias, normal, candidates);
+		}
+
+		bounce *= m_Settings.Reflectance / m_Settings.Samples;
+		Store(receiver, i, receiver.Direct[i] + bounce);
+	}
+}
+
+void Lightmapper::Dilate(Receiver& receiver)
+{
+	irr::s32 size = (irr::s32)receiver.Size;
+	std::vector<bool> covered(size * size, false);
+	for (size_t i = 0; i < receiver.Texels.size(); ++i)
+		covered[receiver.Texels[i].Index] = true;
+
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		std::vector<bool> next(covered);
+		for (irr::s32 y = 0; y < size; ++y)
+		{
+			for (irr::s32 x = 0; x < size; ++x)
+			{
+				if (covered[y * size + x])
+					continue;
+
+				irr::u32 r = 0, g = 0, b = 0, count = 0;
+				for (irr::s32 dy = -1; dy <= 1; ++dy)
+				{
+					for (irr::s32 dx = -1; dx <= 1; ++dx)
+					{
+						irr::s32 nx = x + dx, ny = y + dy;
+						if (nx < 0 || ny < 0 || nx >= size || ny >= size || !covered[ny * size + nx])
+							continue;
+
+						irr::video::SColor color = receiver.Image->getPixel(nx, ny);
+						r += color.getRed();
+						g += color.getGreen();
+						b += color.getBlue();
+						++count;
+					}
+				}
+
+				if (count)
+				{
+					receiver.Image->setPixel(x, y, irr::video::SColor(255, r / count, g / count, b / count));
+					next[y * size + x] = true;
+				}
+			}
+		}
+
+		covered.swap(next);
+	}
+}
+
+irr::core::vector3df Lightmapper::Direct(const irr::core::vector3df& position,
+	const irr::core::vector3df& normal, std::vector<irr::u32>& candidates) const
+{
+	irr::core::vector3df light;
+
+	for (size_t l = 0; l < m_Lights.size(); ++l)
+	{
+		const Light& source = m_Lights[l];
+
+		irr::core::vector3df toLight;
+		irr::f32 distance = m_SceneSize;
+		irr::f32 attenuation = 1.0f;
+		if (source.Type == irr::video::ELT_DIRECTIONAL)
+			toLight = -source.Direction;
+		else
+		{
+			toLight = source.Position - position;
+			distance = toLight.getLength();
+			if (distance > source.Radius || irr::core::iszero(distance))
+				continue;
+
+			toLight /= distance;
+			attenuation = 1.0f / irr::core::max_(source.Attenuation.X +
+				source.Attenuation.Y * distance + source.Attenuation.Z * distance * distance, 0.0001f);
+
+			if (source.Type == irr::video::ELT_SPOT)
+			{
+				irr::f32 angle = toLight.dotProduct(-source.Direction);
+				if (angle < source.CosOuter)
+					continue;
+				if (angle < source.CosInner && source.CosInner > source.CosOuter)
+					attenuation *= powf((angle - source.CosOuter) / (source.CosInner - source.CosOuter),
+						source.Falloff);
+			}
+		}
+
+		irr::f32 lambert = normal.dotProduct(toLight);
+		if (lambert <= 0)
+			continue;
+
+		if (source.Shadows && Occluded(position, source.Type == irr::video::ELT_DIRECTIONAL ?
+			position + toLight * distance : source.Position, candidates))
+			continue;
+
+		light += source.Diffuse * (lambert * attenuation);
+	}
+
+	return light;
+}
+
+// the segment's parameter where it crosses the triangle, both sides count
+static bool Intersect(const irr::core::triangle3df& triangle, const irr::core::vector3df& start,
+	const irr::core::vector3df& dir, irr::f32& t)
+{
+	irr::core::vector3df e1 = triangle.pointB - triangle.pointA;
+	irr::core::vector3df e2 = triangle.pointC - triangle.pointA;
+	irr::core::vector3df p = dir.crossProduct(e2);
+	irr::f32 det = e1.dotProduct(p);
+	if (fabsf(det) < 1.0e-12f)
+		return false;
+
+	irr::f32 inv = 1.0f / det;
+	irr::core::vector3df s = start - triangle.pointA;
+	irr::f32 u = s.dotProduct(p) * inv;
+	if (u < 0 || u > 1)
+		return false;
+
+	irr::core::vector3df q = s.crossProduct(e1);
+	irr::f32 v = dir.dotProduct(q) * inv;
+	if (v < 0 || u + v > 1)
+		return false;
+
+	t = e2.dotProduct(q) * inv;
+	return t > 1.0e-5f && t < 1.0f;
+}
+
+bool Lightmapper::Occluded(const irr::core::vector3df& from, const irr::core::vector3df& to,
+	std::vector<irr::u32>& candidates) const
+{
+	if (!m_Scene)
+		return false;
+
+	candidates.clear();
+	m_Scene->Query(irr::core::line3df(from, to), candidates);
+
+	irr::core::vector3df dir = to - from;
+	irr::f32 t;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		// stop short of the light's own end of the segment
+		if (Intersect(m_Scene->GetTriangle(candidates[i]), from, dir, t) && t < 0.9999f)
+			return true;
+	}
+
+	return false;
+}
+
+bool Lightmapper::Trace(const irr::core::vector3df& from, const irr::core::vector3df& to,
+	irr::core::vector3df& hit, irr::core::vector3df& normal, std::vector<irr::u32>& candidates) const
+{
+	if (!m_Scene)
+		return false;
+
+	candidates.clear();
+	m_Scene->Query(irr::core::line3df(from, to), candidates);
+
+	irr::core::vector3df dir = to - from;
+	irr::f32 nearest = 2.0f;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		irr::core::triangle3df triangle = m_Scene->GetTriangle(candidates[i]);
+		irr::f32 t;
+		if (Intersect(triangle, from, dir, t) && t < nearest)
+		{
+			nearest = t;
+			normal = triangle.getNormal();
+		}
+	}
+
+	if (nearest > 1.0f)
+		return false;
+
+	hit = from + dir * nearest;
+	normal.normalize();
+	return true;
+}
+
+void Lightmapper::Store(Receiver& receiver, irr::u32 texel, const irr::core::vector3df& light)
+{
+	// the lightmap is drawn doubled, so half is full brightness and brighter
+	// spots still show
+	irr::core::vector3df c = (light + m_Ambient) * 0.5f;
+	receiver.Colors[texel] = irr::video::SColor(255,
+		(irr::u32)(irr::core::clamp(c.X, 0.0f, 1.0f) * 255.0f),
+		(irr::u32)(irr::core::clamp(c.Y, 0.0f, 1.0f) * 255.0f),
+		(irr::u32)(irr::core::clamp(c.Z, 0.0f, 1.0f) * 255.0f));
+}
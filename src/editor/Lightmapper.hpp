@@ -0,0 +1,187 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "CollisionShape.hpp"
+#include "WorkerPool.hpp"
+
+#include <wx/string.h>
+
+#include "irrlicht.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Map;
+
+// Copies of meshes with a second set of texture coordinates laid out for a
+// lightmap. Every node using a mesh shares its copy, and since the layout only
+// depends on the mesh it's the same each time the map is loaded.
+class LightmapMeshes
+{
+private:
+	typedef std::map<irr::scene::IMesh*, irr::scene::IMesh*> meshmap_t;
+	meshmap_t m_Unwrapped; // source to copy, both are held
+	meshmap_t m_Sources;   // copy to source
+
+public:
+	LightmapMeshes(void);
+	~LightmapMeshes(void);
+
+	// The copy of a mesh, unwrapped on first use
+	irr::scene::IMesh* Get(irr::scene::IMesh* source);
+
+	// The mesh a copy was made from, null if it isn't a copy
+	irr::scene::IMesh* GetSource(irr::scene::IMesh* mesh);
+
+	void Clear(void);
+
+	// Groups the triangles into charts facing the same axis, projects them
+	// flat and packs them into the unit square
+	static irr::scene::IMesh* Unwrap(irr::scene::IMesh* source);
+};
+
+// Bakes the light of the map's light nodes into a lightmap per static mesh.
+// Direct light, then one bounce of indirect light, is traced against a BVH of
+// the map's geometry. The texels are split into tiles which the workers take
+// in turn. The workers never touch the lightmap images; Poll copies each tile
+// into its image once the tile is finished, so the images can be shown while
+// the bake runs.
+class Lightmapper
+{
+public:
+	enum STAGE
+	{
+		STAGE_PREPARE,  // finding the texels of each lightmap
+		STAGE_DIRECT,
+		STAGE_INDIRECT,
+		STAGE_DONE
+	};
+
+	struct Settings
+	{
+		irr::f32 TexelsPerUnit;
+		irr::u32 MinSize;
+		irr::u32 MaxSize;
+		irr::u32 Samples;       // indirect rays per texel
+		irr::f32 Reflectance;   // of every surface, for the bounce
+
+		Settings(void);
+	};
+
+	typedef std::map<wxString, irr::video::IImage*> lightmaps_t;
+
+private:
+	enum { TILE_TEXELS = 256 };
+
+	struct Texel
+	{
+		irr::u32 Index;
+		irr::core::vector3df Position;
+		irr::core::vector3df Normal;
+	};
+
+	struct Receiver
+	{
+		wxString Name;
+		irr::scene::IMesh* Mesh;
+		irr::core::matrix4 Transform;
+		irr::core::matrix4 NormalTransform;
+		irr::u32 Size;
+		irr::video::IImage* Image;
+		std::vector<Texel> Texels;
+		std::vector<irr::core::vector3df> Direct;
+		std::vector<irr::video::SColor> Colors; // per texel, until published
+	};
+
+	struct Light
+	{
+		irr::video::E_LIGHT_TYPE Type;
+		irr::core::vector3df Position;
+		irr::core::vector3df Direction;
+		irr::core::vector3df Diffuse;
+		irr::core::vector3df Attenuation;
+		irr::f32 Radius;
+		irr::f32 CosOuter;
+		irr::f32 CosInner;
+		irr::f32 Falloff;
+		bool Shadows;
+	};
+
+	struct Tile
+	{
+		irr::u32 Receiver;
+		irr::u32 First;
+		irr::u32 Count;
+	};
+
+	irr::scene::ISceneManager* m_SceneMgr;
+	std::shared_ptr<Map> m_Map;
+	Settings m_Settings;
+
+	std::vector<Receiver> m_Receivers;
+	std::vector<Light> m_Lights;
+	irr::core::vector3df m_Ambient;
+	std::shared_ptr<const CollisionShape> m_Scene;
+	irr::f32 m_SceneSize;
+	irr::f32 m_Bias;
+
+	lightmaps_t m_Lightmaps;
+
+	STAGE m_Stage;
+	std::vector<Tile> m_Tiles;
+	std::atomic<irr::u32> m_NextTile;
+	std::atomic<irr::u32> m_DoneTiles;
+	std::atomic<bool> m_Cancel;
+	std::mutex m_FinishedMutex;
+	std::vector<irr::u32> m_Finished; // tiles not yet copied to the images
+	std::unique_ptr<WorkerPool> m_Workers;
+
+public:
+	Lightmapper(std::shared_ptr<Map>& map, const Settings& settings);
+	~Lightmapper(void);
+
+	// Gathers the lights, the geometry and the meshes to light, then starts
+	// the workers. False if there's no static mesh in the map.
+	bool Start(irr::scene::ISceneNode* mapRoot);
+
+	// Moves on once the workers finish a stage; false when the bake is done
+	bool Poll(void);
+
+	// Stops the workers; the lightmaps keep what was finished
+	void Cancel(void);
+
+	STAGE GetStage(void) const { return m_Stage; }
+
+	// Percent of the current stage
+	int GetProgress(void) const;
+
+	// A lightmap per entity, filled in as the bake runs
+	const lightmaps_t& GetLightmaps(void) const { return m_Lightmaps; }
+
+private:
+	void Begin(STAGE stage);
+	void Work(void);
+	void Publish(void);
+
+	void Prepare(Receiver& receiver);
+	void LightDirect(Receiver& receiver, const Tile& tile, std::vector<irr::u32>& candidates);
+	void LightIndirect(Receiver& receiver, const Tile& tile, std::vector<irr::u32>& candidates);
+	void Dilate(Receiver& receiver);
+
+	irr::core::vector3df Direct(const irr::core::vector3df& position, const irr::core::vector3df& normal,
+		std::vector<irr::u32>& candidates) const;
+	bool Occluded(const irr::core::vector3df& from, const irr::core::vector3df& to,
+		std::vector<irr::u32>& candidates) const;
+	bool Trace(const irr::core::vector3df& from, const irr::core::vector3df& to,
+		irr::core::vector3df& hit, irr::core::vector3df& normal, std::vector<irr::u32>& candidates) const;
+
+	void Store(Receiver& receiver, irr::u32 texel, const irr::core::vector3df& light);
+};
@@ -98,6 +98,11 @@ MainWindow::MainWindow(void)
     menuTools->Append(TOOL_TEXTUREBROWSER, _("Show Texture Browser"), nullptr, _("Open the texture browser"));
     menuTools->Append(TOOL_SOUNDBROWSER, _("Show Sound Browser"), nullptr, _("Open the sound browser"));
     menuTools->Append(TOOL_MESHBROWSER, _("Show Mesh Browser"), nullptr, _("Open the mesh browser"));
+    menuTools->AppendSeparator();
+    menuTools->Append(TOOL_BUILDNAVMESH, _("Build Navigation Mesh"), nullptr,
+        _("Rebuild the navigation mesh where the map changed"));
+    menuTools->Append(TOOL_CHECKNAVIGATION, _("Check Navigation"), nullptr,
+        _("Find paths from the player start to the path nodes"));
 
     wxMenu* menuHelp = new wxMenu;
     menuHelp->Append(wxID_ABOUT);
@@ -156,6 +161,7 @@ MainWindow::MainWindow(void)
     SetStatusText("Manifold Editor");
 
     Bind(wxEVT_CLOSE_WINDOW, &MainWindow::OnClose, this);
+    Bind(wxEVT_IDLE, &MainWindow::OnIdle, this);
 
     Bind(ME_CONFIGCHANGED, &MainWindow::OnConfigChanged, this);
 
@@ -307,6 +313,14 @@ void MainWindow::OnClose(wxCloseEvent& event)
     event.Skip(); // continue the process
 }
 
+void MainWindow::OnIdle(wxIdleEvent& event)
+{
+    if (m_AudioSystem)
+        m_AudioSystem->update(); // surface audio underruns in the log
+
+    event.Skip();
+}
+
 void MainWindow::OnConfigChanged(wxCommandEvent& event)
 {
     wxLogMessage(wxT("MainWindow::OnConfigChanged"));
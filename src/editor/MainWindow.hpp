@@ -90,6 +90,12 @@ private:
 	 */
 	void OnClose(wxCloseEvent& event);
 
+	/**
+	 * @brief Handle idle events
+	 * @param event The idle event
+	 */
+	void OnIdle(wxIdleEvent& event);
+
 	/**
 	 * @brief Handle configuration change events
 	 * @param event The command event
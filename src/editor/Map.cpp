@@ -6,6 +6,7 @@
 
 #include "Commands.hpp"
 #include "Common.hpp"
+#include "Component.hpp"
 #include "ExplorerPanel.hpp"
 #include "Map.hpp"
 #include "Serialize.hpp"
@@ -14,14 +15,19 @@
 #include "../extend/PlaneSceneNode.hpp"
 #include "../extend/PlayerStartNode.hpp"
 #include "../extend/PathSceneNode.hpp"
+#include "../extend/TerrainSceneNode.hpp"
 
+#include <wx/hashmap.h>
 #include <wx/log.h>
 #include <wx/stdpaths.h>
 
+#include <unordered_set>
+
 Map::Map(void)
 	: m_SceneMgr(nullptr), m_MapRoot(nullptr)
 {
 	m_NextId = 1;
+	m_NextHandle = 1;
 	m_Lighting = false;
 }
 
@@ -29,6 +35,7 @@ Map::Map(const wxFileName& fileName)
 	: m_SceneMgr(nullptr), m_MapRoot(nullptr), m_FileName(fileName)
 {
 	m_NextId = 1;
+	m_NextHandle = 1;
 	m_Lighting = false;
 }
 
@@ -38,6 +45,10 @@ Map::~Map(void)
 		entity != m_Entities.end(); ++entity)
 		entity->second->drop();
 
+	for (lightmapimages_t::iterator i = m_LightmapImages.begin();
+		i != m_LightmapImages.end(); ++i)
+		i->second->drop();
+
 	if (m_SceneMgr)
 		m_SceneMgr->drop();
 }
@@ -46,6 +57,8 @@ void Map::SetSceneMgr(irr::scene::ISceneManager* sceneMgr)
 {
 	m_SceneMgr = sceneMgr;
 	m_SceneMgr->grab();
+	m_AnimatorFactories.clear();
+	m_Collision.SetSceneMgr(sceneMgr);
 }
 
 irr::scene::ISceneManager* Map::GetSceneMgr(void)
@@ -84,66 +97,43 @@ void Map::Save(const wxFileName& fileName)
 		return;
 	}
 
-	// always use relative paths
-	irr::io::SAttributeReadWriteOptions opts;
-	opts.Filename = ".";
-	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
+	// the terrains then save the heightfield name
+	SaveHeightfields(outFileName);
+
+	// lightmaps baked since the map was loaded, the rest are copied
+	// along with the other textures
+	for (entities_t::iterator entity = m_Entities.begin();
+		entity != m_Entities.end(); ++entity)
+	{
+		lightmapimages_t::iterator image = m_LightmapImages.find(GetLightmap(entity->first));
+		if (image != m_LightmapImages.end() &&
+			!serializer->AddImage(image->first->getName().getPath().c_str(), image->second))
+			wxLogWarning(_("Unable to save the lightmap of %s"), entity->first);
+	}
+
+	if (!m_NavMesh.IsEmpty())
+	{
+		std::vector<irr::u8> data;
+		m_NavMesh.Write(data);
+		if (!serializer->AddData(NavMeshName(outFileName), &data[0], data.size()))
+			wxLogWarning(_("Unable to save the navigation mesh"));
+	}
 
 	// process the map entities
 	for (entities_t::iterator entity = m_Entities.begin();
 		entity != m_Entities.end(); ++entity)
 	{
-		irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName((*entity).first.c_str(), nullptr);
+		irr::core::stringc type;
+		irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+		irr::core::array<irr::io::IAttributes*> materials;
+		irr::core::array<irr::io::IAttributes*> animators;
+		irr::scene::ISceneNode* node = SerializeEntity((*entity).first, type,
+			attributes, materials, animators);
 		if (node)
 		{
-			// do we save this one
-			if (node->getID() & NID_NOSAVE)
-				continue;
-
-			// if the node has debug data turned on, store it for later and turn it off while saving
-			irr::u32 debugData = node->isDebugDataVisible();
-			node->setDebugDataVisible(irr::scene::EDS_OFF);
-
-			irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes();
-			node->serializeAttributes(attributes, &opts);
-			
-			irr::core::array<irr::io::IAttributes*> materials;
-			for (irr::u32 i = 0; i < node->getMaterialCount(); ++i)
-			{
-				irr::video::SMaterial& material = node->getMaterial(i);
-				irr::io::IAttributes* matAttribs = m_SceneMgr->getVideoDriver()->createAttributesFromMaterial(
-					material, &opts);
-				materials.push_back(matAttribs);
-			}
-
-			irr::core::array<irr::io::IAttributes*> animators;
-			const irr::scene::ISceneNodeAnimatorList animator = node->getAnimators();
-			for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animator.begin();
-				i != animator.end(); ++i)
-			{
-				irr::io::IAttributes* animAttribs = m_SceneMgr->getFileSystem()->createEmptyAttributes();
-				irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = (*i)->getType();
-				irr::u32 factoryCount = m_SceneMgr->getRegisteredSceneNodeAnimatorFactoryCount();
-				for (irr::u32 j = 0; j < factoryCount; ++j)
-				{
-					irr::scene::ISceneNodeAnimatorFactory* factory = m_SceneMgr->getSceneNodeAnimatorFactory(j);
-					const irr::c8* name = factory->getCreateableSceneNodeAnimatorTypeName(type);
-					if (name)
-					{
-						(*i)->serializeAttributes(animAttribs, &opts);
-						if (!animAttribs->existsAttribute("Type"))
-							animAttribs->setAttribute("Type", name);
-						animators.push_back(animAttribs);
-						break;
-					}
-				}
-			}
-
 			irr::io::IAttributes* userData = GetAttributes((*entity).first);
 			userData->grab();
 
-			//irr::scene::ESCENE_NODE_TYPE type = node->getType();
-			irr::core::stringc type = m_SceneMgr->getSceneNodeTypeName(node->getType());
 			const irr::scene::ISceneNodeList& children = node->getChildren();
 			bool child = false;
 			for (irr::scene::ISceneNodeList::ConstIterator i = children.begin();
@@ -156,16 +146,68 @@ void Map::Save(const wxFileName& fileName)
 				}
 			}
 
-			// restore the debug data
-			node->setDebugDataVisible(debugData);
-
 			serializer->Next(type, attributes, materials, animators, userData, child);
 		}
+		else
+			attributes->drop();
 	}
 
 	serializer->Finalize();
 }
 
+void Map::SaveHeightfields(const wxFileName& fileName)
+{
+	const irr::scene::ISceneNodeList& children = m_MapRoot->getChildren();
+	for (irr::scene::ISceneNodeList::ConstIterator i = children.begin();
+		i != children.end(); ++i)
+	{
+		if ((*i)->getType() != (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+			continue;
+
+		TerrainSceneNode* terrain = static_cast<TerrainSceneNode*>(*i);
+		if (!terrain->isModified())
+			continue;
+
+		// named after the map, the map is loaded from its own directory
+		wxFileName heightsName(fileName.GetPath(), wxString::Format(wxT("%s_%s.mhf"),
+			fileName.GetName(), wxString(terrain->getName())));
+
+		irr::io::IWriteFile* file = m_SceneMgr->getFileSystem()->createAndWriteFile(
+			heightsName.GetFullPath().c_str().AsChar());
+		if (file && terrain->writeHeights(file))
+			terrain->setHeightmapName(heightsName.GetFullName().c_str().AsChar());
+		else
+			wxLogWarning(_("Unable to save the heights of %s"), wxString(terrain->getName()));
+
+		if (file)
+			file->drop();
+	}
+}
+
+wxString Map::NavMeshName(const wxFileName& fileName)
+{
+	return wxString::Format(wxT("%s.mnv"), fileName.GetName());
+}
+
+void Map::LoadNavMesh(void)
+{
+	// the package is read like any other, a loose map's file is beside it
+	wxString path = m_FileName.GetExt() == wxT("mmp") ?
+		wxString::Format(wxT("%s:%s"), m_FileName.GetFullName(), NavMeshName(m_FileName)) :
+		wxFileName(m_FileName.GetPath(), NavMeshName(m_FileName)).GetFullPath();
+
+	irr::io::IReadFile* file = m_SceneMgr->getFileSystem()->createAndOpenFile(path.c_str().AsChar());
+	if (!file)
+		return; // not built yet
+
+	std::vector<irr::u8> data(file->getSize());
+	if (data.empty() || file->read(&data[0], (irr::u32)data.size()) != (irr::s32)data.size() ||
+		!m_NavMesh.Read(&data[0], data.size()))
+		wxLogWarning(_("Unable to read the navigation mesh"));
+
+	file->drop();
+}
+
 void Map::Load(irr::scene::ISceneNode* mapRoot, 
 	ExplorerPanel* explorerPanel)
 {
@@ -186,11 +228,6 @@ void Map::Load(irr::scene::ISceneNode* mapRoot,
 		return;
 	}
 
-	// always use relative paths
-	irr::io::SAttributeReadWriteOptions opts;
-	opts.Filename = ".";
-	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
-
 	irr::core::stringc type;
 	irr::io::IAttributes* attributes = m_SceneMgr->getFileSystem()->createEmptyAttributes(
 		m_SceneMgr->getVideoDriver());
@@ -199,111 +236,209 @@ void Map::Load(irr::scene::ISceneNode* mapRoot,
 	irr::io::IAttributes* userData = m_SceneMgr->getFileSystem()->createEmptyAttributes(
 		m_SceneMgr->getVideoDriver());
 	bool child = false;
-	std::shared_ptr<Map> self = shared_from_this();
+
+	// the explorer sorts once at the end rather than per entity
+	explorerPanel->BeginUpdate();
 	while (serializer->Next(type, attributes, materials, animators, userData, child))
 	{
-		wxString _type = type.c_str();
 		wxString name = attributes->getAttributeAsString("Name").c_str();
-		AddNodeCommand cmd(_type, explorerPanel, m_SceneMgr,
-			m_MapRoot, self, name);
-		if (!cmd.Do())
-			continue;
+		CreateEntity(type, name, attributes, materials, animators, userData,
+			explorerPanel);
+
+		materials.clear();
+		attributes->clear();
+	}
 
-		irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(name.c_str().AsChar(),
-			m_MapRoot);
-		node->deserializeAttributes(attributes, &opts);
+	explorerPanel->EndUpdate();
+	serializer->Finalize();
+
+	LoadNavMesh();
+
+	explorerPanel->SetMapName(m_FileName.GetFullName());
+}
+
+irr::scene::ISceneNode* Map::CreateEntity(const irr::core::stringc& type, const wxString& name,
+	irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+	irr::core::array<irr::io::IAttributes*>& animators, irr::io::IAttributes* userData,
+	ExplorerPanel* explorerPanel)
+{
+	// always use relative paths
+	irr::io::SAttributeReadWriteOptions opts;
+	opts.Filename = ".";
+	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
 
+	std::shared_ptr<Map> self = shared_from_this();
+	AddNodeCommand cmd(wxString(type.c_str()), explorerPanel, m_SceneMgr,
+		m_MapRoot, self, name);
+	if (!cmd.Do())
+	{
 		for (irr::u32 i = 0; i < materials.size(); ++i)
-		{
-			if (node->getMaterialCount() > i)
-			{
-				m_SceneMgr->getVideoDriver()->fillMaterialStructureFromAttributes(
-					node->getMaterial(i), materials[i]);
-			}
+			materials[i]->drop();
+		for (irr::u32 i = 0; i < animators.size(); ++i)
+			animators[i]->drop();
+		return nullptr;
+	}
 
+	// the command hands back what it made, no need to search the scene for it
+	irr::scene::ISceneNode* node = cmd.GetNode();
+	if (!node)
+	{
+		cmd.Undo();
+		for (irr::u32 i = 0; i < materials.size(); ++i)
 			materials[i]->drop();
+		for (irr::u32 i = 0; i < animators.size(); ++i)
+			animators[i]->drop();
+		return nullptr;
+	}
+
+	node->deserializeAttributes(attributes, &opts);
+
+	// lightmapped meshes are saved with the plain mesh's name
+	for (irr::u32 i = 0; i < materials.size(); ++i)
+	{
+		if (materials[i]->getAttributeAsString("Type").find("lightmap") == 0)
+		{
+			irr::scene::IMesh* mesh = GetLightmapMesh(node);
+			if (mesh)
+				static_cast<irr::scene::IMeshSceneNode*>(node)->setMesh(mesh);
+			break;
 		}
+	}
 
-		for (irr::u32 i = 0; i < animators.size(); ++i)
+	for (irr::u32 i = 0; i < materials.size(); ++i)
+	{
+		if (node->getMaterialCount() > i)
 		{
-			irr::core::stringc animType = animators[i]->getAttributeAsString("Type");
-			irr::scene::ISceneNodeAnimator* animator = m_SceneMgr->createSceneNodeAnimator(animType.c_str(), node);
-			if (animator)
-			{
-				animator->deserializeAttributes(animators[i], &opts);
-				animator->drop();
-			}
+			m_SceneMgr->getVideoDriver()->fillMaterialStructureFromAttributes(
+				node->getMaterial(i), materials[i]);
+		}
 
+		materials[i]->drop();
+	}
+
+	for (irr::u32 i = 0; i < animators.size(); ++i)
+	{
+		// components go to the store, everything else is a real animator
+		if (SetEntityComponent(name, animators[i]))
+		{
 			animators[i]->drop();
+			continue;
 		}
 
-		// create a triangle selector if one doesn't exist, typically used by actors
-		if (!node->getTriangleSelector())
+		irr::core::stringc animType = animators[i]->getAttributeAsString("Type");
+		irr::scene::ISceneNodeAnimator* animator = m_SceneMgr->createSceneNodeAnimator(animType.c_str(), node);
+		if (animator)
 		{
-			irr::scene::ITriangleSelector* selector = nullptr;
-			if (node->getType() == irr::scene::ESNT_MESH)
-				selector = m_SceneMgr->createTriangleSelector(
-					static_cast<irr::scene::IMeshSceneNode*>(node)->getMesh(), node);
-			else if (node->getType() == irr::scene::ESNT_ANIMATED_MESH)
-				selector = m_SceneMgr->createTriangleSelector(
-					static_cast<irr::scene::IAnimatedMeshSceneNode*>(node)->getMesh(), node);
-			else
-				selector = m_SceneMgr->createTriangleSelectorFromBoundingBox(node);
-
-			if (selector)
-			{
-				node->setTriangleSelector(selector);
-				selector->drop();
-			}
+			animator->deserializeAttributes(animators[i], &opts);
+			animator->drop();
 		}
 
-		// set the custom attributes
-		irr::io::IAttributes* attribs = GetAttributes(name);
-		if (attribs)
+		animators[i]->drop();
+	}
+
+	// create a triangle selector if one doesn't exist, typically used by actors
+	if (!node->getTriangleSelector())
+	{
+		irr::scene::ITriangleSelector* selector = CreateTriangleSelector(node);
+		if (selector)
 		{
-			for (irr::u32 i = 0; i < userData->getAttributeCount(); ++i)
-			{
-				switch (userData->getAttributeType(i))
-				{
-				case irr::io::EAT_STRING:
-					attribs->addString(userData->getAttributeName(i), 
-						userData->getAttributeAsString(i).c_str());
-					break;
-				case irr::io::EAT_VECTOR3D:
-					attribs->addVector3d(userData->getAttributeName(i), 
-						userData->getAttributeAsVector3d(i));
-					break;
-				case irr::io::EAT_VECTOR2D:
-					attribs->addVector2d(userData->getAttributeName(i), 
-						userData->getAttributeAsVector2d(i));
-					break;
-				case irr::io::EAT_COLOR:
-					attribs->addColor(userData->getAttributeName(i), 
-						userData->getAttributeAsColor(i));
-					break;
-				case irr::io::EAT_FLOAT:
-					attribs->addFloat(userData->getAttributeName(i), 
-						userData->getAttributeAsFloat(i));
-					break;
-				case irr::io::EAT_INT:
-					attribs->addInt(userData->getAttributeName(i), 
-						userData->getAttributeAsInt(i));
-					break;
-				case irr::io::EAT_BOOL:
-					attribs->addBool(userData->getAttributeName(i), 
-						userData->getAttributeAsBool(i));
-					break;
-				}
-			}
+			node->setTriangleSelector(selector);
+			selector->drop();
 		}
+	}
 
-		materials.clear();
-		attributes->clear();
+	// set the custom attributes
+	irr::io::IAttributes* attribs = GetAttributes(name);
+	if (attribs)
+		CopyAttributes(attribs, userData);
+
+	return node;
+}
+
+irr::scene::ISceneNode* Map::SerializeEntity(const wxString& name, irr::core::stringc& type,
+	irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+	irr::core::array<irr::io::IAttributes*>& animators)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(name.c_str(), nullptr);
+	if (!node)
+		return nullptr;
+
+	return SerializeEntity(node, type, attributes, materials, animators);
+}
+
+irr::scene::ISceneNode* Map::SerializeEntity(irr::scene::ISceneNode* node, irr::core::stringc& type,
+	irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+	irr::core::array<irr::io::IAttributes*>& animators)
+{
+	// do we save this one
+	if (node->getID() & NID_NOSAVE)
+		return nullptr;
+
+	// always use relative paths
+	irr::io::SAttributeReadWriteOptions opts;
+	opts.Filename = ".";
+	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
+
+	// if the node has debug data turned on, store it for later and turn it off while saving
+	irr::u32 debugData = node->isDebugDataVisible();
+	node->setDebugDataVisible(irr::scene::EDS_OFF);
+
+	node->serializeAttributes(attributes, &opts);
+
+	// the copy with lightmap coordinates isn't in the mesh cache
+	if (node->getType() == irr::scene::ESNT_MESH)
+	{
+		irr::scene::IMesh* source = m_LightmapMeshes.GetSource(
+			static_cast<irr::scene::IMeshSceneNode*>(node)->getMesh());
+		if (source)
+		{
+			irr::io::IFileSystem* fileSystem = m_SceneMgr->getFileSystem();
+			irr::io::path path = fileSystem->getRelativeFilename(fileSystem->getAbsolutePath(
+				m_SceneMgr->getMeshCache()->getMeshName(source).getPath()), opts.Filename);
+			attributes->setAttribute("Mesh", path.c_str());
+		}
 	}
 
-	serializer->Finalize();
+	for (irr::u32 i = 0; i < node->getMaterialCount(); ++i)
+	{
+		irr::video::SMaterial& material = node->getMaterial(i);
+		irr::io::IAttributes* matAttribs = m_SceneMgr->getVideoDriver()->createAttributesFromMaterial(
+			material, &opts);
+		materials.push_back(matAttribs);
+	}
 
-	explorerPanel->SetMapName(m_FileName.GetFullName());
+	const irr::scene::ISceneNodeAnimatorList animator = node->getAnimators();
+	for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animator.begin();
+		i != animator.end(); ++i)
+	{
+		const irr::c8* animName = GetAnimatorTypeName((*i)->getType());
+		if (animName)
+		{
+			irr::io::IAttributes* animAttribs = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+			(*i)->serializeAttributes(animAttribs, &opts);
+			if (!animAttribs->existsAttribute("Type"))
+				animAttribs->setAttribute("Type", animName);
+			animators.push_back(animAttribs);
+		}
+	}
+
+	// components are saved alongside the animators
+	GetEntityComponents(wxString(node->getName()), animators);
+
+	type = m_SceneMgr->getSceneNodeTypeName(node->getType());
+
+	// restore the debug data
+	node->setDebugDataVisible(debugData);
+
+	return node;
+}
+
+static wxString FormatId(int id)
+{
+	if (id < 100)
+		return wxString::Format("%03d", id);
+
+	return wxString::Format("%d", id);
 }
 
 wxString Map::NextName(const wxString& base)
@@ -312,18 +447,84 @@ wxString Map::NextName(const wxString& base)
 	
 	do
 	{
-		if (m_NextId < 100)
-			id = wxString::Format("%03d", m_NextId++);
-		else
-			id = wxString::Format("%d", m_NextId++);
+		id = FormatId(m_NextId++);
 	} while (m_SceneMgr->getSceneNodeFromName(id.ToStdString().c_str()));
 
 	return wxString(base).Append(id);
 }
 
+void Map::NextNames(const wxString& base, size_t count, std::vector<wxString>& names)
+{
+	NextNames(std::vector<wxString>(count, base), names);
+}
+
+void Map::NextNames(const std::vector<wxString>& bases, std::vector<wxString>& names)
+{
+	// one pass over the map rather than a scene search per name
+	std::unordered_set<wxString, wxStringHash, wxStringEqual> used;
+	if (m_MapRoot)
+	{
+		const irr::core::list<irr::scene::ISceneNode*>& children = m_MapRoot->getChildren();
+		for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin();
+			it != children.end(); ++it)
+			used.insert(wxString((*it)->getName()));
+	}
+
+	names.reserve(names.size() + bases.size());
+	for (size_t i = 0; i < bases.size(); )
+	{
+		wxString name(bases[i]);
+		name.Append(FormatId(m_NextId++));
+		if (used.find(name) != used.end())
+			continue;
+
+		names.push_back(name);
+		++i;
+	}
+}
+
+void Map::CopyAttributes(irr::io::IAttributes* to, irr::io::IAttributes* from)
+{
+	for (irr::u32 i = 0; i < from->getAttributeCount(); ++i)
+	{
+		switch (from->getAttributeType(i))
+		{
+		case irr::io::EAT_STRING:
+			to->addString(from->getAttributeName(i), 
+				from->getAttributeAsString(i).c_str());
+			break;
+		case irr::io::EAT_VECTOR3D:
+			to->addVector3d(from->getAttributeName(i), 
+				from->getAttributeAsVector3d(i));
+			break;
+		case irr::io::EAT_VECTOR2D:
+			to->addVector2d(from->getAttributeName(i), 
+				from->getAttributeAsVector2d(i));
+			break;
+		case irr::io::EAT_COLOR:
+			to->addColor(from->getAttributeName(i), 
+				from->getAttributeAsColor(i));
+			break;
+		case irr::io::EAT_FLOAT:
+			to->addFloat(from->getAttributeName(i), 
+				from->getAttributeAsFloat(i));
+			break;
+		case irr::io::EAT_INT:
+			to->addInt(from->getAttributeName(i), 
+				from->getAttributeAsInt(i));
+			break;
+		case irr::io::EAT_BOOL:
+			to->addBool(from->getAttributeName(i), 
+				from->getAttributeAsBool(i));
+			break;
+		}
+	}
+}
+
 void Map::AddEntity(const wxString& name, irr::io::IAttributes* attribs)
 {
 	m_Entities.emplace(name, attribs);
+	m_Handles.emplace(name, m_NextHandle++);
 }
 
 void Map::RemoveEntity(const wxString& name)
@@ -334,6 +535,13 @@ void Map::RemoveEntity(const wxString& name)
 		entity->second->drop();
 		m_Entities.erase(entity);
 	}
+
+	handles_t::iterator handle = m_Handles.find(name);
+	if (handle != m_Handles.end())
+	{
+		m_Components.RemoveEntity(handle->second);
+		m_Handles.erase(handle);
+	}
 }
 
 void Map::RecomputeLighting(bool lighting)
@@ -342,8 +550,9 @@ void Map::RecomputeLighting(bool lighting)
 	for (entities_t::iterator i = m_Entities.begin();
 		i != m_Entities.end(); ++i)
 	{
+		// baked lighting replaces the dynamic lighting
 		irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(i->first.c_str());
-		if (node)
+		if (node && !GetLightmap(i->first))
 			node->setMaterialFlag(irr::video::EMF_LIGHTING, lighting);
 	}
 
@@ -355,6 +564,145 @@ bool Map::IsLighting(void)
 	return m_Lighting;
 }
 
+static bool IsLightmapMaterial(const irr::video::SMaterial& material)
+{
+	return material.MaterialType >= irr::video::EMT_LIGHTMAP &&
+		material.MaterialType <= irr::video::EMT_LIGHTMAP_LIGHTING_M4;
+}
+
+irr::scene::IMesh* Map::GetLightmapMesh(irr::scene::ISceneNode* node)
+{
+	if (node->getType() != irr::scene::ESNT_MESH)
+		return nullptr;
+
+	irr::scene::IMesh* mesh = static_cast<irr::scene::IMeshSceneNode*>(node)->getMesh();
+	return mesh ? m_LightmapMeshes.Get(mesh) : nullptr;
+}
+
+irr::video::ITexture* Map::CreateLightmap(const wxString& entityName, irr::video::IImage* image)
+{
+	// a new name each bake, the last one's texture is kept for undo
+	irr::video::IVideoDriver* driver = m_SceneMgr->getVideoDriver();
+	wxString name = wxString::Format(wxT("lightmaps/%s.png"), entityName);
+	for (int i = 2; driver->findTexture(name.c_str().AsChar()); ++i)
+		name = wxString::Format(wxT("lightmaps/%s_%d.png"), entityName, i);
+
+	irr::video::ITexture* texture = driver->addTexture(name.c_str().AsChar(), image);
+	if (texture)
+	{
+		image->grab();
+		m_LightmapImages[texture] = image;
+	}
+
+	return texture;
+}
+
+irr::video::ITexture* Map::GetLightmap(const wxString& entityName)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(entityName.c_str(), m_MapRoot);
+	if (!node || node->getType() != irr::scene::ESNT_MESH || node->getMaterialCount() == 0 ||
+		!IsLightmapMaterial(node->getMaterial(0)))
+		return nullptr;
+
+	return node->getMaterial(0).getTexture(1);
+}
+
+void Map::SetLightmap(const wxString& entityName, irr::video::ITexture* lightmap)
+{
+	irr::scene::ISceneNode* node = m_SceneMgr->getSceneNodeFromName(entityName.c_str(), m_MapRoot);
+	if (!node || node->getType() != irr::scene::ESNT_MESH)
+		return;
+
+	irr::scene::IMeshSceneNode* meshNode = static_cast<irr::scene::IMeshSceneNode*>(node);
+	irr::scene::IMesh* source = m_LightmapMeshes.GetSource(meshNode->getMesh());
+	if (!source)
+		source = meshNode->getMesh();
+
+	irr::scene::IMesh* mesh = lightmap ? m_LightmapMeshes.Get(source) : source;
+	if (!mesh)
+		return;
+
+	// setting the mesh copies its materials over the node's
+	irr::core::array<irr::video::SMaterial> materials;
+	for (irr::u32 i = 0; i < meshNode->getMaterialCount(); ++i)
+		materials.push_back(meshNode->getMaterial(i));
+
+	if (meshNode->getMesh() != mesh)
+		meshNode->setMesh(mesh);
+
+	for (irr::u32 i = 0; i < meshNode->getMaterialCount() && i < materials.size(); ++i)
+	{
+		irr::video::SMaterial& material = meshNode->getMaterial(i);
+		material = materials[i];
+		material.setTexture(1, lightmap);
+		if (lightmap)
+		{
+			material.MaterialType = irr::video::EMT_LIGHTMAP_M2;
+			material.Lighting = false;
+		}
+		else if (IsLightmapMaterial(material))
+		{
+			material.MaterialType = irr::video::EMT_SOLID;
+			material.Lighting = m_Lighting;
+		}
+	}
+}
+
+void Map::GetStaticTriangles(std::vector<irr::core::triangle3df>& triangles)
+{
+	std::vector<irr::core::triangle3df> nodeTriangles;
+
+	const irr::scene::ISceneNodeList& children = m_MapRoot->getChildren();
+	for (irr::scene::ISceneNodeList::ConstIterator i = children.begin(); i != children.end(); ++i)
+	{
+		// actors and markers have children and move about, so they don't count
+		irr::scene::ISceneNode* node = *i;
+		irr::scene::ITriangleSelector* selector = node->getTriangleSelector();
+		if (!selector || !node->isVisible() || (node->getID() & NID_NOSAVE) ||
+			!node->getChildren().empty() || node->getType() == irr::scene::ESNT_SKY_DOME ||
+			node->getType() == irr::scene::ESNT_SKY_BOX)
+			continue;
+
+		// the terrain's selector caps its count, so take the heightfield whole
+		if (node->getType() == (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		{
+			static_cast<TerrainSceneNode*>(node)->getTriangles(triangles);
+			continue;
+		}
+
+		nodeTriangles.resize(selector->getTriangleCount());
+		irr::s32 count = 0;
+		if (!nodeTriangles.empty())
+			selector->getTriangles(&nodeTriangles[0], (irr::s32)nodeTriangles.size(), count);
+
+		triangles.insert(triangles.end(), nodeTriangles.begin(), nodeTriangles.begin() + count);
+	}
+}
+
+irr::u32 Map::BuildNavMesh(const NavMesh::Settings& settings)
+{
+	std::vector<irr::core::triangle3df> triangles;
+	GetStaticTriangles(triangles);
+	return m_NavMesh.Build(triangles, settings);
+}
+
+void Map::UpdateLightmap(const wxString& entityName)
+{
+	irr::video::ITexture* texture = GetLightmap(entityName);
+	lightmapimages_t::iterator image = m_LightmapImages.find(texture);
+	if (image == m_LightmapImages.end())
+		return;
+
+	void* pixels = texture->lock(irr::video::ETLM_WRITE_ONLY);
+	if (!pixels)
+		return;
+
+	image->second->copyToScaling(pixels, texture->getSize().Width, texture->getSize().Height,
+		texture->getColorFormat(), texture->getPitch());
+	texture->unlock();
+	texture->regenerateMipMapLevels();
+}
+
 irr::io::IAttributes* Map::GetAttributes(const wxString& entityName)
 {
 	entities_t::iterator entity = m_Entities.find(entityName);
@@ -363,3 +711,90 @@ irr::io::IAttributes* Map::GetAttributes(const wxString& entityName)
 
 	return entity->second;
 }
+
+const irr::c8* Map::GetAnimatorTypeName(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	irr::scene::ISceneNodeAnimatorFactory* const* cached = m_AnimatorFactories.find((irr::u32)type);
+	if (cached)
+		return (*cached)->getCreateableSceneNodeAnimatorTypeName(type);
+
+	// first time we've seen this type, find the factory that owns it. Misses
+	// aren't remembered since components can be registered at any time.
+	irr::u32 factoryCount = m_SceneMgr->getRegisteredSceneNodeAnimatorFactoryCount();
+	for (irr::u32 i = 0; i < factoryCount; ++i)
+	{
+		irr::scene::ISceneNodeAnimatorFactory* factory = m_SceneMgr->getSceneNodeAnimatorFactory(i);
+		const irr::c8* name = factory->getCreateableSceneNodeAnimatorTypeName(type);
+		if (name)
+		{
+			m_AnimatorFactories.insert((irr::u32)type, factory);
+			return name;
+		}
+	}
+
+	return nullptr;
+}
+
+EntityHandle Map::GetEntityHandle(const wxString& entityName)
+{
+	handles_t::iterator handle = m_Handles.find(entityName);
+	if (handle == m_Handles.end())
+		return 0;
+
+	return handle->second;
+}
+
+bool Map::AddComponent(const wxString& entityName, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type)
+{
+	EntityHandle handle = GetEntityHandle(entityName);
+	if (handle == 0)
+		return false;
+
+	return m_Components.Add(handle, type);
+}
+
+void Map::GetEntityComponents(const wxString& entityName,
+	irr::core::array<irr::io::IAttributes*>& components)
+{
+	EntityHandle handle = GetEntityHandle(entityName);
+	const std::vector<irr::scene::ESCENE_NODE_ANIMATOR_TYPE>* types = m_Components.GetTypes(handle);
+	if (!types)
+		return;
+
+	for (size_t i = 0; i < types->size(); ++i)
+	{
+		const irr::c8* name = GetAnimatorTypeName((*types)[i]);
+		if (!name)
+			continue;
+
+		irr::io::IAttributes* component = m_SceneMgr->getFileSystem()->createEmptyAttributes();
+		component->addString("Type", name);
+		m_Components.Read(handle, (*types)[i], component);
+		components.push_back(component);
+	}
+}
+
+bool Map::SetEntityComponent(const wxString& entityName, irr::io::IAttributes* component)
+{
+	irr::core::stringc typeName = component->getAttributeAsString("Type");
+	irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = ComponentFactory::HashComponentName(typeName.c_str());
+	if (!ComponentFactory::GetDefinition(type))
+		return false;
+
+	EntityHandle handle = GetEntityHandle(entityName);
+	if (handle == 0)
+		return false;
+
+	AddComponent(entityName, type); // no-op if it already has one
+	return m_Components.Write(handle, type, component);
+}
+
+ComponentStore& Map::GetComponentStore(void)
+{
+	return m_Components;
+}
+
+irr::scene::ITriangleSelector* Map::CreateTriangleSelector(irr::scene::ISceneNode* node)
+{
+	return m_Collision.CreateSelector(node);
+}
@@ -9,10 +9,16 @@
 #include <wx/filename.h>
 
 #include "irrlicht.h"
+#include "CollisionShape.hpp"
+#include "ComponentStore.hpp"
+#include "Lightmapper.hpp"
+#include "NavMesh.hpp"
+#include "../extend/TypeRegistry.hpp"
 
 #include <list>
 #include <map>
 #include <memory>
+#include <vector>
 
 class ExplorerPanel;
 
@@ -29,8 +35,28 @@ protected:
 	typedef std::map<wxString, irr::io::IAttributes*> entities_t;
 	entities_t m_Entities;
 
+	typedef std::map<wxString, EntityHandle> handles_t;
+	handles_t m_Handles;
+	EntityHandle m_NextHandle;
+
+	// component data lives here rather than in animators on the scene nodes
+	ComponentStore m_Components;
+
+	CollisionCache m_Collision;
+
 	bool m_Lighting;
 
+	// meshes with lightmap coordinates, and the images baked this session
+	// for the lightmap textures, which are saved with the map
+	LightmapMeshes m_LightmapMeshes;
+	typedef std::map<irr::video::ITexture*, irr::video::IImage*> lightmapimages_t;
+	lightmapimages_t m_LightmapImages;
+
+	NavMesh m_NavMesh;
+
+	// factory that created each animator type seen so far
+	TypeRegistry<irr::scene::ISceneNodeAnimatorFactory*> m_AnimatorFactories;
+
 public:
 	Map(void);
 	Map(const wxFileName& fileName);
@@ -45,13 +71,102 @@ public:
 	void Save(const wxFileName& fileName);
 	void Load(irr::scene::ISceneNode* mapRoot, ExplorerPanel* explorerPanel);
 
+	// Creates an entity from the attribute sets a serializer reads, the
+	// materials and animators are dropped. Null if the type is unknown.
+	irr::scene::ISceneNode* CreateEntity(const irr::core::stringc& type, const wxString& name,
+		irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+		irr::core::array<irr::io::IAttributes*>& animators, irr::io::IAttributes* userData,
+		ExplorerPanel* explorerPanel);
+
+	// Fills in the attribute sets a serializer writes for an entity, the
+	// caller drops the materials and animators. Null if it isn't saved.
+	irr::scene::ISceneNode* SerializeEntity(const wxString& name, irr::core::stringc& type,
+		irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+		irr::core::array<irr::io::IAttributes*>& animators);
+
+	// The same, for a node already at hand
+	irr::scene::ISceneNode* SerializeEntity(irr::scene::ISceneNode* node, irr::core::stringc& type,
+		irr::io::IAttributes* attributes, irr::core::array<irr::io::IAttributes*>& materials,
+		irr::core::array<irr::io::IAttributes*>& animators);
+
 	wxString NextName(const wxString& base);
 
+	// Reserves count names at once, for adding many entities together
+	void NextNames(const wxString& base, size_t count, std::vector<wxString>& names);
+
+	// Reserves a name for each base at once
+	void NextNames(const std::vector<wxString>& bases, std::vector<wxString>& names);
+
+	// The custom attribute types the map saves
+	static void CopyAttributes(irr::io::IAttributes* to, irr::io::IAttributes* from);
+
 	void AddEntity(const wxString& name, irr::io::IAttributes* attribs);
 	void RemoveEntity(const wxString& name);
 
 	void RecomputeLighting(bool lighting);
 	bool IsLighting(void);
 
+	irr::scene::ISceneNode* GetMapRoot(void) { return m_MapRoot; }
+
+	// The copy of a mesh node's mesh with lightmap coordinates, null if the
+	// node can't take a lightmap
+	irr::scene::IMesh* GetLightmapMesh(irr::scene::ISceneNode* node);
+
+	// Makes a texture of a baked image, kept with the image until the map
+	// is saved. The image can still be drawn into; see UpdateLightmap.
+	irr::video::ITexture* CreateLightmap(const wxString& entityName, irr::video::IImage* image);
+
+	// The lightmap of an entity, null if it hasn't one
+	irr::video::ITexture* GetLightmap(const wxString& entityName);
+
+	// Puts the mesh with lightmap coordinates on the entity and the texture in
+	// its second layer. A null texture puts the plain mesh back.
+	void SetLightmap(const wxString& entityName, irr::video::ITexture* lightmap);
+
+	// Copies the image of the entity's lightmap to the texture again
+	void UpdateLightmap(const wxString& entityName);
+
+	// World space triangles of the visible geometry that doesn't move,
+	// which is everything with a selector but no children
+	void GetStaticTriangles(std::vector<irr::core::triangle3df>& triangles);
+
+	// Rebuilds the navigation mesh tiles whose geometry changed, returns
+	// the number rebuilt
+	irr::u32 BuildNavMesh(const NavMesh::Settings& settings);
+	const NavMesh& GetNavMesh(void) const { return m_NavMesh; }
+
 	irr::io::IAttributes* GetAttributes(const wxString& entityName);
+
+	// Handle of the entity in the component store, 0 if there's no such entity
+	EntityHandle GetEntityHandle(const wxString& entityName);
+
+	// Adds a component with its default values; false if it isn't a component
+	// type or the entity already has one
+	bool AddComponent(const wxString& entityName, irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+
+	// Appends one attribute set per component, with "Type" holding the
+	// component name the same way animators are saved. The caller drops them.
+	void GetEntityComponents(const wxString& entityName,
+		irr::core::array<irr::io::IAttributes*>& components);
+
+	// Adds or updates a component from an attribute set written by
+	// GetEntityComponents. Returns false if "Type" isn't a component type.
+	bool SetEntityComponent(const wxString& entityName, irr::io::IAttributes* component);
+
+	ComponentStore& GetComponentStore(void);
+
+	// Picking selector for a node; nodes using the same mesh file share
+	// one collision shape, read from the package when it has one
+	irr::scene::ITriangleSelector* CreateTriangleSelector(irr::scene::ISceneNode* node);
+
+	// Type name an animator is saved under, or null if no factory knows it
+	const irr::c8* GetAnimatorTypeName(irr::scene::ESCENE_NODE_ANIMATOR_TYPE type);
+
+protected:
+	// Sculpted terrains write their heights next to the map file
+	void SaveHeightfields(const wxFileName& fileName);
+
+	// The navigation mesh is saved beside the map, inside it for a package
+	wxString NavMeshName(const wxFileName& fileName);
+	void LoadNavMesh(void);
 };
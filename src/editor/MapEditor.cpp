@@ -4,16 +4,22 @@
 * Copyright (c) 2023 James Kinnaird
 */
 
+#include "Commands.hpp"
 #include "Common.hpp"
 #include "FSHandler.hpp"
 #include "MainWindow.hpp"
 #include "MapEditor.hpp"
 #include "Serialize.hpp"
 
+#include "../extend/PathSceneNode.hpp"
+#include "../extend/PlayerStartNode.hpp"
+
 #include <wx/busyinfo.h>
 #include <wx/confbase.h>
 #include <wx/log.h>
 #include <wx/msgdlg.h>
+#include <wx/progdlg.h>
+#include <wx/utils.h>
 
 MapEditor::MapEditor(MainWindow* parent, wxMenu* editMenu, 
     BrowserWindow* browserWindow, const wxFileName& mapName)
@@ -200,6 +206,10 @@ MapEditor::MapEditor(MainWindow* parent, wxMenu* editMenu,
 
     parent->Bind(wxEVT_MENU, &MainWindow::OnToolAction, parent, TOOL_CALCLIGHTING);
     Bind(wxEVT_MENU, &MapEditor::OnToolsRecomputeLighting, this, TOOL_CALCLIGHTING);
+    parent->Bind(wxEVT_MENU, &MainWindow::OnToolAction, parent, TOOL_BUILDNAVMESH);
+    Bind(wxEVT_MENU, &MapEditor::OnToolsBuildNavMesh, this, TOOL_BUILDNAVMESH);
+    parent->Bind(wxEVT_MENU, &MainWindow::OnToolAction, parent, TOOL_CHECKNAVIGATION);
+    Bind(wxEVT_MENU, &MapEditor::OnToolsCheckNavigation, this, TOOL_CHECKNAVIGATION);
     parent->Bind(wxEVT_MENU, &MainWindow::OnToolAction, parent, TOOL_PLAYMAP);
     Bind(wxEVT_MENU, &MapEditor::OnToolsPlayMap, this, TOOL_PLAYMAP);
 
@@ -264,6 +274,7 @@ void MapEditor::OnUndo(void)
 {
     m_ViewPanel->ClearSelection();
     m_Commands.Undo();
+    m_ViewPanel->EntitiesMoved();
     m_ViewPanel->Refresh(false);
 }
 
@@ -271,6 +282,7 @@ void MapEditor::OnRedo(void)
 {
     m_ViewPanel->ClearSelection();
     m_Commands.Redo();
+    m_ViewPanel->EntitiesMoved();
     m_ViewPanel->Refresh(false);
 }
 
@@ -368,8 +380,185 @@ void MapEditor::OnIdle(wxIdleEvent& event)
 
 void MapEditor::OnToolsRecomputeLighting(wxCommandEvent& event)
 {
-    if (m_Map)
+    if (!m_Map)
+        return;
+
+    wxConfigBase* config = wxConfigBase::Get();
+    Lightmapper::Settings settings;
+    settings.TexelsPerUnit = (irr::f32)config->ReadDouble(wxT("/Lighting/TexelsPerUnit"), settings.TexelsPerUnit);
+    settings.MaxSize = (irr::u32)config->ReadLong(wxT("/Lighting/MaxSize"), settings.MaxSize);
+    settings.MinSize = irr::core::min_(settings.MinSize, settings.MaxSize);
+    settings.Samples = (irr::u32)config->ReadLong(wxT("/Lighting/Samples"), settings.Samples);
+    settings.Reflectance = (irr::f32)config->ReadDouble(wxT("/Lighting/Reflectance"), settings.Reflectance);
+
+    // without static meshes there's nothing to bake, the lights still light
+    // everything else
+    Lightmapper lightmapper(m_Map, settings);
+    if (!lightmapper.Start(m_Map->GetMapRoot()))
+    {
         m_Map->RecomputeLighting(true);
+        return;
+    }
+
+    // the lightmaps go on straight away and fill in as the bake runs
+    BakeLightingCommand* cmd = new BakeLightingCommand(m_Map, lightmapper.GetLightmaps());
+    cmd->Do();
+
+    wxProgressDialog progress(_("Recompute Lighting"), _("Finding the lightmap texels"), 100, this,
+        wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME);
+    bool cancelled = false;
+    while (lightmapper.Poll())
+    {
+        cmd->Update();
+        m_ViewPanel->Refresh();
+
+        wxString stage;
+        switch (lightmapper.GetStage())
+        {
+        case Lightmapper::STAGE_DIRECT:
+            stage = _("Tracing direct light");
+            break;
+        case Lightmapper::STAGE_INDIRECT:
+            stage = _("Tracing bounced light");
+            break;
+        default:
+            stage = _("Finding the lightmap texels");
+            break;
+        }
+
+        if (!progress.Update(lightmapper.GetProgress(), stage))
+        {
+            cancelled = true;
+            break;
+        }
+
+        wxMilliSleep(100);
+    }
+
+    if (cancelled)
+    {
+        lightmapper.Cancel();
+        cmd->Undo();
+        delete cmd;
+        return;
+    }
+
+    cmd->Update();
+    m_Commands.Store(cmd);
+    m_Map->RecomputeLighting(true);
+}
+
+void MapEditor::OnToolsBuildNavMesh(wxCommandEvent& event)
+{
+    if (!m_Map)
+        return;
+
+    wxConfigBase* config = wxConfigBase::Get();
+    NavMesh::Settings settings;
+    settings.CellSize = (irr::f32)config->ReadDouble(wxT("/Navigation/CellSize"), settings.CellSize);
+    settings.AgentHeight = (irr::f32)config->ReadDouble(wxT("/Navigation/AgentHeight"), settings.AgentHeight);
+    settings.AgentRadius = (irr::f32)config->ReadDouble(wxT("/Navigation/AgentRadius"), settings.AgentRadius);
+    settings.AgentClimb = (irr::f32)config->ReadDouble(wxT("/Navigation/AgentClimb"), settings.AgentClimb);
+    settings.MaxSlope = (irr::f32)config->ReadDouble(wxT("/Navigation/MaxSlope"), settings.MaxSlope);
+
+    irr::u32 built;
+    {
+        wxBusyInfo wait(_("Building the navigation mesh..."));
+        built = m_Map->BuildNavMesh(settings);
+    }
+
+    wxLogMessage(_("Navigation mesh: %u tiles rebuilt, %u polygons"), built,
+        (irr::u32)m_Map->GetNavMesh().GetPolygons().size());
+
+    // the old paths may not hold any more
+    m_ViewPanel->SetOverlay(std::vector<irr::video::S3DVertex>());
+}
+
+void MapEditor::OnToolsCheckNavigation(wxCommandEvent& event)
+{
+    if (!m_Map)
+        return;
+
+    if (m_Map->GetNavMesh().IsEmpty())
+        OnToolsBuildNavMesh(event);
+
+    const NavMesh& navMesh = m_Map->GetNavMesh();
+    std::vector<irr::video::S3DVertex> lines;
+    irr::video::S3DVertex vertex;
+
+    // the walkable area, raised a little to stay out of the floor
+    vertex.Color.set(255, 64, 128, 255);
+    irr::core::vector3df lift(0, 0.1f, 0);
+    const std::vector<NavMesh::Polygon>& polygons = navMesh.GetPolygons();
+    for (size_t p = 0; p < polygons.size(); ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            vertex.Pos = polygons[p].Corners[c] + lift;
+            lines.push_back(vertex);
+            vertex.Pos = polygons[p].Corners[(c + 1) % 4] + lift;
+            lines.push_back(vertex);
+        }
+    }
+
+    irr::scene::ISceneNode* start = nullptr;
+    std::vector<PathSceneNode*> pathNodes;
+    const irr::scene::ISceneNodeList& children = m_Map->GetMapRoot()->getChildren();
+    for (irr::scene::ISceneNodeList::ConstIterator i = children.begin(); i != children.end(); ++i)
+    {
+        if ((*i)->getType() == (irr::scene::ESCENE_NODE_TYPE)ESNT_PLAYERSTART && !start)
+            start = *i;
+        else if ((*i)->getType() == (irr::scene::ESCENE_NODE_TYPE)ESNT_PATHNODE)
+            pathNodes.push_back(static_cast<PathSceneNode*>(*i));
+    }
+
+    // from the start to every node, then along each link
+    std::vector<std::pair<irr::scene::ISceneNode*, irr::scene::ISceneNode*>> queries;
+    for (size_t n = 0; n < pathNodes.size(); ++n)
+    {
+        if (start)
+            queries.push_back(std::make_pair(start, pathNodes[n]));
+        if (pathNodes[n]->getNext())
+            queries.push_back(std::make_pair(pathNodes[n], pathNodes[n]->getNext()));
+    }
+
+    size_t unreachable = 0;
+    std::vector<irr::core::vector3df> path;
+    for (size_t q = 0; q < queries.size(); ++q)
+    {
+        irr::core::vector3df from = queries[q].first->getAbsolutePosition();
+        irr::core::vector3df to = queries[q].second->getAbsolutePosition();
+        if (navMesh.FindPath(from, to, path))
+        {
+            vertex.Color.set(255, 0, 255, 0);
+            for (size_t p = 0; p + 1 < path.size(); ++p)
+            {
+                vertex.Pos = path[p] + lift;
+                lines.push_back(vertex);
+                vertex.Pos = path[p + 1] + lift;
+                lines.push_back(vertex);
+            }
+        }
+        else
+        {
+            wxLogWarning(_("%s can't reach %s"), wxString(queries[q].first->getName()),
+                wxString(queries[q].second->getName()));
+
+            vertex.Color.set(255, 255, 0, 0);
+            vertex.Pos = from;
+            lines.push_back(vertex);
+            vertex.Pos = to;
+            lines.push_back(vertex);
+            ++unreachable;
+        }
+    }
+
+    if (!start)
+        wxLogWarning(_("The map has no player start"));
+    wxLogMessage(_("Navigation: %u of %u paths found"), (unsigned)(queries.size() - unreachable),
+        (unsigned)queries.size());
+
+    m_ViewPanel->SetOverlay(lines);
 }
 
 void MapEditor::OnToolsPlayMap(wxCommandEvent& event)
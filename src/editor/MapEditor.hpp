@@ -145,6 +145,18 @@ private:
 	 */
 	void OnToolsRecomputeLighting(wxCommandEvent& event);
 
+	/**
+	 * @brief Handle build navigation mesh tool action
+	 * @param event The command event
+	 */
+	void OnToolsBuildNavMesh(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle check navigation tool action, drawing the paths found
+	 * @param event The command event
+	 */
+	void OnToolsCheckNavigation(wxCommandEvent& event);
+
 	/**
 	 * @brief Handle play map tool action
 	 * @param event The command event
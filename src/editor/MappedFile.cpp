@@ -0,0 +1,302 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "MappedFile.hpp"
+
+#include <wx/filename.h>
+
+#include <string.h>
+
+#if defined(__WXMSW__)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::map<wxString, std::shared_ptr<MappedArchive>> MappedArchive::ms_Archives;
+std::mutex MappedArchive::ms_Mutex;
+
+MappedFile::MappedFile(void)
+	: m_Data(nullptr), m_Size(0)
+#if defined(__WXMSW__)
+	, m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+bool MappedFile::Open(const wxString& path)
+{
+	Close();
+
+#if defined(__WXMSW__)
+	m_File = ::CreateFileW(path.wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(m_File, &size) || size.QuadPart == 0 || size.QuadPart > SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	m_Mapping = ::CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_Data = static_cast<const irr::u8*>(::MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_Data)
+	{
+		Close();
+		return false;
+	}
+
+	m_Size = (size_t)size.QuadPart;
+#else
+	int fd = ::open(path.fn_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference
+	if (data == MAP_FAILED)
+		return false;
+
+	m_Data = static_cast<const irr::u8*>(data);
+	m_Size = (size_t)st.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+#if defined(__WXMSW__)
+	if (m_Data)
+		::UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		::CloseHandle(m_Mapping);
+	if (m_File != INVALID_HANDLE_VALUE)
+		::CloseHandle(m_File);
+
+	m_Mapping = nullptr;
+	m_File = INVALID_HANDLE_VALUE;
+#else
+	if (m_Data)
+		::munmap(const_cast<irr::u8*>(m_Data), m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+MappedReadFile::MappedReadFile(const irr::io::path& filename,
+	const std::shared_ptr<const MappedFile>& mapping, const irr::u8* data, size_t size)
+	: m_Filename(filename), m_Mapping(mapping), m_Data(data), m_Size((long)size), m_Pos(0)
+{
+}
+
+irr::s32 MappedReadFile::read(void* buffer, irr::u32 sizeToRead)
+{
+	long count = irr::core::min_((long)sizeToRead, m_Size - m_Pos);
+	if (count <= 0)
+		return 0;
+
+	memcpy(buffer, m_Data + m_Pos, count);
+	m_Pos += count;
+	return (irr::s32)count;
+}
+
+bool MappedReadFile::seek(long finalPos, bool relativeMovement)
+{
+	long pos = relativeMovement ? m_Pos + finalPos : finalPos;
+	if (pos < 0 || pos > m_Size)
+		return false;
+
+	m_Pos = pos;
+	return true;
+}
+
+std::shared_ptr<MappedArchive> MappedArchive::Open(const wxString& path)
+{
+	wxFileName fn(path);
+	fn.MakeAbsolute();
+	wxString key = fn.GetFullPath();
+
+	wxDateTime modTime;
+	if (!fn.GetTimes(nullptr, &modTime, nullptr))
+		return std::shared_ptr<MappedArchive>();
+	wxInt64 modified = modTime.GetValue().GetValue();
+
+	std::lock_guard<std::mutex> lock(ms_Mutex);
+
+	// reuse it while the package hasn't changed
+	std::map<wxString, std::shared_ptr<MappedArchive>>::iterator cached = ms_Archives.find(key);
+	if (cached != ms_Archives.end() && cached->second->m_Modified == modified)
+		return cached->second;
+
+	std::shared_ptr<MappedFile> file(new MappedFile);
+	if (!file->Open(key))
+		return std::shared_ptr<MappedArchive>();
+
+	std::shared_ptr<MappedArchive> archive(new MappedArchive);
+	archive->m_File = file;
+	archive->m_Modified = modified;
+	if (!archive->Index())
+		return std::shared_ptr<MappedArchive>();
+
+	// nothing can be read in place, don't hold on to the mapping
+	if (archive->m_Entries.empty())
+		archive->m_File.reset();
+
+	ms_Archives[key] = archive;
+	return archive;
+}
+
+void MappedArchive::Release(const wxString& path)
+{
+	wxFileName fn(path);
+	fn.MakeAbsolute();
+
+	std::lock_guard<std::mutex> lock(ms_Mutex);
+	ms_Archives.erase(fn.GetFullPath());
+}
+
+irr::io::IReadFile* MappedArchive::OpenFile(const wxString& path, const irr::io::path& filename)
+{
+	if (wxFileName::GetSize(path) < MIN_MAPPED_SIZE)
+		return nullptr;
+
+	std::shared_ptr<MappedFile> file(new MappedFile);
+	if (!file->Open(path))
+		return nullptr;
+
+	return new MappedReadFile(filename, file, file->GetData(), file->GetSize());
+}
+
+const irr::u8* MappedArchive::Find(const wxString& name, size_t& size) const
+{
+	std::map<wxString, Entry>::const_iterator entry = m_Entries.find(NormalizeName(name));
+	if (entry == m_Entries.end())
+		return nullptr;
+
+	size = entry->second.Size;
+	return m_File->GetData() + entry->second.Offset;
+}
+
+irr::io::IReadFile* MappedArchive::CreateReadFile(const wxString& name, const irr::io::path& filename) const
+{
+	size_t size = 0;
+	const irr::u8* data = Find(name, size);
+	if (!data)
+		return nullptr;
+
+	return new MappedReadFile(filename, m_File, data, size);
+}
+
+static irr::u16 ReadU16(const irr::u8* p)
+{
+	return (irr::u16)(p[0] | (p[1] << 8));
+}
+
+static irr::u32 ReadU32(const irr::u8* p)
+{
+	return (irr::u32)p[0] | ((irr::u32)p[1] << 8) | ((irr::u32)p[2] << 16) | ((irr::u32)p[3] << 24);
+}
+
+bool MappedArchive::Index(void)
+{
+	static const size_t END_SIZE = 22;
+	static const size_t CENTRAL_SIZE = 46;
+	static const size_t LOCAL_SIZE = 30;
+
+	const irr::u8* data = m_File->GetData();
+	size_t size = m_File->GetSize();
+	if (size < END_SIZE)
+		return false;
+
+	// the end record is last, possibly followed by a comment of up to 64k
+	size_t end = size - END_SIZE;
+	size_t first = size > END_SIZE + 0xffff ? size - END_SIZE - 0xffff : 0;
+	while (ReadU32(data + end) != 0x06054b50)
+	{
+		if (end == first)
+			return false;
+		--end;
+	}
+
+	irr::u16 count = ReadU16(data + end + 10);
+	size_t central = ReadU32(data + end + 16);
+
+	for (irr::u16 i = 0; i < count; ++i)
+	{
+		if (central + CENTRAL_SIZE > size || ReadU32(data + central) != 0x02014b50)
+			return false;
+
+		const irr::u8* header = data + central;
+		irr::u16 flags = ReadU16(header + 8);
+		irr::u16 method = ReadU16(header + 10);
+		irr::u32 compressedSize = ReadU32(header + 20);
+		irr::u32 uncompressedSize = ReadU32(header + 24);
+		irr::u16 nameLen = ReadU16(header + 28);
+		irr::u16 extraLen = ReadU16(header + 30);
+		irr::u16 commentLen = ReadU16(header + 32);
+		size_t local = ReadU32(header + 42);
+
+		if (central + CENTRAL_SIZE + nameLen > size)
+			return false;
+
+		// only stored, unencrypted, non-zip64 entries can be read in place
+		if (method == 0 && !(flags & 1) && compressedSize == uncompressedSize &&
+			compressedSize != 0xffffffff && local + LOCAL_SIZE <= size &&
+			ReadU32(data + local) == 0x04034b50)
+		{
+			const char* name = reinterpret_cast<const char*>(header + CENTRAL_SIZE);
+			wxString entryName = (flags & (1 << 11)) ?
+				wxString::FromUTF8(name, nameLen) : wxString(name, wxConvISO8859_1, nameLen);
+
+			// the local header can have a different extra field, e.g. alignment padding
+			Entry entry;
+			entry.Offset = local + LOCAL_SIZE + ReadU16(data + local + 26) + ReadU16(data + local + 28);
+			entry.Size = compressedSize;
+			if (entry.Offset + entry.Size <= size && !entryName.EndsWith(wxT("/")))
+				m_Entries[NormalizeName(entryName)] = entry;
+		}
+
+		central += CENTRAL_SIZE + nameLen + extraLen + commentLen;
+	}
+
+	return true;
+}
+
+wxString MappedArchive::NormalizeName(const wxString& name)
+{
+	wxString normalized(name);
+	normalized.Replace(wxT("\\"), wxT("/"));
+	while (normalized.StartsWith(wxT("/")))
+		normalized.erase(0, 1);
+
+	return normalized;
+}
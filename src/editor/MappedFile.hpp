@@ -0,0 +1,110 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <wx/string.h>
+
+#include "irrlicht.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+// A whole file mapped read-only into memory
+class MappedFile
+{
+private:
+	const irr::u8* m_Data;
+	size_t m_Size;
+
+#if defined(__WXMSW__)
+	void* m_File;
+	void* m_Mapping;
+#endif
+
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	bool Open(const wxString& path);
+	void Close(void);
+
+	const irr::u8* GetData(void) const { return m_Data; }
+	size_t GetSize(void) const { return m_Size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+// Reads a span of a mapped file. The span stays valid for the lifetime of the
+// read file, so loaders that can work in memory can use getData() directly
+// instead of copying it out with read().
+class MappedReadFile : public irr::io::IReadFile
+{
+private:
+	irr::io::path m_Filename;
+	std::shared_ptr<const MappedFile> m_Mapping; // keeps the pages mapped
+	const irr::u8* m_Data;
+	long m_Size;
+	long m_Pos;
+
+public:
+	MappedReadFile(const irr::io::path& filename, const std::shared_ptr<const MappedFile>& mapping,
+		const irr::u8* data, size_t size);
+
+	const irr::io::path& getFileName(void) const { return m_Filename; }
+	long getPos(void) const { return m_Pos; }
+	long getSize(void) const { return m_Size; }
+	irr::s32 read(void* buffer, irr::u32 sizeToRead);
+	bool seek(long finalPos, bool relativeMovement = false);
+
+	const irr::u8* getData(void) const { return m_Data; }
+};
+
+// Index of the entries of a zip package that are stored uncompressed, which
+// can be read straight out of the mapped package. Packages without any are
+// not kept mapped.
+class MappedArchive
+{
+private:
+	struct Entry
+	{
+		size_t Offset;
+		size_t Size;
+	};
+
+	std::shared_ptr<const MappedFile> m_File;
+	std::map<wxString, Entry> m_Entries; // by name, with '/' separators
+	wxInt64 m_Modified;
+
+	static std::map<wxString, std::shared_ptr<MappedArchive>> ms_Archives;
+	static std::mutex ms_Mutex;
+
+public:
+	// Loose files smaller than this are cheaper to read than to map
+	enum { MIN_MAPPED_SIZE = 16 * 1024 };
+
+	// Opens or reuses the package; null if it can't be mapped or isn't a zip
+	static std::shared_ptr<MappedArchive> Open(const wxString& path);
+
+	// Forgets a package, e.g. before it is rebuilt
+	static void Release(const wxString& path);
+
+	// Maps a loose file; null if it's small or can't be mapped
+	static irr::io::IReadFile* OpenFile(const wxString& path, const irr::io::path& filename);
+
+	// The bytes of a stored entry, or null if it isn't stored uncompressed
+	const irr::u8* Find(const wxString& name, size_t& size) const;
+
+	// A read file over a stored entry, or null if it isn't stored uncompressed
+	irr::io::IReadFile* CreateReadFile(const wxString& name, const irr::io::path& filename) const;
+
+private:
+	bool Index(void);
+	static wxString NormalizeName(const wxString& name);
+};
@@ -0,0 +1,379 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Common.hpp"
+#include "MeshInstancer.hpp"
+
+#include <cmath>
+#include <cstring>
+
+// Draws every selected batch in the solid pass
+class MeshInstancer::BatchNode : public irr::scene::ISceneNode
+{
+private:
+	const MeshInstancer::batchmap_t& m_Batches;
+	irr::core::aabbox3df m_Box;
+
+public:
+	BatchNode(const MeshInstancer::batchmap_t& batches, irr::scene::ISceneNode* parent,
+		irr::scene::ISceneManager* sceneMgr)
+		: irr::scene::ISceneNode(parent, sceneMgr, NID_NOSAVE), m_Batches(batches)
+	{
+		// the batches were culled on their own
+		setAutomaticCulling(irr::scene::EAC_OFF);
+	}
+
+	void OnRegisterSceneNode()
+	{
+		if (IsVisible)
+			SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_SOLID);
+
+		ISceneNode::OnRegisterSceneNode();
+	}
+
+	void render()
+	{
+		irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+		// the vertices are already in world space
+		driver->setTransform(irr::video::ETS_WORLD, irr::core::IdentityMatrix);
+
+		for (MeshInstancer::batchmap_t::const_iterator batch = m_Batches.begin();
+			batch != m_Batches.end(); ++batch)
+		{
+			if (!batch->second.Source)
+				continue;
+
+			for (size_t b = 0; b < batch->second.Buffers.size(); ++b)
+			{
+				driver->setMaterial(MeshInstancer::GetMaterial(batch->second.Source, (irr::u32)b));
+				driver->drawMeshBuffer(batch->second.Buffers[b]);
+			}
+		}
+	}
+
+	const irr::core::aabbox3df& getBoundingBox() const
+	{
+		return m_Box;
+	}
+};
+
+bool MeshInstancer::BatchKey::operator<(const BatchKey& other) const
+{
+	if (Mesh != other.Mesh)
+		return Mesh < other.Mesh;
+	if (X != other.X)
+		return X < other.X;
+	if (Y != other.Y)
+		return Y < other.Y;
+	return Z < other.Z;
+}
+
+MeshInstancer::MeshInstancer(irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* parent)
+	: m_SceneMgr(sceneMgr)
+{
+	m_Batch = new BatchNode(m_Batches, parent, sceneMgr);
+	m_Batch->setVisible(false);
+
+	m_Stats.Instances = 0;
+	m_Stats.Batches = 0;
+}
+
+MeshInstancer::~MeshInstancer(void)
+{
+	Restore();
+
+	for (batchmap_t::iterator batch = m_Batches.begin(); batch != m_Batches.end(); ++batch)
+	{
+		Release(batch->second);
+		batch->first.Mesh->drop();
+	}
+
+	m_Batch->remove();
+	m_Batch->drop();
+}
+
+void MeshInstancer::Update(irr::scene::ISceneNode* mapRoot)
+{
+	Restore();
+
+	// nodes come and go with every edit, so they're found again each frame
+	for (batchmap_t::iterator batch = m_Batches.begin(); batch != m_Batches.end(); ++batch)
+		batch->second.Next.clear();
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = mapRoot->getChildren().begin();
+		child != mapRoot->getChildren().end(); ++child)
+		Track(*child);
+
+	batchmap_t::iterator batch = m_Batches.begin();
+	while (batch != m_Batches.end())
+	{
+		Batch& current = batch->second;
+		if (current.Next.empty())
+		{
+			Release(current);
+			batch->first.Mesh->drop();
+			batch = m_Batches.erase(batch);
+			continue;
+		}
+
+		// only the pointers of the old placements are compared, they may be gone
+		bool changed = current.Next.size() != current.Nodes.size();
+		for (size_t i = 0; i < current.Next.size() && !changed; ++i)
+		{
+			changed = current.Next[i] != current.Nodes[i] ||
+				current.Next[i]->getAbsoluteTransformation() != current.Transforms[i];
+		}
+
+		if (changed)
+		{
+			current.Nodes.swap(current.Next);
+			current.Transforms.clear();
+			for (size_t i = 0; i < current.Nodes.size(); ++i)
+				current.Transforms.push_back(current.Nodes[i]->getAbsoluteTransformation());
+
+			if (current.Nodes.size() >= MIN_INSTANCES)
+				Build(batch->first.Mesh, current);
+			else
+				Release(current); // the nodes draw themselves
+		}
+
+		++batch;
+	}
+}
+
+void MeshInstancer::Select(irr::scene::ICameraSceneNode* camera)
+{
+	Restore();
+
+	m_Stats.Instances = 0;
+	m_Stats.Batches = 0;
+
+	if (!camera)
+		return;
+
+	const irr::scene::SViewFrustum* frustum = camera->getViewFrustum();
+
+	for (batchmap_t::iterator batch = m_Batches.begin(); batch != m_Batches.end(); ++batch)
+	{
+		Batch& current = batch->second;
+		if (current.Buffers.empty())
+			continue;
+
+		// outside the view; the scene manager skips the placements as well
+		bool culled = false;
+		for (irr::u32 p = 0; p < irr::scene::SViewFrustum::VF_PLANE_COUNT && !culled; ++p)
+			culled = current.Box.classifyPlaneRelation(frustum->planes[p]) == irr::core::ISREL3D_FRONT;
+		if (culled)
+			continue;
+
+		// every placement has to draw the same way for the batch to stand in
+		// for them; hidden or swapped for a stand-in in this view, drawing its
+		// own debug data, or textured differently and they draw themselves
+		irr::scene::IMeshSceneNode* source = current.Nodes[0];
+		bool batched = !IsTransparent(source);
+		for (size_t i = 0; i < current.Nodes.size() && batched; ++i)
+		{
+			irr::scene::IMeshSceneNode* node = current.Nodes[i];
+			batched = node->isTrulyVisible() && !node->isDebugDataVisible();
+			for (irr::u32 b = 0; b < current.Buffers.size() && batched && i > 0; ++b)
+				batched = GetMaterial(node, b) == GetMaterial(source, b);
+		}
+
+		if (!batched)
+			continue;
+
+		current.Source = source;
+		for (size_t i = 0; i < current.Nodes.size(); ++i)
+		{
+			current.Nodes[i]->setVisible(false);
+			m_Hidden.push_back(current.Nodes[i]);
+		}
+
+		m_Stats.Instances += (irr::u32)current.Nodes.size();
+		++m_Stats.Batches;
+	}
+
+	m_Batch->setVisible(m_Stats.Batches > 0);
+}
+
+void MeshInstancer::Restore(void)
+{
+	for (size_t i = 0; i < m_Hidden.size(); ++i)
+		m_Hidden[i]->setVisible(true);
+
+	m_Hidden.clear();
+	m_Batch->setVisible(false);
+
+	for (batchmap_t::iterator batch = m_Batches.begin(); batch != m_Batches.end(); ++batch)
+		batch->second.Source = nullptr;
+}
+
+void MeshInstancer::Track(irr::scene::ISceneNode* node)
+{
+	// moved since the last draw; parents are tracked first
+	node->updateAbsolutePosition();
+
+	// hiding a node hides its children, so only the leaves can be batched;
+	// a selected node draws its box and is left out until it's unselected
+	if (node->getType() == irr::scene::ESNT_MESH && node->getChildren().empty() &&
+		node->isVisible() && !node->isDebugDataVisible())
+	{
+		irr::scene::IMeshSceneNode* meshNode = static_cast<irr::scene::IMeshSceneNode*>(node);
+		irr::scene::IMesh* mesh = meshNode->getMesh();
+		if (mesh && mesh->getMeshBufferCount() > 0)
+		{
+			irr::core::vector3df centre = node->getTransformedBoundingBox().getCenter();
+
+			BatchKey key;
+			key.Mesh = mesh;
+			key.X = (irr::s32)std::floor(centre.X / CHUNK_SIZE);
+			key.Y = (irr::s32)std::floor(centre.Y / CHUNK_SIZE);
+			key.Z = (irr::s32)std::floor(centre.Z / CHUNK_SIZE);
+
+			batchmap_t::iterator batch = m_Batches.find(key);
+			if (batch == m_Batches.end())
+			{
+				// held so the key can't be reused by another mesh
+				mesh->grab();
+				batch = m_Batches.emplace(key, Batch()).first;
+				batch->second.Source = nullptr;
+			}
+
+			batch->second.Next.push_back(meshNode);
+		}
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+		child != node->getChildren().end(); ++child)
+		Track(*child);
+}
+
+void MeshInstancer::Build(irr::scene::IMesh* mesh, Batch& batch)
+{
+	irr::u32 count = mesh->getMeshBufferCount();
+	if (batch.Buffers.size() != count)
+		Release(batch);
+
+	irr::u32 instances = (irr::u32)batch.Nodes.size();
+	for (irr::u32 b = 0; b < count; ++b)
+	{
+		irr::scene::IMeshBuffer* source = mesh->getMeshBuffer(b);
+		irr::u32 vertexCount = source->getVertexCount();
+		irr::u32 indexCount = source->getIndexCount();
+		irr::video::E_VERTEX_TYPE vertexType = source->getVertexType();
+		irr::video::E_INDEX_TYPE indexType = (irr::u64)vertexCount * instances > 0xffff ?
+			irr::video::EIT_32BIT : irr::video::EIT_16BIT;
+
+		if (batch.Buffers.size() <= b)
+			batch.Buffers.push_back(nullptr);
+
+		irr::scene::IDynamicMeshBuffer*& merged = batch.Buffers[b];
+		if (merged && (merged->getVertexType() != vertexType || merged->getIndexType() != indexType))
+		{
+			m_SceneMgr->getVideoDriver()->removeHardwareBuffer(merged);
+			merged->drop();
+			merged = nullptr;
+		}
+
+		if (!merged)
+		{
+			merged = new irr::scene::CDynamicMeshBuffer(vertexType, indexType);
+			merged->setHardwareMappingHint(irr::scene::EHM_STATIC);
+		}
+
+		irr::u32 pitch = irr::video::getVertexPitchFromType(vertexType);
+		irr::scene::IVertexBuffer& vertices = merged->getVertexBuffer();
+		vertices.set_used(vertexCount * instances);
+		irr::u8* vertexData = static_cast<irr::u8*>(vertices.getData());
+
+		irr::scene::IIndexBuffer& indices = merged->getIndexBuffer();
+		indices.set_used(indexCount * instances);
+
+		for (irr::u32 i = 0; i < instances; ++i)
+		{
+			const irr::core::matrix4& transform = batch.Transforms[i];
+			irr::u8* first = vertexData + (size_t)i * vertexCount * pitch;
+			memcpy(first, source->getVertices(), (size_t)vertexCount * pitch);
+
+			// every vertex type starts with the standard one
+			for (irr::u32 v = 0; v < vertexCount; ++v)
+			{
+				irr::video::S3DVertex* vertex = reinterpret_cast<irr::video::S3DVertex*>(first + (size_t)v * pitch);
+				transform.transformVect(vertex->Pos);
+				transform.rotateVect(vertex->Normal);
+				vertex->Normal.normalize();
+
+				if (vertexType == irr::video::EVT_TANGENTS)
+				{
+					irr::video::S3DVertexTangents* tangents = static_cast<irr::video::S3DVertexTangents*>(vertex);
+					transform.rotateVect(tangents->Tangent);
+					tangents->Tangent.normalize();
+					transform.rotateVect(tangents->Binormal);
+					tangents->Binormal.normalize();
+				}
+			}
+
+			irr::u32 base = i * vertexCount;
+			irr::u32 offset = i * indexCount;
+			if (source->getIndexType() == irr::video::EIT_16BIT)
+			{
+				const irr::u16* sourceIndices = source->getIndices();
+				for (irr::u32 n = 0; n < indexCount; ++n)
+					indices.setValue(offset + n, base + sourceIndices[n]);
+			}
+			else
+			{
+				const irr::u32* sourceIndices = reinterpret_cast<const irr::u32*>(source->getIndices());
+				for (irr::u32 n = 0; n < indexCount; ++n)
+					indices.setValue(offset + n, base + sourceIndices[n]);
+			}
+		}
+
+		merged->recalculateBoundingBox();
+		merged->setDirty();
+
+		if (b == 0)
+			batch.Box = merged->getBoundingBox();
+		else
+			batch.Box.addInternalBox(merged->getBoundingBox());
+	}
+}
+
+void MeshInstancer::Release(Batch& batch)
+{
+	// the driver keeps the hardware copy until it's told to let go
+	for (size_t b = 0; b < batch.Buffers.size(); ++b)
+	{
+		if (!batch.Buffers[b])
+			continue;
+
+		m_SceneMgr->getVideoDriver()->removeHardwareBuffer(batch.Buffers[b]);
+		batch.Buffers[b]->drop();
+	}
+
+	batch.Buffers.clear();
+}
+
+const irr::video::SMaterial& MeshInstancer::GetMaterial(irr::scene::IMeshSceneNode* node, irr::u32 buffer)
+{
+	// the materials the node would draw with
+	return node->isReadOnlyMaterials() ?
+		node->getMesh()->getMeshBuffer(buffer)->getMaterial() : node->getMaterial(buffer);
+}
+
+bool MeshInstancer::IsTransparent(irr::scene::IMeshSceneNode* node)
+{
+	// transparent buffers are sorted and drawn later by the scene manager
+	irr::scene::IMesh* mesh = node->getMesh();
+	for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+	{
+		if (GetMaterial(node, b).isTransparent())
+			return true;
+	}
+
+	return false;
+}
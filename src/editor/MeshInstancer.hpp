@@ -0,0 +1,90 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <map>
+#include <vector>
+
+// Merges repeated placements of the same mesh into static batches: the
+// placements of a mesh that fall in the same chunk of the map are copied,
+// already transformed, into one vertex and index buffer per mesh buffer, and
+// a batch is drawn with one call per buffer. A batch is only rebuilt when one
+// of its placements moves, comes or goes. The map's nodes stay the editor's
+// entities; they're hidden for the duration of a draw while the batch stands
+// in for them, and the instancer keeps nothing per placement but the node and
+// the transform the batch was built with.
+class MeshInstancer
+{
+public:
+	enum
+	{
+		MIN_INSTANCES = 4,  // placements needed before a chunk is batched
+		CHUNK_SIZE = 512,   // world units on a side of a batch's chunk
+	};
+
+	struct Stats
+	{
+		irr::u32 Instances;
+		irr::u32 Batches;
+	};
+
+private:
+	class BatchNode;
+
+	struct BatchKey
+	{
+		irr::scene::IMesh* Mesh;
+		irr::s32 X, Y, Z;
+
+		bool operator<(const BatchKey& other) const;
+	};
+
+	struct Batch
+	{
+		std::vector<irr::scene::IMeshSceneNode*> Nodes;
+		std::vector<irr::core::matrix4> Transforms;     // as the buffers were built
+		std::vector<irr::scene::IMeshSceneNode*> Next;  // found by this update
+		std::vector<irr::scene::IDynamicMeshBuffer*> Buffers; // one per mesh buffer
+		irr::core::aabbox3df Box;
+		irr::scene::IMeshSceneNode* Source; // materials for this view, null if not drawn
+	};
+
+	irr::scene::ISceneManager* m_SceneMgr;
+	BatchNode* m_Batch;
+
+	typedef std::map<BatchKey, Batch> batchmap_t;
+	batchmap_t m_Batches;
+
+	std::vector<irr::scene::ISceneNode*> m_Hidden;
+	Stats m_Stats;
+
+public:
+	MeshInstancer(irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* parent);
+	~MeshInstancer(void);
+
+	// Once per frame; finds the mesh nodes in the map and rebuilds the
+	// batches whose placements changed
+	void Update(irr::scene::ISceneNode* mapRoot);
+
+	// Picks the batches to draw for this view. Restore() must be called
+	// after drawing.
+	void Select(irr::scene::ICameraSceneNode* camera);
+	void Restore(void);
+
+	// For the last view selected
+	const Stats& GetStats(void) const { return m_Stats; }
+
+private:
+	void Track(irr::scene::ISceneNode* node);
+	void Build(irr::scene::IMesh* mesh, Batch& batch);
+	void Release(Batch& batch);
+
+	static const irr::video::SMaterial& GetMaterial(irr::scene::IMeshSceneNode* node, irr::u32 buffer);
+	static bool IsTransparent(irr::scene::IMeshSceneNode* node);
+};
@@ -0,0 +1,281 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Common.hpp"
+#include "MeshLOD.hpp"
+
+const irr::f32 MeshLOD::LEVEL_RADIUS[MeshSimplifier::MAX_LEVELS] = { 64.0f, 32.0f, 16.0f };
+
+MeshLOD::MeshLOD(irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* parent)
+	: m_SceneMgr(sceneMgr), m_Parent(parent)
+{
+	// leave most of the cores to the other background work
+	m_Workers.reset(new WorkerPool(1));
+}
+
+MeshLOD::~MeshLOD(void)
+{
+	// nothing may finish after this
+	m_Workers.reset();
+
+	Restore();
+
+	while (!m_Instances.empty())
+		Remove(m_Instances.begin());
+
+	for (levelmap_t::iterator levels = m_Levels.begin();
+		levels != m_Levels.end(); ++levels)
+	{
+		for (size_t i = 0; i < levels->second.Meshes.size(); ++i)
+			levels->second.Meshes[i]->drop();
+		levels->first->drop();
+	}
+}
+
+void MeshLOD::Update(irr::scene::ISceneNode* mapRoot)
+{
+	Restore();
+
+	// pick up what the workers have finished
+	std::vector<std::pair<irr::scene::IMesh*, std::vector<MeshSimplifier::level_t>>> built;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		built.swap(m_Built);
+	}
+
+	for (size_t i = 0; i < built.size(); ++i)
+	{
+		Levels& levels = m_Levels[built[i].first];
+		for (size_t l = 0; l < built[i].second.size(); ++l)
+			levels.Meshes.push_back(MeshSimplifier::CreateMesh(built[i].second[l], built[i].first));
+	}
+
+	// forget nodes that have left the map
+	for (instancemap_t::iterator instance = m_Instances.begin();
+		instance != m_Instances.end();)
+	{
+		instancemap_t::iterator next = instance;
+		++next;
+
+		if (!instance->second.Node->getParent())
+			Remove(instance);
+
+		instance = next;
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = mapRoot->getChildren().begin();
+		child != mapRoot->getChildren().end(); ++child)
+		Track(*child);
+}
+
+void MeshLOD::Select(irr::scene::ICameraSceneNode* camera, const irr::core::recti& viewPort)
+{
+	Restore();
+
+	if (!camera)
+		return;
+
+	// pixels per unit of radius; divided by distance with a perspective projection
+	const irr::core::matrix4& projection = camera->getProjectionMatrix();
+	irr::f32 scale = projection[5] * viewPort.getHeight() * 0.5f;
+	bool ortho = camera->isOrthogonal();
+	irr::core::vector3df eye(camera->getAbsolutePosition());
+
+	for (instancemap_t::iterator i = m_Instances.begin(); i != m_Instances.end(); ++i)
+	{
+		Instance& instance = i->second;
+		if (!instance.Node->isVisible())
+			continue;
+
+		levelmap_t::iterator levels = m_Levels.find(instance.Source);
+		if (levels == m_Levels.end() || levels->second.Meshes.empty())
+			continue;
+
+		const irr::core::aabbox3df& box = instance.Node->getTransformedBoundingBox();
+		irr::f32 radius = box.getExtent().getLength() * 0.5f * scale;
+		if (!ortho)
+			radius /= irr::core::max_(eye.getDistanceFrom(box.getCenter()), 0.001f);
+
+		irr::s32 level = 0;
+		for (size_t l = 0; l < levels->second.Meshes.size(); ++l)
+		{
+			if (radius < LEVEL_RADIUS[l])
+				level = (irr::s32)l + 1;
+		}
+
+		if (level == 0)
+			continue;
+
+		irr::scene::IMesh* mesh = levels->second.Meshes[level - 1];
+		if (!instance.StandIn)
+		{
+			instance.StandIn = m_SceneMgr->addMeshSceneNode(mesh, m_Parent, NID_NOSAVE);
+			instance.Level = level;
+		}
+		else if (instance.Level != level)
+		{
+			instance.StandIn->setMesh(mesh);
+			instance.Level = level;
+		}
+
+		// look exactly like the node, including any texture proxies in use
+		irr::u32 materialCount = irr::core::min_(instance.StandIn->getMaterialCount(),
+			instance.Node->getMaterialCount());
+		for (irr::u32 m = 0; m < materialCount; ++m)
+			instance.StandIn->getMaterial(m) = instance.Node->getMaterial(m);
+
+		const irr::core::matrix4& transform = instance.Node->getAbsoluteTransformation();
+		instance.StandIn->setPosition(transform.getTranslation());
+		instance.StandIn->setRotation(transform.getRotationDegrees());
+		instance.StandIn->setScale(transform.getScale());
+		instance.StandIn->updateAbsolutePosition();
+		instance.StandIn->setDebugDataVisible(instance.Node->isDebugDataVisible());
+		instance.StandIn->setVisible(true);
+
+		instance.Node->setVisible(false);
+		instance.Swapped = true;
+		m_Swapped.push_back(&instance);
+	}
+}
+
+void MeshLOD::Restore(void)
+{
+	for (size_t i = 0; i < m_Swapped.size(); ++i)
+	{
+		m_Swapped[i]->Node->setVisible(true);
+		m_Swapped[i]->StandIn->setVisible(false);
+		m_Swapped[i]->Swapped = false;
+	}
+
+	m_Swapped.clear();
+}
+
+void MeshLOD::Track(irr::scene::ISceneNode* node)
+{
+	// a stand-in can't take the place of a node with children
+	irr::scene::IMesh* mesh = GetStaticMesh(node);
+	if (mesh && node->getChildren().empty())
+	{
+		instancemap_t::iterator instance = m_Instances.find(node);
+		if (instance == m_Instances.end())
+		{
+			Instance newInstance;
+			newInstance.Node = node;
+			newInstance.Source = mesh;
+			newInstance.StandIn = nullptr;
+			newInstance.Level = 0;
+			newInstance.Swapped = false;
+			m_Instances.emplace(node, newInstance);
+			node->grab();
+		}
+		else if (instance->second.Source != mesh)
+		{
+			// the mesh was changed, the stand-in needs a new one
+			instance->second.Source = mesh;
+			instance->second.Level = 0;
+		}
+
+		if (m_Levels.find(mesh) == m_Levels.end())
+			Request(mesh);
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+		child != node->getChildren().end(); ++child)
+		Track(*child);
+}
+
+void MeshLOD::Request(irr::scene::IMesh* mesh)
+{
+	Levels& levels = m_Levels[mesh];
+	mesh->grab();
+
+	irr::u32 triangles = 0;
+	for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		triangles += mesh->getMeshBuffer(b)->getIndexCount() / 3;
+
+	if (triangles < MeshSimplifier::MIN_TRIANGLES)
+		return;
+
+	// packages carry prebuilt levels next to the mesh
+	irr::scene::IMeshCache* meshCache = m_SceneMgr->getMeshCache();
+	for (irr::u32 i = 0; i < meshCache->getMeshCount(); ++i)
+	{
+		irr::scene::IAnimatedMesh* cached = meshCache->getMeshByIndex(i);
+		if (cached != mesh && cached->getMesh(0) != mesh)
+			continue;
+
+		irr::io::path sidecarName(meshCache->getMeshName(i).getPath());
+		sidecarName += ".lod";
+
+		irr::io::IReadFile* sidecar = m_SceneMgr->getFileSystem()->createAndOpenFile(sidecarName);
+		if (!sidecar)
+			break;
+
+		std::vector<irr::u8> data(sidecar->getSize());
+		bool read = data.empty() || sidecar->read(&data[0], (irr::u32)data.size()) == (irr::s32)data.size();
+		sidecar->drop();
+
+		std::vector<MeshSimplifier::level_t> built;
+		if (read && !data.empty() && MeshSimplifier::Load(&data[0], data.size(), triangles, built))
+		{
+			for (size_t l = 0; l < built.size(); ++l)
+				levels.Meshes.push_back(MeshSimplifier::CreateMesh(built[l], mesh));
+			return;
+		}
+
+		break;
+	}
+
+	// otherwise build them in the background
+	MeshSimplifier::level_t source;
+	if (!MeshSimplifier::Extract(mesh, source))
+		return;
+
+	m_Workers->Submit([this, mesh, source]()
+	{
+		std::vector<MeshSimplifier::level_t> built;
+		MeshSimplifier::BuildLevels(source, built);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Built.push_back(std::make_pair(mesh, built));
+	});
+}
+
+void MeshLOD::Remove(instancemap_t::iterator instance)
+{
+	if (instance->second.StandIn)
+		instance->second.StandIn->remove();
+
+	instance->second.Node->drop();
+	m_Instances.erase(instance);
+}
+
+irr::scene::IMesh* MeshLOD::GetStaticMesh(irr::scene::ISceneNode* node)
+{
+	switch (node->getType())
+	{
+	case irr::scene::ESNT_MESH:
+	{
+		// the levels would drop the lightmap coordinates
+		irr::scene::IMesh* mesh = static_cast<irr::scene::IMeshSceneNode*>(node)->getMesh();
+		if (mesh && mesh->getMeshBufferCount() > 0 &&
+			mesh->getMeshBuffer(0)->getVertexType() == irr::video::EVT_2TCOORDS)
+			return nullptr;
+		return mesh;
+	}
+	case irr::scene::ESNT_ANIMATED_MESH:
+	{
+		// only models without animation, the levels can't follow the skinning
+		irr::scene::IAnimatedMesh* mesh = static_cast<irr::scene::IAnimatedMeshSceneNode*>(node)->getMesh();
+		if (mesh && mesh->getFrameCount() <= 1)
+			return mesh->getMesh(0);
+	} break;
+	default:
+		break;
+	}
+
+	return nullptr;
+}
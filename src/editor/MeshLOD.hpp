@@ -0,0 +1,76 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "MeshSimplifier.hpp"
+#include "WorkerPool.hpp"
+
+#include "irrlicht.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Draws mesh and model nodes with simplified meshes when they're small on
+// screen. Levels come from the <mesh>.lod sidecar the package builder stores
+// next to the mesh, or are built on worker threads otherwise. The map's own
+// nodes never change; a stand-in node is shown in their place for the
+// duration of a draw, so picking and selection still use the full mesh.
+class MeshLOD
+{
+private:
+	struct Levels
+	{
+		std::vector<irr::scene::IMesh*> Meshes; // coarser with each level, empty until built
+	};
+
+	struct Instance
+	{
+		irr::scene::ISceneNode* Node;
+		irr::scene::IMesh* Source;
+		irr::scene::IMeshSceneNode* StandIn;
+		irr::s32 Level;
+		bool Swapped;
+	};
+
+	irr::scene::ISceneManager* m_SceneMgr;
+	irr::scene::ISceneNode* m_Parent;
+
+	typedef std::map<irr::scene::IMesh*, Levels> levelmap_t;
+	levelmap_t m_Levels;
+
+	typedef std::map<irr::scene::ISceneNode*, Instance> instancemap_t;
+	instancemap_t m_Instances;
+	std::vector<Instance*> m_Swapped;
+
+	std::unique_ptr<WorkerPool> m_Workers;
+	std::mutex m_Mutex;
+	std::vector<std::pair<irr::scene::IMesh*, std::vector<MeshSimplifier::level_t>>> m_Built;
+
+public:
+	// Projected radius, in pixels, below which each level is used
+	static const irr::f32 LEVEL_RADIUS[MeshSimplifier::MAX_LEVELS];
+
+	MeshLOD(irr::scene::ISceneManager* sceneMgr, irr::scene::ISceneNode* parent);
+	~MeshLOD(void);
+
+	// Once per frame; picks up new nodes and finished levels
+	void Update(irr::scene::ISceneNode* mapRoot);
+
+	// Shows the stand-ins for the nodes that are small in this view.
+	// Restore() must be called after drawing.
+	void Select(irr::scene::ICameraSceneNode* camera, const irr::core::recti& viewPort);
+	void Restore(void);
+
+private:
+	void Track(irr::scene::ISceneNode* node);
+	void Request(irr::scene::IMesh* mesh);
+	void Remove(instancemap_t::iterator instance);
+
+	static irr::scene::IMesh* GetStaticMesh(irr::scene::ISceneNode* node);
+};
@@ -0,0 +1,664 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "MeshSimplifier.hpp"
+
+#include <math.h>
+#include <string.h>
+
+static const irr::u32 LOD_MAGIC = 0x444f4c4d; // 'MLOD'
+static const irr::u32 LOD_VERSION = 1;
+
+// Error quadric as the upper triangle of a symmetric 4x4 matrix
+struct Quadric
+{
+	double m[10];
+
+	Quadric(void)
+	{
+		for (int i = 0; i < 10; ++i)
+			m[i] = 0.0;
+	}
+
+	// of the plane ax + by + cz + d = 0
+	Quadric(double a, double b, double c, double d)
+	{
+		m[0] = a * a; m[1] = a * b; m[2] = a * c; m[3] = a * d;
+		m[4] = b * b; m[5] = b * c; m[6] = b * d;
+		m[7] = c * c; m[8] = c * d;
+		m[9] = d * d;
+	}
+
+	Quadric operator+(const Quadric& other) const
+	{
+		Quadric result;
+		for (int i = 0; i < 10; ++i)
+			result.m[i] = m[i] + other.m[i];
+		return result;
+	}
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		for (int i = 0; i < 10; ++i)
+			m[i] += other.m[i];
+		return *this;
+	}
+
+	double Det(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33) const
+	{
+		return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31] -
+			m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+	}
+
+	double Error(const irr::core::vector3df& p) const
+	{
+		double x = p.X, y = p.Y, z = p.Z;
+		return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x +
+			m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+			m[7] * z * z + 2 * m[8] * z + m[9];
+	}
+};
+
+struct Triangle
+{
+	irr::u32 V[3];
+	double Error[4]; // per edge, and the smallest
+	irr::core::vector3df Normal;
+	bool Deleted;
+	bool Dirty;
+};
+
+struct Vertex
+{
+	irr::core::vector3df Pos;
+	Quadric Q;
+	irr::u32 RefStart;
+	irr::u32 RefCount;
+	bool Border;
+};
+
+struct Ref
+{
+	irr::u32 Triangle;
+	irr::u32 Corner;
+};
+
+// Working state of a single buffer
+struct Collapser
+{
+	std::vector<Triangle> Triangles;
+	std::vector<Vertex> Vertices;
+	std::vector<Ref> Refs;
+
+	double EdgeError(irr::u32 v1, irr::u32 v2, irr::core::vector3df& result) const
+	{
+		Quadric q = Vertices[v1].Q + Vertices[v2].Q;
+
+		// the optimal position, if the quadric can be solved
+		double det = q.Det(0, 1, 2, 1, 4, 5, 2, 5, 7);
+		if (det != 0.0)
+		{
+			result.X = (irr::f32)(-1.0 / det * q.Det(1, 2, 3, 4, 5, 6, 5, 7, 8));
+			result.Y = (irr::f32)(1.0 / det * q.Det(0, 2, 3, 1, 5, 6, 2, 7, 8));
+			result.Z = (irr::f32)(-1.0 / det * q.Det(0, 1, 3, 1, 4, 6, 2, 5, 8));
+			return q.Error(result);
+		}
+
+		// otherwise the best of the ends and the middle
+		const irr::core::vector3df& p1 = Vertices[v1].Pos;
+		const irr::core::vector3df& p2 = Vertices[v2].Pos;
+		irr::core::vector3df p3 = (p1 + p2) * 0.5f;
+		double e1 = q.Error(p1);
+		double e2 = q.Error(p2);
+		double e3 = q.Error(p3);
+
+		double error = irr::core::min_(e1, e2, e3);
+		if (error == e1)
+			result = p1;
+		else if (error == e2)
+			result = p2;
+		else
+			result = p3;
+
+		return error;
+	}
+
+	void UpdateErrors(Triangle& t)
+	{
+		irr::core::vector3df p;
+		for (int j = 0; j < 3; ++j)
+			t.Error[j] = EdgeError(t.V[j], t.V[(j + 1) % 3], p);
+		t.Error[3] = irr::core::min_(t.Error[0], t.Error[1], t.Error[2]);
+	}
+
+	// Would moving the vertex to p flip or squash any of its other triangles
+	bool Flipped(const irr::core::vector3df& p, irr::u32 other, const Vertex& v,
+		std::vector<bool>& deleted) const
+	{
+		for (irr::u32 k = 0; k < v.RefCount; ++k)
+		{
+			const Ref& ref = Refs[v.RefStart + k];
+			const Triangle& t = Triangles[ref.Triangle];
+			if (t.Deleted)
+				continue;
+
+			irr::u32 id1 = t.V[(ref.Corner + 1) % 3];
+			irr::u32 id2 = t.V[(ref.Corner + 2) % 3];
+
+			// shares the collapsed edge, so it goes away
+			if (id1 == other || id2 == other)
+			{
+				deleted[k] = true;
+				continue;
+			}
+
+			irr::core::vector3df d1 = (Vertices[id1].Pos - p).normalize();
+			irr::core::vector3df d2 = (Vertices[id2].Pos - p).normalize();
+			if (fabs(d1.dotProduct(d2)) > 0.999f)
+				return true;
+
+			irr::core::vector3df n = d1.crossProduct(d2).normalize();
+			deleted[k] = false;
+			if (n.dotProduct(t.Normal) < 0.2f)
+				return true;
+		}
+
+		return false;
+	}
+
+	void UpdateTriangles(irr::u32 i0, const Vertex& v, const std::vector<bool>& deleted,
+		irr::u32& deletedCount)
+	{
+		for (irr::u32 k = 0; k < v.RefCount; ++k)
+		{
+			Ref ref = Refs[v.RefStart + k];
+			Triangle& t = Triangles[ref.Triangle];
+			if (t.Deleted)
+				continue;
+
+			if (deleted[k])
+			{
+				t.Deleted = true;
+				++deletedCount;
+				continue;
+			}
+
+			t.V[ref.Corner] = i0;
+			t.Dirty = true;
+			UpdateErrors(t);
+			Refs.push_back(ref);
+		}
+	}
+
+	void Compact(bool first)
+	{
+		if (!first)
+		{
+			size_t dst = 0;
+			for (size_t i = 0; i < Triangles.size(); ++i)
+			{
+				if (!Triangles[i].Deleted)
+					Triangles[dst++] = Triangles[i];
+			}
+			Triangles.resize(dst);
+		}
+
+		// rebuild the vertex -> triangle references
+		for (size_t i = 0; i < Vertices.size(); ++i)
+		{
+			Vertices[i].RefStart = 0;
+			Vertices[i].RefCount = 0;
+		}
+		for (size_t i = 0; i < Triangles.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+				++Vertices[Triangles[i].V[j]].RefCount;
+		}
+
+		irr::u32 start = 0;
+		for (size_t i = 0; i < Vertices.size(); ++i)
+		{
+			Vertices[i].RefStart = start;
+			start += Vertices[i].RefCount;
+			Vertices[i].RefCount = 0;
+		}
+
+		Refs.resize(Triangles.size() * 3);
+		for (size_t i = 0; i < Triangles.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				Vertex& v = Vertices[Triangles[i].V[j]];
+				Refs[v.RefStart + v.RefCount].Triangle = (irr::u32)i;
+				Refs[v.RefStart + v.RefCount].Corner = j;
+				++v.RefCount;
+			}
+		}
+
+		if (!first)
+			return;
+
+		// an edge used by only one triangle is a border
+		std::vector<irr::u32> counts, ids;
+		for (size_t i = 0; i < Vertices.size(); ++i)
+		{
+			counts.clear();
+			ids.clear();
+
+			const Vertex& v = Vertices[i];
+			for (irr::u32 k = 0; k < v.RefCount; ++k)
+			{
+				const Triangle& t = Triangles[Refs[v.RefStart + k].Triangle];
+				for (int j = 0; j < 3; ++j)
+				{
+					size_t o = 0;
+					while (o < ids.size() && ids[o] != t.V[j])
+						++o;
+
+					if (o == ids.size())
+					{
+						ids.push_back(t.V[j]);
+						counts.push_back(1);
+					}
+					else
+						++counts[o];
+				}
+			}
+
+			for (size_t o = 0; o < ids.size(); ++o)
+			{
+				if (counts[o] == 1)
+				{
+					Vertices[ids[o]].Border = true;
+					Vertices[i].Border = true;
+				}
+			}
+		}
+
+		// planes of the triangles around each vertex
+		for (size_t i = 0; i < Triangles.size(); ++i)
+		{
+			Triangle& t = Triangles[i];
+			const irr::core::vector3df& p0 = Vertices[t.V[0]].Pos;
+			irr::core::vector3df n = (Vertices[t.V[1]].Pos - p0).crossProduct(
+				Vertices[t.V[2]].Pos - p0).normalize();
+			t.Normal = n;
+
+			Quadric q(n.X, n.Y, n.Z, -n.dotProduct(p0));
+			for (int j = 0; j < 3; ++j)
+				Vertices[t.V[j]].Q += q;
+		}
+
+		for (size_t i = 0; i < Triangles.size(); ++i)
+			UpdateErrors(Triangles[i]);
+	}
+};
+
+bool MeshSimplifier::Extract(irr::scene::IMesh* mesh, level_t& level)
+{
+	level.clear();
+	if (!mesh)
+		return false;
+
+	for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+	{
+		irr::scene::IMeshBuffer* meshBuffer = mesh->getMeshBuffer(b);
+		irr::u32 vertexCount = meshBuffer->getVertexCount();
+		if (vertexCount > 0xffff)
+			return false;
+
+		// every vertex type starts with the standard layout
+		level.push_back(Buffer());
+		Buffer& buffer = level.back();
+		buffer.Vertices.resize(vertexCount);
+
+		irr::u32 pitch = irr::video::getVertexPitchFromType(meshBuffer->getVertexType());
+		const irr::u8* vertices = static_cast<const irr::u8*>(meshBuffer->getVertices());
+		for (irr::u32 i = 0; i < vertexCount; ++i)
+			buffer.Vertices[i] = *reinterpret_cast<const irr::video::S3DVertex*>(vertices + i * pitch);
+
+		irr::u32 indexCount = meshBuffer->getIndexCount();
+		buffer.Indices.resize(indexCount);
+		if (meshBuffer->getIndexType() == irr::video::EIT_16BIT)
+		{
+			if (indexCount)
+				memcpy(&buffer.Indices[0], meshBuffer->getIndices(), indexCount * sizeof(irr::u16));
+		}
+		else
+		{
+			const irr::u32* indices = reinterpret_cast<const irr::u32*>(meshBuffer->getIndices());
+			for (irr::u32 i = 0; i < indexCount; ++i)
+				buffer.Indices[i] = (irr::u16)indices[i];
+		}
+	}
+
+	return true;
+}
+
+void MeshSimplifier::BuildLevels(const level_t& source, std::vector<level_t>& levels)
+{
+	levels.clear();
+
+	irr::u32 previous = GetTriangleCount(source);
+	if (previous < MIN_TRIANGLES)
+		return;
+
+	irr::f32 ratio = 0.5f;
+	for (int i = 0; i < MAX_LEVELS; ++i, ratio *= 0.5f)
+	{
+		level_t level;
+		Simplify(source, ratio, level);
+
+		// stop once the borders won't let it get any smaller
+		irr::u32 triangles = GetTriangleCount(level);
+		if (triangles == 0 || triangles > previous * 9 / 10)
+			break;
+
+		levels.push_back(level);
+		previous = triangles;
+	}
+}
+
+void MeshSimplifier::Simplify(const level_t& source, irr::f32 ratio, level_t& result)
+{
+	result.resize(source.size());
+	for (size_t b = 0; b < source.size(); ++b)
+	{
+		irr::u32 triangles = (irr::u32)(source[b].Indices.size() / 3);
+		SimplifyBuffer(source[b], (irr::u32)(triangles * ratio), result[b]);
+	}
+}
+
+void MeshSimplifier::SimplifyBuffer(const Buffer& source, irr::u32 targetTriangles, Buffer& result)
+{
+	Collapser c;
+
+	c.Vertices.resize(source.Vertices.size());
+	for (size_t i = 0; i < source.Vertices.size(); ++i)
+	{
+		c.Vertices[i].Pos = source.Vertices[i].Pos;
+		c.Vertices[i].Border = false;
+	}
+
+	for (size_t i = 0; i + 2 < source.Indices.size(); i += 3)
+	{
+		Triangle t;
+		t.V[0] = source.Indices[i];
+		t.V[1] = source.Indices[i + 1];
+		t.V[2] = source.Indices[i + 2];
+		t.Deleted = false;
+		t.Dirty = false;
+
+		// skip anything degenerate or out of range
+		if (t.V[0] == t.V[1] || t.V[1] == t.V[2] || t.V[0] == t.V[2] ||
+			t.V[0] >= c.Vertices.size() || t.V[1] >= c.Vertices.size() || t.V[2] >= c.Vertices.size())
+			continue;
+
+		c.Triangles.push_back(t);
+	}
+
+	irr::u32 triangleCount = (irr::u32)c.Triangles.size();
+	irr::u32 deletedCount = 0;
+	std::vector<bool> deleted0, deleted1;
+
+	// collapse everything under a rising error threshold until the target is met
+	for (int iteration = 0; iteration < 100 && triangleCount - deletedCount > targetTriangles; ++iteration)
+	{
+		if (iteration % 5 == 0)
+			c.Compact(iteration == 0);
+
+		for (size_t i = 0; i < c.Triangles.size(); ++i)
+			c.Triangles[i].Dirty = false;
+
+		double threshold = 0.000000001 * pow(double(iteration + 3), 7.0);
+
+		for (size_t i = 0; i < c.Triangles.size(); ++i)
+		{
+			Triangle& t = c.Triangles[i];
+			if (t.Error[3] > threshold || t.Deleted || t.Dirty)
+				continue;
+
+			for (int j = 0; j < 3; ++j)
+			{
+				if (t.Error[j] >= threshold)
+					continue;
+
+				irr::u32 i0 = t.V[j];
+				irr::u32 i1 = t.V[(j + 1) % 3];
+				Vertex& v0 = c.Vertices[i0];
+				Vertex& v1 = c.Vertices[i1];
+
+				// borders stay put, they include the texture seams
+				if (v0.Border || v1.Border)
+					continue;
+
+				irr::core::vector3df p;
+				c.EdgeError(i0, i1, p);
+
+				deleted0.assign(v0.RefCount, false);
+				deleted1.assign(v1.RefCount, false);
+				if (c.Flipped(p, i1, v0, deleted0) || c.Flipped(p, i0, v1, deleted1))
+					continue;
+
+				v0.Pos = p;
+				v0.Q += v1.Q;
+
+				irr::u32 refStart = (irr::u32)c.Refs.size();
+				c.UpdateTriangles(i0, v0, deleted0, deletedCount);
+				c.UpdateTriangles(i0, v1, deleted1, deletedCount);
+
+				// reuse the old references when the new ones fit
+				irr::u32 refCount = (irr::u32)c.Refs.size() - refStart;
+				if (refCount <= v0.RefCount)
+				{
+					if (refCount)
+						memmove(&c.Refs[v0.RefStart], &c.Refs[refStart], refCount * sizeof(Ref));
+				}
+				else
+					v0.RefStart = refStart;
+
+				v0.RefCount = refCount;
+				break;
+			}
+
+			if (triangleCount - deletedCount <= targetTriangles)
+				break;
+		}
+	}
+
+	// keep the attributes of the surviving vertices, at their new positions
+	std::vector<irr::s32> remap(c.Vertices.size(), -1);
+	result.Vertices.clear();
+	result.Indices.clear();
+
+	for (size_t i = 0; i < c.Triangles.size(); ++i)
+	{
+		const Triangle& t = c.Triangles[i];
+		if (t.Deleted)
+			continue;
+
+		for (int j = 0; j < 3; ++j)
+		{
+			irr::u32 v = t.V[j];
+			if (remap[v] < 0)
+			{
+				remap[v] = (irr::s32)result.Vertices.size();
+				irr::video::S3DVertex vertex = source.Vertices[v];
+				vertex.Pos = c.Vertices[v].Pos;
+				result.Vertices.push_back(vertex);
+			}
+
+			result.Indices.push_back((irr::u16)remap[v]);
+		}
+	}
+}
+
+irr::scene::SMesh* MeshSimplifier::CreateMesh(const level_t& level, irr::scene::IMesh* source)
+{
+	irr::scene::SMesh* mesh = new irr::scene::SMesh;
+	for (size_t b = 0; b < level.size(); ++b)
+	{
+		irr::scene::SMeshBuffer* buffer = new irr::scene::SMeshBuffer;
+		if (!level[b].Vertices.empty())
+			buffer->append(&level[b].Vertices[0], (irr::u32)level[b].Vertices.size(),
+				&level[b].Indices[0], (irr::u32)level[b].Indices.size());
+
+		if (source && b < source->getMeshBufferCount())
+			buffer->Material = source->getMeshBuffer((irr::u32)b)->getMaterial();
+
+		buffer->recalculateBoundingBox();
+		mesh->addMeshBuffer(buffer);
+		buffer->drop();
+	}
+
+	mesh->setHardwareMappingHint(irr::scene::EHM_STATIC);
+	mesh->recalculateBoundingBox();
+	return mesh;
+}
+
+irr::u32 MeshSimplifier::GetTriangleCount(const level_t& level)
+{
+	irr::u32 count = 0;
+	for (size_t b = 0; b < level.size(); ++b)
+		count += (irr::u32)(level[b].Indices.size() / 3);
+
+	return count;
+}
+
+static void WriteU32(std::vector<irr::u8>& data, irr::u32 value)
+{
+	data.push_back((irr::u8)(value & 0xff));
+	data.push_back((irr::u8)((value >> 8) & 0xff));
+	data.push_back((irr::u8)((value >> 16) & 0xff));
+	data.push_back((irr::u8)((value >> 24) & 0xff));
+}
+
+static void WriteF32(std::vector<irr::u8>& data, irr::f32 value)
+{
+	irr::u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteU32(data, bits);
+}
+
+static bool ReadU32(const irr::u8*& p, const irr::u8* end, irr::u32& value)
+{
+	if (end - p < 4)
+		return false;
+
+	value = (irr::u32)p[0] | ((irr::u32)p[1] << 8) | ((irr::u32)p[2] << 16) | ((irr::u32)p[3] << 24);
+	p += 4;
+	return true;
+}
+
+static bool ReadF32(const irr::u8*& p, const irr::u8* end, irr::f32& value)
+{
+	irr::u32 bits;
+	if (!ReadU32(p, end, bits))
+		return false;
+
+	memcpy(&value, &bits, sizeof(value));
+	return true;
+}
+
+void MeshSimplifier::Save(const std::vector<level_t>& levels, irr::u32 sourceTriangles,
+	std::vector<irr::u8>& data)
+{
+	data.clear();
+	WriteU32(data, LOD_MAGIC);
+	WriteU32(data, LOD_VERSION);
+	WriteU32(data, sourceTriangles);
+	WriteU32(data, (irr::u32)levels.size());
+
+	for (size_t l = 0; l < levels.size(); ++l)
+	{
+		WriteU32(data, (irr::u32)levels[l].size());
+		for (size_t b = 0; b < levels[l].size(); ++b)
+		{
+			const Buffer& buffer = levels[l][b];
+			WriteU32(data, (irr::u32)buffer.Vertices.size());
+			WriteU32(data, (irr::u32)buffer.Indices.size());
+
+			for (size_t v = 0; v < buffer.Vertices.size(); ++v)
+			{
+				const irr::video::S3DVertex& vertex = buffer.Vertices[v];
+				WriteF32(data, vertex.Pos.X);
+				WriteF32(data, vertex.Pos.Y);
+				WriteF32(data, vertex.Pos.Z);
+				WriteF32(data, vertex.Normal.X);
+				WriteF32(data, vertex.Normal.Y);
+				WriteF32(data, vertex.Normal.Z);
+				WriteU32(data, vertex.Color.color);
+				WriteF32(data, vertex.TCoords.X);
+				WriteF32(data, vertex.TCoords.Y);
+			}
+
+			for (size_t i = 0; i < buffer.Indices.size(); ++i)
+			{
+				data.push_back((irr::u8)(buffer.Indices[i] & 0xff));
+				data.push_back((irr::u8)(buffer.Indices[i] >> 8));
+			}
+		}
+	}
+}
+
+bool MeshSimplifier::Load(const irr::u8* data, size_t size, irr::u32 sourceTriangles,
+	std::vector<level_t>& levels)
+{
+	levels.clear();
+
+	const irr::u8* p = data;
+	const irr::u8* end = data + size;
+
+	irr::u32 magic, version, triangles, levelCount;
+	if (!ReadU32(p, end, magic) || magic != LOD_MAGIC ||
+		!ReadU32(p, end, version) || version != LOD_VERSION ||
+		!ReadU32(p, end, triangles) || triangles != sourceTriangles ||
+		!ReadU32(p, end, levelCount) || levelCount > MAX_LEVELS)
+		return false;
+
+	levels.resize(levelCount);
+	for (irr::u32 l = 0; l < levelCount; ++l)
+	{
+		irr::u32 bufferCount;
+		if (!ReadU32(p, end, bufferCount) || bufferCount > 0xffff)
+			return false;
+
+		levels[l].resize(bufferCount);
+		for (irr::u32 b = 0; b < bufferCount; ++b)
+		{
+			Buffer& buffer = levels[l][b];
+			irr::u32 vertexCount, indexCount;
+			if (!ReadU32(p, end, vertexCount) || !ReadU32(p, end, indexCount) ||
+				vertexCount > 0xffff || (size_t)(end - p) < (size_t)vertexCount * 36 + (size_t)indexCount * 2)
+				return false;
+
+			buffer.Vertices.resize(vertexCount);
+			for (irr::u32 v = 0; v < vertexCount; ++v)
+			{
+				irr::video::S3DVertex& vertex = buffer.Vertices[v];
+				ReadF32(p, end, vertex.Pos.X);
+				ReadF32(p, end, vertex.Pos.Y);
+				ReadF32(p, end, vertex.Pos.Z);
+				ReadF32(p, end, vertex.Normal.X);
+				ReadF32(p, end, vertex.Normal.Y);
+				ReadF32(p, end, vertex.Normal.Z);
+				ReadU32(p, end, vertex.Color.color);
+				ReadF32(p, end, vertex.TCoords.X);
+				ReadF32(p, end, vertex.TCoords.Y);
+			}
+
+			buffer.Indices.resize(indexCount);
+			for (irr::u32 i = 0; i < indexCount; ++i, p += 2)
+			{
+				buffer.Indices[i] = (irr::u16)(p[0] | (p[1] << 8));
+				if (buffer.Indices[i] >= vertexCount)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,58 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <vector>
+
+// Quadric edge collapse simplification for building mesh LODs. Meshes are
+// copied out into plain arrays first, so the simplification itself can run
+// on a worker thread. Edges on open borders (including texture seams) are
+// never collapsed, which keeps the silhouette and the UV layout intact.
+class MeshSimplifier
+{
+public:
+	enum
+	{
+		MIN_TRIANGLES = 512, // smaller meshes don't get any LODs
+		MAX_LEVELS = 3,      // besides the full mesh
+	};
+
+	struct Buffer
+	{
+		std::vector<irr::video::S3DVertex> Vertices;
+		std::vector<irr::u16> Indices;
+	};
+
+	typedef std::vector<Buffer> level_t; // one buffer per mesh buffer
+
+	// False if the mesh has vertex or index formats that can't be simplified
+	static bool Extract(irr::scene::IMesh* mesh, level_t& level);
+
+	// Halves the triangle count for each level, stopping early once it
+	// no longer makes a difference; empty if the mesh is too small
+	static void BuildLevels(const level_t& source, std::vector<level_t>& levels);
+
+	static void Simplify(const level_t& source, irr::f32 ratio, level_t& result);
+
+	// A renderable mesh, with the materials of the source mesh
+	static irr::scene::SMesh* CreateMesh(const level_t& level, irr::scene::IMesh* source);
+
+	static irr::u32 GetTriangleCount(const level_t& level);
+
+	// The sidecar stored in packages next to the mesh, as <mesh>.lod
+	static void Save(const std::vector<level_t>& levels, irr::u32 sourceTriangles,
+		std::vector<irr::u8>& data);
+
+	// False if the data is damaged or was built from a different mesh
+	static bool Load(const irr::u8* data, size_t size, irr::u32 sourceTriangles,
+		std::vector<level_t>& levels);
+
+private:
+	static void SimplifyBuffer(const Buffer& source, irr::u32 targetTriangles, Buffer& result);
+};
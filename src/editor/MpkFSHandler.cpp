@@ -5,10 +5,10 @@
 */
 
 #include "MpkFSHandler.hpp"
+#include "VirtualFS.hpp"
 
-#include <wx/config.h>
+#include <wx/filename.h>
 #include <wx/fs_arc.h>
-#include <wx/stdpaths.h>
 
 MpkFSHandler::MpkFSHandler(void)
 {
@@ -18,11 +18,6 @@ MpkFSHandler::~MpkFSHandler(void)
 {
 }
 
-void MpkFSHandler::AddSearchPath(const wxString& path)
-{
-	m_SearchPaths.Add(path);
-}
-
 bool MpkFSHandler::CanOpen(const wxString& location)
 {
 	// providing the archive file can set the filename as the protocol
@@ -38,66 +33,6 @@ bool MpkFSHandler::CanOpen(const wxString& location)
 	return false; // fall through
 }
 
-wxString MpkFSHandler::FindValidPath(const wxString& location)
-{
-	wxString path = location;
-
-	wxFileName fn(path);
-
-	// check if it's in the data directory
-	wxFileName search(wxStandardPaths::Get().GetDataDir(), fn.GetFullName());
-	if (search.FileExists())
-	{
-		path = search.GetFullPath();
-	}
-	else
-	{
-		// check if it's in the executable directory
-		wxFileName exePath(wxStandardPaths::Get().GetExecutablePath());
-		search.Assign(exePath.GetPath(), fn.GetFullName());
-		if (search.FileExists())
-		{
-			path = search.GetFullPath();
-		}
-		else
-		{
-			bool found = false;
-
-			// check all the configured paths
-			wxConfigBase* config = wxConfigBase::Get();
-			if (config) // we might not have a config file
-			{
-				wxString entry;
-				long cookie;
-				wxConfigPathChanger cpc(config, wxT("/Paths/"));
-				if (config->GetFirstEntry(entry, cookie))
-				{
-					do
-					{
-						search.Assign(config->Read(entry), fn.GetFullName());
-						if (search.FileExists())
-						{
-							path = search.GetFullPath();
-							found = true;
-							break;
-						}
-					} while (config->GetNextEntry(entry, cookie));
-				}
-			}
-
-			// check the custom search paths
-			if (!found)
-			{
-				wxString search = m_SearchPaths.FindValidPath(fn.GetFullName());
-				if (!search.empty())
-					path = search;
-			}
-		}
-	}
-
-	return path;
-}
-
 wxFSFile* MpkFSHandler::OpenFile(wxFileSystem& fs, const wxString& location)
 {
 	// providing the archive file can set the filename as the protocol
@@ -121,7 +56,7 @@ wxFSFile* MpkFSHandler::OpenFile(wxFileSystem& fs, const wxString& location)
 	}
 
 	// search for the package
-	wxString path = FindValidPath(loc);
+	wxString path = VirtualFS::Get().ResolvePackage(loc);
 	if (path.empty())
 		path.assign(loc); // just set it to the current dir, maybe it wasn't added as a search path
 
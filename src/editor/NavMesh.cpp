@@ -0,0 +1,731 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "NavMesh.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+static const irr::u32 NAVMESH_MAGIC = 0x56414e4d; // MNAV
+static const irr::u32 NAVMESH_VERSION = 1;
+
+NavMesh::Settings::Settings(void)
+	: CellSize(1.5f), CellHeight(0.5f), AgentHeight(10.0f), AgentRadius(3.0f),
+	  AgentClimb(2.5f), MaxSlope(45.0f), TileCells(48)
+{
+}
+
+bool NavMesh::Settings::operator==(const Settings& other) const
+{
+	return CellSize == other.CellSize && CellHeight == other.CellHeight &&
+		AgentHeight == other.AgentHeight && AgentRadius == other.AgentRadius &&
+		AgentClimb == other.AgentClimb && MaxSlope == other.MaxSlope &&
+		TileCells == other.TileCells;
+}
+
+irr::f32 NavMesh::Polygon::GetHeight(irr::f32 x, irr::f32 z) const
+{
+	irr::f32 u = irr::core::clamp((x - Corners[0].X) / (Corners[2].X - Corners[0].X), 0.0f, 1.0f);
+	irr::f32 v = irr::core::clamp((z - Corners[0].Z) / (Corners[2].Z - Corners[0].Z), 0.0f, 1.0f);
+	irr::f32 front = Corners[0].Y + (Corners[1].Y - Corners[0].Y) * u;
+	irr::f32 back = Corners[3].Y + (Corners[2].Y - Corners[3].Y) * u;
+	return front + (back - front) * v;
+}
+
+irr::core::vector3df NavMesh::Polygon::GetCenter(void) const
+{
+	return (Corners[0] + Corners[1] + Corners[2] + Corners[3]) * 0.25f;
+}
+
+NavMesh::NavMesh(void)
+{
+}
+
+NavMesh::~NavMesh(void)
+{
+}
+
+irr::u64 NavMesh::TileKey(irr::s32 x, irr::s32 z)
+{
+	return ((irr::u64)(irr::u32)x << 32) | (irr::u32)z;
+}
+
+irr::u32 NavMesh::Build(const std::vector<irr::core::triangle3df>& triangles, const Settings& settings)
+{
+	// different settings change every tile
+	if (!(settings == m_Settings))
+	{
+		m_Tiles.clear();
+		m_Settings = settings;
+	}
+
+	// a tile sees the triangles within its border too, so the edges erode
+	// the same way on both sides of a seam
+	irr::f32 tileSize = m_Settings.TileCells * m_Settings.CellSize;
+	irr::f32 border = (ceilf(m_Settings.AgentRadius / m_Settings.CellSize) + 1.0f) * m_Settings.CellSize;
+
+	std::map<irr::u64, std::vector<irr::u32>> binned;
+	for (size_t t = 0; t < triangles.size(); ++t)
+	{
+		const irr::core::triangle3df& tri = triangles[t];
+		irr::f32 minX = irr::core::min_(tri.pointA.X, tri.pointB.X, tri.pointC.X) - border;
+		irr::f32 maxX = irr::core::max_(tri.pointA.X, tri.pointB.X, tri.pointC.X) + border;
+		irr::f32 minZ = irr::core::min_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) - border;
+		irr::f32 maxZ = irr::core::max_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) + border;
+
+		for (irr::s32 z = (irr::s32)floorf(minZ / tileSize); z <= (irr::s32)floorf(maxZ / tileSize); ++z)
+		{
+			for (irr::s32 x = (irr::s32)floorf(minX / tileSize); x <= (irr::s32)floorf(maxX / tileSize); ++x)
+				binned[TileKey(x, z)].push_back((irr::u32)t);
+		}
+	}
+
+	// tiles with nothing under them any more
+	for (tiles_t::iterator tile = m_Tiles.begin(); tile != m_Tiles.end();)
+	{
+		if (binned.find(tile->first) == binned.end())
+			tile = m_Tiles.erase(tile);
+		else
+			++tile;
+	}
+
+	std::vector<irr::u64> dirty;
+	for (std::map<irr::u64, std::vector<irr::u32>>::iterator bin = binned.begin(); bin != binned.end(); ++bin)
+	{
+		// FNV-1a of the triangles in the order they came
+		irr::u64 hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < bin->second.size(); ++i)
+		{
+			const irr::u8* bytes = reinterpret_cast<const irr::u8*>(&triangles[bin->second[i]]);
+			for (size_t b = 0; b < sizeof(irr::core::triangle3df); ++b)
+				hash = (hash ^ bytes[b]) * 1099511628211ULL;
+		}
+
+		tiles_t::iterator tile = m_Tiles.find(bin->first);
+		if (tile != m_Tiles.end() && tile->second.Hash == hash)
+			continue;
+
+		Tile& changed = m_Tiles[bin->first];
+		changed.X = (irr::s32)(bin->first >> 32);
+		changed.Z = (irr::s32)(irr::u32)bin->first;
+		changed.Hash = hash;
+		changed.Polygons.clear();
+		dirty.push_back(bin->first);
+	}
+
+	// the tiles don't share anything while they build
+	WorkerPool workers;
+	for (size_t i = 0; i < dirty.size(); ++i)
+	{
+		const std::vector<irr::u32>& indices = binned[dirty[i]];
+		Tile& tile = m_Tiles[dirty[i]];
+		workers.Submit([this, &triangles, &indices, &tile]()
+		{
+			BuildTile(triangles, indices, tile);
+		});
+	}
+
+	workers.Wait();
+
+	LinkTiles();
+	return (irr::u32)dirty.size();
+}
+
+void NavMesh::Clear(void)
+{
+	m_Tiles.clear();
+	LinkTiles();
+}
+
+namespace
+{
+	struct Span
+	{
+		irr::f32 Min, Max;
+		bool Walkable;
+
+		bool operator<(const Span& other) const { return Min < other.Min; }
+	};
+
+	struct Surface
+	{
+		irr::f32 Y;
+		bool Open; // not eroded or in a polygon yet
+	};
+
+	typedef std::vector<Surface> cell_t;
+
+	// keeps the part of a polygon on one side of an axis aligned line in the
+	// xz plane
+	void Clip(const std::vector<irr::core::vector3df>& in, std::vector<irr::core::vector3df>& out,
+		bool alongX, irr::f32 value, bool keepAbove)
+	{
+		out.clear();
+		for (size_t i = 0; i < in.size(); ++i)
+		{
+			const irr::core::vector3df& a = in[i];
+			const irr::core::vector3df& b = in[(i + 1) % in.size()];
+			irr::f32 da = (alongX ? a.X : a.Z) - value;
+			irr::f32 db = (alongX ? b.X : b.Z) - value;
+			if (!keepAbove)
+			{
+				da = -da;
+				db = -db;
+			}
+
+			if (da >= 0)
+				out.push_back(a);
+			if ((da >= 0) != (db >= 0))
+				out.push_back(a + (b - a) * (da / (da - db)));
+		}
+	}
+
+	// the open surface nearest a height, within a step of it
+	irr::s32 FindSurface(const cell_t& cell, irr::f32 y, irr::f32 climb)
+	{
+		irr::s32 found = -1;
+		irr::f32 nearest = climb;
+		for (size_t s = 0; s < cell.size(); ++s)
+		{
+			irr::f32 d = fabsf(cell[s].Y - y);
+			if (cell[s].Open && d <= nearest)
+			{
+				nearest = d;
+				found = (irr::s32)s;
+			}
+		}
+
+		return found;
+	}
+}
+
+void NavMesh::BuildTile(const std::vector<irr::core::triangle3df>& triangles,
+	const std::vector<irr::u32>& indices, Tile& tile) const
+{
+	const irr::f32 cs = m_Settings.CellSize;
+	const irr::f32 climb = m_Settings.AgentClimb;
+	const irr::s32 erode = (irr::s32)ceilf(m_Settings.AgentRadius / cs);
+	const irr::s32 border = erode + 1;
+	const irr::s32 first = border, last = border + (irr::s32)m_Settings.TileCells; // interior, exclusive
+	const irr::s32 size = (irr::s32)m_Settings.TileCells + border * 2;
+	const irr::f32 x0 = (tile.X * (irr::s32)m_Settings.TileCells - border) * cs;
+	const irr::f32 z0 = (tile.Z * (irr::s32)m_Settings.TileCells - border) * cs;
+	const irr::f32 minNormalY = cosf(m_Settings.MaxSlope * irr::core::DEGTORAD);
+
+	// the solid spans of each column
+	std::vector<std::vector<Span>> columns(size * size);
+	std::vector<irr::core::vector3df> poly, row, cell;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		const irr::core::triangle3df& tri = triangles[indices[i]];
+
+		// either winding, one sided floors are common
+		irr::core::vector3df normal = tri.getNormal();
+		normal.normalize();
+		bool walkable = fabsf(normal.Y) >= minNormalY;
+
+		irr::s32 cx0 = irr::core::max_((irr::s32)floorf((irr::core::min_(tri.pointA.X, tri.pointB.X, tri.pointC.X) - x0) / cs), 0);
+		irr::s32 cx1 = irr::core::min_((irr::s32)floorf((irr::core::max_(tri.pointA.X, tri.pointB.X, tri.pointC.X) - x0) / cs), size - 1);
+		irr::s32 cz0 = irr::core::max_((irr::s32)floorf((irr::core::min_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) - z0) / cs), 0);
+		irr::s32 cz1 = irr::core::min_((irr::s32)floorf((irr::core::max_(tri.pointA.Z, tri.pointB.Z, tri.pointC.Z) - z0) / cs), size - 1);
+
+		std::vector<irr::core::vector3df> source;
+		source.push_back(tri.pointA);
+		source.push_back(tri.pointB);
+		source.push_back(tri.pointC);
+		for (irr::s32 z = cz0; z <= cz1; ++z)
+		{
+			Clip(source, poly, false, z0 + z * cs, true);
+			Clip(poly, row, false, z0 + (z + 1) * cs, false);
+			if (row.empty())
+				continue;
+
+			for (irr::s32 x = cx0; x <= cx1; ++x)
+			{
+				Clip(row, poly, true, x0 + x * cs, true);
+				Clip(poly, cell, true, x0 + (x + 1) * cs, false);
+				if (cell.empty())
+					continue;
+
+				Span span;
+				span.Min = span.Max = cell[0].Y;
+				for (size_t v = 1; v < cell.size(); ++v)
+				{
+					span.Min = irr::core::min_(span.Min, cell[v].Y);
+					span.Max = irr::core::max_(span.Max, cell[v].Y);
+				}
+				span.Walkable = walkable;
+				columns[z * size + x].push_back(span);
+			}
+		}
+	}
+
+	// join the touching spans, the top one decides if it can be walked on,
+	// and keep the tops with room to stand above them
+	std::vector<cell_t> surfaces(size * size);
+	std::vector<Span> merged;
+	for (size_t c = 0; c < columns.size(); ++c)
+	{
+		std::vector<Span>& column = columns[c];
+		std::sort(column.begin(), column.end());
+
+		merged.clear();
+		for (size_t s = 0; s < column.size(); ++s)
+		{
+			if (merged.empty() || column[s].Min > merged.back().Max + m_Settings.CellHeight)
+			{
+				merged.push_back(column[s]);
+				continue;
+			}
+
+			Span& top = merged.back();
+			if (column[s].Max > top.Max + climb)
+				top.Walkable = column[s].Walkable;
+			else if (fabsf(column[s].Max - top.Max) <= climb)
+				top.Walkable = top.Walkable || column[s].Walkable;
+			top.Max = irr::core::max_(top.Max, column[s].Max);
+		}
+
+		for (size_t s = 0; s < merged.size(); ++s)
+		{
+			if (merged[s].Walkable && (s + 1 == merged.size() ||
+				merged[s + 1].Min - merged[s].Max >= m_Settings.AgentHeight))
+			{
+				Surface surface = { merged[s].Max, true };
+				surfaces[c].push_back(surface);
+			}
+		}
+	}
+
+	// keep the agent's radius away from edges and walls
+	static const irr::s32 dx[4] = { -1, 1, 0, 0 };
+	static const irr::s32 dz[4] = { 0, 0, -1, 1 };
+	std::vector<std::pair<irr::s32, size_t>> eroded;
+	for (irr::s32 pass = 0; pass < erode; ++pass)
+	{
+		eroded.clear();
+		for (irr::s32 z = 0; z < size; ++z)
+		{
+			for (irr::s32 x = 0; x < size; ++x)
+			{
+				const cell_t& here = surfaces[z * size + x];
+				for (size_t s = 0; s < here.size(); ++s)
+				{
+					if (!here[s].Open)
+						continue;
+
+					for (int n = 0; n < 4; ++n)
+					{
+						irr::s32 nx = x + dx[n], nz = z + dz[n];
+						if (nx < 0 || nz < 0 || nx >= size || nz >= size ||
+							FindSurface(surfaces[nz * size + nx], here[s].Y, climb) < 0)
+						{
+							eroded.push_back(std::make_pair(z * size + x, s));
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		for (size_t e = 0; e < eroded.size(); ++e)
+			surfaces[eroded[e].first][eroded[e].second].Open = false;
+	}
+
+	// greedy rectangles of surfaces within a step of each other
+	std::vector<irr::s32> rect; // the surface taken in each cell, row by row
+	for (irr::s32 z = first; z < last; ++z)
+	{
+		for (irr::s32 x = first; x < last; ++x)
+		{
+			for (size_t s = 0; s < surfaces[z * size + x].size(); ++s)
+			{
+				if (!surfaces[z * size + x][s].Open)
+					continue;
+
+				irr::f32 lo = surfaces[z * size + x][s].Y, hi = lo;
+				rect.assign(1, (irr::s32)s);
+
+				// across
+				irr::s32 xe = x;
+				while (xe + 1 < last)
+				{
+					irr::f32 prev = surfaces[z * size + xe][rect.back()].Y;
+					irr::s32 next = FindSurface(surfaces[z * size + xe + 1], prev, climb);
+					if (next < 0)
+						break;
+
+					irr::f32 y = surfaces[z * size + xe + 1][next].Y;
+					if (irr::core::max_(hi, y) - irr::core::min_(lo, y) > climb)
+						break;
+
+					lo = irr::core::min_(lo, y);
+					hi = irr::core::max_(hi, y);
+					rect.push_back(next);
+					++xe;
+				}
+
+				// then down whole rows
+				irr::s32 width = xe - x + 1;
+				irr::s32 ze = z;
+				while (ze + 1 < last)
+				{
+					bool fits = true;
+					irr::f32 rowLo = lo, rowHi = hi;
+					for (irr::s32 i = 0; i < width && fits; ++i)
+					{
+						irr::f32 above = surfaces[ze * size + x + i][rect[(ze - z) * width + i]].Y;
+						irr::s32 next = FindSurface(surfaces[(ze + 1) * size + x + i], above, climb);
+						if (next < 0)
+						{
+							fits = false;
+							break;
+						}
+
+						irr::f32 y = surfaces[(ze + 1) * size + x + i][next].Y;
+						if (i > 0 && fabsf(y - surfaces[(ze + 1) * size + x + i - 1][rect.back()].Y) > climb)
+							fits = false;
+
+						rowLo = irr::core::min_(rowLo, y);
+						rowHi = irr::core::max_(rowHi, y);
+						rect.push_back(next);
+					}
+
+					if (!fits || rowHi - rowLo > climb)
+					{
+						rect.resize((ze - z + 1) * width);
+						break;
+					}
+
+					lo = rowLo;
+					hi = rowHi;
+					++ze;
+				}
+
+				for (irr::s32 j = 0; j <= ze - z; ++j)
+				{
+					for (irr::s32 i = 0; i < width; ++i)
+						surfaces[(z + j) * size + x + i][rect[j * width + i]].Open = false;
+				}
+
+				Polygon polygon;
+				irr::f32 px0 = x0 + x * cs, px1 = x0 + (xe + 1) * cs;
+				irr::f32 pz0 = z0 + z * cs, pz1 = z0 + (ze + 1) * cs;
+				irr::s32 lastRow = (ze - z) * width;
+				polygon.Corners[0].set(px0, surfaces[z * size + x][rect[0]].Y, pz0);
+				polygon.Corners[1].set(px1, surfaces[z * size + xe][rect[width - 1]].Y, pz0);
+				polygon.Corners[2].set(px1, surfaces[ze * size + xe][rect[lastRow + width - 1]].Y, pz1);
+				polygon.Corners[3].set(px0, surfaces[ze * size + x][rect[lastRow]].Y, pz1);
+				tile.Polygons.push_back(polygon);
+			}
+		}
+	}
+}
+
+void NavMesh::LinkTiles(void)
+{
+	m_Polygons.clear();
+	m_Links.clear();
+	m_TilePolygons.clear();
+
+	for (tiles_t::iterator tile = m_Tiles.begin(); tile != m_Tiles.end(); ++tile)
+	{
+		std::vector<irr::u32>& indices = m_TilePolygons[tile->first];
+		for (size_t p = 0; p < tile->second.Polygons.size(); ++p)
+		{
+			indices.push_back((irr::u32)m_Polygons.size());
+			m_Polygons.push_back(tile->second.Polygons[p]);
+		}
+	}
+
+	m_Links.resize(m_Polygons.size());
+
+	// polygons only meet those of their own tile and the ones around it
+	for (tiles_t::iterator tile = m_Tiles.begin(); tile != m_Tiles.end(); ++tile)
+	{
+		const std::vector<irr::u32>& own = m_TilePolygons[tile->first];
+		for (irr::s32 z = tile->second.Z - 1; z <= tile->second.Z + 1; ++z)
+		{
+			for (irr::s32 x = tile->second.X - 1; x <= tile->second.X + 1; ++x)
+			{
+				std::map<irr::u64, std::vector<irr::u32>>::const_iterator other =
+					m_TilePolygons.find(TileKey(x, z));
+				if (other == m_TilePolygons.end())
+					continue;
+
+				for (size_t a = 0; a < own.size(); ++a)
+				{
+					for (size_t b = 0; b < other->second.size(); ++b)
+					{
+						// each pair once
+						if (own[a] < other->second[b])
+							Connect(own[a], other->second[b]);
+					}
+				}
+			}
+		}
+	}
+}
+
+void NavMesh::Connect(irr::u32 a, irr::u32 b)
+{
+	const Polygon& pa = m_Polygons[a];
+	const Polygon& pb = m_Polygons[b];
+	irr::f32 epsilon = m_Settings.CellSize * 0.01f;
+
+	irr::core::vector3df portal;
+	irr::f32 lo, hi;
+	if (fabsf(pa.Corners[2].X - pb.Corners[0].X) < epsilon || fabsf(pa.Corners[0].X - pb.Corners[2].X) < epsilon)
+	{
+		lo = irr::core::max_(pa.Corners[0].Z, pb.Corners[0].Z);
+		hi = irr::core::min_(pa.Corners[2].Z, pb.Corners[2].Z);
+		portal.X = fabsf(pa.Corners[2].X - pb.Corners[0].X) < epsilon ? pa.Corners[2].X : pa.Corners[0].X;
+		portal.Z = (lo + hi) * 0.5f;
+	}
+	else if (fabsf(pa.Corners[2].Z - pb.Corners[0].Z) < epsilon || fabsf(pa.Corners[0].Z - pb.Corners[2].Z) < epsilon)
+	{
+		lo = irr::core::max_(pa.Corners[0].X, pb.Corners[0].X);
+		hi = irr::core::min_(pa.Corners[2].X, pb.Corners[2].X);
+		portal.Z = fabsf(pa.Corners[2].Z - pb.Corners[0].Z) < epsilon ? pa.Corners[2].Z : pa.Corners[0].Z;
+		portal.X = (lo + hi) * 0.5f;
+	}
+	else
+		return;
+
+	if (hi - lo < epsilon)
+		return;
+
+	// the edges have to line up in height as well
+	irr::f32 ya = pa.GetHeight(portal.X, portal.Z);
+	irr::f32 yb = pb.GetHeight(portal.X, portal.Z);
+	if (fabsf(ya - yb) > m_Settings.AgentClimb)
+		return;
+
+	portal.Y = irr::core::max_(ya, yb);
+
+	Link link;
+	link.Portal = portal;
+	link.Target = b;
+	m_Links[a].push_back(link);
+	link.Target = a;
+	m_Links[b].push_back(link);
+}
+
+irr::s32 NavMesh::FindPolygon(const irr::core::vector3df& point) const
+{
+	irr::f32 tileSize = m_Settings.TileCells * m_Settings.CellSize;
+	irr::s32 tx = (irr::s32)floorf(point.X / tileSize);
+	irr::s32 tz = (irr::s32)floorf(point.Z / tileSize);
+
+	// the floor under the point, or the nearest beside it if the point is
+	// in the margin kept from the walls
+	irr::f32 reach = m_Settings.AgentRadius + m_Settings.CellSize * 2.0f;
+	irr::s32 found = -1;
+	irr::f32 nearest = std::numeric_limits<irr::f32>::max();
+	for (irr::s32 z = tz - 1; z <= tz + 1; ++z)
+	{
+		for (irr::s32 x = tx - 1; x <= tx + 1; ++x)
+		{
+			std::map<irr::u64, std::vector<irr::u32>>::const_iterator tile = m_TilePolygons.find(TileKey(x, z));
+			if (tile == m_TilePolygons.end())
+				continue;
+
+			for (size_t i = 0; i < tile->second.size(); ++i)
+			{
+				const Polygon& polygon = m_Polygons[tile->second[i]];
+				irr::f32 cx = irr::core::clamp(point.X, polygon.Corners[0].X, polygon.Corners[2].X);
+				irr::f32 cz = irr::core::clamp(point.Z, polygon.Corners[0].Z, polygon.Corners[2].Z);
+				irr::f32 across = irr::core::vector2df(point.X - cx, point.Z - cz).getLength();
+				irr::f32 below = point.Y - polygon.GetHeight(cx, cz);
+				if (across > reach || below < -m_Settings.AgentClimb)
+					continue;
+
+				irr::f32 distance = across * across + below * below;
+				if (distance < nearest)
+				{
+					nearest = distance;
+					found = (irr::s32)tile->second[i];
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+bool NavMesh::FindPath(const irr::core::vector3df& start, const irr::core::vector3df& end,
+	std::vector<irr::core::vector3df>& path) const
+{
+	path.clear();
+
+	irr::s32 from = FindPolygon(start);
+	irr::s32 to = FindPolygon(end);
+	if (from < 0 || to < 0)
+		return false;
+
+	// A* over the polygons, each entered through the middle of an edge
+	const Polygon& goalPolygon = m_Polygons[to];
+	irr::core::vector3df goal(irr::core::clamp(end.X, goalPolygon.Corners[0].X, goalPolygon.Corners[2].X), 0,
+		irr::core::clamp(end.Z, goalPolygon.Corners[0].Z, goalPolygon.Corners[2].Z));
+	goal.Y = goalPolygon.GetHeight(goal.X, goal.Z);
+
+	const Polygon& startPolygon = m_Polygons[from];
+	irr::core::vector3df origin(irr::core::clamp(start.X, startPolygon.Corners[0].X, startPolygon.Corners[2].X), 0,
+		irr::core::clamp(start.Z, startPolygon.Corners[0].Z, startPolygon.Corners[2].Z));
+	origin.Y = startPolygon.GetHeight(origin.X, origin.Z);
+
+	std::vector<irr::f32> cost(m_Polygons.size(), std::numeric_limits<irr::f32>::max());
+	std::vector<irr::s32> parent(m_Polygons.size(), -1);
+	std::vector<irr::core::vector3df> entry(m_Polygons.size());
+
+	typedef std::pair<irr::f32, irr::u32> open_t;
+	std::priority_queue<open_t, std::vector<open_t>, std::greater<open_t>> open;
+	cost[from] = 0;
+	entry[from] = origin;
+	open.push(open_t(origin.getDistanceFrom(goal), (irr::u32)from));
+
+	bool reached = false;
+	while (!open.empty())
+	{
+		open_t current = open.top();
+		open.pop();
+
+		irr::u32 polygon = current.second;
+		if (polygon == (irr::u32)to)
+		{
+			reached = true;
+			break;
+		}
+
+		// stale, a cheaper way here was queued since
+		if (current.first > cost[polygon] + entry[polygon].getDistanceFrom(goal) + 0.001f)
+			continue;
+
+		const std::vector<Link>& links = m_Links[polygon];
+		for (size_t l = 0; l < links.size(); ++l)
+		{
+			irr::f32 next = cost[polygon] + entry[polygon].getDistanceFrom(links[l].Portal);
+			if (next < cost[links[l].Target])
+			{
+				cost[links[l].Target] = next;
+				parent[links[l].Target] = (irr::s32)polygon;
+				entry[links[l].Target] = links[l].Portal;
+				open.push(open_t(next + links[l].Portal.getDistanceFrom(goal), links[l].Target));
+			}
+		}
+	}
+
+	if (!reached)
+		return false;
+
+	path.push_back(end);
+	path.push_back(goal);
+	for (irr::s32 polygon = to; polygon != from; polygon = parent[polygon])
+		path.push_back(entry[polygon]);
+	path.push_back(origin);
+	path.push_back(start);
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+namespace
+{
+	template <typename T> void Put(std::vector<irr::u8>& data, const T& value)
+	{
+		const irr::u8* bytes = reinterpret_cast<const irr::u8*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T> bool Get(const irr::u8*& data, const irr::u8* end, T& value)
+	{
+		if ((size_t)(end - data) < sizeof(T))
+			return false;
+
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+}
+
+void NavMesh::Write(std::vector<irr::u8>& data) const
+{
+	Put(data, NAVMESH_MAGIC);
+	Put(data, NAVMESH_VERSION);
+	Put(data, m_Settings.CellSize);
+	Put(data, m_Settings.CellHeight);
+	Put(data, m_Settings.AgentHeight);
+	Put(data, m_Settings.AgentRadius);
+	Put(data, m_Settings.AgentClimb);
+	Put(data, m_Settings.MaxSlope);
+	Put(data, m_Settings.TileCells);
+
+	Put(data, (irr::u32)m_Tiles.size());
+	for (tiles_t::const_iterator tile = m_Tiles.begin(); tile != m_Tiles.end(); ++tile)
+	{
+		Put(data, tile->second.X);
+		Put(data, tile->second.Z);
+		Put(data, tile->second.Hash);
+		Put(data, (irr::u32)tile->second.Polygons.size());
+		for (size_t p = 0; p < tile->second.Polygons.size(); ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				Put(data, tile->second.Polygons[p].Corners[c].X);
+				Put(data, tile->second.Polygons[p].Corners[c].Y);
+				Put(data, tile->second.Polygons[p].Corners[c].Z);
+			}
+		}
+	}
+}
+
+bool NavMesh::Read(const irr::u8* data, size_t size)
+{
+	const irr::u8* end = data + size;
+
+	irr::u32 magic, version, tileCount;
+	Settings settings;
+	if (!Get(data, end, magic) || magic != NAVMESH_MAGIC ||
+		!Get(data, end, version) || version != NAVMESH_VERSION ||
+		!Get(data, end, settings.CellSize) || !Get(data, end, settings.CellHeight) ||
+		!Get(data, end, settings.AgentHeight) || !Get(data, end, settings.AgentRadius) ||
+		!Get(data, end, settings.AgentClimb) || !Get(data, end, settings.MaxSlope) ||
+		!Get(data, end, settings.TileCells) || !Get(data, end, tileCount))
+		return false;
+
+	tiles_t tiles;
+	for (irr::u32 t = 0; t < tileCount; ++t)
+	{
+		Tile tile;
+		irr::u32 count;
+		if (!Get(data, end, tile.X) || !Get(data, end, tile.Z) ||
+			!Get(data, end, tile.Hash) || !Get(data, end, count) ||
+			(size_t)(end - data) < count * sizeof(irr::f32) * 12)
+			return false;
+
+		tile.Polygons.resize(count);
+		for (irr::u32 p = 0; p < count; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				Get(data, end, tile.Polygons[p].Corners[c].X);
+				Get(data, end, tile.Polygons[p].Corners[c].Y);
+				Get(data, end, tile.Polygons[p].Corners[c].Z);
+			}
+		}
+
+		tiles[TileKey(tile.X, tile.Z)] = std::move(tile);
+	}
+
+	m_Settings = settings;
+	m_Tiles.swap(tiles);
+	LinkTiles();
+	return true;
+}
@@ -0,0 +1,100 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <map>
+#include <vector>
+
+// The walkable surface of a map as convex polygons, split into square tiles.
+// Each tile voxelizes the triangles under it, keeps the tops of the spans an
+// agent fits on and merges them into quads. A tile remembers a hash of its
+// triangles, so building again only redoes the tiles whose geometry changed.
+class NavMesh
+{
+public:
+	struct Settings
+	{
+		irr::f32 CellSize;      // of the voxels across
+		irr::f32 CellHeight;    // gap that still joins two spans
+		irr::f32 AgentHeight;
+		irr::f32 AgentRadius;
+		irr::f32 AgentClimb;    // step an agent walks up
+		irr::f32 MaxSlope;      // degrees
+		irr::u32 TileCells;     // cells along a tile's side
+
+		Settings(void);
+
+		bool operator==(const Settings& other) const;
+	};
+
+	struct Polygon
+	{
+		// corners at (min x, min z), (max x, min z), (max x, max z) and (min x, max z)
+		irr::core::vector3df Corners[4];
+
+		irr::f32 GetHeight(irr::f32 x, irr::f32 z) const;
+		irr::core::vector3df GetCenter(void) const;
+	};
+
+private:
+	struct Tile
+	{
+		irr::s32 X, Z;
+		irr::u64 Hash;
+		std::vector<Polygon> Polygons;
+	};
+
+	struct Link
+	{
+		irr::u32 Target;
+		irr::core::vector3df Portal; // middle of the shared edge
+	};
+
+	typedef std::map<irr::u64, Tile> tiles_t;
+
+	Settings m_Settings;
+	tiles_t m_Tiles;
+
+	// every tile's polygons in one list, with the polygons each one joins
+	std::vector<Polygon> m_Polygons;
+	std::vector<std::vector<Link>> m_Links;
+	std::map<irr::u64, std::vector<irr::u32>> m_TilePolygons;
+
+public:
+	NavMesh(void);
+	~NavMesh(void);
+
+	// Rebuilds the tiles whose triangles changed on all cores, triangles in
+	// world space. Returns the number of tiles built.
+	irr::u32 Build(const std::vector<irr::core::triangle3df>& triangles, const Settings& settings);
+
+	void Clear(void);
+	bool IsEmpty(void) const { return m_Tiles.empty(); }
+
+	const Settings& GetSettings(void) const { return m_Settings; }
+	const std::vector<Polygon>& GetPolygons(void) const { return m_Polygons; }
+
+	// The polygon an agent at the point stands on, -1 if there's none near
+	irr::s32 FindPolygon(const irr::core::vector3df& point) const;
+
+	// Walks from start to end through the middles of the edges crossed.
+	// False if the end can't be reached.
+	bool FindPath(const irr::core::vector3df& start, const irr::core::vector3df& end,
+		std::vector<irr::core::vector3df>& path) const;
+
+	void Write(std::vector<irr::u8>& data) const;
+	bool Read(const irr::u8* data, size_t size);
+
+private:
+	static irr::u64 TileKey(irr::s32 x, irr::s32 z);
+	void BuildTile(const std::vector<irr::core::triangle3df>& triangles,
+		const std::vector<irr::u32>& indices, Tile& tile) const;
+	void LinkTiles(void);
+	void Connect(irr::u32 a, irr::u32 b);
+};
@@ -4,7 +4,11 @@
 * Copyright (c) 2023 James Kinnaird
 */
 
+#include "Lightmapper.hpp"
+#include "NavMesh.hpp"
 #include "Preferences.hpp"
+#include "ResolutionScaler.hpp"
+#include "TextureResidency.hpp"
 
 #include <wx/config.h>
 #include <wx/filename.h>
@@ -48,6 +52,39 @@ PreferencesWindow::PreferencesWindow(wxWindow* parent)
 		} while (config->GetNextEntry(entry, cookie));
 	}
 
+	// rendering, picked up by views opened afterwards
+	generalPage->Append(new wxPropertyCategory("Rendering"));
+	generalPage->Append(new wxIntProperty(_("Texture budget (MB)"), wxT("/Rendering/TextureBudget"),
+		config->ReadLong(wxT("/Rendering/TextureBudget"), TextureResidency::DEFAULT_BUDGET)));
+	generalPage->Append(new wxIntProperty(_("Frame time budget (ms)"), wxT("/Rendering/FrameBudget"),
+		config->ReadLong(wxT("/Rendering/FrameBudget"), ResolutionScaler::DEFAULT_BUDGET)));
+
+	// lightmap baking, read each time lighting is recomputed
+	Lightmapper::Settings lighting;
+	generalPage->Append(new wxPropertyCategory("Lighting"));
+	generalPage->Append(new wxFloatProperty(_("Lightmap texels per unit"), wxT("/Lighting/TexelsPerUnit"),
+		config->ReadDouble(wxT("/Lighting/TexelsPerUnit"), lighting.TexelsPerUnit)));
+	generalPage->Append(new wxIntProperty(_("Largest lightmap"), wxT("/Lighting/MaxSize"),
+		config->ReadLong(wxT("/Lighting/MaxSize"), lighting.MaxSize)));
+	generalPage->Append(new wxIntProperty(_("Bounce rays per texel"), wxT("/Lighting/Samples"),
+		config->ReadLong(wxT("/Lighting/Samples"), lighting.Samples)));
+	generalPage->Append(new wxFloatProperty(_("Surface reflectance"), wxT("/Lighting/Reflectance"),
+		config->ReadDouble(wxT("/Lighting/Reflectance"), lighting.Reflectance)));
+
+	// navigation mesh, a change rebuilds every tile
+	NavMesh::Settings navigation;
+	generalPage->Append(new wxPropertyCategory("Navigation"));
+	generalPage->Append(new wxFloatProperty(_("Voxel size"), wxT("/Navigation/CellSize"),
+		config->ReadDouble(wxT("/Navigation/CellSize"), navigation.CellSize)));
+	generalPage->Append(new wxFloatProperty(_("Agent height"), wxT("/Navigation/AgentHeight"),
+		config->ReadDouble(wxT("/Navigation/AgentHeight"), navigation.AgentHeight)));
+	generalPage->Append(new wxFloatProperty(_("Agent radius"), wxT("/Navigation/AgentRadius"),
+		config->ReadDouble(wxT("/Navigation/AgentRadius"), navigation.AgentRadius)));
+	generalPage->Append(new wxFloatProperty(_("Agent step height"), wxT("/Navigation/AgentClimb"),
+		config->ReadDouble(wxT("/Navigation/AgentClimb"), navigation.AgentClimb)));
+	generalPage->Append(new wxFloatProperty(_("Steepest walkable slope"), wxT("/Navigation/MaxSlope"),
+		config->ReadDouble(wxT("/Navigation/MaxSlope"), navigation.MaxSlope)));
+
 	sizer->Add(m_Properties, wxSizerFlags(9).Expand());
 	sizer->Add(CreateSeparatedButtonSizer(wxOK | wxCANCEL | wxAPPLY),
 		wxSizerFlags(1).Expand());
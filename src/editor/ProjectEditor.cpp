@@ -9,6 +9,7 @@
 #include "MainWindow.hpp"
 #include "ProjectEditor.hpp"
 #include "ScriptEditor.hpp"
+#include "TextureTranscoder.hpp"
 
 #include <wx/accel.h>
 #include <wx/busyinfo.h>
@@ -144,6 +145,11 @@ ProjectEditor::ProjectEditor(MainWindow* parent, wxMenu* editMenu,
 		return;
 	}
 
+	// read the textures transcoded by package builds
+	irr::video::IImageLoader* ddsLoader = new DDSImageLoader(m_RenderDevice->getVideoDriver());
+	m_RenderDevice->getVideoDriver()->addExternalImageLoader(ddsLoader);
+	ddsLoader->drop();
+
 	m_Browser->SetRenderDevice(m_RenderDevice);
 
 	Load(m_FileName);
@@ -55,6 +55,12 @@ public:
 	 */
 	const wxFileName& GetFileName(void) { return m_FileName; }
 
+	/**
+	 * @brief Get the render device used for loading assets
+	 * @return Pointer to the Irrlicht device
+	 */
+	irr::IrrlichtDevice* GetRenderDevice(void) { return m_RenderDevice; }
+
 	/**
 	 * @brief Open a new editor window for the specified file
 	 * @param fileName Path to the file to open
@@ -4,11 +4,17 @@
 * Copyright (c) 2023 James Kinnaird
 */
 
+#include "CollisionShape.hpp"
 #include "Common.hpp"
+#include "FSHandler.hpp"
+#include "MappedFile.hpp"
 #include "ProjectEditor.hpp"
 #include "ProjectExplorer.hpp"
 #include "Serialize.hpp"
+#include "TextureTranscoder.hpp"
+#include "WorkerPool.hpp"
 
+#include <wx/file.h>
 #include <wx/filedlg.h>
 #include <wx/log.h>
 #include <wx/menu.h>
@@ -21,12 +27,20 @@
 #include <wx/xml/xml.h>
 #include <wx/zipstrm.h>
 
+#include <memory>
+#include <vector>
+
 #define XML_PROJECT_NAME	"ManifoldProject"
 #define XML_PACKAGE_NAME	"Package"
 #define XML_FILTER_NAME		"Filter"
 #define XML_FILE_NAME		"File"
 #define XML_MAP_NAME		"Map"
 
+// hot asset types that are stored uncompressed and page aligned so they can be
+// read straight from the mapped package; these formats barely deflate anyway
+#define DEFAULT_STORE_TYPES	"jpg;jpeg;png;dds;ogg;mp3;wav"
+#define PACKAGE_ALIGNMENT	4096
+
 class TreeItemData : public wxTreeItemData
 {
 public:
@@ -41,9 +55,11 @@ public:
 
 	wxFileName m_FileName;
 	wxString m_Filter;
+	wxString m_StoreTypes; // packages only
+	wxString m_TranscodeTypes; // packages only, none by default
 
 public:
-	TreeItemData(NODE_TYPE type) : m_Type(type) {}
+	TreeItemData(NODE_TYPE type) : m_Type(type), m_StoreTypes(wxT(DEFAULT_STORE_TYPES)) {}
 	~TreeItemData(void)	{}
 };
 
@@ -71,6 +87,7 @@ ProjectExplorer::ProjectExplorer(ProjectEditor* parent)
 	Bind(wxEVT_MENU, &ProjectExplorer::OnMenuCleanPackage, this, MENU_CLEANPACKAGE);
 	Bind(wxEVT_MENU, &ProjectExplorer::OnMenuOpenFile, this, MENU_OPENFILE);
 	Bind(wxEVT_MENU, &ProjectExplorer::OnMenuRemove, this, MENU_REMOVE);
+	Bind(wxEVT_MENU, &ProjectExplorer::OnMenuProperties, this, MENU_PROPERTIES);
 }
 
 ProjectExplorer::~ProjectExplorer(void)
@@ -109,6 +126,9 @@ void ProjectExplorer::Save(const wxFileName& fileName)
 
 			wxXmlNode* pkgNode = new wxXmlNode(root, wxXML_ELEMENT_NODE, XML_PACKAGE_NAME);
 			pkgNode->AddAttribute("Path", itemData->m_FileName.GetFullPath());
+			pkgNode->AddAttribute("Store", itemData->m_StoreTypes);
+			if (!itemData->m_TranscodeTypes.empty())
+				pkgNode->AddAttribute("Transcode", itemData->m_TranscodeTypes);
 
 			wxTreeItemIdValue filterCookie;
 			wxTreeItemId filter = m_Explorer->GetFirstChild(treeItem, filterCookie);
@@ -192,6 +212,8 @@ void ProjectExplorer::Load(const wxFileName& fileName)
 				wxXmlNode* packageNode = child;
 				TreeItemData* data = new TreeItemData(TreeItemData::NODE_PACKAGE);
 				data->m_FileName = packageNode->GetAttribute("Path");
+				data->m_StoreTypes = packageNode->GetAttribute("Store", wxT(DEFAULT_STORE_TYPES));
+				data->m_TranscodeTypes = packageNode->GetAttribute("Transcode", wxEmptyString);
 				wxTreeItemId packageId = m_Explorer->AppendItem(m_Root, data->m_FileName.GetFullName(),
 					-1, -1, data);
 
@@ -318,6 +340,45 @@ void ProjectExplorer::OnNewZipPackage(const wxFileName& fileName)
 	Save(data->m_FileName);
 }
 
+// Store an entry uncompressed with its data on a page boundary, so the
+// package can be read from a mapping without copies
+static void AlignEntry(wxZipOutputStream& outStream, wxOutputStream& file, wxZipEntry* entry)
+{
+	entry->SetMethod(wxZIP_METHOD_STORE);
+
+	// pad the local header so the data starts on a page boundary. The
+	// header is written where the previous entry ended, with the name in
+	// UTF-8 like the package stream writes it (flagged when it isn't ASCII).
+	outStream.CloseEntry();
+	size_t headerSize = 30 + strlen(entry->GetName(wxPATH_UNIX).mb_str(wxConvUTF8)) + 6;
+	size_t padding = (PACKAGE_ALIGNMENT -
+		(size_t)((file.TellO() + headerSize) % PACKAGE_ALIGNMENT)) % PACKAGE_ALIGNMENT;
+
+	// the same alignment extra field that Android's zipalign writes
+	std::vector<char> extra(6 + padding, 0);
+	extra[0] = (char)0x35;
+	extra[1] = (char)0xd9;
+	extra[2] = (char)((extra.size() - 4) & 0xff);
+	extra[3] = (char)((extra.size() - 4) >> 8);
+	extra[4] = (char)(PACKAGE_ALIGNMENT & 0xff);
+	extra[5] = (char)(PACKAGE_ALIGNMENT >> 8);
+	entry->SetLocalExtra(&extra[0], extra.size());
+}
+
+static bool ReadWholeFile(const wxString& path, std::vector<irr::u8>& data)
+{
+	wxFile file;
+	if (!wxFile::Exists(path) || !file.Open(path))
+		return false;
+
+	wxFileOffset length = file.Length();
+	if (length <= 0)
+		return false;
+
+	data.resize((size_t)length);
+	return file.Read(&data[0], data.size()) == (ssize_t)data.size();
+}
+
 void ProjectExplorer::BuildPackage(const wxTreeItemId& package)
 {
 	// move the working directory to the project file location
@@ -336,10 +397,38 @@ void ProjectExplorer::BuildPackage(const wxTreeItemId& package)
 	if (!tempFile.IsOk())
 		return;
 
-	wxZipOutputStream outStream(tempFile);
+	// names are UTF-8, AlignEntry measures them the same way
+	wxZipOutputStream outStream(tempFile, -1, wxConvUTF8);
 	if (!outStream.IsOk())
 		return;
 
+	wxArrayString storeTypes = wxSplit(data->m_StoreTypes.Lower(), wxT(';'));
+	wxArrayString transcodeTypes = wxSplit(data->m_TranscodeTypes.Lower(), wxT(';'));
+
+	// mesh LODs are simplified in the background while the other files are added
+	struct Sidecar
+	{
+		wxString Name;
+		irr::u32 SourceTriangles;
+		MeshSimplifier::level_t Source;
+		std::vector<irr::u8> Data;
+		std::vector<irr::u8> Collision;
+	};
+	std::vector<std::shared_ptr<Sidecar>> sidecars;
+
+	// textures are transcoded the same way, unless an earlier build of the
+	// same source is in the cache
+	struct Texture
+	{
+		wxString Name;
+		wxFileName CacheName;
+		TextureTranscoder::Image Source;
+		std::vector<irr::u8> Data;
+	};
+	std::vector<std::shared_ptr<Texture>> textures;
+
+	WorkerPool workers;
+
 	wxTreeItemIdValue filterCookie;
 	wxTreeItemId filter = m_Explorer->GetFirstChild(package, filterCookie);
 	while (filter.IsOk())
@@ -360,14 +449,71 @@ void ProjectExplorer::BuildPackage(const wxTreeItemId& package)
 				destPath.append(fileData->m_FileName.GetFullName());
 			}
 			
-			wxLogMessage(_("Adding %s -> %s"), fileData->m_FileName.GetFullPath(),
-				destPath);
+			// the transcoded texture is stored under the source's name, so every
+			// lookup finds it as it is and the DDS loader knows it by its header
+			std::shared_ptr<Texture> texture;
+			std::vector<irr::u8> source;
+			if (transcodeTypes.Index(fileData->m_FileName.GetExt().Lower()) != wxNOT_FOUND &&
+				ReadWholeFile(fileData->m_FileName.GetFullPath(), source))
+			{
+				texture.reset(new Texture);
+				texture->Name = destPath;
+				texture->CacheName = CacheFileName(wxString::Format(wxT("%016") wxLongLongFmtSpec wxT("x.dds"),
+					(wxULongLong_t)TextureTranscoder::Hash(&source[0], source.size())), wxT("textures"));
+
+				if (ReadWholeFile(texture->CacheName.GetFullPath(), texture->Data) &&
+					TextureTranscoder::IsTranscoded(&texture->Data[0], texture->Data.size()))
+					wxLogMessage(_("Transcoding %s (cached)"), fileData->m_FileName.GetFullPath());
+				else if (ExtractTexture(fileData->m_FileName, source, texture->Source))
+				{
+					wxLogMessage(_("Transcoding %s"), fileData->m_FileName.GetFullPath());
+					workers.Submit([texture]()
+					{
+						TextureTranscoder::Transcode(texture->Source, texture->Data);
+						texture->Source.Pixels.clear();
+
+						wxTempFile cacheFile(texture->CacheName.GetFullPath());
+						if (cacheFile.IsOpened() && cacheFile.Write(&texture->Data[0], texture->Data.size()))
+							cacheFile.Commit();
+					});
+				}
+				else
+					texture.reset(); // not an image after all, stored as it is
+			}
+
+			if (texture)
+				textures.push_back(texture);
+			else
+				wxLogMessage(_("Adding %s -> %s"), fileData->m_FileName.GetFullPath(),
+					destPath);
 
 			wxFileInputStream srcFile(fileData->m_FileName.GetFullPath());
-			if (srcFile.IsOk())
+			if (!texture && srcFile.IsOk())
 			{
-				if (outStream.PutNextEntry(destPath))
+				wxZipEntry* entry = new wxZipEntry(destPath);
+				if (storeTypes.Index(fileData->m_FileName.GetExt().Lower()) != wxNOT_FOUND)
+					AlignEntry(outStream, tempFile, entry);
+
+				if (outStream.PutNextEntry(entry))
 					outStream.Write(srcFile);
+
+				std::shared_ptr<Sidecar> sidecar(new Sidecar);
+				sidecar->Name = destPath;
+				bool extracted = ExtractMesh(fileData->m_FileName, sidecar->Source, sidecar->Collision);
+				if (extracted || !sidecar->Collision.empty())
+					sidecars.push_back(sidecar);
+
+				if (extracted)
+				{
+					sidecar->SourceTriangles = MeshSimplifier::GetTriangleCount(sidecar->Source);
+					workers.Submit([sidecar]()
+					{
+						std::vector<MeshSimplifier::level_t> levels;
+						MeshSimplifier::BuildLevels(sidecar->Source, levels);
+						if (!levels.empty())
+							MeshSimplifier::Save(levels, sidecar->SourceTriangles, sidecar->Data);
+					});
+				}
 			}
 
 			file = m_Explorer->GetNextChild(filter, fileCookie);
@@ -376,13 +522,111 @@ void ProjectExplorer::BuildPackage(const wxTreeItemId& package)
 		filter = m_Explorer->GetNextChild(package, filterCookie);
 	}
 
+	workers.Wait();
+	for (size_t i = 0; i < sidecars.size(); ++i)
+	{
+		// collision shapes are stored so the editor can use them in place
+		if (!sidecars[i]->Collision.empty())
+		{
+			wxLogMessage(_("Adding %s.col"), sidecars[i]->Name);
+			wxZipEntry* entry = new wxZipEntry(sidecars[i]->Name + wxT(".col"));
+			AlignEntry(outStream, tempFile, entry);
+			if (outStream.PutNextEntry(entry))
+				outStream.Write(&sidecars[i]->Collision[0], sidecars[i]->Collision.size());
+		}
+
+		if (sidecars[i]->Data.empty())
+			continue; // too small to need any levels
+
+		wxLogMessage(_("Adding %s.lod"), sidecars[i]->Name);
+		if (outStream.PutNextEntry(sidecars[i]->Name + wxT(".lod")))
+			outStream.Write(&sidecars[i]->Data[0], sidecars[i]->Data.size());
+	}
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		// stored so the loader can decode them straight out of the mapping
+		wxLogMessage(_("Adding %s"), textures[i]->Name);
+		wxZipEntry* entry = new wxZipEntry(textures[i]->Name);
+		AlignEntry(outStream, tempFile, entry);
+		if (outStream.PutNextEntry(entry))
+			outStream.Write(&textures[i]->Data[0], textures[i]->Data.size());
+	}
+
 	outStream.Close();
+
+	// let go of the old package if it's mapped, or it can't be replaced
+	MappedArchive::Release(packageName.GetFullPath());
 	tempFile.Commit();
 
 	wxSetWorkingDirectory(oldWorkingPath);
 	wxLogMessage(_("Finished building package %s"), packageName.GetFullPath());
 }
 
+bool ProjectExplorer::ExtractMesh(const wxFileName& fileName, MeshSimplifier::level_t& level,
+	std::vector<irr::u8>& collision)
+{
+	irr::IrrlichtDevice* device = m_Editor->GetRenderDevice();
+	if (!device)
+		return false;
+
+	// only files one of the mesh loaders understands
+	irr::scene::ISceneManager* sceneMgr = device->getSceneManager();
+	irr::io::path path(fileName.GetFullPath().c_str().AsChar());
+	bool loadable = false;
+	for (irr::u32 i = 0; i < sceneMgr->getMeshLoaderCount() && !loadable; ++i)
+		loadable = sceneMgr->getMeshLoader(i)->isALoadableFileExtension(path);
+
+	if (!loadable)
+		return false;
+
+	// an open map may be using the mesh already, leave the cache as it was
+	bool cached = sceneMgr->getMeshCache()->isMeshLoaded(path);
+	irr::scene::IAnimatedMesh* mesh = sceneMgr->getMesh(path);
+	if (!mesh)
+		return false;
+
+	// animated models are drawn at full detail and keep the engine's selector
+	bool extracted = false;
+	if (mesh->getFrameCount() <= 1)
+	{
+		extracted = MeshSimplifier::Extract(mesh->getMesh(0), level);
+
+		// built even when the mesh is too big to simplify, those gain the most
+		std::shared_ptr<const CollisionShape> shape = CollisionShape::Build(mesh->getMesh(0));
+		if (shape)
+			collision = shape->GetData();
+	}
+
+	// nothing else needs it once the package is built
+	if (!cached)
+		sceneMgr->getMeshCache()->removeMesh(mesh);
+	return extracted;
+}
+
+bool ProjectExplorer::ExtractTexture(const wxFileName& fileName, std::vector<irr::u8>& source,
+	TextureTranscoder::Image& image)
+{
+	irr::IrrlichtDevice* device = m_Editor->GetRenderDevice();
+	if (!device)
+		return false;
+
+	// decoded here since the image loaders aren't safe to share with the workers
+	irr::io::IReadFile* file = device->getFileSystem()->createMemoryReadFile(&source[0],
+		(irr::s32)source.size(), fileName.GetFullPath().c_str().AsChar(), false);
+	if (!file)
+		return false;
+
+	irr::video::IImage* decoded = device->getVideoDriver()->createImageFromFile(file);
+	file->drop();
+	if (!decoded)
+		return false;
+
+	bool extracted = TextureTranscoder::Extract(device->getVideoDriver(), decoded, image);
+	decoded->drop();
+	return extracted;
+}
+
 void ProjectExplorer::CleanPackage(const wxTreeItemId& package)
 {
 	TreeItemData* data = dynamic_cast<TreeItemData*>(m_Explorer->GetItemData(package));
@@ -693,3 +937,29 @@ void ProjectExplorer::OnMenuCleanPackage(wxCommandEvent& event)
 
 	CleanPackage(package);
 }
+
+void ProjectExplorer::OnMenuProperties(wxCommandEvent& event)
+{
+	wxTreeItemId item = m_Explorer->GetFocusedItem();
+	if (!item.IsOk())
+		return;
+
+	TreeItemData* data = dynamic_cast<TreeItemData*>(m_Explorer->GetItemData(item));
+	if (data->m_Type != TreeItemData::NODE_PACKAGE)
+		return;
+
+	wxTextEntryDialog dialog(this, _("File types stored uncompressed (e.g. png;ogg)"),
+		wxString::Format(_("%s properties"), data->m_FileName.GetFullName()), data->m_StoreTypes);
+	if (dialog.ShowModal() != wxID_OK)
+		return;
+
+	data->m_StoreTypes = dialog.GetValue();
+
+	wxTextEntryDialog transcodeDialog(this, _("Image types transcoded to compressed DDS (e.g. png;jpg;tga), empty for none"),
+		wxString::Format(_("%s properties"), data->m_FileName.GetFullName()), data->m_TranscodeTypes);
+	if (transcodeDialog.ShowModal() == wxID_OK)
+		data->m_TranscodeTypes = transcodeDialog.GetValue();
+
+	data = dynamic_cast<TreeItemData*>(m_Explorer->GetItemData(m_Root));
+	Save(data->m_FileName);
+}
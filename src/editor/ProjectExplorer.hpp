@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include "MeshSimplifier.hpp"
+#include "TextureTranscoder.hpp"
+
 #include <wx/filename.h>
 #include <wx/panel.h>
 #include <wx/treectrl.h>
@@ -94,6 +97,26 @@ private:
 	 */
 	void CleanPackage(const wxTreeItemId& package);
 
+	/**
+	 * @brief Load a mesh file for building its LODs and collision shape
+	 * @param fileName Path to the file, which may not be a mesh
+	 * @param level Receives the triangles of the mesh
+	 * @param collision Receives the collision shape sidecar data, for any static mesh
+	 * @return true if the file is a static mesh that can be simplified
+	 */
+	bool ExtractMesh(const wxFileName& fileName, MeshSimplifier::level_t& level,
+		std::vector<irr::u8>& collision);
+
+	/**
+	 * @brief Decode an image file for transcoding
+	 * @param fileName Path to the file, which may not be an image
+	 * @param source The contents of the file
+	 * @param image Receives the pixels of the image
+	 * @return true if one of the image loaders could decode the file
+	 */
+	bool ExtractTexture(const wxFileName& fileName, std::vector<irr::u8>& source,
+		TextureTranscoder::Image& image);
+
 	/**
 	 * @brief Open a map file
 	 * @param fileName Path to the map file
@@ -179,4 +202,10 @@ public:
 	 * @param event The command event
 	 */
 	void OnMenuCleanPackage(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle properties menu action, edits the file types a package stores uncompressed or transcodes
+	 * @param event The command event
+	 */
+	void OnMenuProperties(wxCommandEvent& event);
 };
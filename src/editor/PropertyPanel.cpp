@@ -5,15 +5,18 @@
 */
 
 #include "Commands.hpp"
+#include "Component.hpp"
 #include "Convert.hpp"
 #include "MapEditor.hpp"
 #include "PropertyPanel.hpp"
 #include "../extend/CylinderSceneNode.hpp"
 #include "../extend/PlaneSceneNode.hpp"
 #include "../extend/PathSceneNode.hpp"
+#include "../extend/TerrainSceneNode.hpp"
 #include "ViewPanel.hpp"
 
 #include <wx/artprov.h>
+#include <wx/display.h>
 #include <wx/log.h>
 #include <wx/propgrid/advprops.h>
 #include <wx/sizer.h>
@@ -31,9 +34,24 @@ public:
 	irr::io::E_ATTRIBUTE_TYPE m_Type;
 };
 
+static irr::core::vector3df GetNodePosition(irr::scene::ISceneNode* node)
+{
+	return node->getAbsolutePosition();
+}
+
+static irr::core::vector3df GetNodeRotation(irr::scene::ISceneNode* node)
+{
+	return node->getRotation();
+}
+
+static irr::core::vector3df GetNodeScale(irr::scene::ISceneNode* node)
+{
+	return node->getScale();
+}
+
 PropertyPanel::PropertyPanel(wxWindow* parent, wxCommandProcessor& cmdProc)
-	: wxPanel(parent), m_Commands(cmdProc), m_Properties(nullptr),
-	  m_SceneNode(nullptr), m_PosX(nullptr), m_PosY(nullptr), m_PosZ(nullptr)
+	: wxPanel(parent), m_Commands(cmdProc), m_ViewPanel(nullptr), m_Properties(nullptr),
+	  m_SceneNode(nullptr), m_UpdateInterval(std::chrono::milliseconds(16))
 {
 	m_ToolBar = new wxToolBar(this, wxID_ANY, wxDefaultPosition, wxDefaultSize,
 		wxTB_FLAT | wxTB_HORIZONTAL);
@@ -67,9 +85,14 @@ void PropertyPanel::SetMap(std::shared_ptr<Map>& map)
 	m_Map = map;
 }
 
+void PropertyPanel::SetViewPanel(ViewPanel* viewPanel)
+{
+	m_ViewPanel = viewPanel;
+}
+
 void PropertyPanel::Clear(void)
 {
-	m_PosX = m_PosY = m_PosZ = nullptr;
+	m_Transform.clear();
 	m_Properties->Clear();
 	m_SceneNode = nullptr;
 }
@@ -79,453 +102,502 @@ void PropertyPanel::Refresh(void)
 	if (m_SceneNode == nullptr)
 		return;
 
-	if (m_Properties->GetRoot()->GetChildCount() == 0) // first time
-	{
-		irr::io::SAttributeReadWriteOptions opts;
-		opts.Filename = ".";
-		opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
-		irr::io::IAttributes* attribs = m_SceneNode->getSceneManager()->getFileSystem()->createEmptyAttributes(nullptr);
-		m_SceneNode->serializeAttributes(attribs, &opts);
-
-		m_GeneralProperties = new wxPropertyCategory(_("General"));
-		m_CustomProperties = new wxPropertyCategory(_("Custom"));
-		m_Components = new wxPropertyCategory(_("Components"));
-		m_Properties->Append(m_GeneralProperties);
-		m_Properties->Append(m_CustomProperties);
-		m_Properties->Append(m_Components);
-
-		// name
-		wxStringProperty* name = new wxStringProperty(_("Name"));
-		name->SetValueFromString(m_SceneNode->getName());
-		m_Properties->AppendIn(m_GeneralProperties, name);
-
-		// build the position
-		irr::core::vector3df pos = m_SceneNode->getAbsolutePosition();
-		wxPGProperty* position = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Position"),
+	m_Properties->Freeze();
+	m_Transform.clear();
+	m_Properties->Clear();
+
+	irr::io::SAttributeReadWriteOptions opts;
+	opts.Filename = ".";
+	opts.Flags = irr::io::EARWF_USE_RELATIVE_PATHS;
+	irr::io::IAttributes* attribs = m_SceneNode->getSceneManager()->getFileSystem()->createEmptyAttributes(nullptr);
+	m_SceneNode->serializeAttributes(attribs, &opts);
+
+	m_GeneralProperties = new wxPropertyCategory(_("General"));
+	m_CustomProperties = new wxPropertyCategory(_("Custom"));
+	m_Components = new wxPropertyCategory(_("Components"));
+	m_Properties->Append(m_GeneralProperties);
+	m_Properties->Append(m_CustomProperties);
+	m_Properties->Append(m_Components);
+
+	// name
+	wxStringProperty* name = new wxStringProperty(_("Name"));
+	name->SetValueFromString(m_SceneNode->getName());
+	m_Properties->AppendIn(m_GeneralProperties, name);
+
+	// the transform rows are bound to the node so drags only push values
+	m_Properties->Collapse(BindTransform(_("Position"), GetNodePosition));
+	m_Properties->Collapse(BindTransform(_("Rotation"), GetNodeRotation));
+	m_Properties->Collapse(BindTransform(_("Scale"), GetNodeScale));
+
+	// custom based on node type
+	switch (m_SceneNode->getType())
+	{
+	case irr::scene::ESNT_CUBE:
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Size"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("Size")));
+		break;
+	case irr::scene::ESNT_SPHERE:
+	{
+		wxPGProperty* size = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Size"),
 			wxPG_LABEL, "<composed>"));
-		m_PosX = new wxFloatProperty(_("x"), wxPG_LABEL, pos.X);
-		m_Properties->AppendIn(position, m_PosX);
-		m_PosY = new wxFloatProperty(_("y"), wxPG_LABEL, pos.Y);
-		m_Properties->AppendIn(position, m_PosY);
-		m_PosZ = new wxFloatProperty(_("z"), wxPG_LABEL, pos.Z);
-		m_Properties->AppendIn(position, m_PosZ);
-		m_Properties->Collapse(position);
-
-		// build the rotation
-		irr::core::vector3df rot = m_SceneNode->getRotation();
-		wxPGProperty* rotation = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Rotation"),
+		m_Properties->AppendIn(size, new wxFloatProperty(_("radius"), wxPG_LABEL, 
+			attribs->getAttributeAsFloat("Radius")));
+		m_Properties->AppendIn(size, new wxIntProperty(_("polyCountX"), wxPG_LABEL, 
+			attribs->getAttributeAsInt("PolyCountX")));
+		m_Properties->AppendIn(size, new wxIntProperty(_("polyCountY"), wxPG_LABEL, 
+			attribs->getAttributeAsInt("PolyCountY")));
+		m_Properties->Collapse(size);
+	} break;
+	case ESNT_CYLINDER:
+	{
+		wxPGProperty* size = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Size"),
 			wxPG_LABEL, "<composed>"));
-		m_Properties->AppendIn(rotation, new wxFloatProperty(_("x"), wxPG_LABEL, rot.X));
-		m_Properties->AppendIn(rotation, new wxFloatProperty(_("y"), wxPG_LABEL, rot.Y));
-		m_Properties->AppendIn(rotation, new wxFloatProperty(_("z"), wxPG_LABEL, rot.Z));
-		m_Properties->Collapse(rotation);
-
-		// scale
-		irr::core::vector3df _scale = m_SceneNode->getScale();
-		wxPGProperty* scale = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Scale"),
+		m_Properties->AppendIn(size, new wxFloatProperty(_("radius"), wxPG_LABEL, 
+			attribs->getAttributeAsFloat("Radius")));
+		m_Properties->AppendIn(size, new wxFloatProperty(_("length"), wxPG_LABEL, 
+			attribs->getAttributeAsFloat("Length")));
+		m_Properties->AppendIn(size, new wxIntProperty(_("tessalation"), wxPG_LABEL, 
+			attribs->getAttributeAsInt("Tesselation")));
+		m_Properties->Collapse(size);
+	} break;
+	case ESNT_PLANE:
+	{
+		irr::core::vector2df size(attribs->getAttributeAsVector2d("TileSize"));
+		const irr::core::dimension2df _tileSize(size.X, size.Y);
+		const irr::core::dimension2du _tileCount(attribs->getAttributeAsDimension2d("TileCount"));
+
+		wxPGProperty* count = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Tile Count"),
 			wxPG_LABEL, "<composed>"));
-		m_Properties->AppendIn(scale, new wxFloatProperty(_("x"), wxPG_LABEL, _scale.X));
-		m_Properties->AppendIn(scale, new wxFloatProperty(_("y"), wxPG_LABEL, _scale.Y));
-		m_Properties->AppendIn(scale, new wxFloatProperty(_("z"), wxPG_LABEL, _scale.Z));
-		m_Properties->Collapse(scale);
+		m_Properties->AppendIn(count, new wxUIntProperty(_("x"), wxPG_LABEL, _tileCount.Width));
+		m_Properties->AppendIn(count, new wxUIntProperty(_("y"), wxPG_LABEL, _tileCount.Height));
+		m_Properties->Collapse(count);
 
-		// custom based on node type
-		switch (m_SceneNode->getType())
-		{
-		case irr::scene::ESNT_CUBE:
-			m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Size"), wxPG_LABEL,
-				attribs->getAttributeAsFloat("Size")));
-			break;
-		case irr::scene::ESNT_SPHERE:
-		{
-			wxPGProperty* size = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Size"),
-				wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(size, new wxFloatProperty(_("radius"), wxPG_LABEL, 
-				attribs->getAttributeAsFloat("Radius")));
-			m_Properties->AppendIn(size, new wxIntProperty(_("polyCountX"), wxPG_LABEL, 
-				attribs->getAttributeAsInt("PolyCountX")));
-			m_Properties->AppendIn(size, new wxIntProperty(_("polyCountY"), wxPG_LABEL, 
-				attribs->getAttributeAsInt("PolyCountY")));
-			m_Properties->Collapse(size);
-		} break;
-		case ESNT_CYLINDER:
-		{
-			wxPGProperty* size = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Size"),
-				wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(size, new wxFloatProperty(_("radius"), wxPG_LABEL, 
-				attribs->getAttributeAsFloat("Radius")));
-			m_Properties->AppendIn(size, new wxFloatProperty(_("length"), wxPG_LABEL, 
-				attribs->getAttributeAsFloat("Length")));
-			m_Properties->AppendIn(size, new wxIntProperty(_("tessalation"), wxPG_LABEL, 
-				attribs->getAttributeAsInt("Tesselation")));
-			m_Properties->Collapse(size);
-		} break;
-		case ESNT_PLANE:
-		{
-			irr::core::vector2df size(attribs->getAttributeAsVector2d("TileSize"));
-			const irr::core::dimension2df _tileSize(size.X, size.Y);
-			const irr::core::dimension2du _tileCount(attribs->getAttributeAsDimension2d("TileCount"));
-
-			wxPGProperty* count = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Tile Count"),
-				wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(count, new wxUIntProperty(_("x"), wxPG_LABEL, _tileCount.Width));
-			m_Properties->AppendIn(count, new wxUIntProperty(_("y"), wxPG_LABEL, _tileCount.Height));
-			m_Properties->Collapse(count);
-
-			wxPGProperty* sizeProp = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Tile Size"),
-				wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(sizeProp, new wxFloatProperty(_("x"), wxPG_LABEL, _tileSize.Width));
-			m_Properties->AppendIn(sizeProp, new wxFloatProperty(_("y"), wxPG_LABEL, _tileSize.Height));
-			m_Properties->Collapse(sizeProp);
-		} break;
-		case irr::scene::ESNT_LIGHT:
-		{
-			m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Radius"), wxPG_LABEL,
-				attribs->getAttributeAsFloat("Radius")));
-
-			irr::video::SColorf color = attribs->getAttributeAsColor("AmbientColor");
-			wxPGProperty* ambient = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Ambient"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				color.a));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				color.r));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				color.g));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				color.b));
-			m_Properties->Collapse(ambient);
-
-			color = attribs->getAttributeAsColor("DiffuseColor");
-			wxPGProperty* diffuse = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Diffuse"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				color.a));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				color.r));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				color.g));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				color.b));
-			m_Properties->Collapse(diffuse);
-
-			color = attribs->getAttributeAsColor("SpecularColor");
-			wxPGProperty* specular = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Specular"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				color.a));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				color.r));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				color.g));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				color.b));
-			m_Properties->Collapse(specular);
-		} break;
-		case irr::scene::ESNT_SKY_DOME:
-		{
-			m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Radius"), wxPG_LABEL,
-				attribs->getAttributeAsFloat("Radius")));
-			m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Arc"), wxPG_LABEL,
-				attribs->getAttributeAsFloat("SpherePercentage")));
-			m_Properties->AppendIn(m_GeneralProperties, new wxIntProperty(_("HorizontalResolution"), wxPG_LABEL,
-				attribs->getAttributeAsInt("HorizontalResolution")));
-			m_Properties->AppendIn(m_GeneralProperties, new wxIntProperty(_("VerticalResolution"), wxPG_LABEL,
-				attribs->getAttributeAsInt("VerticalResolution")));
-		} break;
-		case ESNT_PATHNODE:
-		{
-			// build the list of path node names
-			irr::scene::ISceneManager* smgr = m_SceneNode->getSceneManager();
-			irr::core::array<irr::scene::ISceneNode*> nodes;
-			smgr->getSceneNodesFromType((irr::scene::ESCENE_NODE_TYPE)ESNT_PATHNODE, 
-				nodes, nullptr);
+		wxPGProperty* sizeProp = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Tile Size"),
+			wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(sizeProp, new wxFloatProperty(_("x"), wxPG_LABEL, _tileSize.Width));
+		m_Properties->AppendIn(sizeProp, new wxFloatProperty(_("y"), wxPG_LABEL, _tileSize.Height));
+		m_Properties->Collapse(sizeProp);
+	} break;
+	case irr::scene::ESNT_LIGHT:
+	{
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Radius"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("Radius")));
+
+		irr::video::SColorf color = attribs->getAttributeAsColor("AmbientColor");
+		wxPGProperty* ambient = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Ambient"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			color.a));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			color.r));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			color.g));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			color.b));
+		m_Properties->Collapse(ambient);
+
+		color = attribs->getAttributeAsColor("DiffuseColor");
+		wxPGProperty* diffuse = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Diffuse"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			color.a));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			color.r));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			color.g));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			color.b));
+		m_Properties->Collapse(diffuse);
+
+		color = attribs->getAttributeAsColor("SpecularColor");
+		wxPGProperty* specular = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Specular"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			color.a));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			color.r));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			color.g));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			color.b));
+		m_Properties->Collapse(specular);
+	} break;
+	case ESNT_CHUNKTERRAIN:
+	{
+		m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(_("Heightmap"), wxPG_LABEL,
+			attribs->getAttributeAsString("Heightmap").c_str()));
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Cell Size"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("CellSize")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Height Scale"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("HeightScale")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxUIntProperty(_("Chunk Size"), wxPG_LABEL,
+			attribs->getAttributeAsInt("ChunkSize")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("LOD Distance"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("LodDistance")));
+	} break;
+	case irr::scene::ESNT_SKY_DOME:
+	{
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Radius"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("Radius")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxFloatProperty(_("Arc"), wxPG_LABEL,
+			attribs->getAttributeAsFloat("SpherePercentage")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxIntProperty(_("HorizontalResolution"), wxPG_LABEL,
+			attribs->getAttributeAsInt("HorizontalResolution")));
+		m_Properties->AppendIn(m_GeneralProperties, new wxIntProperty(_("VerticalResolution"), wxPG_LABEL,
+			attribs->getAttributeAsInt("VerticalResolution")));
+	} break;
+	case ESNT_PATHNODE:
+	{
+		// build the list of path node names
+		irr::scene::ISceneManager* smgr = m_SceneNode->getSceneManager();
+		irr::core::array<irr::scene::ISceneNode*> nodes;
+		smgr->getSceneNodesFromType((irr::scene::ESCENE_NODE_TYPE)ESNT_PATHNODE, 
+			nodes, nullptr);
 
-			PathSceneNode* pathNode = dynamic_cast<PathSceneNode*>(m_SceneNode);
+		PathSceneNode* pathNode = dynamic_cast<PathSceneNode*>(m_SceneNode);
 
-			wxArrayString pathNames, nodeNames;
-			nodeNames.push_back(wxT("--none--"));
+		wxArrayString pathNames, nodeNames;
+		nodeNames.push_back(wxT("--none--"));
 
-			irr::u32 count = nodes.size();
-			for (irr::u32 i = 0; i < count; ++i)
-			{
-				PathSceneNode* node = dynamic_cast<PathSceneNode*>(nodes[i]);
+		irr::u32 count = nodes.size();
+		for (irr::u32 i = 0; i < count; ++i)
+		{
+			PathSceneNode* node = dynamic_cast<PathSceneNode*>(nodes[i]);
 
-				wxString name(node->getName());
-				if (name.CompareTo(wxString(m_SceneNode->getName()), wxString::ignoreCase) != 0)
-					nodeNames.push_back(name);
+			wxString name(node->getName());
+			if (name.CompareTo(wxString(m_SceneNode->getName()), wxString::ignoreCase) != 0)
+				nodeNames.push_back(name);
 
-				bool duplicatePathName = false;
-				wxString path(node->getPathName().c_str());
-				for (int j = 0; j < pathNames.Count(); ++j)
+			bool duplicatePathName = false;
+			wxString path(node->getPathName().c_str());
+			for (int j = 0; j < pathNames.Count(); ++j)
+			{
+				if (pathNames[j] == path)
 				{
-					if (pathNames[j] == path)
-					{
-						duplicatePathName = true;
-						break;
-					}
+					duplicatePathName = true;
+					break;
 				}
-
-				if (!duplicatePathName)
-					pathNames.push_back(path);
 			}
 
-			// populate the choice box
-			PathSceneNode* prevNode = pathNode->getPrev();
-			PathSceneNode* nextNode = pathNode->getNext();
+			if (!duplicatePathName)
+				pathNames.push_back(path);
+		}
 
-			wxEditEnumProperty* pathChoices = new wxEditEnumProperty(
-				_("Path Name"), wxPG_LABEL, pathNames, wxArrayInt(),
-				wxString(pathNode->getPathName().c_str()));
-			wxEnumProperty* prevChoices = new wxEnumProperty(
-				_("Previous Node"), wxPG_LABEL, nodeNames);
-			wxEnumProperty* nextChoices = new wxEnumProperty(
-				_("Next Node"), wxPG_LABEL, nodeNames);
+		// populate the choice box
+		PathSceneNode* prevNode = pathNode->getPrev();
+		PathSceneNode* nextNode = pathNode->getNext();
 
-			if (prevNode)
-				prevChoices->SetValueFromString(wxString(prevNode->getName()));
+		wxEditEnumProperty* pathChoices = new wxEditEnumProperty(
+			_("Path Name"), wxPG_LABEL, pathNames, wxArrayInt(),
+			wxString(pathNode->getPathName().c_str()));
+		wxEnumProperty* prevChoices = new wxEnumProperty(
+			_("Previous Node"), wxPG_LABEL, nodeNames);
+		wxEnumProperty* nextChoices = new wxEnumProperty(
+			_("Next Node"), wxPG_LABEL, nodeNames);
 
-			if (nextNode)
-				nextChoices->SetValueFromString(wxString(nextNode->getName()));
+		if (prevNode)
+			prevChoices->SetValueFromString(wxString(prevNode->getName()));
 
-			m_Properties->AppendIn(m_GeneralProperties, pathChoices);
-			m_Properties->AppendIn(m_GeneralProperties, prevChoices);
-			m_Properties->AppendIn(m_GeneralProperties, nextChoices);
-		} break;
-		}
+		if (nextNode)
+			nextChoices->SetValueFromString(wxString(nextNode->getName()));
 
-		attribs->drop();
+		m_Properties->AppendIn(m_GeneralProperties, pathChoices);
+		m_Properties->AppendIn(m_GeneralProperties, prevChoices);
+		m_Properties->AppendIn(m_GeneralProperties, nextChoices);
+	} break;
+	}
 
-		// materials
-		irr::u32 numMaterials = m_SceneNode->getMaterialCount();
-		if (numMaterials > 0)
-		{
-			if (numMaterials > 1)
-				wxLogWarning(_("More than 1 material is defined, but we only support 1 material currently"));
+	attribs->drop();
 
-			const irr::video::SMaterial& mat = m_SceneNode->getMaterial(0);
-			
-			// make sure we get the relative path for the textures
-			irr::io::IAttributes* matAttribs = m_SceneNode->getSceneManager()->getVideoDriver()
-				->createAttributesFromMaterial(mat, &opts);
+	// materials
+	irr::u32 numMaterials = m_SceneNode->getMaterialCount();
+	if (numMaterials > 0)
+	{
+		if (numMaterials > 1)
+			wxLogWarning(_("More than 1 material is defined, but we only support 1 material currently"));
 
-			// textures
-			for (irr::u32 j = 0; j < irr::video::MATERIAL_MAX_TEXTURES; ++j)
-			{
-				wxString texName;
-				texName.assign(matAttribs->getAttributeAsString(wxString::Format(_("Texture%d"), j + 1).c_str()).c_str());
-				if (texName.compare(wxT("../0")) == 0 || texName.compare(wxT("..\\0")) == 0 || texName.compare(wxT("0")) == 0)
-					texName.clear();
-
-				//m_Properties->Append(new TextureProperty(j, wxString::Format(_("Texture%d"), j + 1),
-				//	wxPG_LABEL, texName));
-				m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(wxString::Format(_("Texture%d"), j + 1),
-					wxPG_LABEL, texName));
-			}
+		const irr::video::SMaterial& mat = m_SceneNode->getMaterial(0);
+		
+		// make sure we get the relative path for the textures
+		irr::io::IAttributes* matAttribs = m_SceneNode->getSceneManager()->getVideoDriver()
+			->createAttributesFromMaterial(mat, &opts);
 
-			wxPGProperty* ambient = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Ambient"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Alpha"), wxPG_LABEL, 
-				mat.AmbientColor.getAlpha()));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				mat.AmbientColor.getRed()));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				mat.AmbientColor.getGreen()));
-			m_Properties->AppendIn(ambient, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				mat.AmbientColor.getBlue()));
-			m_Properties->Collapse(ambient);
-
-			wxPGProperty* diffuse = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Diffuse"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				mat.DiffuseColor.getAlpha()));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				mat.DiffuseColor.getRed()));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				mat.DiffuseColor.getGreen()));
-			m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				mat.DiffuseColor.getBlue()));
-			m_Properties->Collapse(diffuse);
-
-			wxPGProperty* emissive = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Emissive"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(emissive, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				mat.EmissiveColor.getAlpha()));
-			m_Properties->AppendIn(emissive, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				mat.EmissiveColor.getRed()));
-			m_Properties->AppendIn(emissive, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				mat.EmissiveColor.getGreen()));
-			m_Properties->AppendIn(emissive, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				mat.EmissiveColor.getBlue()));
-			m_Properties->Collapse(emissive);
-
-			wxPGProperty* specular = m_Properties->AppendIn(m_GeneralProperties,
-				new wxStringProperty(_("Specular"), wxPG_LABEL, "<composed>"));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
-				mat.SpecularColor.getAlpha()));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Red"), wxPG_LABEL,
-				mat.SpecularColor.getRed()));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Green"), wxPG_LABEL,
-				mat.SpecularColor.getGreen()));
-			m_Properties->AppendIn(specular, new wxUIntProperty(_("Blue"), wxPG_LABEL,
-				mat.SpecularColor.getBlue()));
-			m_Properties->Collapse(specular);
-
-			m_Properties->AppendIn(m_GeneralProperties,
-				new wxFloatProperty(_("Shininess"), wxPG_LABEL, mat.Shininess));
+		// textures
+		for (irr::u32 j = 0; j < irr::video::MATERIAL_MAX_TEXTURES; ++j)
+		{
+			wxString texName;
+			texName.assign(matAttribs->getAttributeAsString(wxString::Format(_("Texture%d"), j + 1).c_str()).c_str());
+			if (texName.compare(wxT("../0")) == 0 || texName.compare(wxT("..\\0")) == 0 || texName.compare(wxT("0")) == 0)
+				texName.clear();
+
+			//m_Properties->Append(new TextureProperty(j, wxString::Format(_("Texture%d"), j + 1),
+			//	wxPG_LABEL, texName));
+			m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(wxString::Format(_("Texture%d"), j + 1),
+				wxPG_LABEL, texName));
 		}
 
-		// read the custom attributes
-		attribs = m_Map->GetAttributes(m_SceneNode->getName());
-		if (attribs)
+		wxPGProperty* ambient = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Ambient"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Alpha"), wxPG_LABEL, 
+			mat.AmbientColor.getAlpha()));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			mat.AmbientColor.getRed()));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			mat.AmbientColor.getGreen()));
+		m_Properties->AppendIn(ambient, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			mat.AmbientColor.getBlue()));
+		m_Properties->Collapse(ambient);
+
+		wxPGProperty* diffuse = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Diffuse"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			mat.DiffuseColor.getAlpha()));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			mat.DiffuseColor.getRed()));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			mat.DiffuseColor.getGreen()));
+		m_Properties->AppendIn(diffuse, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			mat.DiffuseColor.getBlue()));
+		m_Properties->Collapse(diffuse);
+
+		wxPGProperty* emissive = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Emissive"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(emissive, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			mat.EmissiveColor.getAlpha()));
+		m_Properties->AppendIn(emissive, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			mat.EmissiveColor.getRed()));
+		m_Properties->AppendIn(emissive, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			mat.EmissiveColor.getGreen()));
+		m_Properties->AppendIn(emissive, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			mat.EmissiveColor.getBlue()));
+		m_Properties->Collapse(emissive);
+
+		wxPGProperty* specular = m_Properties->AppendIn(m_GeneralProperties,
+			new wxStringProperty(_("Specular"), wxPG_LABEL, "<composed>"));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Alpha"), wxPG_LABEL,
+			mat.SpecularColor.getAlpha()));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Red"), wxPG_LABEL,
+			mat.SpecularColor.getRed()));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Green"), wxPG_LABEL,
+			mat.SpecularColor.getGreen()));
+		m_Properties->AppendIn(specular, new wxUIntProperty(_("Blue"), wxPG_LABEL,
+			mat.SpecularColor.getBlue()));
+		m_Properties->Collapse(specular);
+
+		m_Properties->AppendIn(m_GeneralProperties,
+			new wxFloatProperty(_("Shininess"), wxPG_LABEL, mat.Shininess));
+	}
+
+	// read the custom attributes
+	attribs = m_Map->GetAttributes(m_SceneNode->getName());
+	if (attribs)
+	{
+		for (irr::u32 i = 0; i < attribs->getAttributeCount(); ++i)
 		{
-			for (irr::u32 i = 0; i < attribs->getAttributeCount(); ++i)
+			wxString name = attribs->getAttributeName(i);
+			PropertyClientData* clientData = new PropertyClientData(attribs->getAttributeType(i));
+			switch (clientData->m_Type)
 			{
-				wxString name = attribs->getAttributeName(i);
-				PropertyClientData* clientData = new PropertyClientData(attribs->getAttributeType(i));
-				switch (clientData->m_Type)
-				{
-				case irr::io::EAT_STRING:
-				{
-					wxStringProperty* property = new wxStringProperty(name, wxPG_LABEL,
-						attribs->getAttributeAsString(i).c_str());
-					property->SetClientData(clientData);
-					m_Properties->AppendIn(m_CustomProperties, property);
-				} break;
-				case irr::io::EAT_VECTOR3D:
-				{
-					irr::core::vector3df vec = attribs->getAttributeAsVector3d(i);
-					wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
-						new wxStringProperty(name, wxPG_LABEL, "<composed>"));
-					wxFloatProperty* x = new wxFloatProperty(_("x"), wxPG_LABEL, vec.X);
-					x->SetClientData(clientData);
-					wxFloatProperty* y = new wxFloatProperty(_("y"), wxPG_LABEL, vec.Y);
-					y->SetClientData(clientData);
-					wxFloatProperty* z = new wxFloatProperty(_("z"), wxPG_LABEL, vec.Z);
-					z->SetClientData(clientData);
-					m_Properties->AppendIn(property, x);
-					m_Properties->AppendIn(property, y);
-					m_Properties->AppendIn(property, z);
-					m_Properties->Collapse(property);
-					property->SetClientData(clientData);
-				} break;
-				case irr::io::EAT_VECTOR2D:
-				{
-					irr::core::vector2df vec = attribs->getAttributeAsVector2d(i);
-					wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
-						new wxStringProperty(name, wxPG_LABEL, "<composed>"));
-					wxFloatProperty* x = new wxFloatProperty(_("x"), wxPG_LABEL, vec.X);
-					x->SetClientData(clientData);
-					wxFloatProperty* y = new wxFloatProperty(_("y"), wxPG_LABEL, vec.Y);
-					y->SetClientData(clientData);
-					m_Properties->AppendIn(property, x);
-					m_Properties->AppendIn(property, y);
-					m_Properties->Collapse(property);
-					property->SetClientData(clientData);
-				} break;
-				case irr::io::EAT_COLOR:
-				{
-					irr::video::SColor color = attribs->getAttributeAsColor(i);
-					wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
-						new wxStringProperty(name, wxPG_LABEL, "<composed>"));
-					wxUIntProperty* alpha = new wxUIntProperty(_("Alpha"), wxPG_LABEL, color.getAlpha());
-					alpha->SetClientData(clientData);
-					wxUIntProperty* red = new wxUIntProperty(_("Red"), wxPG_LABEL, color.getRed());
-					red->SetClientData(clientData);
-					wxUIntProperty* green = new wxUIntProperty(_("Green"), wxPG_LABEL, color.getGreen());
-					green->SetClientData(clientData);
-					wxUIntProperty* blue = new wxUIntProperty(_("Blue"), wxPG_LABEL, color.getBlue());
-					blue->SetClientData(clientData);
-					m_Properties->AppendIn(property, alpha);
-					m_Properties->AppendIn(property, red);
-					m_Properties->AppendIn(property, green);
-					m_Properties->AppendIn(property, blue);
-					m_Properties->Collapse(property);
-					property->SetClientData(clientData);
-				} break;
-				case irr::io::EAT_FLOAT:
-				{
-					wxFloatProperty* property = new wxFloatProperty(name, wxPG_LABEL,
-						attribs->getAttributeAsFloat(i));
-					property->SetClientData(clientData);
-					m_Properties->AppendIn(m_CustomProperties, property);
-				} break;
-				case irr::io::EAT_BOOL:
-				{
-					wxBoolProperty* property = new wxBoolProperty(name, wxPG_LABEL,
-						attribs->getAttributeAsBool(i));
-					property->SetClientData(clientData);
-					m_Properties->AppendIn(m_CustomProperties, property);
-				} break;
-				case irr::io::EAT_INT:
-				{
-					wxIntProperty* property = new wxIntProperty(name, wxPG_LABEL,
-						attribs->getAttributeAsInt(i));
-					property->SetClientData(clientData);
-					m_Properties->AppendIn(m_CustomProperties, property);
-				} break;
-				}
+			case irr::io::EAT_STRING:
+			{
+				wxStringProperty* property = new wxStringProperty(name, wxPG_LABEL,
+					attribs->getAttributeAsString(i).c_str());
+				property->SetClientData(clientData);
+				m_Properties->AppendIn(m_CustomProperties, property);
+			} break;
+			case irr::io::EAT_VECTOR3D:
+			{
+				irr::core::vector3df vec = attribs->getAttributeAsVector3d(i);
+				wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
+					new wxStringProperty(name, wxPG_LABEL, "<composed>"));
+				wxFloatProperty* x = new wxFloatProperty(_("x"), wxPG_LABEL, vec.X);
+				x->SetClientData(clientData);
+				wxFloatProperty* y = new wxFloatProperty(_("y"), wxPG_LABEL, vec.Y);
+				y->SetClientData(clientData);
+				wxFloatProperty* z = new wxFloatProperty(_("z"), wxPG_LABEL, vec.Z);
+				z->SetClientData(clientData);
+				m_Properties->AppendIn(property, x);
+				m_Properties->AppendIn(property, y);
+				m_Properties->AppendIn(property, z);
+				m_Properties->Collapse(property);
+				property->SetClientData(clientData);
+			} break;
+			case irr::io::EAT_VECTOR2D:
+			{
+				irr::core::vector2df vec = attribs->getAttributeAsVector2d(i);
+				wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
+					new wxStringProperty(name, wxPG_LABEL, "<composed>"));
+				wxFloatProperty* x = new wxFloatProperty(_("x"), wxPG_LABEL, vec.X);
+				x->SetClientData(clientData);
+				wxFloatProperty* y = new wxFloatProperty(_("y"), wxPG_LABEL, vec.Y);
+				y->SetClientData(clientData);
+				m_Properties->AppendIn(property, x);
+				m_Properties->AppendIn(property, y);
+				m_Properties->Collapse(property);
+				property->SetClientData(clientData);
+			} break;
+			case irr::io::EAT_COLOR:
+			{
+				irr::video::SColor color = attribs->getAttributeAsColor(i);
+				wxPGProperty* property = m_Properties->AppendIn(m_CustomProperties, 
+					new wxStringProperty(name, wxPG_LABEL, "<composed>"));
+				wxUIntProperty* alpha = new wxUIntProperty(_("Alpha"), wxPG_LABEL, color.getAlpha());
+				alpha->SetClientData(clientData);
+				wxUIntProperty* red = new wxUIntProperty(_("Red"), wxPG_LABEL, color.getRed());
+				red->SetClientData(clientData);
+				wxUIntProperty* green = new wxUIntProperty(_("Green"), wxPG_LABEL, color.getGreen());
+				green->SetClientData(clientData);
+				wxUIntProperty* blue = new wxUIntProperty(_("Blue"), wxPG_LABEL, color.getBlue());
+				blue->SetClientData(clientData);
+				m_Properties->AppendIn(property, alpha);
+				m_Properties->AppendIn(property, red);
+				m_Properties->AppendIn(property, green);
+				m_Properties->AppendIn(property, blue);
+				m_Properties->Collapse(property);
+				property->SetClientData(clientData);
+			} break;
+			case irr::io::EAT_FLOAT:
+			{
+				wxFloatProperty* property = new wxFloatProperty(name, wxPG_LABEL,
+					attribs->getAttributeAsFloat(i));
+				property->SetClientData(clientData);
+				m_Properties->AppendIn(m_CustomProperties, property);
+			} break;
+			case irr::io::EAT_BOOL:
+			{
+				wxBoolProperty* property = new wxBoolProperty(name, wxPG_LABEL,
+					attribs->getAttributeAsBool(i));
+				property->SetClientData(clientData);
+				m_Properties->AppendIn(m_CustomProperties, property);
+			} break;
+			case irr::io::EAT_INT:
+			{
+				wxIntProperty* property = new wxIntProperty(name, wxPG_LABEL,
+					attribs->getAttributeAsInt(i));
+				property->SetClientData(clientData);
+				m_Properties->AppendIn(m_CustomProperties, property);
+			} break;
 			}
 		}
-	
-		// add the components
-		const irr::scene::ISceneNodeAnimatorList animators = m_SceneNode->getAnimators();
-		for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animators.begin();
-			i != animators.end(); ++i)
+	}
+
+	// add the components from the map's store
+	irr::core::array<irr::io::IAttributes*> components;
+	m_Map->GetEntityComponents(m_SceneNode->getName(), components);
+	for (irr::u32 i = 0; i < components.size(); ++i)
+	{
+		wxPGProperty* component = new wxPropertyCategory(
+			components[i]->getAttributeAsString("Type").c_str());
+		m_Properties->Insert(m_Components, m_Components->GetChildCount(), component);
+
+		for (irr::u32 j = 0; j < components[i]->getAttributeCount(); ++j)
 		{
-			wxPGProperty* component = nullptr;
+			if (strcmp(components[i]->getAttributeName(j), "Type") == 0)
+				continue;
 
-			irr::io::IAttributes* animAttribs = m_Map->GetSceneMgr()->getFileSystem()->createEmptyAttributes();
-			irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = (*i)->getType();
-			irr::u32 factoryCount = m_Map->GetSceneMgr()->getRegisteredSceneNodeAnimatorFactoryCount();
-			for (irr::u32 j = 0; j < factoryCount; ++j)
-			{
-				irr::scene::ISceneNodeAnimatorFactory* factory = m_Map->GetSceneMgr()->getSceneNodeAnimatorFactory(j);
-				const irr::c8* name = factory->getCreateableSceneNodeAnimatorTypeName(type);
-				if (name)
-				{
-					(*i)->serializeAttributes(animAttribs, &opts);
-					// if (!animAttribs->existsAttribute("Type"))
-					// 	animAttribs->setAttribute("Type", name);
+			AddAttribute(component, components[i]->getAttributeType(j),
+				components[i]->getAttributeName(j),
+				components[i]->getAttributeAsString(j).c_str());
+		}
 
-					component = new wxPropertyCategory(name);
-					break;
-				}
-			}
+		m_Properties->Collapse(component);
+		components[i]->drop();
+	}
 
-			if (component)
-			{
-				m_Properties->Insert(m_Components, m_Components->GetChildCount(), component);
+	// and any other animators
+	const irr::scene::ISceneNodeAnimatorList animators = m_SceneNode->getAnimators();
+	for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animators.begin();
+		i != animators.end(); ++i)
+	{
+		wxPGProperty* component = nullptr;
 
-				for (irr::u32 j = 0; j < animAttribs->getAttributeCount(); ++j)
-				{
-					AddAttribute(component, animAttribs->getAttributeType(j),
-						animAttribs->getAttributeName(j),
-						animAttribs->getAttributeAsString(j).c_str());
-				}
+		irr::io::IAttributes* animAttribs = m_Map->GetSceneMgr()->getFileSystem()->createEmptyAttributes();
+		const irr::c8* name = m_Map->GetAnimatorTypeName((*i)->getType());
+		if (name)
+		{
+			(*i)->serializeAttributes(animAttribs, &opts);
+			// if (!animAttribs->existsAttribute("Type"))
+			// 	animAttribs->setAttribute("Type", name);
+
+			component = new wxPropertyCategory(name);
+		}
 
-				m_Properties->Collapse(component);
+		if (component)
+		{
+			m_Properties->Insert(m_Components, m_Components->GetChildCount(), component);
+
+			for (irr::u32 j = 0; j < animAttribs->getAttributeCount(); ++j)
+			{
+				AddAttribute(component, animAttribs->getAttributeType(j),
+					animAttribs->getAttributeName(j),
+					animAttribs->getAttributeAsString(j).c_str());
 			}
 
-			animAttribs->drop();
+			m_Properties->Collapse(component);
 		}
 
+		animAttribs->drop();
 	}
-	else // refresh the children
+
+	m_Properties->Thaw();
+}
+
+void PropertyPanel::UpdateTransform(bool force)
+{
+	if (m_SceneNode == nullptr || m_Transform.empty())
+		return;
+
+	clock_t::time_point now = clock_t::now();
+	if (!force && now - m_LastUpdate < m_UpdateInterval)
+		return;
+
+	m_LastUpdate = now;
+
+	for (std::vector<TransformBinding>::iterator binding = m_Transform.begin();
+		binding != m_Transform.end(); ++binding)
 	{
-		irr::core::vector3df pos = m_SceneNode->getAbsolutePosition();
-		m_PosX->SetValue(pos.X);
-		m_PosY->SetValue(pos.Y);
-		m_PosZ->SetValue(pos.Z);
+		irr::core::vector3df value = binding->Get(m_SceneNode);
+		const irr::f32 axes[3] = { value.X, value.Y, value.Z };
+		const irr::f32 shown[3] = { binding->Shown.X, binding->Shown.Y, binding->Shown.Z };
+		for (int i = 0; i < 3; ++i)
+		{
+			// setting the value directly doesn't send a change event
+			if (!irr::core::equals(axes[i], shown[i]))
+				m_Properties->SetPropertyValue(binding->Axis[i], (double)axes[i]);
+		}
+
+		binding->Shown = value;
 	}
 }
 
 void PropertyPanel::SetSceneNode(irr::scene::ISceneNode* node)
 {
 	m_SceneNode = node;
+
+	// pace the drag updates to the display this panel is on
+	int refresh = wxDisplay(this).GetCurrentMode().refresh;
+	m_UpdateInterval = std::chrono::milliseconds(1000 / (refresh > 0 ? refresh : 60));
+
 	Refresh();
 }
 
+wxPGProperty* PropertyPanel::BindTransform(const wxString& label,
+	irr::core::vector3df (*get)(irr::scene::ISceneNode*))
+{
+	TransformBinding binding;
+	binding.Get = get;
+	binding.Shown = get(m_SceneNode);
+
+	wxPGProperty* property = m_Properties->AppendIn(m_GeneralProperties, new wxStringProperty(label,
+		wxPG_LABEL, "<composed>"));
+	binding.Axis[0] = m_Properties->AppendIn(property, new wxFloatProperty(_("x"), wxPG_LABEL, binding.Shown.X));
+	binding.Axis[1] = m_Properties->AppendIn(property, new wxFloatProperty(_("y"), wxPG_LABEL, binding.Shown.Y));
+	binding.Axis[2] = m_Properties->AppendIn(property, new wxFloatProperty(_("z"), wxPG_LABEL, binding.Shown.Z));
+
+	m_Transform.push_back(binding);
+	return property;
+}
+
 void PropertyPanel::OnToolAdd(wxCommandEvent& event)
 {
 	wxLogMessage(_("Not implemented"));
@@ -611,6 +683,31 @@ void PropertyPanel::OnValueChanged(wxPropertyGridEvent& event)
 		m_Commands.Submit(new ResizeNodeCommand(m_SceneNode, size));
 
 	}
+	else if (propName.compare(_("Heightmap")) == 0)
+	{
+		m_Commands.Submit(new ChangeTerrainCommand(m_SceneNode, "Heightmap",
+			event.GetValue().GetString()));
+	}
+	else if (propName.compare(_("Cell Size")) == 0)
+	{
+		m_Commands.Submit(new ChangeTerrainCommand(m_SceneNode, "CellSize",
+			wxString::FromCDouble(event.GetValue().GetDouble())));
+	}
+	else if (propName.compare(_("Height Scale")) == 0)
+	{
+		m_Commands.Submit(new ChangeTerrainCommand(m_SceneNode, "HeightScale",
+			wxString::FromCDouble(event.GetValue().GetDouble())));
+	}
+	else if (propName.compare(_("Chunk Size")) == 0)
+	{
+		m_Commands.Submit(new ChangeTerrainCommand(m_SceneNode, "ChunkSize",
+			wxString::Format("%ld", event.GetValue().GetLong())));
+	}
+	else if (propName.compare(_("LOD Distance")) == 0)
+	{
+		m_Commands.Submit(new ChangeTerrainCommand(m_SceneNode, "LodDistance",
+			wxString::FromCDouble(event.GetValue().GetDouble())));
+	}
 	else if (propName.compare(_("Ambient")) == 0)
 	{
 		irr::video::SColor color = valueToColor(event.GetValue());
@@ -689,21 +786,21 @@ void PropertyPanel::OnValueChanged(wxPropertyGridEvent& event)
 		{			
 			PropertyClientData* clientData = static_cast<PropertyClientData*>(property->GetClientData());
 
-			// look up the component type
-			irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = irr::scene::ESNAT_UNKNOWN;
+			// look up the component type, stored components are named by it
+			irr::scene::ESCENE_NODE_ANIMATOR_TYPE type = ComponentFactory::HashComponentName(
+				property->GetParent()->GetParent()->GetName());
+			if (!ComponentFactory::GetDefinition(type))
+				type = irr::scene::ESNAT_UNKNOWN;
+
 			const irr::scene::ISceneNodeAnimatorList animators = m_SceneNode->getAnimators();
 			for (irr::scene::ISceneNodeAnimatorList::ConstIterator i = animators.begin();
-				i != animators.end(); ++i)
+				type == irr::scene::ESNAT_UNKNOWN && i != animators.end(); ++i)
 			{
-				irr::u32 factoryCount = m_Map->GetSceneMgr()->getRegisteredSceneNodeAnimatorFactoryCount();
-				for (irr::u32 j = 0; j < factoryCount; ++j)
+				const irr::c8* typeName = m_Map->GetAnimatorTypeName((*i)->getType());
+				if (typeName && property->GetParent()->GetParent()->GetName() == typeName)
 				{
-					irr::scene::ISceneNodeAnimatorFactory* factory = m_Map->GetSceneMgr()->getSceneNodeAnimatorFactory(j);
-					if (factory->getCreateableSceneNodeAnimatorTypeName((*i)->getType()) == property->GetParent()->GetParent()->GetName())
-					{
-						type = (*i)->getType();
-						break;
-					}
+					type = (*i)->getType();
+					break;
 				}
 			}
 
@@ -726,6 +823,10 @@ void PropertyPanel::OnValueChanged(wxPropertyGridEvent& event)
 				m_SceneNode->getName(), m_Map, this, type, name, value));
 		}
 	}
+
+	// the node may have moved or changed size
+	if (m_ViewPanel)
+		m_ViewPanel->EntitiesMoved();
 }
 
 void PropertyPanel::AddAttribute(wxPGProperty* parent, const irr::io::E_ATTRIBUTE_TYPE& type, 
@@ -16,6 +16,7 @@
 
 #include "irrlicht.h"
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <vector>
@@ -29,11 +30,29 @@ class ViewPanel;
  * The PropertyPanel class provides a property grid panel for editing
  * object properties. It supports various property types and real-time
  * property updates.
+ *
+ * The grid is only rebuilt when the selection or the set of properties
+ * changes. While a node is being dragged only the transform rows whose
+ * value moved are updated, at most once per display refresh.
  */
 class PropertyPanel : public wxPanel
 {
 private:
+	/**
+	 * @struct TransformBinding
+	 * @brief A composed x/y/z row bound to the node value it shows
+	 */
+	struct TransformBinding
+	{
+		wxPGProperty* Axis[3];                                  ///< The x, y and z rows
+		irr::core::vector3df (*Get)(irr::scene::ISceneNode*);   ///< Reads the value from the node
+		irr::core::vector3df Shown;                             ///< Value the rows show
+	};
+
+	typedef std::chrono::steady_clock clock_t;
+
 	wxCommandProcessor& m_Commands;
+	ViewPanel* m_ViewPanel;
 	wxToolBar* m_ToolBar;
 	wxPropertyGrid* m_Properties;
 	wxPGProperty* m_GeneralProperties;
@@ -42,9 +61,9 @@ private:
 
 	irr::scene::ISceneNode* m_SceneNode;
 
-	wxFloatProperty* m_PosX;
-	wxFloatProperty* m_PosY;
-	wxFloatProperty* m_PosZ;
+	std::vector<TransformBinding> m_Transform;
+	clock_t::time_point m_LastUpdate;
+	clock_t::duration m_UpdateInterval;    ///< One display refresh
 
 	std::shared_ptr<Map> m_Map;
 
@@ -67,16 +86,28 @@ public:
 	 */
 	void SetMap(std::shared_ptr<Map>& map);
 
+	/**
+	 * @brief Set the view panel
+	 * @param viewPanel Pointer to the view panel
+	 */
+	void SetViewPanel(ViewPanel* viewPanel);
+
 	/**
 	 * @brief Clear the property panel
 	 */
 	void Clear(void);
 
 	/**
-	 * @brief Refresh the property panel
+	 * @brief Rebuild the property panel, after the node's properties changed
 	 */
 	void Refresh(void);
 
+	/**
+	 * @brief Update the position, rotation and scale rows that changed
+	 * @param force Update even if the last update was within a display refresh
+	 */
+	void UpdateTransform(bool force = false);
+
 	/**
 	 * @brief Set the scene node for the property panel
 	 * @param node Pointer to the scene node
@@ -84,6 +115,15 @@ public:
 	void SetSceneNode(irr::scene::ISceneNode* node);
 
 private:
+	/**
+	 * @brief Add a composed x/y/z row bound to a node value
+	 * @param label The row label
+	 * @param get Reads the value from the node
+	 * @return The composed row
+	 */
+	wxPGProperty* BindTransform(const wxString& label,
+		irr::core::vector3df (*get)(irr::scene::ISceneNode*));
+
 	/**
 	 * @brief Handle tool add events
 	 * @param event The command event
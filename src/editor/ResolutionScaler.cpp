@@ -0,0 +1,172 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "ResolutionScaler.hpp"
+
+ResolutionScaler::ResolutionScaler(irr::video::IVideoDriver* driver, irr::u32 views,
+	irr::video::SColor clearColor)
+	: m_Driver(driver), m_ClearColor(clearColor), m_Budget((irr::f32)DEFAULT_BUDGET),
+	  m_Drawing(0), m_Visible(views)
+{
+	m_Supported = m_Driver->queryFeature(irr::video::EVDF_RENDER_TO_TARGET);
+
+	View view;
+	view.Mode = MODE_AUTO;
+	view.Step = SCALE_STEPS;
+	view.FrameTime = 0;
+	view.Target = nullptr;
+	view.Scaled = false;
+	view.Drawn = false;
+	m_Views.resize(views, view);
+
+	m_LastActivity = clock_t::now();
+}
+
+ResolutionScaler::~ResolutionScaler(void)
+{
+	for (size_t i = 0; i < m_Views.size(); ++i)
+	{
+		if (m_Views[i].Target)
+			m_Driver->removeTexture(m_Views[i].Target);
+	}
+}
+
+void ResolutionScaler::SetBudget(irr::u32 milliseconds)
+{
+	m_Budget = (irr::f32)irr::core::max_(milliseconds, 1u);
+}
+
+void ResolutionScaler::SetMode(irr::u32 view, MODE mode)
+{
+	m_Views[view].Mode = mode;
+}
+
+void ResolutionScaler::Activity(void)
+{
+	m_LastActivity = clock_t::now();
+}
+
+void ResolutionScaler::Begin(irr::u32 view, const irr::core::recti& viewPort)
+{
+	View& state = m_Views[view];
+
+	// a view drawn twice means a new frame started
+	if (state.Drawn)
+	{
+		m_Visible = m_Drawing;
+		m_Drawing = 0;
+		for (size_t i = 0; i < m_Views.size(); ++i)
+			m_Views[i].Drawn = false;
+	}
+	state.Drawn = true;
+	++m_Drawing;
+
+	state.Start = clock_t::now();
+	state.ViewPort = viewPort;
+	state.Scaled = false;
+
+	irr::u32 step = GetStep(state);
+	if (step < SCALE_STEPS && m_Supported)
+	{
+		irr::core::dimension2du size(
+			irr::core::max_((irr::u32)viewPort.getWidth() * step / SCALE_STEPS, 1u),
+			irr::core::max_((irr::u32)viewPort.getHeight() * step / SCALE_STEPS, 1u));
+
+		if (state.Target && state.Target->getSize() != size)
+		{
+			m_Driver->removeTexture(state.Target);
+			state.Target = nullptr;
+		}
+
+		if (!state.Target)
+		{
+			irr::io::path name("#view");
+			name += view;
+			state.Target = m_Driver->addRenderTargetTexture(size, name, irr::video::ECF_A8R8G8B8);
+		}
+
+		if (state.Target && m_Driver->setRenderTarget(state.Target, true, true, m_ClearColor))
+		{
+			m_Driver->setViewPort(irr::core::recti(0, 0, size.Width, size.Height));
+			state.Scaled = true;
+			return;
+		}
+	}
+
+	m_Driver->setViewPort(viewPort);
+}
+
+void ResolutionScaler::End(irr::u32 view, const irr::core::recti& screen)
+{
+	View& state = m_Views[view];
+
+	if (state.Scaled)
+	{
+		// stretch the target over the view
+		const irr::core::dimension2du& size = state.Target->getSize();
+		m_Driver->setRenderTarget(nullptr, false, false);
+		m_Driver->setViewPort(screen);
+		m_Driver->draw2DImage(state.Target, state.ViewPort,
+			irr::core::recti(0, 0, size.Width, size.Height));
+		state.Scaled = false;
+	}
+
+	irr::f32 frameTime = std::chrono::duration<irr::f32, std::milli>(clock_t::now() - state.Start).count();
+	state.FrameTime = state.FrameTime == 0 ? frameTime : state.FrameTime * 0.8f + frameTime * 0.2f;
+
+	// an idle view is drawn at full size without losing the scale it'll need
+	// again, and the estimate from a full size draw says nothing about it
+	if (state.Mode != MODE_AUTO || IsIdle())
+		return;
+
+	// each view gets an even share of the frame
+	irr::f32 budget = m_Budget / irr::core::max_(irr::core::max_(m_Visible, m_Drawing), 1u);
+
+	// the time is roughly proportional to the pixels drawn; step by one at a
+	// time with room either side so it doesn't flicker between two sizes
+	if (state.FrameTime > budget && state.Step > MIN_SCALE_STEP)
+	{
+		--state.Step;
+		state.FrameTime = 0;
+	}
+	else if (state.Step < SCALE_STEPS && state.FrameTime > 0)
+	{
+		irr::f32 next = (irr::f32)(state.Step + 1) / state.Step;
+		if (state.FrameTime * next * next < budget * 0.8f)
+		{
+			++state.Step;
+			state.FrameTime = 0;
+		}
+	}
+}
+
+irr::u32 ResolutionScaler::GetScale(irr::u32 view) const
+{
+	if (!m_Supported)
+		return 100;
+
+	return GetStep(m_Views[view]) * 100 / SCALE_STEPS;
+}
+
+bool ResolutionScaler::IsIdle(void) const
+{
+	return clock_t::now() - m_LastActivity > std::chrono::milliseconds((int)IDLE_TIME);
+}
+
+irr::u32 ResolutionScaler::GetStep(const View& view) const
+{
+	switch (view.Mode)
+	{
+	case MODE_FULL:
+		return SCALE_STEPS;
+	case MODE_HALF:
+		return SCALE_STEPS / 2;
+	default:
+		break;
+	}
+
+	return IsIdle() ? (irr::u32)SCALE_STEPS : view.Step;
+}
@@ -0,0 +1,87 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <chrono>
+#include <vector>
+
+// Keeps the views within a frame time budget by drawing them into smaller
+// render targets and stretching those over the views. The budget is for the
+// whole frame and split evenly between the views drawn in it; each view's
+// scale is adjusted from its measured draw time against its share. Once the
+// views have been left alone for a moment they're drawn at full resolution
+// again.
+class ResolutionScaler
+{
+public:
+	enum MODE
+	{
+		MODE_AUTO,  // follow the budget
+		MODE_FULL,  // always full resolution
+		MODE_HALF,  // always half resolution
+	};
+
+	enum
+	{
+		DEFAULT_BUDGET = 40,    // ms per frame, the refresh timer's interval
+		IDLE_TIME = 500,        // ms without input before full resolution
+		SCALE_STEPS = 8,        // the scale moves in eighths
+		MIN_SCALE_STEP = 2,     // no lower than a quarter
+	};
+
+private:
+	typedef std::chrono::steady_clock clock_t;
+
+	struct View
+	{
+		MODE Mode;
+		irr::u32 Step;          // current scale, in SCALE_STEPS
+		irr::f32 FrameTime;     // smoothed, in ms
+		irr::video::ITexture* Target;
+		irr::core::recti ViewPort;
+		bool Scaled;            // drawing into the target right now
+		bool Drawn;             // begun in the current frame
+		clock_t::time_point Start;
+	};
+
+	irr::video::IVideoDriver* m_Driver;
+	irr::video::SColor m_ClearColor;
+	irr::f32 m_Budget;
+	bool m_Supported;
+
+	irr::u32 m_Drawing;     // views begun in the current frame
+	irr::u32 m_Visible;     // views drawn in the last whole frame
+
+	std::vector<View> m_Views;
+	clock_t::time_point m_LastActivity;
+
+public:
+	ResolutionScaler(irr::video::IVideoDriver* driver, irr::u32 views, irr::video::SColor clearColor);
+	~ResolutionScaler(void);
+
+	void SetBudget(irr::u32 milliseconds);
+
+	void SetMode(irr::u32 view, MODE mode);
+	MODE GetMode(irr::u32 view) const { return m_Views[view].Mode; }
+
+	// Called on input so the views drop to a lower resolution while in use
+	void Activity(void);
+
+	// Sets up the driver for drawing a view into the given part of the screen,
+	// End() puts the result there
+	void Begin(irr::u32 view, const irr::core::recti& viewPort);
+	void End(irr::u32 view, const irr::core::recti& screen);
+
+	// Percentage of full resolution the view was last drawn at
+	irr::u32 GetScale(irr::u32 view) const;
+
+private:
+	bool IsIdle(void) const;
+	irr::u32 GetStep(const View& view) const;
+};
@@ -204,6 +204,29 @@ void IrrSave::Finalize(void)
 	}
 }
 
+bool IrrSave::AddImage(const wxString& dest, irr::video::IImage* image)
+{
+	// next to the map, where the relative texture name finds it
+	wxFileName fileName(dest);
+	fileName.MakeAbsolute(m_FileName.GetPath());
+	if (!fileName.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		return false;
+
+	return m_VideoDriver->writeImageToFile(image,
+		fileName.GetFullPath().c_str().AsChar());
+}
+
+bool IrrSave::AddData(const wxString& dest, const void* data, size_t size)
+{
+	wxFileName fileName(dest);
+	fileName.MakeAbsolute(m_FileName.GetPath());
+	if (!fileName.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		return false;
+
+	wxFileOutputStream file(fileName.GetFullPath());
+	return file.IsOk() && file.WriteAll(data, size);
+}
+
 IrrLoad::IrrLoad(const wxFileName& fileName)
 	: Serializer(fileName)
 {
@@ -509,12 +532,15 @@ bool MmpSave::Next(irr::core::stringc& type, irr::io::IAttributes* attributes,
 			{
 				wxString location(texture->getName().getPath().c_str());
 
-				// first try to load the texture file directly from disk
+				// first see if it's an image already written to the package
 				wxFileName fileName(location);
-				if (fileName.IsOk() && fileName.IsFileReadable())
+				if (m_Entries.find(location) != m_Entries.end())
+					location = wxString::Format(wxT("%s:%s"), m_FileName.GetFullName(), location);
+				// then try to load the texture file directly from disk
+				else if (fileName.IsOk() && fileName.IsFileReadable())
 				{
 					wxString destPath = wxString::Format(wxT("textures/%s"), fileName.GetFullName());
-					if (AddFile(fileName, destPath))
+					if (m_Entries.find(destPath) != m_Entries.end() || AddFile(fileName, destPath))
 					{
 						// update the texture path to this package
 						location = wxString::Format(wxT("%s:%s"),
@@ -530,7 +556,13 @@ bool MmpSave::Next(irr::core::stringc& type, irr::io::IAttributes* attributes,
 					wxFileName filePath(location.substr(location.rfind(wxT(':')) + 1));
 
 					wxFileName fn(archivePath);
-					if (fn.GetFullName() == m_FileName.GetFullName() ||	// saving
+					if (m_Entries.find(filePath.GetFullPath(wxPATH_UNIX)) != m_Entries.end())
+					{
+						// already copied for another material
+						location = wxString::Format(wxT("%s:%s"),
+							m_FileName.GetFullName(), filePath.GetFullPath(wxPATH_UNIX));
+					}
+					else if (fn.GetFullName() == m_FileName.GetFullName() ||	// saving
 						fn.GetExt() == wxT("mmp")) // save as
 					{
 						// copy the the texture over
@@ -547,6 +579,8 @@ bool MmpSave::Next(irr::core::stringc& type, irr::io::IAttributes* attributes,
 								{
 									if (m_OutStream.CopyEntry(entry, inputStream))
 									{
+										m_Entries.insert(filePath.GetFullPath(wxPATH_UNIX));
+
 										// update the texture path to this package
 										location = wxString::Format(wxT("%s:%s"),
 											m_FileName.GetFullName(), entryPath.GetFullPath());
@@ -570,11 +604,11 @@ bool MmpSave::Next(irr::core::stringc& type, irr::io::IAttributes* attributes,
 					wxString outFileName(location.substr(location.rfind(wxT(':')) + 1));
 					location = wxString::Format(wxT("%s:%s"),
 						outPackageName.GetFullName(), outFileName);
-
-					// update the texture attributes
-					materials[i]->setAttribute(texId.ToStdString().c_str(), texture,
-						location.ToStdString().c_str());
 				}
+
+				// update the texture attributes
+				materials[i]->setAttribute(texId.ToStdString().c_str(), texture,
+					location.ToStdString().c_str());
 			}
 		}
 	}
@@ -617,9 +651,42 @@ bool MmpSave::AddFile(const wxFileName& source, const wxString& dest)
 	size_t size = srcFile.GetSize();
 	m_OutStream.Write(srcFile);
 
+	m_Entries.insert(dest);
 	return true;
 }
 
+bool MmpSave::AddImage(const wxString& dest, irr::video::IImage* image)
+{
+	if (m_Entries.find(dest) != m_Entries.end())
+		return true;
+
+	// the writer is picked by the name's extension
+	StreamWriteFile* file = new StreamWriteFile(dest);
+	bool written = m_VideoDriver->writeImageToFile(image, file);
+	if (written)
+	{
+		wxMemoryInputStream imageStream(file->GetStream());
+		written = m_OutStream.PutNextEntry(dest);
+		if (written)
+		{
+			m_OutStream.Write(imageStream);
+			m_Entries.insert(dest);
+		}
+	}
+
+	file->drop();
+	return written;
+}
+
+bool MmpSave::AddData(const wxString& dest, const void* data, size_t size)
+{
+	if (m_Entries.find(dest) != m_Entries.end() || !m_OutStream.PutNextEntry(dest))
+		return false;
+
+	m_Entries.insert(dest);
+	return m_OutStream.WriteAll(data, size);
+}
+
 MmpLoad::MmpLoad(const wxFileName& fileName)
 	: IrrLoad(fileName), m_InFile(fileName.GetFullPath()),
 	m_InStream(m_InFile)
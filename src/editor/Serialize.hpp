@@ -16,6 +16,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 
 class Map;
 class Serializer;
@@ -89,6 +90,13 @@ public:
 		irr::core::array<irr::io::IAttributes*>& materials, irr::core::array<irr::io::IAttributes*>& animators, 
 		irr::io::IAttributes* userData, bool& child) = 0;
 	virtual void Finalize(void) = 0;
+
+	// Saves an image the map made, such as a lightmap, to a path relative
+	// to the map. Called after Begin.
+	virtual bool AddImage(const wxString& dest, irr::video::IImage* image) { return false; }
+
+	// Saves data the map built, such as the navigation mesh, the same way
+	virtual bool AddData(const wxString& dest, const void* data, size_t size) { return false; }
 };
 
 // process .irr XML files
@@ -107,6 +115,9 @@ public:
 		irr::core::array<irr::io::IAttributes*>& materials, irr::core::array<irr::io::IAttributes*>& animators, 
 		irr::io::IAttributes* userData, bool& child);
 	virtual void Finalize(void);
+
+	virtual bool AddImage(const wxString& dest, irr::video::IImage* image);
+	virtual bool AddData(const wxString& dest, const void* data, size_t size);
 };
 
 class IrrLoad : public Serializer
@@ -137,6 +148,9 @@ protected:
 	wxTempFileOutputStream m_OutFile;
 	wxZipOutputStream m_OutStream;
 
+	// a texture shared by several materials is only stored once
+	std::set<wxString> m_Entries;
+
 public:
 	MmpSave(const wxFileName& fileName);
 	virtual ~MmpSave(void);
@@ -147,6 +161,9 @@ public:
 		irr::io::IAttributes* userData, bool& child);
 	virtual void Finalize(void);
 
+	virtual bool AddImage(const wxString& dest, irr::video::IImage* image);
+	virtual bool AddData(const wxString& dest, const void* data, size_t size);
+
 protected:
 	bool AddFile(const wxFileName& source, const wxString& dest);
 };
@@ -0,0 +1,230 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "SoundCache.hpp"
+#include "FSHandler.hpp"
+
+#include <wx/datstrm.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+#include <wx/wfstream.h>
+
+static const wxUint32 CACHE_MAGIC = 0x434D534D; // 'MSMC'
+static const wxUint32 CACHE_VERSION = 1;
+
+static const wxUint32 PEAKS_MAGIC = 0x4B50534D; // 'MSPK'
+static const wxUint32 PEAKS_VERSION = 1;
+
+static wxString MakeKey(const wxString& package, const wxString& entry)
+{
+	wxString key(package);
+	key.append(wxT('|'));
+	key.append(entry);
+	return key;
+}
+
+SoundMetadataCache::SoundMetadataCache(const wxFileName& fileName)
+	: m_FileName(fileName), m_Dirty(false)
+{
+}
+
+SoundMetadataCache::~SoundMetadataCache(void)
+{
+	Save();
+}
+
+bool SoundMetadataCache::Load(void)
+{
+	m_Entries.clear();
+	m_Dirty = false;
+
+	if (!m_FileName.FileExists())
+		return false;
+
+	wxFileInputStream file(m_FileName.GetFullPath());
+	if (!file.IsOk())
+		return false;
+
+	wxDataInputStream data(file);
+	if (data.Read32() != CACHE_MAGIC || data.Read32() != CACHE_VERSION)
+	{
+		wxLogWarning(_("Ignoring outdated sound cache: %s"), m_FileName.GetFullPath());
+		return false;
+	}
+
+	wxUint32 count = data.Read32();
+	for (wxUint32 i = 0; i < count && file.IsOk(); ++i)
+	{
+		wxString key = data.ReadString();
+
+		CacheEntry entry;
+		entry.modified = (wxInt64)data.Read64();
+		entry.metadata.sampleRate = data.Read32();
+		entry.metadata.channels = data.Read32();
+		entry.metadata.duration = data.ReadDouble();
+		entry.metadata.format = data.ReadString();
+
+		if (!file.IsOk())
+			break; // truncated, keep what we have
+
+		m_Entries[key] = entry;
+	}
+
+	return true;
+}
+
+bool SoundMetadataCache::Save(void)
+{
+	if (!m_Dirty)
+		return true;
+
+	wxFileOutputStream file(m_FileName.GetFullPath());
+	if (!file.IsOk())
+	{
+		wxLogWarning(_("Failed to write sound cache: %s"), m_FileName.GetFullPath());
+		return false;
+	}
+
+	wxDataOutputStream data(file);
+	data.Write32(CACHE_MAGIC);
+	data.Write32(CACHE_VERSION);
+	data.Write32((wxUint32)m_Entries.size());
+
+	for (entries_t::const_iterator i = m_Entries.begin(); i != m_Entries.end(); ++i)
+	{
+		data.WriteString(i->first);
+		data.Write64((wxUint64)i->second.modified);
+		data.Write32(i->second.metadata.sampleRate);
+		data.Write32(i->second.metadata.channels);
+		data.WriteDouble(i->second.metadata.duration);
+		data.WriteString(i->second.metadata.format);
+	}
+
+	m_Dirty = false;
+	return file.IsOk();
+}
+
+bool SoundMetadataCache::Find(const wxString& package, const wxString& entry, wxInt64 modified,
+	SoundMetadata& metadata) const
+{
+	entries_t::const_iterator i = m_Entries.find(MakeKey(package, entry));
+	if (i == m_Entries.end() || i->second.modified != modified)
+		return false;
+
+	metadata = i->second.metadata;
+	return true;
+}
+
+void SoundMetadataCache::Store(const wxString& package, const wxString& entry, wxInt64 modified,
+	const SoundMetadata& metadata)
+{
+	CacheEntry& cached = m_Entries[MakeKey(package, entry)];
+	cached.modified = modified;
+	cached.metadata = metadata;
+	m_Dirty = true;
+}
+
+wxInt64 SoundMetadataCache::GetModified(const wxString& package)
+{
+	return (wxInt64)wxFileModificationTime(package);
+}
+
+wxString SoundMetadataCache::MakeKey(const wxString& package, const wxString& entry)
+{
+	return ::MakeKey(package, entry);
+}
+
+SoundPeakCache::SoundPeakCache(const wxString& subDir)
+	: m_SubDir(subDir)
+{
+}
+
+std::shared_ptr<SoundPeaks> SoundPeakCache::Find(const wxString& package, const wxString& entry,
+	wxInt64 modified) const
+{
+	wxString key(MakeKey(package, entry));
+	wxFileName fileName(GetFileName(key));
+	if (!fileName.FileExists())
+		return nullptr;
+
+	wxFileInputStream file(fileName.GetFullPath());
+	if (!file.IsOk())
+		return nullptr;
+
+	wxDataInputStream data(file);
+	if (data.Read32() != PEAKS_MAGIC || data.Read32() != PEAKS_VERSION)
+		return nullptr;
+
+	// the name is a hash, so make sure it's really this sound and still current
+	if (data.ReadString() != key || (wxInt64)data.Read64() != modified)
+		return nullptr;
+
+	std::shared_ptr<SoundPeaks> peaks(new SoundPeaks);
+	peaks->sampleRate = data.Read32();
+	peaks->frameCount = data.Read64();
+
+	wxUint32 levelCount = data.Read32();
+	for (wxUint32 i = 0; i < levelCount && file.IsOk(); ++i)
+	{
+		wxUint32 size = data.Read32();
+		if (!file.IsOk() || size == 0)
+			return nullptr;
+
+		peaks->levels.push_back(std::vector<int8_t>(size));
+		data.Read8((wxUint8*)peaks->levels.back().data(), size);
+	}
+
+	if (!file.IsOk() || peaks->levels.empty())
+		return nullptr; // truncated, rebuild it
+
+	return peaks;
+}
+
+bool SoundPeakCache::Store(const wxString& package, const wxString& entry, wxInt64 modified,
+	const SoundPeaks& peaks)
+{
+	wxString key(MakeKey(package, entry));
+	wxFileName fileName(GetFileName(key));
+
+	wxFileOutputStream file(fileName.GetFullPath());
+	if (!file.IsOk())
+	{
+		wxLogWarning(_("Failed to write waveform cache: %s"), fileName.GetFullPath());
+		return false;
+	}
+
+	wxDataOutputStream data(file);
+	data.Write32(PEAKS_MAGIC);
+	data.Write32(PEAKS_VERSION);
+	data.WriteString(key);
+	data.Write64((wxUint64)modified);
+	data.Write32(peaks.sampleRate);
+	data.Write64((wxUint64)peaks.frameCount);
+
+	data.Write32((wxUint32)peaks.levels.size());
+	for (size_t i = 0; i < peaks.levels.size(); ++i)
+	{
+		data.Write32((wxUint32)peaks.levels[i].size());
+		data.Write8((const wxUint8*)peaks.levels[i].data(), peaks.levels[i].size());
+	}
+
+	return file.IsOk();
+}
+
+wxFileName SoundPeakCache::GetFileName(const wxString& key) const
+{
+	// 64-bit FNV-1a of the key keeps the names short and filesystem safe
+	wxUint64 hash = 14695981039346656037ULL;
+	wxScopedCharBuffer utf8(key.utf8_str());
+	for (size_t i = 0; i < utf8.length(); ++i)
+	{
+		hash ^= (wxUint8)utf8[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return CacheFileName(wxString::Format(wxT("%08x%08x.peaks"),
+		(unsigned int)(hash >> 32), (unsigned int)(hash & 0xFFFFFFFF)), m_SubDir);
+}
@@ -0,0 +1,70 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "AudioSystem.hpp"
+
+#include <wx/filename.h>
+
+#include <map>
+#include <memory>
+
+// Persistent sound metadata, keyed by package and entry. An entry is only
+// valid while the package's modification time matches the one recorded.
+class SoundMetadataCache
+{
+private:
+	struct CacheEntry
+	{
+		wxInt64 modified;
+		SoundMetadata metadata;
+	};
+
+	typedef std::map<wxString, CacheEntry> entries_t;
+	entries_t m_Entries;
+
+	wxFileName m_FileName;
+	bool m_Dirty;
+
+public:
+	SoundMetadataCache(const wxFileName& fileName);
+	~SoundMetadataCache(void);
+
+	bool Load(void);
+	bool Save(void);
+
+	bool Find(const wxString& package, const wxString& entry, wxInt64 modified,
+		SoundMetadata& metadata) const;
+	void Store(const wxString& package, const wxString& entry, wxInt64 modified,
+		const SoundMetadata& metadata);
+
+	// Modification time used to validate entries for a package or loose file
+	static wxInt64 GetModified(const wxString& package);
+
+private:
+	static wxString MakeKey(const wxString& package, const wxString& entry);
+};
+
+// Persistent waveform peak pyramids, one file per sound in a cache sub folder
+// next to the metadata cache. Like the metadata, a file is only used while
+// the package's modification time matches the one it was built from.
+class SoundPeakCache
+{
+private:
+	wxString m_SubDir;
+
+public:
+	SoundPeakCache(const wxString& subDir);
+
+	std::shared_ptr<SoundPeaks> Find(const wxString& package, const wxString& entry,
+		wxInt64 modified) const;
+	bool Store(const wxString& package, const wxString& entry, wxInt64 modified,
+		const SoundPeaks& peaks);
+
+private:
+	wxFileName GetFileName(const wxString& key) const;
+};
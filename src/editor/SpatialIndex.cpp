@@ -0,0 +1,193 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "Common.hpp"
+#include "SpatialIndex.hpp"
+
+#include <algorithm>
+
+struct CompareEntryCentre
+{
+	int Axis;
+
+	bool operator()(const SpatialIndex::Entry& a, const SpatialIndex::Entry& b) const
+	{
+		return (&a.Centre.X)[Axis] < (&b.Centre.X)[Axis];
+	}
+};
+
+SpatialIndex::SpatialIndex(void)
+	: m_State(STATE_STALE)
+{
+}
+
+void SpatialIndex::Build(irr::scene::ISceneNode* mapRoot)
+{
+	Clear();
+	Collect(mapRoot);
+
+	if (!m_Entries.empty())
+		BuildNode(0, (irr::u32)m_Entries.size());
+
+	m_State = STATE_CURRENT;
+}
+
+void SpatialIndex::Clear(void)
+{
+	m_Entries.clear();
+	m_Nodes.clear();
+	m_State = STATE_STALE;
+}
+
+void SpatialIndex::Update(irr::scene::ISceneNode* mapRoot)
+{
+	if (m_State == STATE_STALE)
+		Build(mapRoot);
+	else if (m_State == STATE_MOVED)
+		Refit();
+}
+
+void SpatialIndex::Query(const irr::core::plane3df* planes, irr::u32 planeCount,
+	std::vector<irr::scene::ISceneNode*>& nodes) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	// every plane starts out clipping
+	QueryNode(0, planes, planeCount, (1u << planeCount) - 1, nodes);
+}
+
+void SpatialIndex::Collect(irr::scene::ISceneNode* node)
+{
+	irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+	for (; child != node->getChildren().end(); ++child)
+	{
+		Collect(*child);
+
+		// the sky surrounds everything, it's only ever picked directly
+		if (((*child)->getID() & NID_PICKABLE) == 0 ||
+			(*child)->getType() == irr::scene::ESNT_SKY_BOX ||
+			(*child)->getType() == irr::scene::ESNT_SKY_DOME)
+			continue;
+
+		Entry entry;
+		entry.Box = (*child)->getTransformedBoundingBox();
+		entry.Centre = entry.Box.getCenter();
+		entry.Node = *child;
+		m_Entries.push_back(entry);
+	}
+}
+
+void SpatialIndex::BuildNode(irr::u32 first, irr::u32 count)
+{
+	irr::u32 index = (irr::u32)m_Nodes.size();
+	m_Nodes.push_back(Node());
+
+	irr::core::aabbox3df bounds(m_Entries[first].Box);
+	irr::core::aabbox3df centres(m_Entries[first].Centre);
+	for (irr::u32 i = first + 1; i < first + count; ++i)
+	{
+		bounds.addInternalBox(m_Entries[i].Box);
+		centres.addInternalPoint(m_Entries[i].Centre);
+	}
+
+	m_Nodes[index].Box = bounds;
+	m_Nodes[index].First = first;
+	m_Nodes[index].Count = count;
+	m_Nodes[index].Right = 0;
+
+	if (count <= LEAF_SIZE)
+		return;
+
+	// split at the median along the widest spread of centres
+	irr::core::vector3df extent = centres.getExtent();
+	CompareEntryCentre compare;
+	compare.Axis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+
+	irr::u32 half = count / 2;
+	std::nth_element(m_Entries.begin() + first, m_Entries.begin() + first + half,
+		m_Entries.begin() + first + count, compare);
+
+	BuildNode(first, half);
+
+	// the vector may have grown, so don't hold on to the node
+	m_Nodes[index].Right = (irr::u32)m_Nodes.size();
+	BuildNode(first + half, count - half);
+}
+
+void SpatialIndex::Refit(void)
+{
+	for (size_t i = 0; i < m_Entries.size(); ++i)
+	{
+		m_Entries[i].Box = m_Entries[i].Node->getTransformedBoundingBox();
+		m_Entries[i].Centre = m_Entries[i].Box.getCenter();
+	}
+
+	// children always come after their parent, so walk backwards
+	for (size_t i = m_Nodes.size(); i-- > 0; )
+	{
+		Node& node = m_Nodes[i];
+		if (node.Right == 0)
+		{
+			node.Box = m_Entries[node.First].Box;
+			for (irr::u32 e = node.First + 1; e < node.First + node.Count; ++e)
+				node.Box.addInternalBox(m_Entries[e].Box);
+		}
+		else
+		{
+			node.Box = m_Nodes[i + 1].Box;
+			node.Box.addInternalBox(m_Nodes[node.Right].Box);
+		}
+	}
+
+	m_State = STATE_CURRENT;
+}
+
+void SpatialIndex::QueryNode(irr::u32 index, const irr::core::plane3df* planes, irr::u32 planeCount,
+	irr::u32 clipped, std::vector<irr::scene::ISceneNode*>& nodes) const
+{
+	const Node& node = m_Nodes[index];
+	for (irr::u32 i = 0; i < planeCount; ++i)
+	{
+		if ((clipped & (1u << i)) == 0)
+			continue; // the parent was already behind this plane
+
+		irr::core::EIntersectionRelation3D relation = node.Box.classifyPlaneRelation(planes[i]);
+		if (relation == irr::core::ISREL3D_FRONT)
+			return;
+		if (relation == irr::core::ISREL3D_BACK)
+			clipped &= ~(1u << i);
+	}
+
+	if (clipped == 0)
+	{
+		// wholly inside, take everything under it without more tests
+		for (irr::u32 i = node.First; i < node.First + node.Count; ++i)
+			nodes.push_back(m_Entries[i].Node);
+		return;
+	}
+
+	if (node.Right == 0)
+	{
+		for (irr::u32 i = node.First; i < node.First + node.Count; ++i)
+		{
+			bool outside = false;
+			for (irr::u32 p = 0; p < planeCount && !outside; ++p)
+			{
+				if ((clipped & (1u << p)) &&
+					m_Entries[i].Box.classifyPlaneRelation(planes[p]) == irr::core::ISREL3D_FRONT)
+					outside = true;
+			}
+
+			if (!outside)
+				nodes.push_back(m_Entries[i].Node);
+		}
+		return;
+	}
+
+	QueryNode(index + 1, planes, planeCount, clipped, nodes);
+	QueryNode(node.Right, planes, planeCount, clipped, nodes);
+}
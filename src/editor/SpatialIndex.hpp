@@ -0,0 +1,76 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <vector>
+
+// Bounding volume hierarchy over the world boxes of the pickable entities.
+// It's kept between queries: edits that add or remove entities invalidate it
+// and edits that only move or resize them mark it for a refit, and Update
+// does whichever is pending before a query.
+class SpatialIndex
+{
+public:
+	enum { LEAF_SIZE = 8 };
+
+	struct Entry
+	{
+		irr::core::aabbox3df Box;
+		irr::core::vector3df Centre;
+		irr::scene::ISceneNode* Node;
+	};
+
+	struct Node
+	{
+		irr::core::aabbox3df Box;
+		irr::u32 First;   // entries covered by the node
+		irr::u32 Count;
+		irr::u32 Right;   // right child of an inner node, 0 for a leaf
+	};
+
+private:
+	enum State
+	{
+		STATE_CURRENT,
+		STATE_MOVED,    // same entities, the boxes need refitting
+		STATE_STALE,    // entities came or went, needs a rebuild
+	};
+
+	std::vector<Entry> m_Entries;
+	std::vector<Node> m_Nodes;
+	State m_State;
+
+public:
+	SpatialIndex(void);
+
+	void Build(irr::scene::ISceneNode* mapRoot);
+	void Clear(void);
+
+	// Entities were added or removed
+	void Invalidate(void) { m_State = STATE_STALE; }
+
+	// Entities were moved or resized
+	void MarkMoved(void) { if (m_State == STATE_CURRENT) m_State = STATE_MOVED; }
+
+	// Rebuilds or refits if an edit called for it
+	void Update(irr::scene::ISceneNode* mapRoot);
+
+	irr::u32 GetCount(void) const { return (irr::u32)m_Entries.size(); }
+
+	// Entities whose box is not entirely in front of any of the planes
+	void Query(const irr::core::plane3df* planes, irr::u32 planeCount,
+		std::vector<irr::scene::ISceneNode*>& nodes) const;
+
+private:
+	void Collect(irr::scene::ISceneNode* node);
+	void BuildNode(irr::u32 first, irr::u32 count);
+	void Refit(void);
+	void QueryNode(irr::u32 index, const irr::core::plane3df* planes, irr::u32 planeCount,
+		irr::u32 clipped, std::vector<irr::scene::ISceneNode*>& nodes) const;
+};
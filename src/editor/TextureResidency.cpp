@@ -0,0 +1,305 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "TextureResidency.hpp"
+
+#include <algorithm>
+
+TextureResidency::TextureResidency(irr::scene::ISceneManager* sceneMgr)
+	: m_SceneMgr(sceneMgr), m_Driver(sceneMgr->getVideoDriver()),
+	  m_Budget((irr::u64)DEFAULT_BUDGET * 1024 * 1024), m_Bytes(0),
+	  m_Frame(0), m_Evicted(0), m_ProxiesMade(0), m_ProxyDistance(40.0f)
+{
+}
+
+TextureResidency::~TextureResidency(void)
+{
+	Restore();
+
+	for (entrymap_t::iterator entry = m_Textures.begin();
+		entry != m_Textures.end(); ++entry)
+	{
+		if (entry->second.Proxy)
+			m_Driver->removeTexture(entry->second.Proxy);
+	}
+}
+
+void TextureResidency::SetBudget(irr::u64 bytes)
+{
+	m_Budget = bytes;
+}
+
+void TextureResidency::SetProxyDistance(irr::f32 radii)
+{
+	m_ProxyDistance = radii;
+}
+
+void TextureResidency::Update(irr::scene::ISceneNode* mapRoot)
+{
+	Restore(); // never track the proxies
+
+	++m_Frame;
+	m_ProxiesMade = 0;
+
+	// everything a material can still reach must stay loaded, including the
+	// editor's own nodes and the meshes in the cache
+	std::set<irr::video::ITexture*> referenced;
+	Track(m_SceneMgr->getRootSceneNode(), mapRoot, false, true, referenced);
+
+	irr::scene::IMeshCache* meshCache = m_SceneMgr->getMeshCache();
+	for (irr::u32 i = 0; i < meshCache->getMeshCount(); ++i)
+	{
+		irr::scene::IAnimatedMesh* mesh = meshCache->getMeshByIndex(i);
+		if (!mesh)
+			continue;
+
+		for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		{
+			const irr::video::SMaterial& material = mesh->getMeshBuffer(b)->getMaterial();
+			for (irr::u32 l = 0; l < irr::video::MATERIAL_MAX_TEXTURES; ++l)
+			{
+				if (material.TextureLayer[l].Texture)
+					referenced.insert(material.TextureLayer[l].Texture);
+			}
+		}
+	}
+
+	if (m_Bytes > m_Budget)
+		Evict(referenced);
+}
+
+void TextureResidency::UseProxies(irr::scene::ISceneNode* mapRoot,
+	irr::scene::ICameraSceneNode* camera, bool ortho)
+{
+	Restore();
+
+	if (!camera)
+		return;
+
+	irr::core::vector3df eye(camera->getAbsolutePosition());
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = mapRoot->getChildren().begin();
+		child != mapRoot->getChildren().end(); ++child)
+		Proxy(*child, eye, ortho);
+}
+
+void TextureResidency::Restore(void)
+{
+	// in reverse, in case a material was visited twice
+	for (std::vector<Swap>::reverse_iterator swap = m_Swaps.rbegin();
+		swap != m_Swaps.rend(); ++swap)
+		swap->Material->TextureLayer[swap->Layer].Texture = swap->Texture;
+
+	m_Swaps.clear();
+}
+
+TextureResidency::Stats TextureResidency::GetStats(void) const
+{
+	Stats stats;
+	stats.Textures = (irr::u32)m_Textures.size();
+	stats.Proxies = 0;
+	stats.Evicted = m_Evicted;
+	stats.Bytes = m_Bytes;
+	stats.Budget = m_Budget;
+
+	for (entrymap_t::const_iterator entry = m_Textures.begin();
+		entry != m_Textures.end(); ++entry)
+	{
+		if (entry->second.Proxy)
+			++stats.Proxies;
+	}
+
+	return stats;
+}
+
+void TextureResidency::Track(irr::scene::ISceneNode* node, irr::scene::ISceneNode* mapRoot,
+	bool mapNode, bool visible, std::set<irr::video::ITexture*>& referenced)
+{
+	visible = visible && node->isVisible();
+	mapNode = mapNode || node == mapRoot;
+
+	for (irr::u32 i = 0; i < node->getMaterialCount(); ++i)
+	{
+		const irr::video::SMaterial& material = node->getMaterial(i);
+		for (irr::u32 l = 0; l < irr::video::MATERIAL_MAX_TEXTURES; ++l)
+		{
+			irr::video::ITexture* texture = material.TextureLayer[l].Texture;
+			if (!texture)
+				continue;
+
+			referenced.insert(texture);
+
+			// only the map's textures are managed, the editor's own stay put
+			entrymap_t::iterator entry = m_Textures.find(texture);
+			if (entry == m_Textures.end())
+			{
+				if (!mapNode)
+					continue;
+
+				Entry newEntry;
+				newEntry.LastUsed = m_Frame;
+				newEntry.Bytes = GetBytes(texture);
+				newEntry.Proxy = nullptr;
+				newEntry.ProxyBytes = 0;
+				newEntry.NoProxy = false;
+				entry = m_Textures.emplace(texture, newEntry).first;
+				m_Bytes += newEntry.Bytes;
+			}
+
+			if (visible)
+				entry->second.LastUsed = m_Frame;
+		}
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+		child != node->getChildren().end(); ++child)
+		Track(*child, mapRoot, mapNode, visible, referenced);
+}
+
+void TextureResidency::Proxy(irr::scene::ISceneNode* node, const irr::core::vector3df& eye, bool ortho)
+{
+	if (!node->isVisible())
+		return;
+
+	bool distant = ortho;
+	if (!distant)
+	{
+		const irr::core::aabbox3df& box = node->getTransformedBoundingBox();
+		irr::f32 radius = box.getExtent().getLength() * 0.5f;
+		distant = radius > 0.0f &&
+			eye.getDistanceFrom(box.getCenter()) > radius * m_ProxyDistance;
+	}
+
+	if (distant)
+	{
+		for (irr::u32 i = 0; i < node->getMaterialCount(); ++i)
+		{
+			irr::video::SMaterial& material = node->getMaterial(i);
+			for (irr::u32 l = 0; l < irr::video::MATERIAL_MAX_TEXTURES; ++l)
+			{
+				entrymap_t::iterator entry = m_Textures.find(material.TextureLayer[l].Texture);
+				if (entry == m_Textures.end())
+					continue;
+
+				if (!entry->second.Proxy && !entry->second.NoProxy)
+				{
+					if (m_ProxiesMade >= PROXIES_PER_FRAME)
+						continue; // use the full texture until there's time
+
+					++m_ProxiesMade;
+					entry->second.Proxy = CreateProxy(entry->first, entry->second.ProxyBytes);
+					entry->second.NoProxy = entry->second.Proxy == nullptr;
+					m_Bytes += entry->second.ProxyBytes;
+				}
+
+				if (entry->second.Proxy)
+				{
+					Swap swap;
+					swap.Material = &material;
+					swap.Layer = l;
+					swap.Texture = entry->first;
+					m_Swaps.push_back(swap);
+
+					material.TextureLayer[l].Texture = entry->second.Proxy;
+				}
+			}
+		}
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+		child != node->getChildren().end(); ++child)
+		Proxy(*child, eye, ortho);
+}
+
+static bool CompareLastUsed(const std::pair<irr::u32, irr::video::ITexture*>& a,
+	const std::pair<irr::u32, irr::video::ITexture*>& b)
+{
+	return a.first < b.first;
+}
+
+void TextureResidency::Evict(const std::set<irr::video::ITexture*>& referenced)
+{
+	// only the driver's cache may hold what gets evicted; undo history keeps
+	// its own reference to textures of deleted nodes
+	std::vector<std::pair<irr::u32, irr::video::ITexture*>> candidates;
+	for (entrymap_t::iterator entry = m_Textures.begin();
+		entry != m_Textures.end(); ++entry)
+	{
+		if (referenced.find(entry->first) == referenced.end() &&
+			entry->first->getReferenceCount() == 1)
+			candidates.push_back(std::make_pair(entry->second.LastUsed, entry->first));
+	}
+
+	std::sort(candidates.begin(), candidates.end(), CompareLastUsed);
+
+	for (size_t i = 0; i < candidates.size() && m_Bytes > m_Budget; ++i)
+	{
+		entrymap_t::iterator entry = m_Textures.find(candidates[i].second);
+		if (entry->second.Proxy)
+			m_Driver->removeTexture(entry->second.Proxy);
+
+		m_Bytes -= entry->second.Bytes + entry->second.ProxyBytes;
+		m_Driver->removeTexture(entry->first);
+		m_Textures.erase(entry);
+		++m_Evicted;
+	}
+}
+
+irr::video::ITexture* TextureResidency::CreateProxy(irr::video::ITexture* texture, irr::u64& bytes)
+{
+	bytes = 0;
+
+	const irr::core::dimension2du& size = texture->getSize();
+	if (size.Width <= MIN_PROXY_SIZE && size.Height <= MIN_PROXY_SIZE)
+		return nullptr;
+
+	// only plain formats can be scaled, and only tightly packed ones copied
+	irr::video::ECOLOR_FORMAT format = texture->getColorFormat();
+	if (format != irr::video::ECF_A1R5G5B5 && format != irr::video::ECF_R5G6B5 &&
+		format != irr::video::ECF_R8G8B8 && format != irr::video::ECF_A8R8G8B8)
+		return nullptr;
+
+	if (texture->getPitch() != size.Width * irr::video::IImage::getBitsPerPixelFromFormat(format) / 8)
+		return nullptr;
+
+	// the null driver's textures have no data to read back
+	void* data = texture->lock(irr::video::ETLM_READ_ONLY);
+	if (!data)
+		return nullptr;
+
+	irr::video::IImage* image = m_Driver->createImageFromData(format, size, data, false, false);
+	texture->unlock();
+	if (!image)
+		return nullptr;
+
+	irr::core::dimension2du reduced(irr::core::max_(size.Width >> PROXY_SHIFT, 1u),
+		irr::core::max_(size.Height >> PROXY_SHIFT, 1u));
+	irr::video::IImage* scaled = m_Driver->createImage(format, reduced);
+	image->copyToScaling(scaled);
+	image->drop();
+
+	irr::io::path name(texture->getName().getPath());
+	name += "#proxy";
+	irr::video::ITexture* proxy = m_Driver->addTexture(name, scaled);
+	scaled->drop();
+
+	if (proxy)
+		bytes = GetBytes(proxy);
+
+	return proxy;
+}
+
+irr::u64 TextureResidency::GetBytes(irr::video::ITexture* texture)
+{
+	const irr::core::dimension2du& size = texture->getSize();
+	irr::u64 bytes = (irr::u64)size.Width * size.Height *
+		irr::video::IImage::getBitsPerPixelFromFormat(texture->getColorFormat()) / 8;
+
+	// the mip chain adds a third
+	if (texture->hasMipMaps())
+		bytes += bytes / 3;
+
+	return bytes;
+}
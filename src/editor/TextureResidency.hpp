@@ -0,0 +1,99 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+// Keeps the textures used by the map within a memory budget. Textures that no
+// material references any more are evicted least recently used first, and
+// views that can't show full detail (orthographic views, distant objects) are
+// drawn with reduced proxies. Proxies are only swapped into the materials for
+// the duration of a draw, so saving and undo always see the real textures.
+class TextureResidency
+{
+public:
+	enum
+	{
+		PROXY_SHIFT = 2,        // proxies are 1/4 of the size in each direction
+		MIN_PROXY_SIZE = 64,    // smaller textures aren't worth a proxy
+		PROXIES_PER_FRAME = 4,  // spreads the read back over several frames
+		DEFAULT_BUDGET = 256,   // MB
+	};
+
+	struct Stats
+	{
+		irr::u32 Textures;
+		irr::u32 Proxies;
+		irr::u32 Evicted;
+		irr::u64 Bytes;
+		irr::u64 Budget;
+	};
+
+private:
+	struct Entry
+	{
+		irr::u32 LastUsed; // frame the texture was last on a visible node
+		irr::u64 Bytes;
+		irr::video::ITexture* Proxy;
+		irr::u64 ProxyBytes;
+		bool NoProxy; // can't be read back, e.g. with the null driver
+	};
+
+	struct Swap
+	{
+		irr::video::SMaterial* Material;
+		irr::u32 Layer;
+		irr::video::ITexture* Texture;
+	};
+
+	irr::scene::ISceneManager* m_SceneMgr;
+	irr::video::IVideoDriver* m_Driver;
+
+	typedef std::map<irr::video::ITexture*, Entry> entrymap_t;
+	entrymap_t m_Textures;
+	std::vector<Swap> m_Swaps;
+
+	irr::u64 m_Budget;
+	irr::u64 m_Bytes;
+	irr::u32 m_Frame;
+	irr::u32 m_Evicted;
+	irr::u32 m_ProxiesMade;
+	irr::f32 m_ProxyDistance;
+
+public:
+	TextureResidency(irr::scene::ISceneManager* sceneMgr);
+	~TextureResidency(void);
+
+	void SetBudget(irr::u64 bytes);
+
+	// Distance, in multiples of an object's radius, beyond which it's drawn with proxies
+	void SetProxyDistance(irr::f32 radii);
+
+	// Once per frame before drawing; tracks the textures under the map root
+	// and evicts unreferenced ones while over budget
+	void Update(irr::scene::ISceneNode* mapRoot);
+
+	// Swaps in the proxies for a view; every node in orthographic views, only
+	// distant nodes otherwise. Restore() must be called after drawing.
+	void UseProxies(irr::scene::ISceneNode* mapRoot, irr::scene::ICameraSceneNode* camera, bool ortho);
+	void Restore(void);
+
+	Stats GetStats(void) const;
+
+private:
+	void Track(irr::scene::ISceneNode* node, irr::scene::ISceneNode* mapRoot, bool mapNode, bool visible,
+		std::set<irr::video::ITexture*>& referenced);
+	void Proxy(irr::scene::ISceneNode* node, const irr::core::vector3df& eye, bool ortho);
+	void Evict(const std::set<irr::video::ITexture*>& referenced);
+
+	irr::video::ITexture* CreateProxy(irr::video::ITexture* texture, irr::u64& bytes);
+	static irr::u64 GetBytes(irr::video::ITexture* texture);
+};
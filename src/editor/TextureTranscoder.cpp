@@ -0,0 +1,509 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "MappedFile.hpp"
+#include "TextureTranscoder.hpp"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSCODE_SSE2
+#endif
+
+static const irr::u32 DDS_MAGIC = 0x20534444;     // 'DDS '
+static const irr::u32 DDS_HEADER_SIZE = 124;
+static const irr::u32 DDS_FILE_HEADER_SIZE = 128; // with the magic
+static const irr::u32 FOURCC_DXT1 = 0x31545844;
+static const irr::u32 FOURCC_DXT5 = 0x35545844;
+
+// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE
+static const irr::u32 DDS_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;
+static const irr::u32 DDSD_MIPMAPCOUNT = 0x20000;
+static const irr::u32 DDPF_FOURCC = 0x4;
+// DDSCAPS_TEXTURE
+static const irr::u32 DDS_CAPS = 0x1000;
+// DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+static const irr::u32 DDS_CAPS_MIPMAPS = 0x8 | 0x400000;
+
+static void WriteU32(std::vector<irr::u8>& data, irr::u32 value)
+{
+	data.push_back((irr::u8)(value & 0xff));
+	data.push_back((irr::u8)((value >> 8) & 0xff));
+	data.push_back((irr::u8)((value >> 16) & 0xff));
+	data.push_back((irr::u8)((value >> 24) & 0xff));
+}
+
+static irr::u32 ReadU32(const irr::u8* p)
+{
+	return (irr::u32)p[0] | ((irr::u32)p[1] << 8) | ((irr::u32)p[2] << 16) | ((irr::u32)p[3] << 24);
+}
+
+static irr::u16 To565(int r, int g, int b)
+{
+	return (irr::u16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static void From565(irr::u16 color, int* rgb)
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static irr::u32 GetBlockBytes(bool alpha)
+{
+	return alpha ? 16 : 8;
+}
+
+bool TextureTranscoder::Extract(irr::video::IVideoDriver* driver, irr::video::IImage* image, Image& result)
+{
+	irr::core::dimension2d<irr::u32> size = image->getDimension();
+	if (size.Width == 0 || size.Height == 0)
+		return false;
+
+	irr::video::IImage* converted = image;
+	if (image->getColorFormat() == irr::video::ECF_A8R8G8B8)
+		converted->grab();
+	else
+	{
+		converted = driver->createImage(irr::video::ECF_A8R8G8B8, size);
+		if (!converted)
+			return false;
+		image->copyTo(converted);
+	}
+
+	result.Width = size.Width;
+	result.Height = size.Height;
+	result.Pixels.resize((size_t)size.Width * size.Height);
+
+	const irr::u8* pixels = (const irr::u8*)converted->lock();
+	for (irr::u32 y = 0; y < size.Height; ++y)
+		memcpy(&result.Pixels[(size_t)y * size.Width], pixels + (size_t)y * converted->getPitch(),
+			size.Width * sizeof(irr::u32));
+	converted->unlock();
+	converted->drop();
+
+	return true;
+}
+
+irr::u64 TextureTranscoder::Hash(const irr::u8* data, size_t size)
+{
+	// FNV-1a, started from the version so older outputs aren't reused
+	irr::u64 hash = 14695981039346656037ULL;
+	hash = (hash ^ VERSION) * 1099511628211ULL;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+void TextureTranscoder::Downsample(const Image& source, Image& result)
+{
+	result.Width = std::max(source.Width / 2, 1u);
+	result.Height = std::max(source.Height / 2, 1u);
+	result.Pixels.resize((size_t)result.Width * result.Height);
+
+	const irr::u8* src = (const irr::u8*)&source.Pixels[0];
+	irr::u8* dst = (irr::u8*)&result.Pixels[0];
+	size_t pitch = (size_t)source.Width * 4;
+
+	for (irr::u32 y = 0; y < result.Height; ++y)
+	{
+		// odd sizes repeat the last row or column
+		const irr::u8* row0 = src + std::min(y * 2, source.Height - 1) * pitch;
+		const irr::u8* row1 = src + std::min(y * 2 + 1, source.Height - 1) * pitch;
+		irr::u8* out = dst + (size_t)y * result.Width * 4;
+
+		irr::u32 x = 0;
+#if defined(TRANSCODE_SSE2)
+		// four texels out of eight at a time. The averages round up twice,
+		// which is within a step of the exact result.
+		for (; x + 4 <= result.Width && x * 2 + 8 <= source.Width; x += 4)
+		{
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+			__m128i v0 = _mm_shuffle_epi32(_mm_avg_epu8(a0, b0), _MM_SHUFFLE(3, 1, 2, 0)); // 0 2 1 3
+			__m128i v1 = _mm_shuffle_epi32(_mm_avg_epu8(a1, b1), _MM_SHUFFLE(3, 1, 2, 0)); // 4 6 5 7
+			__m128i even = _mm_unpacklo_epi64(v0, v1);
+			__m128i odd = _mm_unpackhi_epi64(v0, v1);
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_avg_epu8(even, odd));
+		}
+#endif
+
+		for (; x < result.Width; ++x)
+		{
+			irr::u32 x0 = std::min(x * 2, source.Width - 1) * 4;
+			irr::u32 x1 = std::min(x * 2 + 1, source.Width - 1) * 4;
+			for (int c = 0; c < 4; ++c)
+				out[x * 4 + c] = (irr::u8)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+		}
+	}
+}
+
+void TextureTranscoder::Transcode(const Image& source, std::vector<irr::u8>& dds)
+{
+	bool alpha = false;
+	for (size_t i = 0; i < source.Pixels.size() && !alpha; ++i)
+		alpha = (source.Pixels[i] >> 24) != 0xff;
+
+	irr::u32 blockBytes = GetBlockBytes(alpha);
+	irr::u32 levels = 1;
+	size_t dataSize = 0;
+	for (irr::u32 w = source.Width, h = source.Height; ; ++levels)
+	{
+		dataSize += (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+		if (w == 1 && h == 1)
+			break;
+		w = std::max(w / 2, 1u);
+		h = std::max(h / 2, 1u);
+	}
+
+	dds.clear();
+	dds.reserve(DDS_FILE_HEADER_SIZE + dataSize);
+	WriteU32(dds, DDS_MAGIC);
+	WriteU32(dds, DDS_HEADER_SIZE);
+	// a single level isn't a mip chain
+	WriteU32(dds, levels > 1 ? DDS_FLAGS | DDSD_MIPMAPCOUNT : DDS_FLAGS);
+	WriteU32(dds, source.Height);
+	WriteU32(dds, source.Width);
+	WriteU32(dds, ((source.Width + 3) / 4) * ((source.Height + 3) / 4) * blockBytes);
+	WriteU32(dds, 0); // depth
+	WriteU32(dds, levels);
+	for (int i = 0; i < 11; ++i)
+		WriteU32(dds, 0);
+
+	// pixel format
+	WriteU32(dds, 32);
+	WriteU32(dds, DDPF_FOURCC);
+	WriteU32(dds, alpha ? FOURCC_DXT5 : FOURCC_DXT1);
+	for (int i = 0; i < 5; ++i)
+		WriteU32(dds, 0);
+
+	WriteU32(dds, levels > 1 ? DDS_CAPS | DDS_CAPS_MIPMAPS : DDS_CAPS);
+	for (int i = 0; i < 4; ++i)
+		WriteU32(dds, 0);
+
+	size_t offset = dds.size();
+	dds.resize(offset + dataSize);
+
+	Image mips[2];
+	const Image* level = &source;
+	for (irr::u32 l = 0; l < levels; ++l)
+	{
+		irr::u32 blocksWide = (level->Width + 3) / 4;
+		irr::u32 blocksHigh = (level->Height + 3) / 4;
+		for (irr::u32 by = 0; by < blocksHigh; ++by)
+		{
+			for (irr::u32 bx = 0; bx < blocksWide; ++bx)
+			{
+				// blocks past the edge of small levels repeat the last texels
+				irr::u32 texels[16];
+				for (irr::u32 y = 0; y < 4; ++y)
+				{
+					irr::u32 row = std::min(by * 4 + y, level->Height - 1);
+					for (irr::u32 x = 0; x < 4; ++x)
+						texels[y * 4 + x] = level->Pixels[(size_t)row * level->Width +
+							std::min(bx * 4 + x, level->Width - 1)];
+				}
+
+				EncodeBlock(texels, alpha, &dds[offset]);
+				offset += blockBytes;
+			}
+		}
+
+		if (l + 1 < levels)
+		{
+			Downsample(*level, mips[l & 1]);
+			level = &mips[l & 1];
+		}
+	}
+}
+
+bool TextureTranscoder::IsTranscoded(const irr::u8* data, size_t size)
+{
+	if (size < DDS_FILE_HEADER_SIZE || ReadU32(data) != DDS_MAGIC ||
+		ReadU32(data + 4) != DDS_HEADER_SIZE)
+		return false;
+
+	irr::u32 fourCC = ReadU32(data + 84);
+	return fourCC == FOURCC_DXT1 || fourCC == FOURCC_DXT5;
+}
+
+irr::video::IImage* TextureTranscoder::Decode(irr::video::IVideoDriver* driver,
+	const irr::u8* data, size_t size)
+{
+	if (!IsTranscoded(data, size))
+		return nullptr;
+
+	irr::u32 height = ReadU32(data + 12);
+	irr::u32 width = ReadU32(data + 16);
+	bool alpha = ReadU32(data + 84) == FOURCC_DXT5;
+	irr::u32 blocksWide = (width + 3) / 4;
+	irr::u32 blocksHigh = (height + 3) / 4;
+	if (width == 0 || height == 0 ||
+		(size - DDS_FILE_HEADER_SIZE) / GetBlockBytes(alpha) / blocksWide < blocksHigh)
+		return nullptr;
+
+	irr::video::IImage* image = driver->createImage(irr::video::ECF_A8R8G8B8,
+		irr::core::dimension2d<irr::u32>(width, height));
+	if (!image)
+		return nullptr;
+
+	irr::u8* pixels = (irr::u8*)image->lock();
+	const irr::u8* block = data + DDS_FILE_HEADER_SIZE;
+	for (irr::u32 by = 0; by < blocksHigh; ++by)
+	{
+		for (irr::u32 bx = 0; bx < blocksWide; ++bx)
+		{
+			irr::u32 texels[16];
+			DecodeBlock(block, alpha, texels);
+			block += GetBlockBytes(alpha);
+
+			for (irr::u32 y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				irr::u32* row = (irr::u32*)(pixels + (size_t)(by * 4 + y) * image->getPitch());
+				for (irr::u32 x = 0; x < 4 && bx * 4 + x < width; ++x)
+					row[bx * 4 + x] = texels[y * 4 + x];
+			}
+		}
+	}
+	image->unlock();
+
+	return image;
+}
+
+void TextureTranscoder::EncodeBlock(const irr::u32* texels, bool alpha, irr::u8* block)
+{
+	if (alpha)
+	{
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int a = (int)(texels[i] >> 24);
+			lo = std::min(lo, a);
+			hi = std::max(hi, a);
+		}
+
+		// the first end point above the second picks the eight value mode
+		block[0] = (irr::u8)hi;
+		block[1] = (irr::u8)lo;
+
+		irr::u64 bits = 0;
+		if (hi > lo)
+		{
+			int palette[8] = { hi, lo };
+			for (int p = 2; p < 8; ++p)
+				palette[p] = ((8 - p) * hi + (p - 1) * lo) / 7;
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int a = (int)(texels[i] >> 24);
+				int best = 0;
+				for (int p = 1; p < 8; ++p)
+				{
+					if (abs(palette[p] - a) < abs(palette[best] - a))
+						best = p;
+				}
+				bits |= (irr::u64)best << (3 * i);
+			}
+		}
+
+		for (int i = 0; i < 6; ++i)
+			block[2 + i] = (irr::u8)(bits >> (8 * i));
+
+		block += 8;
+	}
+
+	// the end points are the corners of the colours' bounding box, pulled in
+	// a little since the extremes are rarely needed exactly
+	int lo[3] = { 255, 255, 255 };
+	int hi[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			int value = (int)((texels[i] >> (16 - c * 8)) & 0xff);
+			lo[c] = std::min(lo[c], value);
+			hi[c] = std::max(hi[c], value);
+		}
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int inset = (hi[c] - lo[c]) >> 4;
+		lo[c] += inset;
+		hi[c] -= inset;
+	}
+
+	// packing keeps the order, so the first is never below the second and
+	// only equal end points fall into the three colour mode
+	irr::u16 color0 = To565(hi[0], hi[1], hi[2]);
+	irr::u16 color1 = To565(lo[0], lo[1], lo[2]);
+
+	irr::u32 bits = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		From565(color0, palette[0]);
+		From565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 0;
+			int bestDistance = 0x7fffffff;
+			for (int p = 0; p < 4; ++p)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					int d = (int)((texels[i] >> (16 - c * 8)) & 0xff) - palette[p][c];
+					distance += d * d;
+				}
+
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			bits |= (irr::u32)best << (2 * i);
+		}
+	}
+
+	block[0] = (irr::u8)(color0 & 0xff);
+	block[1] = (irr::u8)(color0 >> 8);
+	block[2] = (irr::u8)(color1 & 0xff);
+	block[3] = (irr::u8)(color1 >> 8);
+	for (int i = 0; i < 4; ++i)
+		block[4 + i] = (irr::u8)(bits >> (8 * i));
+}
+
+void TextureTranscoder::DecodeBlock(const irr::u8* block, bool alpha, irr::u32* texels)
+{
+	int alphas[16];
+	if (alpha)
+	{
+		int palette[8] = { block[0], block[1] };
+		if (palette[0] > palette[1])
+		{
+			for (int p = 2; p < 8; ++p)
+				palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7;
+		}
+		else
+		{
+			for (int p = 2; p < 6; ++p)
+				palette[p] = ((6 - p) * palette[0] + (p - 1) * palette[1]) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		irr::u64 bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (irr::u64)block[2 + i] << (8 * i);
+		for (int i = 0; i < 16; ++i)
+			alphas[i] = palette[(bits >> (3 * i)) & 7];
+
+		block += 8;
+	}
+	else
+	{
+		for (int i = 0; i < 16; ++i)
+			alphas[i] = 255;
+	}
+
+	irr::u16 color0 = (irr::u16)(block[0] | (block[1] << 8));
+	irr::u16 color1 = (irr::u16)(block[2] | (block[3] << 8));
+
+	int palette[4][3];
+	From565(color0, palette[0]);
+	From565(color1, palette[1]);
+
+	// BC3 colours always use four, BC1 has three and transparent black when
+	// the end points are in order
+	bool fourColors = alpha || color0 > color1;
+	for (int c = 0; c < 3; ++c)
+	{
+		if (fourColors)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	irr::u32 bits = ReadU32(block + 4);
+	for (int i = 0; i < 16; ++i)
+	{
+		irr::u32 index = (bits >> (2 * i)) & 3;
+		int a = (!fourColors && index == 3) ? 0 : alphas[i];
+		texels[i] = ((irr::u32)a << 24) | ((irr::u32)palette[index][0] << 16) |
+			((irr::u32)palette[index][1] << 8) | (irr::u32)palette[index][2];
+	}
+}
+
+DDSImageLoader::DDSImageLoader(irr::video::IVideoDriver* driver)
+	: m_Driver(driver)
+{
+}
+
+DDSImageLoader::~DDSImageLoader(void)
+{
+}
+
+bool DDSImageLoader::isALoadableFileExtension(const irr::io::path&) const
+{
+	// loadImage turns down anything that isn't ours by its header
+	return true;
+}
+
+bool DDSImageLoader::isALoadableFileFormat(irr::io::IReadFile* file) const
+{
+	if (!file)
+		return false;
+
+	irr::u8 header[128];
+	return file->read(header, sizeof(header)) == (irr::s32)sizeof(header) &&
+		TextureTranscoder::IsTranscoded(header, sizeof(header));
+}
+
+irr::video::IImage* DDSImageLoader::loadImage(irr::io::IReadFile* file) const
+{
+	if (!file || file->getSize() <= 0)
+		return nullptr;
+
+	// packages hand these out mapped, so there's nothing to copy
+	MappedReadFile* mapped = dynamic_cast<MappedReadFile*>(file);
+	if (mapped)
+		return TextureTranscoder::Decode(m_Driver, mapped->getData(), (size_t)mapped->getSize());
+
+	if (!isALoadableFileFormat(file))
+		return nullptr;
+
+	file->seek(0);
+	std::vector<irr::u8> data(file->getSize());
+	if (file->read(&data[0], (irr::u32)data.size()) != (irr::s32)data.size())
+		return nullptr;
+
+	return TextureTranscoder::Decode(m_Driver, &data[0], data.size());
+}
@@ -0,0 +1,71 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <vector>
+
+// Converts textures into DDS files with a full mip chain, block compressed as
+// BC1 (DXT1) when every texel is opaque and BC3 (DXT5) otherwise. The image
+// is copied out into a plain array first, so the work can run on a worker
+// thread. Packages store the result in place of the source, under the
+// source's name, and the DDS loader tells it apart by its header.
+class TextureTranscoder
+{
+public:
+	enum
+	{
+		VERSION = 2, // part of the cache key, bump when the output changes
+	};
+
+	struct Image
+	{
+		irr::u32 Width;
+		irr::u32 Height;
+		std::vector<irr::u32> Pixels; // A8R8G8B8, rows packed
+	};
+
+	// Copies an image out as A8R8G8B8; false if it's empty
+	static bool Extract(irr::video::IVideoDriver* driver, irr::video::IImage* image, Image& result);
+
+	// Content hash of a source file, for caching the transcoded texture
+	static irr::u64 Hash(const irr::u8* data, size_t size);
+
+	// The next level of the mip chain, averaging 2x2 texels
+	static void Downsample(const Image& source, Image& result);
+
+	static void Transcode(const Image& source, std::vector<irr::u8>& dds);
+
+	// Decodes the top level of a file written by Transcode
+	static irr::video::IImage* Decode(irr::video::IVideoDriver* driver, const irr::u8* data, size_t size);
+
+	// Whether the data starts like a file written by Transcode
+	static bool IsTranscoded(const irr::u8* data, size_t size);
+
+private:
+	static void EncodeBlock(const irr::u32* texels, bool alpha, irr::u8* block);
+	static void DecodeBlock(const irr::u8* block, bool alpha, irr::u32* texels);
+};
+
+// Reads the DDS files written by TextureTranscoder, which the bundled loader
+// isn't built for. Packages store them under the name of the source texture,
+// so the loader offers to take any file and checks the header before the
+// loader for the file's extension sees it.
+class DDSImageLoader : public irr::video::IImageLoader
+{
+private:
+	irr::video::IVideoDriver* m_Driver;
+
+public:
+	DDSImageLoader(irr::video::IVideoDriver* driver);
+	~DDSImageLoader(void);
+
+	bool isALoadableFileExtension(const irr::io::path& filename) const;
+	bool isALoadableFileFormat(irr::io::IReadFile* file) const;
+	irr::video::IImage* loadImage(irr::io::IReadFile* file) const;
+};
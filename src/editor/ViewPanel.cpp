@@ -5,21 +5,28 @@
 */
 
 #include "BrowserWindow.hpp"
+#include "Clipboard.hpp"
 #include "Commands.hpp"
 #include "Common.hpp"
 #include "Component.hpp"
 #include "FSHandler.hpp"
 #include "MainWindow.hpp"
 #include "MapEditor.hpp"
+#include "TextureTranscoder.hpp"
 #include "ViewPanel.hpp"
 
+#include "../extend/DebugDrawSceneNode.hpp"
 #include "../extend/PathSceneNode.hpp"
 #include "../extend/SceneNodeFactory.hpp"
+#include "../extend/TerrainSceneNode.hpp"
 
+#include <wx/config.h>
 #include <wx/dcclient.h>
+#include <wx/hashmap.h>
 #include <wx/intl.h>
 #include <wx/log.h>
 #include <wx/sizer.h>
+#include <wx/utils.h>
 
 #include "irrUString.h"
 #include "CGUITTFont.h"
@@ -30,6 +37,14 @@
 #include <gdk/gdkx.h>
 #endif
 
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_set>
+
+static const int MARQUEE_THRESHOLD = 4; // pixels a click moves before it's a marquee
+static const float SCULPT_RADIUS = 6.0f; // brush radius, in terrain cells
+static const float SCULPT_STRENGTH = 0.1f; // height added by each dab, in terrain cells
+
 class IrrEventReceiver : public irr::IEventReceiver
 {
 public:
@@ -76,9 +91,12 @@ ViewPanel::ViewPanel(wxWindow* parent, wxCommandProcessor& cmdProc,
 	  m_PropertyPanel(propertyPanel), m_Init(false), m_ActiveView(VIEW_3D), 
 	  m_FreeLook(false), m_RenderDevice(nullptr),
 	  m_EditorRoot(nullptr), m_MapRoot(nullptr),
-	  m_Camera(nullptr), m_TranslatingSelection(false)
+	  m_Camera(nullptr), m_SelectionBoxDirty(false), m_Marquee(false),
+	  m_MarqueeView(VIEW_3D), m_TranslatingSelection(false),
+	  m_Sculpt(false), m_Sculpting(false)
 {
 	m_ExplorerPanel->SetViewPanel(this);
+	m_PropertyPanel->SetViewPanel(this);
 
 	wxFileSystem fs;
 	m_Cursor[CURSOR_MOVE] = new wxCursor(ImageFromFS(fs, "editor.mpk:icons/move.png", wxBITMAP_TYPE_PNG));
@@ -89,6 +107,14 @@ ViewPanel::ViewPanel(wxWindow* parent, wxCommandProcessor& cmdProc,
 	m_3DCam = nullptr;
 	m_Grid[0] = m_Grid[1] = m_Grid[2] = m_Grid[3] = nullptr;
 	m_Label[0] = m_Label[1] = m_Label[2] = m_Label[3] = nullptr;
+	m_Stats = nullptr;
+	m_ShowStats = false;
+	m_Residency = nullptr;
+	m_MeshLOD = nullptr;
+	m_Instancer = nullptr;
+	m_DebugDraw = nullptr;
+	m_Scaler = nullptr;
+	m_Font = nullptr;
 
 	Bind(wxEVT_TIMER, &ViewPanel::OnTimer, this);
 	Bind(wxEVT_SIZE, &ViewPanel::OnResize, this);
@@ -117,7 +143,12 @@ ViewPanel::ViewPanel(wxWindow* parent, wxCommandProcessor& cmdProc,
 	Bind(wxEVT_MENU, &ViewPanel::OnToolActor, this, TOOL_ACTOR);
 	Bind(wxEVT_MENU, &ViewPanel::OnToolMesh, this, TOOL_MESH);
 	Bind(wxEVT_MENU, &ViewPanel::OnMenuFreeLook, this, MENU_FREELOOK);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuResolution, this, MENU_RESOLUTIONAUTO, MENU_RESOLUTIONHALF);
 	Bind(wxEVT_MENU, &ViewPanel::OnMenuSetTexture, this, MENU_SETTEXTURE);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuArray, this, MENU_ARRAY);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuSculpt, this, MENU_SCULPT);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuPreviewSound, this, MENU_PREVIEWSOUND);
+	Bind(wxEVT_MENU, &ViewPanel::OnMenuSpatialSound, this, MENU_SPATIALSOUND);
 }
 
 ViewPanel::~ViewPanel(void)
@@ -127,6 +158,12 @@ ViewPanel::~ViewPanel(void)
 
 	m_RefreshTimer.Stop();
 
+	// drops the proxies, stand-ins and view targets, needs the driver
+	delete m_Scaler;
+	delete m_Instancer;
+	delete m_MeshLOD;
+	delete m_Residency;
+
 	if (m_RenderDevice)
 	{
 		m_RenderDevice->getCursorControl()->setVisible(true);
@@ -160,6 +197,7 @@ void ViewPanel::SetMap(std::shared_ptr<Map>& map)
 	m_PropertyPanel->Clear();
 	m_ExplorerPanel->Clear();
 	ClearSelection();
+	m_SpatialIndex.Clear();
 
 	m_Map = map;
 
@@ -183,17 +221,22 @@ void ViewPanel::AddToSelection(irr::scene::ISceneNode* node, bool append)
 	bool removed = false;
 
 	// check if node is already in there, remove if yes
-	for (selection_t::iterator i = m_Selection.begin();
-		i != m_Selection.end(); ++i)
+	selectionindex_t::iterator selected = m_SelectionIndex.find(wxString(node->getName()));
+	if (selected != m_SelectionIndex.end())
 	{
-		if (strcmp((*i)->getName(), node->getName()) == 0)
-		{
-			node->setDebugDataVisible(irr::scene::EDS_OFF);
-			m_ExplorerPanel->UnselectItem(node->getName());
-			m_Selection.erase(i); // remove from the selection
-			removed = true;
-			break;
-		}
+		node->setDebugDataVisible(irr::scene::EDS_OFF);
+		m_ExplorerPanel->UnselectItem(node->getName());
+		m_Selection.erase(selected->second); // remove from the selection
+		m_SelectionIndex.erase(selected);
+		removed = true;
+
+		// the box only shrinks if the node was touching its edge
+		irr::core::aabbox3df box = node->getTransformedBoundingBox();
+		if (!m_Selection.empty() && !(
+			box.MinEdge.X > m_SelectionBox.MinEdge.X && box.MaxEdge.X < m_SelectionBox.MaxEdge.X &&
+			box.MinEdge.Y > m_SelectionBox.MinEdge.Y && box.MaxEdge.Y < m_SelectionBox.MaxEdge.Y &&
+			box.MinEdge.Z > m_SelectionBox.MinEdge.Z && box.MaxEdge.Z < m_SelectionBox.MaxEdge.Z))
+			m_SelectionBoxDirty = true;
 	}
 
 	if (!append)
@@ -201,28 +244,230 @@ void ViewPanel::AddToSelection(irr::scene::ISceneNode* node, bool append)
 
 	if (!removed)
 	{
-		m_ExplorerPanel->SelectItem(node->getName());
-
-		node->setDebugDataVisible(irr::scene::EDS_BBOX);
-		m_Selection.push_back(node);
+		SelectNode(node);
 		if (m_Selection.size() > 1)
 			m_PropertyPanel->Clear();
 		else
 			m_PropertyPanel->SetSceneNode(node);
 	}
+}
 
-	UpdateSelectionBoundingBox();
+void ViewPanel::SelectNode(irr::scene::ISceneNode* node)
+{
+	m_ExplorerPanel->SelectItem(node->getName());
+
+	node->setDebugDataVisible(irr::scene::EDS_BBOX);
+	m_SelectionIndex.emplace(wxString(node->getName()), m_Selection.insert(m_Selection.end(), node));
+
+	// grow the box rather than go over the whole selection again
+	if (m_Selection.size() == 1)
+	{
+		m_SelectionBox = node->getTransformedBoundingBox();
+		m_SelectionBoxDirty = false;
+	}
+	else
+		m_SelectionBox.addInternalBox(node->getTransformedBoundingBox());
 }
 
 void ViewPanel::UpdateSelectionBoundingBox(void)
 {
 	m_SelectionBox.reset(0, 0, 0);
+	m_SelectionBoxDirty = false;
 
 	for (selection_t::iterator i = m_Selection.begin();
 		i != m_Selection.end(); ++i)
 	{
-		m_SelectionBox.addInternalBox((*i)->getTransformedBoundingBox());
+		if (i == m_Selection.begin())
+			m_SelectionBox = (*i)->getTransformedBoundingBox();
+		else
+			m_SelectionBox.addInternalBox((*i)->getTransformedBoundingBox());
+	}
+}
+
+void ViewPanel::EntityAdded(const wxString&)
+{
+	m_SpatialIndex.Invalidate();
+}
+
+void ViewPanel::EntityRemoved(const wxString& name)
+{
+	m_SpatialIndex.Invalidate();
+
+	// the node may already be gone, so only go by the name
+	selectionindex_t::iterator selected = m_SelectionIndex.find(name);
+	if (selected == m_SelectionIndex.end())
+		return;
+
+	m_Selection.erase(selected->second);
+	m_SelectionIndex.erase(selected);
+	m_SelectionBoxDirty = true;
+	m_PropertyPanel->Clear();
+}
+
+void ViewPanel::EntitiesMoved(void)
+{
+	m_SpatialIndex.MarkMoved();
+}
+
+irr::core::vector2di ViewPanel::ViewCursor(VIEW view, const irr::core::vector2di& point)
+{
+	irr::core::vector2di cursor(point);
+	const wxSize& size = GetSize() * GetContentScaleFactor();
+
+	switch (view)
+	{
+	case VIEW_FRONT: // top-left
+	{
+		cursor.X = (cursor.X / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
+		cursor.Y = (cursor.Y / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
+	} break;
+	case VIEW_TOP: // top-right
+	{
+		cursor.X = ((cursor.X - (size.GetWidth() / 2.0f)) / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
+		cursor.Y = (cursor.Y / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
+	} break;
+	case VIEW_RIGHT: // bottom-left
+	{
+		cursor.X = (cursor.X / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
+		cursor.Y = ((cursor.Y - (size.GetHeight() / 2.0f)) / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
+	} break;
+	case VIEW_3D: // bottom-right
+	{
+		cursor.X = ((cursor.X - (size.GetWidth() / 2.0f)) / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
+		cursor.Y = ((cursor.Y - (size.GetHeight() / 2.0f)) / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
+	} break;
+	}
+
+	return cursor;
+}
+
+void ViewPanel::SelectMarquee(bool append)
+{
+	irr::scene::ISceneCollisionManager* colMgr =
+		m_RenderDevice->getSceneManager()->getSceneCollisionManager();
+	irr::scene::ICameraSceneNode* camera = m_View[m_MarqueeView];
+
+	// the rays through the corners, in order around the marquee
+	const wxPoint corners[4] = {
+		wxPoint(std::min(m_MarqueeStart.x, m_MarqueeEnd.x), std::min(m_MarqueeStart.y, m_MarqueeEnd.y)),
+		wxPoint(std::max(m_MarqueeStart.x, m_MarqueeEnd.x), std::min(m_MarqueeStart.y, m_MarqueeEnd.y)),
+		wxPoint(std::max(m_MarqueeStart.x, m_MarqueeEnd.x), std::max(m_MarqueeStart.y, m_MarqueeEnd.y)),
+		wxPoint(std::min(m_MarqueeStart.x, m_MarqueeEnd.x), std::max(m_MarqueeStart.y, m_MarqueeEnd.y))
+	};
+
+	irr::core::line3df rays[4];
+	irr::core::vector3df centre;
+	for (int i = 0; i < 4; ++i)
+	{
+		rays[i] = colMgr->getRayFromScreenCoordinates(ViewCursor(m_MarqueeView,
+			irr::core::vector2di(corners[i].x, corners[i].y)), camera);
+		centre += rays[i].getMiddle() * 0.25f;
+	}
+
+	// a side plane through each pair of neighbouring rays, facing out
+	irr::core::plane3df planes[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const irr::core::line3df& next = rays[(i + 1) % 4];
+		planes[i].setPlane(rays[i].start, rays[i].end, next.end);
+		if (planes[i].classifyPointRelation(centre) == irr::core::ISREL3D_FRONT)
+		{
+			planes[i].Normal = -planes[i].Normal;
+			planes[i].D = -planes[i].D;
+		}
+	}
+
+	m_SpatialIndex.Update(m_MapRoot);
+
+	std::vector<irr::scene::ISceneNode*> nodes;
+	m_SpatialIndex.Query(planes, 4, nodes);
+
+	SelectNodes(nodes, append);
+}
+
+void ViewPanel::SelectNodes(const std::vector<irr::scene::ISceneNode*>& nodes, bool append)
+{
+	// the explorer puts the whole selection on its rows once
+	m_ExplorerPanel->BeginUpdate();
+
+	if (!append)
+		ClearSelection();
+
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		if (m_SelectionIndex.find(wxString(nodes[i]->getName())) == m_SelectionIndex.end())
+			SelectNode(nodes[i]);
+	}
+
+	m_ExplorerPanel->EndUpdate();
+
+	if (m_Selection.size() == 1)
+		m_PropertyPanel->SetSceneNode(m_Selection.front());
+	else
+		m_PropertyPanel->Clear();
+}
+
+TerrainSceneNode* ViewPanel::GetSculptTarget(void)
+{
+	if (m_Selection.size() != 1 || m_Selection.front()->getType() !=
+		(irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN)
+		return nullptr;
+
+	return static_cast<TerrainSceneNode*>(m_Selection.front());
+}
+
+bool ViewPanel::Sculpt(const irr::core::line3df& ray, bool lower)
+{
+	TerrainSceneNode* terrain = GetSculptTarget();
+	if (!terrain || !terrain->getTriangleSelector())
+		return false;
+
+	irr::core::vector3df hit;
+	irr::core::triangle3df triangle;
+	irr::scene::ISceneNode* hitNode = nullptr;
+	if (!m_RenderDevice->getSceneManager()->getSceneCollisionManager()->getCollisionPoint(
+		ray, terrain->getTriangleSelector(), hit, triangle, hitNode))
+		return false;
+
+	// the stroke is stored on the first dab and grows until the button is released
+	SculptTerrainCommand* cmd = nullptr;
+	if (m_Sculpting)
+		cmd = dynamic_cast<SculptTerrainCommand*>(m_Commands.GetCurrentCommand());
+	if (!cmd)
+	{
+		cmd = new SculptTerrainCommand(terrain);
+		m_Commands.Store(cmd);
+		m_Sculpting = true;
 	}
+
+	irr::f32 strength = SCULPT_STRENGTH * terrain->getCellSize();
+	cmd->Apply(hit, SCULPT_RADIUS * terrain->getCellSize(), lower ? -strength : strength);
+	m_SelectionBoxDirty = true;
+	return true;
+}
+
+void ViewPanel::EndSculpt(void)
+{
+	m_Sculpting = false;
+
+	SculptTerrainCommand* cmd = dynamic_cast<SculptTerrainCommand*>(
+		m_Commands.GetCurrentCommand());
+	if (cmd)
+		cmd->Finish();
+	EntitiesMoved();
+
+	UpdateSelectionBoundingBox();
+}
+
+void ViewPanel::DrawMarquee(void)
+{
+	irr::core::recti rect(std::min(m_MarqueeStart.x, m_MarqueeEnd.x),
+		std::min(m_MarqueeStart.y, m_MarqueeEnd.y),
+		std::max(m_MarqueeStart.x, m_MarqueeEnd.x),
+		std::max(m_MarqueeStart.y, m_MarqueeEnd.y));
+
+	m_RenderDevice->getVideoDriver()->draw2DRectangleOutline(rect,
+		irr::video::SColor(255, 255, 255, 0));
 }
 
 void ViewPanel::ShowSelection(bool show)
@@ -239,12 +484,15 @@ void ViewPanel::ClearSelection(void)
 	m_ExplorerPanel->UnselectAll();
 	m_PropertyPanel->Clear();
 	m_SelectionBox.reset(0, 0, 0);
+	m_SelectionBoxDirty = false;
 
 	for (selection_t::iterator i = m_Selection.begin();
 		i != m_Selection.end(); i = m_Selection.erase(i))
 	{
 		(*i)->setDebugDataVisible(irr::scene::EDS_OFF);
 	}
+
+	m_SelectionIndex.clear();
 }
 
 void ViewPanel::DeleteSelection(void)
@@ -266,8 +514,28 @@ void ViewPanel::DeleteSelection(void)
 		m_ExplorerPanel->UnselectAll();
 		m_PropertyPanel->Clear();
 		m_SelectionBox.reset(0, 0, 0);
+		m_SelectionBoxDirty = false;
 		m_Selection.clear();
+		m_SelectionIndex.clear();
+	}
+}
+
+bool ViewPanel::CopySelection(void)
+{
+	if (m_Selection.empty())
+		return false;
+
+	// the nodes are at hand, no need to look them up by name
+	EntityClipboard::selection_t selection(m_Selection.begin(), m_Selection.end());
+
+	wxBusyCursor busy;
+	if (!EntityClipboard::Copy(m_Map, selection))
+	{
+		wxLogWarning(_("Unable to put the selection on the clipboard"));
+		return false;
 	}
+
+	return true;
 }
 
 void ViewPanel::BeginFreeLook(void)
@@ -376,6 +644,11 @@ void ViewPanel::OnResize(wxSizeEvent& event)
 			return;
 		}
 
+		// read the textures transcoded by package builds
+		irr::video::IImageLoader* ddsLoader = new DDSImageLoader(m_RenderDevice->getVideoDriver());
+		m_RenderDevice->getVideoDriver()->addExternalImageLoader(ddsLoader);
+		ddsLoader->drop();
+
 		// register the scene node factory
 		irr::scene::ISceneNodeFactory* factory = new SceneNodeFactory(m_RenderDevice->getSceneManager());
 		m_RenderDevice->getSceneManager()->registerSceneNodeFactory(factory);
@@ -394,6 +667,7 @@ void ViewPanel::OnResize(wxSizeEvent& event)
 		{
 			m_RenderDevice->getGUIEnvironment()->addFont(defaultFontUri, defaultFont);
 			m_RenderDevice->getGUIEnvironment()->getSkin()->setFont(defaultFont);
+			m_Font = defaultFont;
 		}
 		else
 			wxLogWarning("Failed to load default font, using built-in as default");
@@ -456,6 +730,30 @@ void ViewPanel::OnResize(wxSizeEvent& event)
 		m_Label[VIEW_3D]->setOverrideColor(irr::video::SColor(255, 0, 0, 255));
 		m_Label[VIEW_3D]->setVisible(false);
 
+		m_Stats = m_RenderDevice->getGUIEnvironment()->addStaticText(L"",
+			irr::core::recti(10, 40, 600, 160), false, true);
+		m_Stats->setOverrideColor(irr::video::SColor(255, 255, 255, 0));
+		m_Stats->setVisible(false);
+
+		m_Residency = new TextureResidency(m_RenderDevice->getSceneManager());
+		m_Residency->SetBudget((irr::u64)wxConfigBase::Get()->ReadLong(wxT("/Rendering/TextureBudget"),
+			TextureResidency::DEFAULT_BUDGET) * 1024 * 1024);
+
+		m_MeshLOD = new MeshLOD(m_RenderDevice->getSceneManager(), m_EditorRoot);
+		m_Instancer = new MeshInstancer(m_RenderDevice->getSceneManager(), m_EditorRoot);
+
+		// path links, selection boxes and markers are drawn together in each view
+		m_DebugDraw = new DebugDrawSceneNode(m_EditorRoot, m_RenderDevice->getSceneManager(), NID_NOSAVE);
+		m_DebugDraw->drop();
+
+		m_Scaler = new ResolutionScaler(m_RenderDevice->getVideoDriver(), 4,
+			irr::video::SColor(255, 170, 170, 170));
+		m_Scaler->SetBudget((irr::u32)wxConfigBase::Get()->ReadLong(wxT("/Rendering/FrameBudget"),
+			ResolutionScaler::DEFAULT_BUDGET));
+		for (int view = VIEW_FRONT; view < VIEW_3D; ++view)
+			m_Scaler->SetMode(view, (ResolutionScaler::MODE)wxConfigBase::Get()->ReadLong(
+				wxString::Format(wxT("/Rendering/ViewResolution%d"), view), ResolutionScaler::MODE_AUTO));
+
 		m_Grid[VIEW_FRONT] = new CGridSceneNode(m_EditorRoot, m_RenderDevice->getSceneManager(),
 			NID_NOSAVE);
 		m_Grid[VIEW_FRONT]->setGridsSize(irr::core::dimension2df(2500.0f, 2500.0f));
@@ -528,6 +826,12 @@ void ViewPanel::OnPaint(wxPaintEvent& event)
 		// update the camera billboard position
 		m_Camera->setPosition(m_View[VIEW_3D]->getPosition());
 
+		// the orthographic views don't need full resolution textures
+		m_Residency->Update(m_MapRoot);
+		m_MeshLOD->Update(m_MapRoot);
+		m_Instancer->Update(m_MapRoot);
+		m_Residency->UseProxies(m_MapRoot, m_View[VIEW_FRONT], true);
+
 		// turn off lighting for orthographic views
 		for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = m_MapRoot->getChildren().begin();
 			child != m_MapRoot->getChildren().end(); ++child)
@@ -540,40 +844,64 @@ void ViewPanel::OnPaint(wxPaintEvent& event)
 		// draw top-left view (FRONT)
 		m_Grid[VIEW_FRONT]->setVisible(true);
 		m_Label[VIEW_FRONT]->setVisible(true);
-		m_RenderDevice->getVideoDriver()->setViewPort(irr::core::recti(
+		m_Scaler->Begin(VIEW_FRONT, irr::core::recti(
 			0, 0, size.x / 2, size.y / 2));
 		m_Ortho[VIEW_FRONT]->resize(irr::core::dimension2di(size.x / 2, size.y / 2));
 		m_RenderDevice->getSceneManager()->setActiveCamera(m_View[VIEW_FRONT]);
-		m_RenderDevice->getGUIEnvironment()->drawAll();
+		m_MeshLOD->Select(m_View[VIEW_FRONT], m_RenderDevice->getVideoDriver()->getViewPort());
+		m_Instancer->Select(m_View[VIEW_FRONT]);
+		m_DebugDraw->capture(m_RenderDevice->getSceneManager()->getRootSceneNode());
+		DrawOverlay();
+		DrawGUI();
 		m_RenderDevice->getSceneManager()->drawAll();
+		m_DebugDraw->release();
+		m_Instancer->Restore(); // before the next view picks its stand-ins
+		m_Scaler->End(VIEW_FRONT, irr::core::recti(0, 0, size.x, size.y));
 		m_Grid[VIEW_FRONT]->setVisible(false);
 		m_Label[VIEW_FRONT]->setVisible(false);
 
 		// draw top-right view (TOP)
 		m_Grid[VIEW_TOP]->setVisible(true);
 		m_Label[VIEW_TOP]->setVisible(true);
-		m_RenderDevice->getVideoDriver()->setViewPort(irr::core::recti(
+		m_Scaler->Begin(VIEW_TOP, irr::core::recti(
 			size.x / 2, 0, size.x, size.y / 2));
 		m_Ortho[VIEW_TOP]->resize(irr::core::dimension2di(size.x / 2, size.y / 2));
 		m_RenderDevice->getSceneManager()->setActiveCamera(m_View[VIEW_TOP]);
-		m_RenderDevice->getGUIEnvironment()->drawAll();
+		m_MeshLOD->Select(m_View[VIEW_TOP], m_RenderDevice->getVideoDriver()->getViewPort());
+		m_Instancer->Select(m_View[VIEW_TOP]);
+		m_DebugDraw->capture(m_RenderDevice->getSceneManager()->getRootSceneNode());
+		DrawOverlay();
+		DrawGUI();
 		m_RenderDevice->getSceneManager()->drawAll();
+		m_DebugDraw->release();
+		m_Instancer->Restore();
+		m_Scaler->End(VIEW_TOP, irr::core::recti(0, 0, size.x, size.y));
 		m_Grid[VIEW_TOP]->setVisible(false);
 		m_Label[VIEW_TOP]->setVisible(false);
 
 		// draw bottom-left view (RIGHT)
 		m_Grid[VIEW_RIGHT]->setVisible(true);
 		m_Label[VIEW_RIGHT]->setVisible(true);
-		m_RenderDevice->getVideoDriver()->setViewPort(irr::core::recti(
+		m_Scaler->Begin(VIEW_RIGHT, irr::core::recti(
 			0, size.y / 2, size.x / 2, size.y));
 		m_Ortho[VIEW_RIGHT]->resize(irr::core::dimension2di(size.x / 2, size.y / 2));
 		m_RenderDevice->getSceneManager()->setActiveCamera(m_View[VIEW_RIGHT]);
-		m_RenderDevice->getGUIEnvironment()->drawAll();
+		m_MeshLOD->Select(m_View[VIEW_RIGHT], m_RenderDevice->getVideoDriver()->getViewPort());
+		m_Instancer->Select(m_View[VIEW_RIGHT]);
+		m_DebugDraw->capture(m_RenderDevice->getSceneManager()->getRootSceneNode());
+		DrawOverlay();
+		DrawGUI();
 		m_RenderDevice->getSceneManager()->drawAll();
+		m_DebugDraw->release();
+		m_Instancer->Restore();
+		m_Scaler->End(VIEW_RIGHT, irr::core::recti(0, 0, size.x, size.y));
 		m_Grid[VIEW_RIGHT]->setVisible(false);
 		m_Label[VIEW_RIGHT]->setVisible(false);
 
 
+		// only distant objects use the proxies in the 3D view
+		m_Residency->UseProxies(m_MapRoot, m_View[VIEW_3D], false);
+
 		// turn on lighting
 		bool lighting = m_Map->IsLighting();
 		for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = m_MapRoot->getChildren().begin();
@@ -584,23 +912,52 @@ void ViewPanel::OnPaint(wxPaintEvent& event)
 			(*child)->getMaterial(1).setFlag(irr::video::EMF_GOURAUD_SHADING, true);
 		}
 
+		// the 3D view camera is the listener for the sound preview
+		std::shared_ptr<AudioSystem> audio = m_Browser->GetAudioSystem();
+		if (audio && audio->isSpatialPreview())
+			audio->setListener(m_View[VIEW_3D]->getAbsolutePosition(),
+				m_View[VIEW_3D]->getTarget(), m_View[VIEW_3D]->getUpVector());
+
 		// draw bottom-right view (3D)
 		m_Camera->setVisible(false);
 		m_Grid[VIEW_3D]->setVisible(true);
 		m_Label[VIEW_3D]->setVisible(true);
-		m_RenderDevice->getVideoDriver()->setViewPort(irr::core::recti(
+		m_Scaler->Begin(VIEW_3D, irr::core::recti(
 			size.x / 2, size.y / 2, size.x, size.y));
 		m_RenderDevice->getSceneManager()->setActiveCamera(m_View[VIEW_3D]);
-		m_RenderDevice->getGUIEnvironment()->drawAll();
+		m_MeshLOD->Select(m_View[VIEW_3D], m_RenderDevice->getVideoDriver()->getViewPort());
+		m_Instancer->Select(m_View[VIEW_3D]);
+		m_DebugDraw->capture(m_RenderDevice->getSceneManager()->getRootSceneNode());
+		DrawOverlay();
+		if (m_ShowStats)
+		{
+			TextureResidency::Stats stats = m_Residency->GetStats();
+			MeshInstancer::Stats instances = m_Instancer->GetStats();
+			m_Stats->setText(wxString::Format(_("%d FPS\nTextures: %u (%u proxies, %u evicted)\nTexture memory: %.1f / %.1f MB\nInstances: %u in %u batches\nResolution: %u%%"),
+				m_RenderDevice->getVideoDriver()->getFPS(), stats.Textures, stats.Proxies, stats.Evicted,
+				stats.Bytes / (1024.0 * 1024.0), stats.Budget / (1024.0 * 1024.0),
+				instances.Instances, instances.Batches, m_Scaler->GetScale(VIEW_3D)).wc_str());
+			m_Stats->setVisible(true);
+		}
+		DrawGUI();
 		m_RenderDevice->getSceneManager()->drawAll();
+		m_DebugDraw->release();
+		m_Instancer->Restore();
+		m_Scaler->End(VIEW_3D, irr::core::recti(0, 0, size.x, size.y));
 		m_Grid[VIEW_3D]->setVisible(false);
 		m_Label[VIEW_3D]->setVisible(false);
+		m_Stats->setVisible(false);
 		m_Camera->setVisible(true);
 
+		m_MeshLOD->Restore();
+		m_Residency->Restore();
+
 
 		// draw the dividing lines
 		m_RenderDevice->getVideoDriver()->setViewPort(irr::core::recti(
 			0, 0, size.x, size.y));
+		if (m_Marquee)
+			DrawMarquee();
 		m_RenderDevice->getVideoDriver()->draw2DLine(
 			irr::core::vector2di(0, size.y / 2), irr::core::vector2di(size.x, size.y / 2));
 		m_RenderDevice->getVideoDriver()->draw2DLine(
@@ -609,6 +966,30 @@ void ViewPanel::OnPaint(wxPaintEvent& event)
 	}
 }
 
+void ViewPanel::DrawGUI(void)
+{
+	// all the labels of a view go out in one quad list per glyph page
+	if (m_Font)
+		m_Font->beginBatch();
+
+	m_RenderDevice->getGUIEnvironment()->drawAll();
+
+	if (m_Font)
+		m_Font->endBatch();
+}
+
+void ViewPanel::SetOverlay(const std::vector<irr::video::S3DVertex>& lines)
+{
+	m_Overlay = lines;
+	Refresh();
+}
+
+void ViewPanel::DrawOverlay(void)
+{
+	for (size_t i = 0; i + 1 < m_Overlay.size(); i += 2)
+		m_DebugDraw->addLine(m_Overlay[i].Pos, m_Overlay[i + 1].Pos, m_Overlay[i].Color);
+}
+
 void ViewPanel::OnMouse(wxMouseEvent& event)
 {
 	irr::SEvent irrEvent;
@@ -620,6 +1001,11 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 		return;
 	}
 
+	// dragging, zooming and looking around are drawn at a reduced resolution
+	if (m_Scaler && (event.ButtonIsDown(wxMOUSE_BTN_ANY) ||
+		event.GetEventType() == wxEVT_MOUSEWHEEL || m_FreeLook))
+		m_Scaler->Activity();
+
 	if (!HasCapture() || !m_FreeLook)
 	{
 		m_RenderDevice->getCursorControl()->setReferenceRect(nullptr);
@@ -664,29 +1050,7 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 		}
 
 		// transform the cursor position
-		switch (m_ActiveView)
-		{
-		case VIEW_FRONT: // top-left
-		{
-			cursor.X = (cursor.X / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
-			cursor.Y = (cursor.Y / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
-		} break;
-		case VIEW_TOP: // top-right
-		{
-			cursor.X = ((cursor.X - (size.GetWidth() / 2.0f)) / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
-			cursor.Y = (cursor.Y / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
-		} break;
-		case VIEW_RIGHT: // bottom-left
-		{
-			cursor.X = (cursor.X / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
-			cursor.Y = ((cursor.Y - (size.GetHeight() / 2.0f)) / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
-		} break;
-		case VIEW_3D: // bottom-right
-		{
-			cursor.X = ((cursor.X - (size.GetWidth() / 2.0f)) / (irr::f32)(size.GetWidth() / 2)) * size.GetWidth();
-			cursor.Y = ((cursor.Y - (size.GetHeight() / 2.0f)) / (irr::f32)(size.GetHeight() / 2)) * size.GetHeight();
-		} break;
-		}
+		cursor = ViewCursor(m_ActiveView, cursor);
 	}
 
 	irrEvent.MouseInput.X = cursor.X;
@@ -705,7 +1069,28 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 		{
 			irrEvent.MouseInput.Event = irr::EMIE_MOUSE_MOVED;
 
-			if (event.Dragging() && m_ActiveView != VIEW_3D)
+			if (m_Sculpting)
+			{
+				if (event.LeftIsDown())
+					Sculpt(mouseRay, event.ShiftDown());
+				else
+					EndSculpt(); // released outside the window
+			}
+			else if (m_Marquee)
+			{
+				if (event.LeftIsDown())
+				{
+					// keep the marquee within the view it started in
+					const wxSize& size = GetSize() * GetContentScaleFactor();
+					int left = (m_MarqueeView == VIEW_TOP || m_MarqueeView == VIEW_3D) ? size.x / 2 : 0;
+					int top = (m_MarqueeView == VIEW_RIGHT || m_MarqueeView == VIEW_3D) ? size.y / 2 : 0;
+					m_MarqueeEnd.x = std::max(left, std::min(event.GetX(), left + size.x / 2 - 1));
+					m_MarqueeEnd.y = std::max(top, std::min(event.GetY(), top + size.y / 2 - 1));
+				}
+				else
+					m_Marquee = false; // released outside the window
+			}
+			else if (event.Dragging() && m_ActiveView != VIEW_3D)
 			{
 				// we're in an ortho view and dragging the mouse
 				if (event.LeftIsDown())
@@ -725,7 +1110,7 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 						if (cmd)
 							cmd->Update(translate);
 
-						m_PropertyPanel->Refresh();
+						m_PropertyPanel->UpdateTransform();
 					}
 				}
 			}
@@ -734,7 +1119,14 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 		{
 			irrEvent.MouseInput.Event = irr::EMIE_LMOUSE_PRESSED_DOWN;
 
-			if (m_Selection.size() > 0
+			if (m_SelectionBoxDirty)
+				UpdateSelectionBoundingBox();
+
+			// a stroke starts on the terrain, anywhere else is a normal click
+			if (m_Sculpt && !m_FreeLook)
+				Sculpt(mouseRay, event.ShiftDown());
+
+			if (!m_Sculpting && m_Selection.size() > 0
 				&& m_SelectionBox.intersectsWithLine(mouseRay))
 			{
 				if (!event.ControlDown() && !m_TranslatingSelection) // translating
@@ -755,6 +1147,14 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 					SetCursor(*m_Cursor[CURSOR_MOVE]);
 				}
 			}
+
+			// anywhere else a drag selects everything in the rectangle
+			if (!m_TranslatingSelection && !m_Sculpting && !m_FreeLook)
+			{
+				m_Marquee = true;
+				m_MarqueeView = m_ActiveView;
+				m_MarqueeStart = m_MarqueeEnd = event.GetPosition();
+			}
 		}
 		else if (type == wxEVT_MIDDLE_DOWN)
 		{
@@ -768,22 +1168,38 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 		{
 			irrEvent.MouseInput.Event = irr::EMIE_LMOUSE_LEFT_UP;
 
+			if (m_Sculpting)
+			{
+				EndSculpt();
+				break; // the terrain stays selected
+			}
+
 			if (m_TranslatingSelection)
 			{
 				m_TranslatingSelection = false;
+				EntitiesMoved();
 
 				// update the selection aabb
 				UpdateSelectionBoundingBox();
 
 				// update the property panel, if appropriate
 				if (m_Selection.size() == 1)
-					m_PropertyPanel->Refresh();
+					m_PropertyPanel->UpdateTransform(true);
 
 				SetCursor(wxNullCursor);
 			}
 
+			bool marquee = m_Marquee &&
+				(std::abs(m_MarqueeEnd.x - m_MarqueeStart.x) >= MARQUEE_THRESHOLD ||
+				 std::abs(m_MarqueeEnd.y - m_MarqueeStart.y) >= MARQUEE_THRESHOLD);
+			m_Marquee = false;
+
+			if (marquee)
+			{
+				SelectMarquee(event.ShiftDown());
+			}
 			// check if other mouse buttons are down - we are likely moving the camera
-			if (!event.ButtonIsDown(wxMOUSE_BTN_MIDDLE) &&
+			else if (!event.ButtonIsDown(wxMOUSE_BTN_MIDDLE) &&
 				!event.ButtonIsDown(wxMOUSE_BTN_RIGHT))
 			{
 				// try to pick an object
@@ -823,6 +1239,11 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 			popupMenu.Append(wxID_PASTE);
 			popupMenu.Append(wxID_DELETE);
 			popupMenu.AppendSeparator();
+			popupMenu.Append(MENU_ARRAY, _("Array..."))->Enable(m_Selection.size() == 1);
+			wxMenuItem* sculpt = popupMenu.AppendCheckItem(MENU_SCULPT, _("Sculpt terrain"));
+			sculpt->Enable(GetSculptTarget() != nullptr);
+			sculpt->Check(m_Sculpt && sculpt->IsEnabled());
+			popupMenu.AppendSeparator();
 
 			popupMenu.Append(TOOL_PLAYERSTART, _("Add player start"));
 			popupMenu.Append(TOOL_LIGHT, _("Add light"));
@@ -845,12 +1266,47 @@ void ViewPanel::OnMouse(wxMouseEvent& event)
 				popupMenu.Append(MENU_FREELOOK, !m_FreeLook ? _("Begin free look") : _("End free look"));
 				popupMenu.AppendSeparator();
 			}
+			else
+			{
+				popupMenu.AppendSeparator();
+				ResolutionScaler::MODE mode = m_Scaler->GetMode(m_ActiveView);
+				popupMenu.AppendRadioItem(MENU_RESOLUTIONAUTO, _("Automatic resolution"))
+					->Check(mode == ResolutionScaler::MODE_AUTO);
+				popupMenu.AppendRadioItem(MENU_RESOLUTIONFULL, _("Full resolution"))
+					->Check(mode == ResolutionScaler::MODE_FULL);
+				popupMenu.AppendRadioItem(MENU_RESOLUTIONHALF, _("Half resolution"))
+					->Check(mode == ResolutionScaler::MODE_HALF);
+				popupMenu.AppendSeparator();
+			}
 
 			const wxString& texture = m_Browser->GetTexture();
 			if (!texture.empty())
 				popupMenu.Append(MENU_SETTEXTURE, wxString::Format(_("Apply texture: %s"),
 					texture));
 
+			std::shared_ptr<AudioSystem> audio = m_Browser->GetAudioSystem();
+			if (audio)
+			{
+				popupMenu.AppendSeparator();
+
+				// sound actors in the selection play their own sounds
+				wxString sound = m_Browser->GetSound();
+				irr::f32 gain;
+				for (selection_t::iterator node = m_Selection.begin();
+					node != m_Selection.end(); ++node)
+				{
+					if (FindActorSound(*node, sound, gain))
+						break;
+				}
+
+				if (!sound.empty())
+					popupMenu.Append(MENU_PREVIEWSOUND, wxString::Format(_("Preview sound: %s"),
+						wxFileName(sound).GetFullName()));
+
+				popupMenu.AppendCheckItem(MENU_SPATIALSOUND, _("3D sound preview"))
+					->Check(audio->isSpatialPreview());
+			}
+
 			PopupMenu(&popupMenu);
 		}
 		else if (type == wxEVT_MOUSEWHEEL)
@@ -887,11 +1343,17 @@ void ViewPanel::OnKey(wxKeyEvent& event)
 		case WXK_DELETE:
 			DeleteSelection();
 			break;
+		case WXK_F3:
+			m_ShowStats = !m_ShowStats;
+			break;
 		}
 	}
 
 	if (m_FreeLook)
 	{
+		if (m_Scaler)
+			m_Scaler->Activity();
+
 		// submit the key to the FPS camera
 		irr::SEvent irrEvent;
 		irrEvent.EventType = irr::EET_KEY_INPUT_EVENT;
@@ -928,6 +1390,11 @@ void ViewPanel::OnKey(wxKeyEvent& event)
 
 void ViewPanel::OnMouseCaptureLost(wxMouseCaptureLostEvent& event)
 {
+	m_Marquee = false;
+
+	if (m_Sculpting)
+		EndSculpt();
+
 	if (m_FreeLook)
 		EndFreeLook();
 }
@@ -1014,19 +1481,16 @@ void ViewPanel::OnToolPlane(wxCommandEvent& event)
 
 void ViewPanel::OnToolTerrain(wxCommandEvent& event)
 {
-	wxLogMessage(wxT("Not implemented"));
-
-	// @TODO
 	// get the 3D camera and create the item directly in front of it
-	//irr::core::vector3df pos = m_View[VIEW_3D]->getAbsolutePosition();
-	//irr::core::vector3df target = m_View[VIEW_3D]->getTarget();
-	//irr::core::line3df ray(pos, target);
+	irr::core::vector3df pos = m_View[VIEW_3D]->getAbsolutePosition();
+	irr::core::vector3df target = m_View[VIEW_3D]->getTarget();
+	irr::core::line3df ray(pos, target);
 
-	//irr::core::vector3df location = ray.getMiddle();
+	irr::core::vector3df location = ray.getMiddle();
 
-	//m_Commands.Submit(new AddNodeCommand(TOOL_TERRAIN, m_ExplorerPanel,
-	//	m_RenderDevice->getSceneManager(), m_MapRoot, 
-	//  m_Map, location, m_Map->NextName("terrain")));
+	m_Commands.Submit(new AddNodeCommand(TOOL_TERRAIN, m_ExplorerPanel,
+		m_RenderDevice->getSceneManager(), m_MapRoot, 
+		m_Map, location, m_Map->NextName("terrain")));
 }
 
 void ViewPanel::OnToolSkybox(wxCommandEvent& event)
@@ -1114,17 +1578,32 @@ void ViewPanel::OnToolMesh(wxCommandEvent& event)
 
 void ViewPanel::OnEditCut(wxCommandEvent& event)
 {
-	wxLogMessage(_("Not implemented"));
+	if (CopySelection())
+		DeleteSelection();
 }
 
 void ViewPanel::OnEditCopy(wxCommandEvent& event)
 {
-	wxLogMessage(_("Not implemented"));
+	CopySelection();
 }
 
 void ViewPanel::OnEditPaste(wxCommandEvent& event)
 {
-	wxLogMessage(_("Not implemented"));
+	if (!m_Map)
+		return;
+
+	std::vector<irr::u8> data;
+	if (!EntityClipboard::Get(data))
+		return;
+
+	wxBusyCursor busy;
+	PasteNodesCommand* cmd = new PasteNodesCommand(m_ExplorerPanel,
+		m_RenderDevice->getSceneManager(), m_MapRoot, m_Map, data);
+	if (!m_Commands.Submit(cmd))
+		return;
+
+	// the pasted entities become the selection
+	SelectNodes(cmd->GetPastedNodes(), false);
 }
 
 void ViewPanel::OnEditDelete(wxCommandEvent& event)
@@ -1145,6 +1624,7 @@ void ViewPanel::OnMenuAlignTop(wxCommandEvent& event)
 
 		m_Commands.Submit(new AlignNodeCommand(m_RenderDevice->getSceneManager(),
 			selection, AlignNodeCommand::ALIGN_TOP));
+		EntitiesMoved();
 	}
 }
 
@@ -1161,6 +1641,7 @@ void ViewPanel::OnMenuAlignMiddle(wxCommandEvent& event)
 
 		m_Commands.Submit(new AlignNodeCommand(m_RenderDevice->getSceneManager(),
 			selection, AlignNodeCommand::ALIGN_MIDDLE));
+		EntitiesMoved();
 	}
 }
 
@@ -1177,6 +1658,7 @@ void ViewPanel::OnMenuAlignBottom(wxCommandEvent& event)
 
 		m_Commands.Submit(new AlignNodeCommand(m_RenderDevice->getSceneManager(),
 			selection, AlignNodeCommand::ALIGN_BOTTOM));
+		EntitiesMoved();
 	}
 }
 
@@ -1188,6 +1670,67 @@ void ViewPanel::OnMenuFreeLook(wxCommandEvent& event)
 		EndFreeLook();
 }
 
+void ViewPanel::OnMenuArray(wxCommandEvent& event)
+{
+	if (m_Selection.size() != 1)
+	{
+		wxLogWarning(_("Select one entity to array"));
+		return;
+	}
+
+	irr::scene::ISceneNode* source = m_Selection.front();
+	if (source->getType() == ESNT_PATHNODE ||
+		source->getType() == irr::scene::ESNT_SKY_BOX ||
+		source->getType() == irr::scene::ESNT_SKY_DOME)
+	{
+		wxLogWarning(_("%s can't be arrayed"), source->getName());
+		return;
+	}
+
+	wxString name(source->getName());
+	ArrayDialog dialog(this, name);
+	if (dialog.ShowModal() != wxID_OK)
+		return;
+
+	wxBusyCursor busy;
+
+	std::vector<ArrayPlacement> placements;
+	ArrayTool::Layout(dialog.GetSettings(), source, m_MapRoot,
+		m_RenderDevice->getSceneManager(), placements);
+	if (placements.empty())
+	{
+		wxLogWarning(_("There was nowhere to put the copies of %s"), name);
+		return;
+	}
+
+	ArrayNodeCommand* cmd = new ArrayNodeCommand(m_ExplorerPanel,
+		m_RenderDevice->getSceneManager(), m_MapRoot, m_Map, name, placements);
+	if (!m_Commands.Submit(cmd))
+		return;
+
+	// the copies become the selection, found in one pass over the map
+	std::unordered_set<wxString, wxStringHash, wxStringEqual> copies(
+		cmd->GetCopies().begin(), cmd->GetCopies().end());
+
+	std::vector<irr::scene::ISceneNode*> nodes;
+	const irr::core::list<irr::scene::ISceneNode*>& children = m_MapRoot->getChildren();
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin();
+		it != children.end(); ++it)
+	{
+		if (copies.find(wxString((*it)->getName())) != copies.end())
+			nodes.push_back(*it);
+	}
+
+	SelectNodes(nodes, false);
+}
+
+void ViewPanel::OnMenuSculpt(wxCommandEvent& event)
+{
+	m_Sculpt = event.IsChecked();
+	if (!m_Sculpt && m_Sculpting)
+		EndSculpt();
+}
+
 void ViewPanel::OnMenuSetTexture(wxCommandEvent& event)
 {
 	ChangeTextureCommand::selection_t selection;
@@ -1200,3 +1743,87 @@ void ViewPanel::OnMenuSetTexture(wxCommandEvent& event)
 	m_Commands.Submit(new ChangeTextureCommand(m_RenderDevice->getSceneManager(),
 		selection, 1, 1, m_Browser->GetTexture()));
 }
+
+void ViewPanel::OnMenuPreviewSound(wxCommandEvent& event)
+{
+	std::shared_ptr<AudioSystem> audio = m_Browser->GetAudioSystem();
+	if (!audio)
+		return;
+
+	// sound actors play what their properties name, where they stand
+	bool played = false;
+	for (selection_t::iterator node = m_Selection.begin();
+		node != m_Selection.end(); ++node)
+	{
+		wxString sound;
+		irr::f32 gain;
+		if (FindActorSound(*node, sound, gain))
+		{
+			audio->playSoundAt(sound, (*node)->getAbsolutePosition(), gain);
+			played = true;
+		}
+	}
+
+	if (played)
+		return;
+
+	// otherwise the browser's sound from the selection, or where the 3D view is looking
+	irr::core::vector3df position(m_View[VIEW_3D]->getTarget());
+	if (!m_Selection.empty())
+		position = m_Selection.front()->getAbsolutePosition();
+
+	audio->playSoundAt(m_Browser->GetSound(), position);
+}
+
+bool ViewPanel::FindActorSound(irr::scene::ISceneNode* node, wxString& sound, irr::f32& gain)
+{
+	irr::io::IAttributes* userData = m_Map ? m_Map->GetAttributes(wxString(node->getName())) : nullptr;
+	if (!userData)
+		return false;
+
+	// the first custom property naming a sound file, and a volume if there is one
+	wxString found;
+	gain = 1.0f;
+	for (irr::u32 i = 0; i < userData->getAttributeCount(); ++i)
+	{
+		wxString name(userData->getAttributeName(i));
+		irr::io::E_ATTRIBUTE_TYPE type = userData->getAttributeType(i);
+		if (type == irr::io::EAT_STRING && found.empty())
+		{
+			wxString value(userData->getAttributeAsString(i).c_str());
+			wxString ext = wxFileName(value.AfterLast(wxT(':'))).GetExt().Lower();
+			if (ext == wxT("ogg") || ext == wxT("wav") || ext == wxT("mp3") || ext == wxT("flac"))
+				found = value;
+		}
+		else if (type == irr::io::EAT_FLOAT &&
+			(name.CmpNoCase(wxT("Volume")) == 0 || name.CmpNoCase(wxT("Gain")) == 0))
+			gain = userData->getAttributeAsFloat(i);
+	}
+
+	if (found.empty())
+		return false;
+
+	sound = found;
+	return true;
+}
+
+void ViewPanel::OnMenuSpatialSound(wxCommandEvent& event)
+{
+	std::shared_ptr<AudioSystem> audio = m_Browser->GetAudioSystem();
+	if (audio)
+		audio->setSpatialPreview(event.IsChecked());
+}
+
+void ViewPanel::OnMenuResolution(wxCommandEvent& event)
+{
+	ResolutionScaler::MODE mode = ResolutionScaler::MODE_AUTO;
+	if (event.GetId() == MENU_RESOLUTIONFULL)
+		mode = ResolutionScaler::MODE_FULL;
+	else if (event.GetId() == MENU_RESOLUTIONHALF)
+		mode = ResolutionScaler::MODE_HALF;
+
+	// remembered for the next map
+	m_Scaler->SetMode(m_ActiveView, mode);
+	wxConfigBase::Get()->Write(wxString::Format(wxT("/Rendering/ViewResolution%d"), (int)m_ActiveView),
+		(long)mode);
+}
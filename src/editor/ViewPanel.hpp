@@ -10,7 +10,12 @@
 #include "BrowserWindow.hpp"
 #include "ExplorerPanel.hpp"
 #include "Map.hpp"
+#include "MeshInstancer.hpp"
+#include "MeshLOD.hpp"
 #include "PropertyPanel.hpp"
+#include "ResolutionScaler.hpp"
+#include "SpatialIndex.hpp"
+#include "TextureResidency.hpp"
 
 #include <wx/cmdproc.h>
 #include <wx/cursor.h>
@@ -23,6 +28,12 @@
 
 #include <list>
 #include <memory>
+#include <unordered_map>
+#include <vector>
+
+class DebugDrawSceneNode;
+class TerrainSceneNode;
+namespace irr { namespace gui { class CGUITTFont; } }
 
 /**
  * @class ViewPanel
@@ -84,15 +95,37 @@ private:
 	irr::scene::ISceneNodeAnimatorCameraFPS* m_3DCam;      ///< FPS camera animator
 	CGridSceneNode* m_Grid[4];                     ///< Grid nodes for each view
 	irr::gui::IGUIStaticText* m_Label[4];          ///< View labels
+	irr::gui::CGUITTFont* m_Font;                  ///< Default font, its text is batched per view
+	irr::gui::IGUIStaticText* m_Stats;             ///< Profiler overlay in the 3D view
+	bool m_ShowStats;                              ///< Profiler overlay toggle
+
+	TextureResidency* m_Residency;                 ///< Texture budget and proxies
+	MeshLOD* m_MeshLOD;                            ///< Simplified stand-ins for small meshes
+	MeshInstancer* m_Instancer;                    ///< Batches for repeated meshes
+	DebugDrawSceneNode* m_DebugDraw;               ///< Batched links, boxes and markers
+	ResolutionScaler* m_Scaler;                    ///< Per view resolution under the frame budget
 
 	std::shared_ptr<Map> m_Map;                    ///< The current map
 	
 	typedef std::list<irr::scene::ISceneNode*> selection_t; ///< Type for node selection
 	selection_t m_Selection;                       ///< Currently selected nodes
+	typedef std::unordered_map<wxString, selection_t::iterator, wxStringHash, wxStringEqual> selectionindex_t; ///< Type for selection lookup
+	selectionindex_t m_SelectionIndex;             ///< Names of the selected nodes to their place in m_Selection
 	irr::core::aabbox3df m_SelectionBox;          ///< Bounding box of selection
+	bool m_SelectionBoxDirty;                      ///< A node on the edge of the box was unselected
+
+	SpatialIndex m_SpatialIndex;                   ///< Entity boxes for marquee selection
+	bool m_Marquee;                                ///< Marquee selection in progress
+	VIEW m_MarqueeView;                            ///< View the marquee started in
+	wxPoint m_MarqueeStart;                        ///< Marquee corner where the drag started
+	wxPoint m_MarqueeEnd;                          ///< Marquee corner under the mouse
 
 	wxPoint m_LastMousePos;                        ///< Last mouse position
 	bool m_TranslatingSelection;                   ///< Selection translation flag
+	bool m_Sculpt;                                 ///< Left drags sculpt the selected terrain
+	bool m_Sculpting;                              ///< Sculpt stroke in progress
+
+	std::vector<irr::video::S3DVertex> m_Overlay;  ///< Line pairs drawn in every view
 
 public:
 	/**
@@ -138,6 +171,23 @@ public:
 	 */
 	void UpdateSelectionBoundingBox(void);
 
+	/**
+	 * @brief Note an entity added to the map
+	 * @param name Name of the entity
+	 */
+	void EntityAdded(const wxString& name);
+
+	/**
+	 * @brief Note an entity removed from the map, dropping it from the selection
+	 * @param name Name of the entity, its node may already be gone
+	 */
+	void EntityRemoved(const wxString& name);
+
+	/**
+	 * @brief Note that entities may have moved or changed size
+	 */
+	void EntitiesMoved(void);
+
 	/**
 	 * @brief Show or hide the selection
 	 * @param show Whether to show the selection
@@ -154,6 +204,12 @@ public:
 	 */
 	void DeleteSelection(void);
 
+	/**
+	 * @brief Put the selected entities on the clipboard
+	 * @return False if nothing was copied
+	 */
+	bool CopySelection(void);
+
 	/**
 	 * @brief Begin free look mode
 	 */
@@ -164,6 +220,12 @@ public:
 	 */
 	void EndFreeLook(void);
 
+	/**
+	 * @brief Set lines drawn over every view, such as navigation paths
+	 * @param lines Pairs of vertices, one pair per line; empty to clear
+	 */
+	void SetOverlay(const std::vector<irr::video::S3DVertex>& lines);
+
 private:
 	/**
 	 * @brief Handle timer events
@@ -183,6 +245,16 @@ private:
 	 */
 	void OnPaint(wxPaintEvent& event);
 
+	/**
+	 * @brief Draw the labels and overlays of the current view
+	 */
+	void DrawGUI(void);
+
+	/**
+	 * @brief Queue the overlay lines for the current view
+	 */
+	void DrawOverlay(void);
+
 	/**
 	 * @brief Handle mouse events
 	 * @param event The mouse event
@@ -212,6 +284,57 @@ private:
 	 */
 	void BuildPathLinks(void);
 
+	/**
+	 * @brief Transform a window position to the screen space of a view's camera
+	 * @param view The view
+	 * @param point The window position
+	 * @return The position for the view's camera
+	 */
+	irr::core::vector2di ViewCursor(VIEW view, const irr::core::vector2di& point);
+
+	/**
+	 * @brief Add a node to the selection, it must not already be selected
+	 * @param node Pointer to the node to add
+	 */
+	void SelectNode(irr::scene::ISceneNode* node);
+
+	/**
+	 * @brief Select the entities inside the marquee
+	 * @param append Whether to append to existing selection
+	 */
+	void SelectMarquee(bool append);
+
+	/**
+	 * @brief Select a batch of nodes, updating the explorer once
+	 * @param nodes The nodes to select
+	 * @param append Whether to append to existing selection
+	 */
+	void SelectNodes(const std::vector<irr::scene::ISceneNode*>& nodes, bool append);
+
+	/**
+	 * @brief Draw the marquee outline over its view
+	 */
+	void DrawMarquee(void);
+
+	/**
+	 * @brief Get the terrain the sculpt tool works on
+	 * @return The single selected terrain, or nullptr
+	 */
+	TerrainSceneNode* GetSculptTarget(void);
+
+	/**
+	 * @brief Apply the sculpt brush where the ray hits the terrain
+	 * @param ray The mouse ray
+	 * @param lower Whether to lower instead of raise
+	 * @return True if the terrain was hit
+	 */
+	bool Sculpt(const irr::core::line3df& ray, bool lower);
+
+	/**
+	 * @brief Finish the current sculpt stroke
+	 */
+	void EndSculpt(void);
+
 public:
 	/**
 	 * @brief Handle cube tool action
@@ -332,4 +455,43 @@ public:
 	 * @param event The command event
 	 */
 	void OnMenuSetTexture(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle array action, copies the selected entity in a pattern
+	 * @param event The command event
+	 */
+	void OnMenuArray(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle sculpt action, toggles the terrain sculpt tool
+	 * @param event The command event
+	 */
+	void OnMenuSculpt(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle preview sound action
+	 * @param event The command event
+	 */
+	void OnMenuPreviewSound(wxCommandEvent& event);
+
+	/**
+	 * @brief Find the sound an actor's custom properties name
+	 * @param node The entity, which may not be an actor
+	 * @param sound Receives the sound's location
+	 * @param gain Receives the actor's Volume or Gain property, 1 without one
+	 * @return true if the entity is a sound actor
+	 */
+	bool FindActorSound(irr::scene::ISceneNode* node, wxString& sound, irr::f32& gain);
+
+	/**
+	 * @brief Handle 3D sound preview toggle
+	 * @param event The command event
+	 */
+	void OnMenuSpatialSound(wxCommandEvent& event);
+
+	/**
+	 * @brief Handle the resolution choice of an orthographic view
+	 * @param event The command event
+	 */
+	void OnMenuResolution(wxCommandEvent& event);
 };
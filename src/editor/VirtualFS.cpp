@@ -0,0 +1,187 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "VirtualFS.hpp"
+
+#include <wx/filename.h>
+#include <wx/log.h>
+
+VirtualFS& VirtualFS::Get(void)
+{
+	static VirtualFS vfs;
+	return vfs;
+}
+
+VirtualFS::VirtualFS(void)
+	: m_Watcher(nullptr)
+{
+	Bind(wxEVT_FSWATCHER, &VirtualFS::OnFileSystemEvent, this);
+}
+
+VirtualFS::~VirtualFS(void)
+{
+	// normally gone already, see StopWatching
+	if (m_Watcher)
+		delete m_Watcher;
+}
+
+void VirtualFS::MountFolder(const wxString& path, int flags)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (size_t i = 0; i < m_Mounts.size(); ++i)
+	{
+		if (m_Mounts[i].Path == path)
+		{
+			m_Mounts[i].Flags |= flags;
+			m_ResolvedFiles.clear();
+			m_ResolvedPackages.clear();
+			return;
+		}
+	}
+
+	Mount mount;
+	mount.Path = path;
+	mount.Flags = flags;
+	m_Mounts.push_back(mount);
+
+	// the whole tree, names resolve into subfolders too
+	if (m_Watcher)
+		m_Watcher->AddTree(wxFileName(path, wxEmptyString), wxFSW_EVENT_CREATE | wxFSW_EVENT_DELETE | wxFSW_EVENT_RENAME);
+
+	// a new mount can satisfy earlier misses
+	m_ResolvedFiles.clear();
+	m_ResolvedPackages.clear();
+}
+
+void VirtualFS::MountArchive(const wxString& path)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	wxFileName fn(path);
+	m_Archives.emplace(fn.GetFullName().Lower(), fn.GetFullPath());
+	m_ResolvedPackages.clear();
+}
+
+wxString VirtualFS::ResolveFile(const wxString& location)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	resolved_t::iterator cached = m_ResolvedFiles.find(location);
+	if (cached != m_ResolvedFiles.end())
+		return cached->second;
+
+	wxString result;
+	if (wxFileName(location).IsAbsolute())
+	{
+		if (wxFileName::FileExists(location))
+			result = location;
+	}
+	else
+	{
+		for (size_t i = 0; i < m_Mounts.size(); ++i)
+		{
+			if (!(m_Mounts[i].Flags & MOUNT_FILES))
+				continue;
+
+			wxFileName fn(m_Mounts[i].Path + wxFileName::GetPathSeparator() + location);
+			if (fn.FileExists())
+			{
+				result = fn.GetFullPath();
+				break;
+			}
+		}
+	}
+
+	m_ResolvedFiles.emplace(location, result);
+	return result;
+}
+
+wxString VirtualFS::ResolvePackage(const wxString& name)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	resolved_t::iterator cached = m_ResolvedPackages.find(name);
+	if (cached != m_ResolvedPackages.end())
+		return cached->second;
+
+	wxString result;
+	wxFileName fn(name);
+
+	// mounted archives are already known by name
+	std::map<wxString, wxString>::iterator archive = m_Archives.find(fn.GetFullName().Lower());
+	if (archive != m_Archives.end() && wxFileName::FileExists(archive->second))
+		result = archive->second;
+
+	for (size_t i = 0; result.empty() && i < m_Mounts.size(); ++i)
+	{
+		if (!(m_Mounts[i].Flags & MOUNT_PACKAGES))
+			continue;
+
+		wxFileName search(m_Mounts[i].Path, fn.GetFullName());
+		if (search.FileExists())
+			result = search.GetFullPath();
+	}
+
+	m_ResolvedPackages.emplace(name, result);
+	return result;
+}
+
+void VirtualFS::StartWatching(void)
+{
+	if (m_Watcher)
+		return;
+
+	m_Watcher = new wxFileSystemWatcher;
+	m_Watcher->SetOwner(this);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (size_t i = 0; i < m_Mounts.size(); ++i)
+	{
+		if (!m_Watcher->AddTree(wxFileName(m_Mounts[i].Path, wxEmptyString),
+			wxFSW_EVENT_CREATE | wxFSW_EVENT_DELETE | wxFSW_EVENT_RENAME))
+			wxLogWarning(_("Unable to watch folder: %s"), m_Mounts[i].Path);
+	}
+}
+
+void VirtualFS::StopWatching(void)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_Watcher)
+		return;
+
+	m_Watcher->RemoveAll();
+	delete m_Watcher;
+	m_Watcher = nullptr;
+}
+
+void VirtualFS::Invalidate(void)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_ResolvedFiles.clear();
+	m_ResolvedPackages.clear();
+}
+
+void VirtualFS::OnFileSystemEvent(wxFileSystemWatcherEvent& event)
+{
+	// only a change in which files exist can affect what a name resolves to
+	switch (event.GetChangeType())
+	{
+	case wxFSW_EVENT_CREATE:
+		// a new subfolder isn't watched until it's added
+		if (m_Watcher && wxFileName::DirExists(event.GetPath().GetFullPath()))
+			m_Watcher->AddTree(wxFileName::DirName(event.GetPath().GetFullPath()),
+				wxFSW_EVENT_CREATE | wxFSW_EVENT_DELETE | wxFSW_EVENT_RENAME);
+		Invalidate();
+		break;
+	case wxFSW_EVENT_DELETE:
+	case wxFSW_EVENT_RENAME:
+		Invalidate();
+		break;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <wx/event.h>
+#include <wx/fswatcher.h>
+#include <wx/string.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Ordered mount table shared by the wxFileSystem and Irrlicht handlers, with
+// a cache of resolved paths so a name is only searched for once. Misses are
+// cached too; the cache is dropped whenever a file appears, disappears or is
+// renamed in a mounted folder.
+class VirtualFS : public wxEvtHandler
+{
+public:
+	enum
+	{
+		MOUNT_FILES = 1 << 0,    // search the folder for loose files
+		MOUNT_PACKAGES = 1 << 1, // search the folder for packages
+	};
+
+private:
+	struct Mount
+	{
+		wxString Path;
+		int Flags;
+	};
+
+	std::vector<Mount> m_Mounts;             // in search order
+	std::map<wxString, wxString> m_Archives; // file name -> full path
+
+	typedef std::map<wxString, wxString> resolved_t; // empty when not found
+	resolved_t m_ResolvedFiles;
+	resolved_t m_ResolvedPackages;
+	std::mutex m_Mutex; // handlers are also used from worker threads
+
+	wxFileSystemWatcher* m_Watcher;
+
+public:
+	static VirtualFS& Get(void);
+
+	// Mounts are searched in the order they were added
+	void MountFolder(const wxString& path, int flags = MOUNT_FILES | MOUNT_PACKAGES);
+	void MountArchive(const wxString& path);
+
+	// Full path of a loose file in a mounted folder, or empty
+	wxString ResolveFile(const wxString& location);
+
+	// Full path of a package by its file name, or empty
+	wxString ResolvePackage(const wxString& name);
+
+	// Starts watching the mounted folders, needs a running event loop
+	void StartWatching(void);
+
+	// Drops the watcher; call before wx shuts down, the instance outlives it
+	void StopWatching(void);
+
+	void Invalidate(void);
+
+private:
+	VirtualFS(void);
+	~VirtualFS(void);
+
+	void OnFileSystemEvent(wxFileSystemWatcherEvent& event);
+};
@@ -0,0 +1,88 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(size_t threadCount)
+	: m_Active(0), m_Shutdown(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (size_t i = 0; i < threadCount; ++i)
+		m_Threads.push_back(std::thread(&WorkerPool::Run, this));
+}
+
+WorkerPool::~WorkerPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.clear(); // don't start anything new
+		m_Shutdown = true;
+	}
+	m_JobReady.notify_all();
+
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+		m_Threads[i].join();
+}
+
+size_t WorkerPool::GetThreadCount(void) const
+{
+	return m_Threads.size();
+}
+
+void WorkerPool::Submit(const job_t& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(job);
+	}
+	m_JobReady.notify_one();
+}
+
+void WorkerPool::Cancel(void)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Jobs.clear();
+	if (m_Active == 0)
+		m_Idle.notify_all();
+}
+
+void WorkerPool::Wait(void)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Idle.wait(lock, [this] { return m_Jobs.empty() && m_Active == 0; });
+}
+
+void WorkerPool::Run(void)
+{
+	for (;;)
+	{
+		job_t job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobReady.wait(lock, [this] { return m_Shutdown || !m_Jobs.empty(); });
+			if (m_Shutdown)
+				return;
+
+			job = m_Jobs.front();
+			m_Jobs.pop_front();
+			++m_Active;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_Active;
+			if (m_Active == 0 && m_Jobs.empty())
+				m_Idle.notify_all();
+		}
+	}
+}
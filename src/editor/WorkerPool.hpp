@@ -0,0 +1,49 @@
+/*
+* ManifoldEditor
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from a shared queue. Jobs must
+// not touch wx UI objects; post results back with CallAfter instead.
+class WorkerPool
+{
+public:
+	typedef std::function<void(void)> job_t;
+
+private:
+	std::vector<std::thread> m_Threads;
+	std::deque<job_t> m_Jobs;
+	std::mutex m_Mutex;
+	std::condition_variable m_JobReady;
+	std::condition_variable m_Idle;
+	size_t m_Active;
+	bool m_Shutdown;
+
+public:
+	// threadCount of 0 uses one thread per hardware core, less one for the UI
+	WorkerPool(size_t threadCount = 0);
+	~WorkerPool(void);
+
+	size_t GetThreadCount(void) const;
+
+	void Submit(const job_t& job);
+
+	// Drops any jobs that haven't started yet
+	void Cancel(void);
+
+	// Blocks until the queue is empty and every worker is idle
+	void Wait(void);
+
+private:
+	void Run(void);
+};
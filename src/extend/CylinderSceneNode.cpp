@@ -5,6 +5,7 @@
 */
 
 #include "CylinderSceneNode.hpp"
+#include "DebugDrawSceneNode.hpp"
 #include "../source/Irrlicht/CShadowVolumeSceneNode.h"
 
 CylinderSceneNode::CylinderSceneNode(irr::f32 radius, irr::f32 length, irr::u32 tesselation,
@@ -54,6 +55,13 @@ void CylinderSceneNode::render(void)
 		driver->drawMeshBuffer(m_Mesh->getMeshBuffer(0));
 		if (DebugDataVisible & irr::scene::EDS_BBOX)
 		{
+			DebugDrawSceneNode* debugDraw = DebugDrawSceneNode::get(SceneManager);
+			if (debugDraw)
+			{
+				debugDraw->addBox(m_Mesh->getMeshBuffer(0)->getBoundingBox(), AbsoluteTransformation);
+				return;
+			}
+
 			irr::video::SMaterial m;
 			m.Lighting = false;
 			driver->setMaterial(m);
@@ -0,0 +1,278 @@
+/*
+* ManifoldEngine
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "DebugDrawSceneNode.hpp"
+
+#include <algorithm>
+
+// 16 bit indices, so each call covers at most this many vertices
+static const irr::u32 MAX_VERTICES = 65532;
+
+static const irr::c8* PARAMETER_NAME = "DebugDrawSceneNode";
+
+//! Orders billboards so the ones sharing a material are next to each other
+static bool materialLess(const irr::video::SMaterial& a, const irr::video::SMaterial& b)
+{
+	if (a.getTexture(0) != b.getTexture(0))
+		return a.getTexture(0) < b.getTexture(0);
+	if (a.MaterialType != b.MaterialType)
+		return a.MaterialType < b.MaterialType;
+	if (a.MaterialTypeParam != b.MaterialTypeParam)
+		return a.MaterialTypeParam < b.MaterialTypeParam;
+	if (a.Lighting != b.Lighting)
+		return a.Lighting < b.Lighting;
+	if (a.ZWriteEnable != b.ZWriteEnable)
+		return a.ZWriteEnable < b.ZWriteEnable;
+	if (a.ZBuffer != b.ZBuffer)
+		return a.ZBuffer < b.ZBuffer;
+	if (a.BlendOperation != b.BlendOperation)
+		return a.BlendOperation < b.BlendOperation;
+	return a.BackfaceCulling < b.BackfaceCulling;
+}
+
+DebugDrawSceneNode::DebugDrawSceneNode(irr::scene::ISceneNode* parent,
+	irr::scene::ISceneManager* mgr, irr::s32 id)
+	: irr::scene::ISceneNode(parent, mgr, id)
+{
+#ifdef _DEBUG
+	setDebugName("DebugDrawSceneNode");
+#endif
+
+	// always drawn, the primitives are in world space
+	setAutomaticCulling(irr::scene::EAC_OFF);
+
+	mgr->getParameters()->setAttribute(PARAMETER_NAME, (void*)this);
+}
+
+DebugDrawSceneNode::~DebugDrawSceneNode(void)
+{
+	release();
+
+	if (get(SceneManager) == this)
+		SceneManager->getParameters()->setAttribute(PARAMETER_NAME, (void*)nullptr);
+}
+
+DebugDrawSceneNode* DebugDrawSceneNode::get(irr::scene::ISceneManager* mgr)
+{
+	if (!mgr || !mgr->getParameters()->existsAttribute(PARAMETER_NAME))
+		return nullptr;
+
+	return static_cast<DebugDrawSceneNode*>(mgr->getParameters()->getAttributeAsUserPointer(PARAMETER_NAME));
+}
+
+void DebugDrawSceneNode::OnRegisterSceneNode(void)
+{
+	// after every other node has had the chance to add to the batch
+	if (IsVisible)
+		SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_TRANSPARENT_EFFECT);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+void DebugDrawSceneNode::render(void)
+{
+	irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	irr::scene::ICameraSceneNode* camera = SceneManager->getActiveCamera();
+
+	if (driver)
+	{
+		driver->setTransform(irr::video::ETS_WORLD, irr::core::IdentityMatrix);
+
+		flushLines(driver);
+		if (camera)
+			flushBillboards(driver, camera);
+	}
+
+	m_Lines.clear();
+	m_Billboards.clear();
+}
+
+const irr::core::aabbox3d<irr::f32>& DebugDrawSceneNode::getBoundingBox(void) const
+{
+	return m_Aabb;
+}
+
+void DebugDrawSceneNode::addLine(const irr::core::vector3df& start, const irr::core::vector3df& end,
+	irr::video::SColor color)
+{
+	m_Lines.push_back(irr::video::S3DVertex(start, irr::core::vector3df(0, 1, 0), color, irr::core::vector2df()));
+	m_Lines.push_back(irr::video::S3DVertex(end, irr::core::vector3df(0, 1, 0), color, irr::core::vector2df()));
+}
+
+void DebugDrawSceneNode::addBox(const irr::core::aabbox3d<irr::f32>& box, const irr::core::matrix4& transform,
+	irr::video::SColor color)
+{
+	irr::core::vector3df edges[8];
+	box.getEdges(edges);
+	for (irr::u32 i = 0; i < 8; ++i)
+		transform.transformVect(edges[i]);
+
+	// same corner order as aabbox3d::getEdges
+	static const irr::u32 lines[24] = {
+		5, 1, 1, 3, 3, 7, 7, 5,
+		0, 2, 2, 6, 6, 4, 4, 0,
+		1, 0, 3, 2, 7, 6, 5, 4
+	};
+
+	for (irr::u32 i = 0; i < 24; i += 2)
+		addLine(edges[lines[i]], edges[lines[i + 1]], color);
+}
+
+void DebugDrawSceneNode::addBillboard(const irr::core::vector3df& position, const irr::core::dimension2df& size,
+	const irr::video::SMaterial& material, irr::video::SColor topColor, irr::video::SColor bottomColor)
+{
+	Billboard billboard;
+	billboard.Position = position;
+	billboard.Size = size;
+	billboard.TopColor = topColor;
+	billboard.BottomColor = bottomColor;
+	billboard.Material = material;
+	m_Billboards.push_back(billboard);
+}
+
+void DebugDrawSceneNode::capture(irr::scene::ISceneNode* root)
+{
+	if (root->isVisible())
+		captureNode(root);
+}
+
+void DebugDrawSceneNode::release(void)
+{
+	for (size_t i = 0; i < m_Hidden.size(); ++i)
+		m_Hidden[i]->setVisible(true);
+	for (size_t i = 0; i < m_DebugData.size(); ++i)
+		m_DebugData[i]->setDebugDataVisible(irr::scene::EDS_BBOX);
+
+	m_Hidden.clear();
+	m_DebugData.clear();
+}
+
+void DebugDrawSceneNode::captureNode(irr::scene::ISceneNode* node)
+{
+	if (node->isDebugDataVisible() == irr::scene::EDS_BBOX)
+	{
+		addBox(node->getBoundingBox(), node->getAbsoluteTransformation());
+		node->setDebugDataVisible(irr::scene::EDS_OFF);
+		m_DebugData.push_back(node);
+	}
+
+	// the children of a billboard still draw themselves
+	if (node->getType() == irr::scene::ESNT_BILLBOARD && node->getChildren().empty())
+	{
+		irr::scene::IBillboardSceneNode* billboard = static_cast<irr::scene::IBillboardSceneNode*>(node);
+
+		irr::video::SColor topColor, bottomColor;
+		billboard->getColor(topColor, bottomColor);
+		addBillboard(billboard->getAbsolutePosition(), billboard->getSize(),
+			billboard->getMaterial(0), topColor, bottomColor);
+
+		node->setVisible(false);
+		m_Hidden.push_back(node);
+		return;
+	}
+
+	for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator child = node->getChildren().begin();
+		child != node->getChildren().end(); ++child)
+	{
+		if ((*child)->isVisible())
+			captureNode(*child);
+	}
+}
+
+void DebugDrawSceneNode::flushLines(irr::video::IVideoDriver* driver)
+{
+	if (m_Lines.empty())
+		return;
+
+	irr::video::SMaterial material;
+	material.Lighting = false;
+	driver->setMaterial(material);
+
+	if (m_LineIndices.empty())
+	{
+		m_LineIndices.resize(MAX_VERTICES);
+		for (irr::u32 i = 0; i < MAX_VERTICES; ++i)
+			m_LineIndices[i] = (irr::u16)i;
+	}
+
+	for (size_t start = 0; start < m_Lines.size(); start += MAX_VERTICES)
+	{
+		irr::u32 count = (irr::u32)irr::core::min_(m_Lines.size() - start, (size_t)MAX_VERTICES);
+		driver->drawVertexPrimitiveList(&m_Lines[start], count, &m_LineIndices[0], count / 2,
+			irr::video::EVT_STANDARD, irr::scene::EPT_LINES, irr::video::EIT_16BIT);
+	}
+}
+
+void DebugDrawSceneNode::flushBillboards(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera)
+{
+	if (m_Billboards.empty())
+		return;
+
+	// one batch per material; sharing a texture isn't enough, the blending
+	// and lighting have to match as well
+	std::stable_sort(m_Billboards.begin(), m_Billboards.end(),
+		[](const Billboard& a, const Billboard& b)
+	{
+		return materialLess(a.Material, b.Material);
+	});
+
+	// every billboard faces the same way, as in CBillboardSceneNode
+	irr::core::vector3df view = camera->getTarget() - camera->getAbsolutePosition();
+	view.normalize();
+
+	irr::core::vector3df up = camera->getUpVector();
+	irr::core::vector3df horizontal = up.crossProduct(view);
+	if (horizontal.getLength() == 0)
+		horizontal.set(up.Y, up.X, up.Z);
+	horizontal.normalize();
+
+	irr::core::vector3df vertical = horizontal.crossProduct(view);
+	vertical.normalize();
+
+	irr::core::vector3df normal = -view;
+
+	size_t first = 0;
+	while (first < m_Billboards.size())
+	{
+		const irr::video::SMaterial& material = m_Billboards[first].Material;
+		size_t last = first;
+		while (last < m_Billboards.size() && m_Billboards[last].Material == material &&
+			(last - first + 1) * 4 <= MAX_VERTICES)
+			++last;
+
+		m_Vertices.clear();
+		m_Indices.clear();
+		for (size_t i = first; i < last; ++i)
+		{
+			const Billboard& billboard = m_Billboards[i];
+			irr::core::vector3df h = horizontal * 0.5f * billboard.Size.Width;
+			irr::core::vector3df v = vertical * 0.5f * billboard.Size.Height;
+
+			irr::u16 base = (irr::u16)m_Vertices.size();
+			m_Vertices.push_back(irr::video::S3DVertex(billboard.Position + h + v, normal,
+				billboard.BottomColor, irr::core::vector2df(1, 1)));
+			m_Vertices.push_back(irr::video::S3DVertex(billboard.Position + h - v, normal,
+				billboard.TopColor, irr::core::vector2df(1, 0)));
+			m_Vertices.push_back(irr::video::S3DVertex(billboard.Position - h - v, normal,
+				billboard.TopColor, irr::core::vector2df(0, 0)));
+			m_Vertices.push_back(irr::video::S3DVertex(billboard.Position - h + v, normal,
+				billboard.BottomColor, irr::core::vector2df(0, 1)));
+
+			m_Indices.push_back(base);
+			m_Indices.push_back(base + 2);
+			m_Indices.push_back(base + 1);
+			m_Indices.push_back(base);
+			m_Indices.push_back(base + 3);
+			m_Indices.push_back(base + 2);
+		}
+
+		driver->setMaterial(material);
+		driver->drawIndexedTriangleList(&m_Vertices[0], (irr::u32)m_Vertices.size(),
+			&m_Indices[0], (irr::u32)m_Indices.size() / 3);
+
+		first = last;
+	}
+}
@@ -0,0 +1,86 @@
+/*
+* ManifoldEngine
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <vector>
+
+#define ESNT_DEBUGDRAW MAKE_IRR_ID('d', 'b', 'g', 'd')
+
+//! Immediate mode lines, boxes and billboards. Everything added while the
+//! scene is drawn is flushed in a single pass once the other nodes are done,
+//! with one draw call for all the lines and one per billboard material.
+class DebugDrawSceneNode : public irr::scene::ISceneNode
+{
+private:
+	struct Billboard
+	{
+		irr::core::vector3df Position;
+		irr::core::dimension2df Size;
+		irr::video::SColor TopColor;
+		irr::video::SColor BottomColor;
+		irr::video::SMaterial Material;
+	};
+
+	irr::core::aabbox3d<irr::f32> m_Aabb;
+
+	std::vector<irr::video::S3DVertex> m_Lines;
+	std::vector<Billboard> m_Billboards;
+
+	// reused for every flush
+	std::vector<irr::video::S3DVertex> m_Vertices;
+	std::vector<irr::u16> m_Indices;
+	std::vector<irr::u16> m_LineIndices;
+
+	// nodes changed by capture()
+	std::vector<irr::scene::ISceneNode*> m_Hidden;
+	std::vector<irr::scene::ISceneNode*> m_DebugData;
+
+public:
+	DebugDrawSceneNode(irr::scene::ISceneNode* parent,
+		irr::scene::ISceneManager* mgr, irr::s32 id);
+	virtual ~DebugDrawSceneNode(void);
+
+	//! The node the nodes of this scene manager should batch into, if any
+	static DebugDrawSceneNode* get(irr::scene::ISceneManager* mgr);
+
+	virtual void OnRegisterSceneNode(void);
+
+	//! draws everything added since the last time
+	virtual void render(void);
+
+	//! returns the axis aligned bounding box of this node
+	virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox(void) const;
+
+	//! Returns type of the scene node
+	virtual irr::scene::ESCENE_NODE_TYPE getType(void) const { return (irr::scene::ESCENE_NODE_TYPE)ESNT_DEBUGDRAW; }
+
+	//! A line in world space
+	void addLine(const irr::core::vector3df& start, const irr::core::vector3df& end,
+		irr::video::SColor color = irr::video::SColor(255, 255, 255, 255));
+
+	//! The edges of a box, transformed into world space
+	void addBox(const irr::core::aabbox3d<irr::f32>& box, const irr::core::matrix4& transform,
+		irr::video::SColor color = irr::video::SColor(255, 255, 255, 255));
+
+	//! A quad facing the camera it's drawn with
+	void addBillboard(const irr::core::vector3df& position, const irr::core::dimension2df& size,
+		const irr::video::SMaterial& material,
+		irr::video::SColor topColor = irr::video::SColor(255, 255, 255, 255),
+		irr::video::SColor bottomColor = irr::video::SColor(255, 255, 255, 255));
+
+	//! Takes over drawing of the billboards and bounding boxes under a node
+	//! for the next draw. release() hands them back.
+	void capture(irr::scene::ISceneNode* root);
+	void release(void);
+
+private:
+	void captureNode(irr::scene::ISceneNode* node);
+	void flushLines(irr::video::IVideoDriver* driver);
+	void flushBillboards(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera);
+};
@@ -5,6 +5,7 @@
 */
 
 #include "PathSceneNode.hpp"
+#include "DebugDrawSceneNode.hpp"
 
 PathSceneNode::PathSceneNode(irr::scene::ISceneNode* parent,
 	irr::scene::ISceneManager* mgr, irr::s32 id,
@@ -33,7 +34,15 @@ PathSceneNode::~PathSceneNode(void)
 void PathSceneNode::OnRegisterSceneNode(void)
 {
 	if (IsVisible && m_DrawLink)
-		SceneManager->registerNodeForRendering(this);
+	{
+		// batched with the other links when there's somewhere to put it
+		DebugDrawSceneNode* debugDraw = DebugDrawSceneNode::get(SceneManager);
+		PathSceneNode* next = getNext();
+		if (debugDraw && next)
+			debugDraw->addLine(getAbsolutePosition(), next->getAbsolutePosition());
+		else if (!debugDraw)
+			SceneManager->registerNodeForRendering(this);
+	}
 
 	ISceneNode::OnRegisterSceneNode();
 }
@@ -5,6 +5,7 @@
 */
 
 #include "PlaneSceneNode.hpp"
+#include "DebugDrawSceneNode.hpp"
 #include "../source/Irrlicht/CShadowVolumeSceneNode.h"
 
 PlaneSceneNode::PlaneSceneNode(const irr::core::dimension2df& tileSize,
@@ -54,6 +55,13 @@ void PlaneSceneNode::render(void)
 		driver->drawMeshBuffer(m_Mesh->getMeshBuffer(0));
 		if (DebugDataVisible & irr::scene::EDS_BBOX)
 		{
+			DebugDrawSceneNode* debugDraw = DebugDrawSceneNode::get(SceneManager);
+			if (debugDraw)
+			{
+				debugDraw->addBox(m_Mesh->getMeshBuffer(0)->getBoundingBox(), AbsoluteTransformation);
+				return;
+			}
+
 			irr::video::SMaterial m;
 			m.Lighting = false;
 			driver->setMaterial(m);
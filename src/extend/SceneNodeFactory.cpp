@@ -9,6 +9,7 @@
 #include "PlaneSceneNode.hpp"
 #include "PlayerStartNode.hpp"
 #include "PathSceneNode.hpp"
+#include "TerrainSceneNode.hpp"
 
 SceneNodeFactory::SceneNodeFactory(irr::scene::ISceneManager* sceneMgr)
 	: m_SceneMgr(sceneMgr)
@@ -17,10 +18,11 @@ SceneNodeFactory::SceneNodeFactory(irr::scene::ISceneManager* sceneMgr)
 	setDebugName("SceneNodeFactory");
 #endif
 
-	m_SupportedSceneNodeTypes.push_back(SceneNodeType((irr::scene::ESCENE_NODE_TYPE)ESNT_CYLINDER, "cylinder"));
-	m_SupportedSceneNodeTypes.push_back(SceneNodeType((irr::scene::ESCENE_NODE_TYPE)ESNT_PLANE, "plane"));
-	m_SupportedSceneNodeTypes.push_back(SceneNodeType((irr::scene::ESCENE_NODE_TYPE)ESNT_PLAYERSTART, "playerstart"));
-	m_SupportedSceneNodeTypes.push_back(SceneNodeType((irr::scene::ESCENE_NODE_TYPE)ESNT_PATHNODE, "pathnode"));
+	addSupportedType((irr::scene::ESCENE_NODE_TYPE)ESNT_CYLINDER, "cylinder");
+	addSupportedType((irr::scene::ESCENE_NODE_TYPE)ESNT_PLANE, "plane");
+	addSupportedType((irr::scene::ESCENE_NODE_TYPE)ESNT_PLAYERSTART, "playerstart");
+	addSupportedType((irr::scene::ESCENE_NODE_TYPE)ESNT_PATHNODE, "pathnode");
+	addSupportedType((irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN, "chunkterrain");
 }
 
 SceneNodeFactory::~SceneNodeFactory(void)
@@ -50,6 +52,9 @@ irr::scene::ISceneNode* SceneNodeFactory::addSceneNode(irr::scene::ESCENE_NODE_T
 	case ESNT_PATHNODE:
 		node = new PathSceneNode(parent, m_SceneMgr, -1);
 		break;
+	case ESNT_CHUNKTERRAIN:
+		node = new TerrainSceneNode(parent, m_SceneMgr, -1);
+		break;
 	}
 
 	if (node)
@@ -87,18 +92,37 @@ const irr::c8* SceneNodeFactory::getCreateableSceneNodeTypeName(irr::u32 idx) co
 
 const irr::c8* SceneNodeFactory::getCreateableSceneNodeTypeName(irr::scene::ESCENE_NODE_TYPE type) const
 {
-	for (irr::u32 i = 0; i < m_SupportedSceneNodeTypes.size(); ++i)
-	{
-		if (m_SupportedSceneNodeTypes[i].Type == type)
-			return m_SupportedSceneNodeTypes[i].TypeName.c_str();
-	}
+	const irr::u32* index = m_TypeIndex.find((irr::u32)type);
+	if (index)
+		return m_SupportedSceneNodeTypes[*index].TypeName.c_str();
 
 	return nullptr;
 }
 
+void SceneNodeFactory::addSupportedType(irr::scene::ESCENE_NODE_TYPE type, const irr::c8* name)
+{
+	m_TypeIndex.insert((irr::u32)type, m_SupportedSceneNodeTypes.size());
+
+	// two names sharing a hash keep the first in the index, the other is
+	// found by the search in getTypeFromName
+	irr::u32 hash = TypeRegistry<irr::u32>::hashName(name);
+	if (!m_NameIndex.find(hash))
+		m_NameIndex.insert(hash, m_SupportedSceneNodeTypes.size());
+	m_SupportedSceneNodeTypes.push_back(SceneNodeType(type, name));
+}
+
 irr::scene::ESCENE_NODE_TYPE SceneNodeFactory::getTypeFromName(const irr::c8* name) const
 {
-	for (irr::u32 i = 0; i < m_SupportedSceneNodeTypes.size(); ++i)
+	// the hash only narrows it down, the name still has to match
+	const irr::u32* index = m_NameIndex.find(TypeRegistry<irr::u32>::hashName(name));
+	if (!index)
+		return irr::scene::ESNT_UNKNOWN;
+
+	if (m_SupportedSceneNodeTypes[*index].TypeName == name)
+		return m_SupportedSceneNodeTypes[*index].Type;
+
+	// a collision, so compare the names of the types registered after it
+	for (irr::u32 i = *index + 1; i < m_SupportedSceneNodeTypes.size(); ++i)
 	{
 		if (m_SupportedSceneNodeTypes[i].TypeName == name)
 			return m_SupportedSceneNodeTypes[i].Type;
@@ -7,12 +7,14 @@
 #pragma once
 
 #include "irrlicht.h"
+#include "TypeRegistry.hpp"
 
 // creates the following scene node types
 // - CylinderSceneNode
 // - PlaneSceneNode
 // - PlayerStartNode
 // - PathSceneNode
+// - TerrainSceneNode
 
 class SceneNodeFactory : public irr::scene::ISceneNodeFactory
 {
@@ -31,6 +33,10 @@ private:
 
 	irr::core::array<SceneNodeType> m_SupportedSceneNodeTypes;
 
+	// indices into m_SupportedSceneNodeTypes
+	TypeRegistry<irr::u32> m_TypeIndex; // by type
+	TypeRegistry<irr::u32> m_NameIndex; // by name hash
+
 public:
 	SceneNodeFactory(irr::scene::ISceneManager* sceneMgr);
 	~SceneNodeFactory(void);
@@ -43,5 +49,6 @@ public:
 	const irr::c8* getCreateableSceneNodeTypeName(irr::scene::ESCENE_NODE_TYPE type) const;
 
 private:
+	void addSupportedType(irr::scene::ESCENE_NODE_TYPE type, const irr::c8* name);
 	irr::scene::ESCENE_NODE_TYPE getTypeFromName(const irr::c8* name) const;
 };
@@ -0,0 +1,1025 @@
+/*
+* ManifoldEngine
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#include "TerrainSceneNode.hpp"
+#include "DebugDrawSceneNode.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+static const irr::u32 HEIGHTS_MAGIC = 0x3146484d; // 'MHF1'
+
+//! Threads kept for the life of the program, so a sculpt stroke doesn't start
+//! and join a thread per core on every tick of the brush
+class ParallelWorkers
+{
+private:
+	std::vector<std::thread> m_Threads;
+	std::atomic<bool> m_Busy; // one parallelFor at a time
+	std::mutex m_Mutex;
+	std::condition_variable m_Start;
+	std::condition_variable m_Done;
+
+	const std::function<void(irr::u32)>* m_Job;
+	irr::u32 m_Count;
+	std::atomic<irr::u32> m_Next;
+	irr::u32 m_Generation;
+	irr::u32 m_Running;
+	bool m_Shutdown;
+
+public:
+	ParallelWorkers(void)
+		: m_Busy(false), m_Job(nullptr), m_Count(0), m_Next(0), m_Generation(0), m_Running(0), m_Shutdown(false)
+	{
+		// the calling thread is the last worker
+		irr::u32 cores = std::max(1u, std::thread::hardware_concurrency());
+		for (irr::u32 i = 1; i < cores; ++i)
+			m_Threads.push_back(std::thread(&ParallelWorkers::run, this));
+	}
+
+	~ParallelWorkers(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Shutdown = true;
+		}
+		m_Start.notify_all();
+
+		for (size_t i = 0; i < m_Threads.size(); ++i)
+			m_Threads[i].join();
+	}
+
+	void execute(irr::u32 count, const std::function<void(irr::u32)>& job)
+	{
+		// a call from inside a job, or from a second thread while the
+		// workers are taken, runs where it is
+		if (count < 2 || m_Threads.empty() || m_Busy.exchange(true))
+		{
+			for (irr::u32 i = 0; i < count; ++i)
+				job(i);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Job = &job;
+			m_Count = count;
+			m_Next = 0;
+			m_Running = (irr::u32)m_Threads.size();
+			++m_Generation;
+		}
+		m_Start.notify_all();
+
+		take(job, count);
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Done.wait(lock, [this] { return m_Running == 0; });
+		m_Job = nullptr;
+		m_Busy = false;
+	}
+
+private:
+	//! each thread takes the next index as it finishes one, so uneven jobs
+	//! still spread evenly
+	void take(const std::function<void(irr::u32)>& job, irr::u32 count)
+	{
+		for (irr::u32 i = m_Next++; i < count; i = m_Next++)
+			job(i);
+	}
+
+	void run(void)
+	{
+		irr::u32 generation = 0;
+		for (;;)
+		{
+			const std::function<void(irr::u32)>* job;
+			irr::u32 count;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Start.wait(lock, [&] { return m_Shutdown || m_Generation != generation; });
+				if (m_Shutdown)
+					return;
+
+				generation = m_Generation;
+				job = m_Job;
+				count = m_Count;
+			}
+
+			take(*job, count);
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (--m_Running == 0)
+					m_Done.notify_one();
+			}
+		}
+	}
+};
+
+//! Runs job(0) .. job(count - 1) across the cores
+static void parallelFor(irr::u32 count, const std::function<void(irr::u32)>& job)
+{
+	static ParallelWorkers workers;
+	workers.execute(count, job);
+}
+
+//! The vertices a level of detail keeps along one side of a chunk; the last
+//! is always kept so neighbouring chunks meet
+static void axisSamples(irr::u32 from, irr::u32 to, irr::u32 step, std::vector<irr::u32>& samples)
+{
+	samples.clear();
+	for (irr::u32 i = from; i < to; i += step)
+		samples.push_back(i);
+	samples.push_back(to);
+}
+
+//! Answers queries from the heightfield, so even the largest terrain needs no
+//! copy of its triangles
+class TerrainTriangleSelector : public irr::scene::ITriangleSelector
+{
+private:
+	// the collision manager sizes its buffer by the count, so keep that sane
+	enum { MAX_TRIANGLES = 1 << 18 };
+
+	TerrainSceneNode* m_Node; // not grabbed, the node holds the selector
+
+public:
+	TerrainTriangleSelector(TerrainSceneNode* node)
+		: m_Node(node)
+	{
+#ifdef _DEBUG
+		setDebugName("TerrainTriangleSelector");
+#endif
+	}
+
+	irr::s32 getTriangleCount() const
+	{
+		irr::u32 count = 2 * (m_Node->getWidth() - 1) * (m_Node->getDepth() - 1);
+		return (irr::s32)irr::core::min_(count, (irr::u32)MAX_TRIANGLES);
+	}
+
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::matrix4* transform = 0) const
+	{
+		irr::core::matrix4 mat(getMatrix(transform));
+
+		outTriangleCount = 0;
+		for (irr::u32 z = 0; z + 1 < m_Node->getDepth(); ++z)
+		{
+			for (irr::u32 x = 0; x + 1 < m_Node->getWidth(); ++x)
+			{
+				if (!addCell(x, z, mat, triangles, arraySize, outTriangleCount))
+					return;
+			}
+		}
+	}
+
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::aabbox3d<irr::f32>& box,
+		const irr::core::matrix4* transform = 0) const
+	{
+		irr::core::matrix4 mat(getMatrix(transform));
+
+		irr::core::matrix4 inverse;
+		m_Node->getAbsoluteTransformation().getInverse(inverse);
+		irr::core::aabbox3df local(box);
+		inverse.transformBoxEx(local);
+
+		outTriangleCount = 0;
+
+		irr::f32 cell = m_Node->getCellSize();
+		irr::s32 x0 = irr::core::max_(0, (irr::s32)floorf(local.MinEdge.X / cell));
+		irr::s32 z0 = irr::core::max_(0, (irr::s32)floorf(local.MinEdge.Z / cell));
+		irr::s32 x1 = irr::core::min_((irr::s32)m_Node->getWidth() - 2, (irr::s32)floorf(local.MaxEdge.X / cell));
+		irr::s32 z1 = irr::core::min_((irr::s32)m_Node->getDepth() - 2, (irr::s32)floorf(local.MaxEdge.Z / cell));
+
+		for (irr::s32 z = z0; z <= z1; ++z)
+		{
+			for (irr::s32 x = x0; x <= x1; ++x)
+			{
+				if (!addCell(x, z, mat, triangles, arraySize, outTriangleCount))
+					return;
+			}
+		}
+	}
+
+	void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+		irr::s32& outTriangleCount, const irr::core::line3d<irr::f32>& line,
+		const irr::core::matrix4* transform = 0) const
+	{
+		irr::core::matrix4 mat(getMatrix(transform));
+
+		irr::core::matrix4 inverse;
+		m_Node->getAbsoluteTransformation().getInverse(inverse);
+		irr::core::vector3df start(line.start), end(line.end);
+		inverse.transformVect(start);
+		inverse.transformVect(end);
+
+		outTriangleCount = 0;
+
+		// walk the cells under the line in cell units, nearest first
+		irr::f32 cell = m_Node->getCellSize();
+		irr::f32 sx = start.X / cell, sz = start.Z / cell;
+		irr::f32 dx = end.X / cell - sx, dz = end.Z / cell - sz;
+
+		// clip to the heightfield
+		irr::f32 t0 = 0, t1 = 1;
+		const irr::f32 p[4] = { -dx, dx, -dz, dz };
+		const irr::f32 q[4] = { sx, m_Node->getWidth() - 1 - sx, sz, m_Node->getDepth() - 1 - sz };
+		for (int i = 0; i < 4; ++i)
+		{
+			if (irr::core::iszero(p[i]))
+			{
+				if (q[i] < 0)
+					return;
+				continue;
+			}
+
+			irr::f32 t = q[i] / p[i];
+			if (p[i] < 0)
+				t0 = irr::core::max_(t0, t);
+			else
+				t1 = irr::core::min_(t1, t);
+		}
+
+		if (t0 > t1)
+			return;
+
+		irr::s32 maxX = (irr::s32)m_Node->getWidth() - 2;
+		irr::s32 maxZ = (irr::s32)m_Node->getDepth() - 2;
+		irr::f32 px = sx + dx * t0, pz = sz + dz * t0;
+		irr::s32 x = irr::core::clamp((irr::s32)floorf(px), 0, maxX);
+		irr::s32 z = irr::core::clamp((irr::s32)floorf(pz), 0, maxZ);
+		irr::s32 endX = irr::core::clamp((irr::s32)floorf(sx + dx * t1), 0, maxX);
+		irr::s32 endZ = irr::core::clamp((irr::s32)floorf(sz + dz * t1), 0, maxZ);
+
+		irr::s32 stepX = dx > 0 ? 1 : -1;
+		irr::s32 stepZ = dz > 0 ? 1 : -1;
+		irr::f32 ex = dx * (t1 - t0), ez = dz * (t1 - t0);
+		irr::f32 tMaxX = irr::core::iszero(ex) ? FLT_MAX : ((x + (stepX > 0 ? 1 : 0)) - px) / ex;
+		irr::f32 tMaxZ = irr::core::iszero(ez) ? FLT_MAX : ((z + (stepZ > 0 ? 1 : 0)) - pz) / ez;
+		irr::f32 tDeltaX = irr::core::iszero(ex) ? FLT_MAX : fabsf(1.0f / ex);
+		irr::f32 tDeltaZ = irr::core::iszero(ez) ? FLT_MAX : fabsf(1.0f / ez);
+
+		for (irr::s32 steps = maxX + maxZ + 4; steps > 0; --steps)
+		{
+			if (!addCell(x, z, mat, triangles, arraySize, outTriangleCount))
+				return;
+
+			if (x == endX && z == endZ)
+				return;
+
+			if (tMaxX < tMaxZ)
+			{
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else
+			{
+				z += stepZ;
+				tMaxZ += tDeltaZ;
+			}
+
+			if (x < 0 || x > maxX || z < 0 || z > maxZ)
+				return;
+		}
+	}
+
+	irr::scene::ISceneNode* getSceneNodeForTriangle(irr::u32) const
+	{
+		return m_Node;
+	}
+
+	irr::u32 getSelectorCount() const
+	{
+		return 1;
+	}
+
+	irr::scene::ITriangleSelector* getSelector(irr::u32 index)
+	{
+		return index == 0 ? this : 0;
+	}
+
+	const irr::scene::ITriangleSelector* getSelector(irr::u32 index) const
+	{
+		return index == 0 ? this : 0;
+	}
+
+private:
+	irr::core::matrix4 getMatrix(const irr::core::matrix4* transform) const
+	{
+		if (transform)
+			return *transform * m_Node->getAbsoluteTransformation();
+
+		return m_Node->getAbsoluteTransformation();
+	}
+
+	//! Both triangles of a cell, wound as the chunks draw them
+	bool addCell(irr::u32 x, irr::u32 z, const irr::core::matrix4& mat,
+		irr::core::triangle3df* triangles, irr::s32 arraySize, irr::s32& count) const
+	{
+		if (count + 2 > arraySize)
+			return false;
+
+		irr::f32 cell = m_Node->getCellSize();
+		irr::core::vector3df p00(x * cell, m_Node->getHeight(x, z), z * cell);
+		irr::core::vector3df p10((x + 1) * cell, m_Node->getHeight(x + 1, z), z * cell);
+		irr::core::vector3df p01(x * cell, m_Node->getHeight(x, z + 1), (z + 1) * cell);
+		irr::core::vector3df p11((x + 1) * cell, m_Node->getHeight(x + 1, z + 1), (z + 1) * cell);
+
+		mat.transformVect(p00);
+		mat.transformVect(p10);
+		mat.transformVect(p01);
+		mat.transformVect(p11);
+
+		triangles[count++].set(p00, p01, p11);
+		triangles[count++].set(p00, p11, p10);
+		return true;
+	}
+};
+
+TerrainSceneNode::TerrainSceneNode(irr::scene::ISceneNode* parent,
+	irr::scene::ISceneManager* mgr, irr::s32 id,
+	const irr::core::vector3df& position,
+	const irr::core::vector3df& rotation,
+	const irr::core::vector3df& scale)
+	: irr::scene::ISceneNode(parent, mgr, id, position, rotation, scale),
+	m_Size(129, 129), m_CellSize(10.0f), m_HeightScale(100.0f), m_ChunkSize(32),
+	m_LodDistance(500.0f), m_Width(0), m_Depth(0), m_ChunksX(0), m_ChunksZ(0),
+	m_Modified(false)
+{
+#ifdef _DEBUG
+	setDebugName("TerrainSceneNode");
+#endif
+
+	load();
+}
+
+TerrainSceneNode::~TerrainSceneNode(void)
+{
+	dropChunks();
+}
+
+void TerrainSceneNode::OnRegisterSceneNode(void)
+{
+	if (IsVisible)
+		SceneManager->registerNodeForRendering(this);
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+void TerrainSceneNode::render(void)
+{
+	irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	irr::scene::ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!driver || !camera || m_Chunks.empty())
+		return;
+
+	driver->setTransform(irr::video::ETS_WORLD, AbsoluteTransformation);
+	driver->setMaterial(m_Material);
+
+	// cull in the node's space
+	irr::core::matrix4 inverse;
+	AbsoluteTransformation.getInverse(inverse);
+	irr::scene::SViewFrustum frustum(*camera->getViewFrustum());
+	frustum.transform(inverse);
+
+	irr::core::vector3df eye = camera->getAbsolutePosition();
+	irr::core::vector3df localEye(eye);
+	inverse.transformVect(localEye);
+
+	for (size_t c = 0; c < m_Chunks.size(); ++c)
+	{
+		const Chunk& chunk = m_Chunks[c];
+
+		bool culled = false;
+		for (irr::u32 i = 0; i < irr::scene::SViewFrustum::VF_PLANE_COUNT && !culled; ++i)
+			culled = chunk.Box.classifyPlaneRelation(frustum.planes[i]) == irr::core::ISREL3D_FRONT;
+		if (culled)
+			continue;
+
+		// the detail drops a level with every LodDistance from the nearest point
+		irr::u32 lod = 0;
+		if (m_LodDistance > 0)
+		{
+			irr::core::vector3df nearest(
+				irr::core::clamp(localEye.X, chunk.Box.MinEdge.X, chunk.Box.MaxEdge.X),
+				irr::core::clamp(localEye.Y, chunk.Box.MinEdge.Y, chunk.Box.MaxEdge.Y),
+				irr::core::clamp(localEye.Z, chunk.Box.MinEdge.Z, chunk.Box.MaxEdge.Z));
+			AbsoluteTransformation.transformVect(nearest);
+
+			lod = irr::core::min_((irr::u32)(nearest.getDistanceFrom(eye) / m_LodDistance),
+				chunk.LodCount - 1);
+		}
+
+		driver->drawMeshBuffer(chunk.Lod[lod]);
+	}
+
+	if (DebugDataVisible & irr::scene::EDS_BBOX)
+	{
+		DebugDrawSceneNode* debugDraw = DebugDrawSceneNode::get(SceneManager);
+		if (debugDraw)
+		{
+			debugDraw->addBox(m_Box, AbsoluteTransformation);
+			return;
+		}
+
+		irr::video::SMaterial m;
+		m.Lighting = false;
+		driver->setMaterial(m);
+		driver->draw3DBox(m_Box, irr::video::SColor(255, 255, 255, 255));
+	}
+}
+
+const irr::core::aabbox3d<irr::f32>& TerrainSceneNode::getBoundingBox(void) const
+{
+	return m_Box;
+}
+
+irr::video::SMaterial& TerrainSceneNode::getMaterial(irr::u32)
+{
+	return m_Material;
+}
+
+irr::u32 TerrainSceneNode::getMaterialCount(void) const
+{
+	return 1;
+}
+
+void TerrainSceneNode::serializeAttributes(irr::io::IAttributes* out, irr::io::SAttributeReadWriteOptions* options) const
+{
+	ISceneNode::serializeAttributes(out, options);
+
+	out->addString("Heightmap", m_Heightmap.c_str());
+	out->addDimension2d("Size", irr::core::dimension2du(m_Width, m_Depth));
+	out->addFloat("CellSize", m_CellSize);
+	out->addFloat("HeightScale", m_HeightScale);
+	out->addInt("ChunkSize", m_ChunkSize);
+	out->addFloat("LodDistance", m_LodDistance);
+}
+
+void TerrainSceneNode::deserializeAttributes(irr::io::IAttributes* in, irr::io::SAttributeReadWriteOptions* options)
+{
+	bool reload = false;
+	bool rebuild = false;
+
+	if (in->existsAttribute("Heightmap"))
+	{
+		irr::core::stringc heightmap = in->getAttributeAsString("Heightmap");
+		reload |= heightmap != m_Heightmap;
+		m_Heightmap = heightmap;
+	}
+
+	if (in->existsAttribute("Size"))
+	{
+		m_Size = in->getAttributeAsDimension2d("Size");
+		reload |= m_Heightmap.empty() && m_Size != irr::core::dimension2du(m_Width, m_Depth);
+	}
+
+	if (in->existsAttribute("CellSize"))
+	{
+		irr::f32 cellSize = irr::core::max_(in->getAttributeAsFloat("CellSize"), 0.0001f);
+		rebuild |= !irr::core::equals(cellSize, m_CellSize);
+		m_CellSize = cellSize;
+	}
+
+	if (in->existsAttribute("HeightScale"))
+	{
+		irr::f32 heightScale = in->getAttributeAsFloat("HeightScale");
+		if (!irr::core::equals(heightScale, m_HeightScale))
+		{
+			// heights already loaded keep their shape
+			if (!irr::core::iszero(m_HeightScale))
+			{
+				irr::f32 ratio = heightScale / m_HeightScale;
+				for (size_t i = 0; i < m_Heights.size(); ++i)
+					m_Heights[i] *= ratio;
+			}
+
+			m_HeightScale = heightScale;
+			rebuild = true;
+		}
+	}
+
+	if (in->existsAttribute("ChunkSize"))
+	{
+		// a power of two, small enough for 16 bit indices
+		irr::u32 chunkSize = 8;
+		while (chunkSize < 128 && chunkSize < (irr::u32)in->getAttributeAsInt("ChunkSize"))
+			chunkSize <<= 1;
+
+		rebuild |= chunkSize != m_ChunkSize;
+		m_ChunkSize = chunkSize;
+	}
+
+	if (in->existsAttribute("LodDistance"))
+		m_LodDistance = in->getAttributeAsFloat("LodDistance");
+
+	if (reload)
+	{
+		load();
+		m_Modified = false;
+	}
+	else if (rebuild)
+	{
+		updateNormals(irr::core::recti(0, 0, m_Width - 1, m_Depth - 1));
+		build();
+	}
+
+	ISceneNode::deserializeAttributes(in, options);
+}
+
+irr::scene::ISceneNode* TerrainSceneNode::clone(ISceneNode* newParent, irr::scene::ISceneManager* newManager)
+{
+	if (!newParent)
+		newParent = Parent;
+	if (!newManager)
+		newManager = SceneManager;
+
+	TerrainSceneNode* nb = new TerrainSceneNode(newParent, newManager, ID,
+		RelativeTranslation, RelativeRotation, RelativeScale);
+
+	nb->m_Heightmap = m_Heightmap;
+	nb->m_Size = m_Size;
+	nb->m_CellSize = m_CellSize;
+	nb->m_HeightScale = m_HeightScale;
+	nb->m_ChunkSize = m_ChunkSize;
+	nb->m_LodDistance = m_LodDistance;
+	nb->m_Width = m_Width;
+	nb->m_Depth = m_Depth;
+	nb->m_Heights = m_Heights;
+	nb->m_Normals = m_Normals;
+	nb->m_Modified = m_Modified;
+	nb->build();
+
+	nb->cloneMembers(this, newManager);
+	nb->m_Material = m_Material;
+
+	if (newParent)
+		nb->drop();
+
+	return nb;
+}
+
+irr::scene::ITriangleSelector* TerrainSceneNode::createTriangleSelector(void)
+{
+	return new TerrainTriangleSelector(this);
+}
+
+void TerrainSceneNode::getBrush(const irr::core::vector3df& point, irr::f32 radius,
+	irr::f32& cx, irr::f32& cz, irr::f32& r) const
+{
+	irr::core::matrix4 inverse;
+	AbsoluteTransformation.getInverse(inverse);
+	irr::core::vector3df local(point);
+	inverse.transformVect(local);
+
+	// in cells
+	cx = local.X / m_CellSize;
+	cz = local.Z / m_CellSize;
+	r = radius / (m_CellSize * irr::core::max_(getAbsoluteTransformation().getScale().X, 0.0001f));
+}
+
+irr::core::recti TerrainSceneNode::getBrushRect(const irr::core::vector3df& point, irr::f32 radius) const
+{
+	irr::f32 cx, cz, r;
+	getBrush(point, radius, cx, cz, r);
+	if (r <= 0)
+		return irr::core::recti(0, 0, -1, -1);
+
+	return irr::core::recti(irr::core::max_(0, (irr::s32)floorf(cx - r)),
+		irr::core::max_(0, (irr::s32)floorf(cz - r)),
+		irr::core::min_((irr::s32)m_Width - 1, (irr::s32)ceilf(cx + r)),
+		irr::core::min_((irr::s32)m_Depth - 1, (irr::s32)ceilf(cz + r)));
+}
+
+irr::core::recti TerrainSceneNode::sculpt(const irr::core::vector3df& point, irr::f32 radius, irr::f32 strength)
+{
+	irr::f32 cx, cz, r;
+	getBrush(point, radius, cx, cz, r);
+
+	irr::core::recti rect = getBrushRect(point, radius);
+	irr::s32 x0 = rect.UpperLeftCorner.X, z0 = rect.UpperLeftCorner.Y;
+	irr::s32 x1 = rect.LowerRightCorner.X, z1 = rect.LowerRightCorner.Y;
+	if (x0 > x1 || z0 > z1)
+		return rect;
+
+	for (irr::s32 z = z0; z <= z1; ++z)
+	{
+		for (irr::s32 x = x0; x <= x1; ++x)
+		{
+			irr::f32 d = sqrtf((x - cx) * (x - cx) + (z - cz) * (z - cz)) / r;
+			if (d < 1.0f)
+				m_Heights[z * m_Width + x] += strength * 0.5f * (1.0f + cosf(irr::core::PI * d));
+		}
+	}
+
+	m_Modified = true;
+	updateRegion(rect);
+	return rect;
+}
+
+void TerrainSceneNode::getHeights(const irr::core::recti& rect, std::vector<irr::f32>& heights) const
+{
+	heights.clear();
+	for (irr::s32 z = rect.UpperLeftCorner.Y; z <= rect.LowerRightCorner.Y; ++z)
+	{
+		const irr::f32* row = &m_Heights[z * m_Width];
+		heights.insert(heights.end(), row + rect.UpperLeftCorner.X, row + rect.LowerRightCorner.X + 1);
+	}
+}
+
+void TerrainSceneNode::setHeights(const irr::core::recti& rect, const std::vector<irr::f32>& heights)
+{
+	irr::u32 width = rect.LowerRightCorner.X - rect.UpperLeftCorner.X + 1;
+	for (irr::s32 z = rect.UpperLeftCorner.Y, i = 0; z <= rect.LowerRightCorner.Y; ++z, ++i)
+	{
+		std::copy(heights.begin() + i * width, heights.begin() + (i + 1) * width,
+			m_Heights.begin() + z * m_Width + rect.UpperLeftCorner.X);
+	}
+
+	m_Modified = true;
+	updateRegion(rect);
+}
+
+void TerrainSceneNode::getTriangles(std::vector<irr::core::triangle3df>& triangles) const
+{
+	if (m_Width < 2 || m_Depth < 2)
+		return;
+
+	size_t first = triangles.size();
+	triangles.resize(first + 2 * (m_Width - 1) * (m_Depth - 1));
+
+	const irr::core::matrix4& mat = AbsoluteTransformation;
+	parallelFor(m_Depth - 1, [&](irr::u32 z)
+	{
+		irr::core::triangle3df* row = &triangles[first + 2 * z * (m_Width - 1)];
+		for (irr::u32 x = 0; x + 1 < m_Width; ++x)
+		{
+			irr::core::vector3df p00(getPosition(x, z)), p10(getPosition(x + 1, z));
+			irr::core::vector3df p01(getPosition(x, z + 1)), p11(getPosition(x + 1, z + 1));
+			mat.transformVect(p00);
+			mat.transformVect(p10);
+			mat.transformVect(p01);
+			mat.transformVect(p11);
+
+			// wound as the chunks draw them
+			row[2 * x].set(p00, p01, p11);
+			row[2 * x + 1].set(p00, p11, p10);
+		}
+	});
+}
+
+void TerrainSceneNode::getHeightfield(irr::u32& width, irr::u32& depth,
+	std::vector<irr::f32>& heights, bool& modified) const
+{
+	width = m_Width;
+	depth = m_Depth;
+	heights = m_Heights;
+	modified = m_Modified;
+}
+
+void TerrainSceneNode::setHeightfield(irr::u32 width, irr::u32 depth,
+	const std::vector<irr::f32>& heights, bool modified)
+{
+	if (width < 2 || depth < 2 || heights.size() != width * depth)
+		return;
+
+	m_Width = width;
+	m_Depth = depth;
+	m_Heights = heights;
+	m_Modified = modified;
+
+	m_Normals.resize(m_Heights.size());
+	updateNormals(irr::core::recti(0, 0, m_Width - 1, m_Depth - 1));
+	build();
+}
+
+irr::core::recti TerrainSceneNode::getChunkRect(irr::u32 chunk) const
+{
+	const Chunk& c = m_Chunks[chunk];
+	return irr::core::recti(c.X0, c.Z0, c.X1, c.Z1);
+}
+
+void TerrainSceneNode::getChunksInRect(const irr::core::recti& rect, std::vector<irr::u32>& chunks) const
+{
+	chunks.clear();
+	if (rect.UpperLeftCorner.X > rect.LowerRightCorner.X ||
+		rect.UpperLeftCorner.Y > rect.LowerRightCorner.Y || rect.LowerRightCorner.X < 0 ||
+		rect.LowerRightCorner.Y < 0)
+		return;
+
+	// a vertex on a chunk's edge is shared with its neighbour
+	irr::s32 x0 = rect.UpperLeftCorner.X > 0 ? (rect.UpperLeftCorner.X - 1) / m_ChunkSize : 0;
+	irr::s32 z0 = rect.UpperLeftCorner.Y > 0 ? (rect.UpperLeftCorner.Y - 1) / m_ChunkSize : 0;
+	irr::s32 x1 = irr::core::min_((irr::s32)m_ChunksX - 1, rect.LowerRightCorner.X / (irr::s32)m_ChunkSize);
+	irr::s32 z1 = irr::core::min_((irr::s32)m_ChunksZ - 1, rect.LowerRightCorner.Y / (irr::s32)m_ChunkSize);
+
+	for (irr::s32 z = z0; z <= z1; ++z)
+	{
+		for (irr::s32 x = x0; x <= x1; ++x)
+			chunks.push_back(z * m_ChunksX + x);
+	}
+}
+
+bool TerrainSceneNode::writeHeights(irr::io::IWriteFile* file)
+{
+	irr::u32 header[3] = { HEIGHTS_MAGIC, m_Width, m_Depth };
+	irr::s32 size = (irr::s32)(m_Heights.size() * sizeof(irr::f32));
+	return file->write(header, sizeof(header)) == sizeof(header) &&
+		file->write(&m_Heights[0], size) == size;
+}
+
+void TerrainSceneNode::load(void)
+{
+	bool loaded = false;
+
+	if (!m_Heightmap.empty())
+	{
+		irr::core::stringc extension;
+		irr::core::getFileNameExtension(extension, m_Heightmap);
+		extension.make_lower();
+
+		if (extension == ".mhf")
+		{
+			irr::io::IReadFile* file = SceneManager->getFileSystem()->createAndOpenFile(m_Heightmap);
+			if (file)
+			{
+				loaded = readHeights(file);
+				file->drop();
+			}
+		}
+		else
+		{
+			irr::video::IImage* image = SceneManager->getVideoDriver()->createImageFromFile(m_Heightmap);
+			if (image && image->getDimension().Width > 1 && image->getDimension().Height > 1)
+			{
+				m_Width = image->getDimension().Width;
+				m_Depth = image->getDimension().Height;
+				m_Heights.resize(m_Width * m_Depth);
+
+				parallelFor(m_Depth, [&](irr::u32 z)
+				{
+					for (irr::u32 x = 0; x < m_Width; ++x)
+						m_Heights[z * m_Width + x] = image->getPixel(x, z).getLuminance() / 255.0f * m_HeightScale;
+				});
+
+				loaded = true;
+			}
+
+			if (image)
+				image->drop();
+		}
+	}
+
+	if (!loaded)
+	{
+		// flat, ready to sculpt
+		m_Width = irr::core::max_(m_Size.Width, 2u);
+		m_Depth = irr::core::max_(m_Size.Height, 2u);
+		m_Heights.assign(m_Width * m_Depth, 0.0f);
+	}
+
+	m_Normals.resize(m_Heights.size());
+	updateNormals(irr::core::recti(0, 0, m_Width - 1, m_Depth - 1));
+	build();
+}
+
+bool TerrainSceneNode::readHeights(irr::io::IReadFile* file)
+{
+	irr::u32 header[3];
+	if (file->read(header, sizeof(header)) != sizeof(header) || header[0] != HEIGHTS_MAGIC ||
+		header[1] < 2 || header[2] < 2)
+		return false;
+
+	irr::s32 size = (irr::s32)(header[1] * header[2] * sizeof(irr::f32));
+	if (file->getSize() - file->getPos() < size)
+		return false;
+
+	m_Width = header[1];
+	m_Depth = header[2];
+	m_Heights.resize(m_Width * m_Depth);
+	return file->read(&m_Heights[0], size) == size;
+}
+
+void TerrainSceneNode::build(void)
+{
+	dropChunks();
+
+	m_ChunksX = (m_Width - 2) / m_ChunkSize + 1;
+	m_ChunksZ = (m_Depth - 2) / m_ChunkSize + 1;
+	m_Chunks.resize(m_ChunksX * m_ChunksZ);
+
+	for (irr::u32 z = 0; z < m_ChunksZ; ++z)
+	{
+		for (irr::u32 x = 0; x < m_ChunksX; ++x)
+		{
+			Chunk& chunk = m_Chunks[z * m_ChunksX + x];
+			chunk.X0 = x * m_ChunkSize;
+			chunk.Z0 = z * m_ChunkSize;
+			chunk.X1 = irr::core::min_(chunk.X0 + m_ChunkSize, m_Width - 1);
+			chunk.Z1 = irr::core::min_(chunk.Z0 + m_ChunkSize, m_Depth - 1);
+			chunk.LodCount = 0;
+		}
+	}
+
+	parallelFor((irr::u32)m_Chunks.size(), [this](irr::u32 i) { buildChunk(m_Chunks[i]); });
+
+	m_Box = m_Chunks[0].Box;
+	for (size_t i = 1; i < m_Chunks.size(); ++i)
+		m_Box.addInternalBox(m_Chunks[i].Box);
+}
+
+void TerrainSceneNode::updateNormals(const irr::core::recti& rect)
+{
+	irr::u32 x0 = rect.UpperLeftCorner.X, x1 = rect.LowerRightCorner.X;
+	irr::u32 z0 = rect.UpperLeftCorner.Y, z1 = rect.LowerRightCorner.Y;
+
+	parallelFor(z1 - z0 + 1, [&](irr::u32 row)
+	{
+		irr::u32 z = z0 + row;
+		irr::u32 down = z > 0 ? z - 1 : z;
+		irr::u32 up = z + 1 < m_Depth ? z + 1 : z;
+
+		for (irr::u32 x = x0; x <= x1; ++x)
+		{
+			irr::u32 left = x > 0 ? x - 1 : x;
+			irr::u32 right = x + 1 < m_Width ? x + 1 : x;
+
+			irr::core::vector3df normal(
+				getHeight(left, z) - getHeight(right, z),
+				m_CellSize * 2.0f,
+				getHeight(x, down) - getHeight(x, up));
+			m_Normals[z * m_Width + x] = normal.normalize();
+		}
+	});
+}
+
+void TerrainSceneNode::updateRegion(const irr::core::recti& rect)
+{
+	// the normals reach one vertex past the edit
+	irr::core::recti grown(
+		irr::core::max_(rect.UpperLeftCorner.X - 1, 0),
+		irr::core::max_(rect.UpperLeftCorner.Y - 1, 0),
+		irr::core::min_(rect.LowerRightCorner.X + 1, (irr::s32)m_Width - 1),
+		irr::core::min_(rect.LowerRightCorner.Y + 1, (irr::s32)m_Depth - 1));
+	updateNormals(grown);
+
+	std::vector<irr::u32> chunks;
+	getChunksInRect(grown, chunks);
+	parallelFor((irr::u32)chunks.size(), [&](irr::u32 i) { fillChunk(m_Chunks[chunks[i]]); });
+
+	m_Box = m_Chunks[0].Box;
+	for (size_t i = 1; i < m_Chunks.size(); ++i)
+		m_Box.addInternalBox(m_Chunks[i].Box);
+}
+
+void TerrainSceneNode::buildChunk(Chunk& chunk)
+{
+	std::vector<irr::u32> xs, zs;
+
+	chunk.LodCount = 0;
+	for (irr::u32 step = 1; step <= m_ChunkSize && chunk.LodCount < MAX_LOD; step <<= 1)
+	{
+		axisSamples(chunk.X0, chunk.X1, step, xs);
+		axisSamples(chunk.Z0, chunk.Z1, step, zs);
+		irr::u16 nx = (irr::u16)xs.size();
+		irr::u16 nz = (irr::u16)zs.size();
+
+		irr::scene::SMeshBuffer* buffer = new irr::scene::SMeshBuffer();
+		buffer->setHardwareMappingHint(irr::scene::EHM_STATIC);
+		buffer->Vertices.set_used(nx * nz + 2 * nx + 2 * nz);
+		buffer->Indices.reallocate((nx - 1) * (nz - 1) * 6 + 2 * ((nx - 1) + (nz - 1)) * 12);
+
+		for (irr::u16 j = 0; j + 1 < nz; ++j)
+		{
+			for (irr::u16 i = 0; i + 1 < nx; ++i)
+			{
+				irr::u16 a = j * nx + i;
+				irr::u16 b = a + 1;
+				irr::u16 c = a + nx;
+				irr::u16 d = c + 1;
+
+				buffer->Indices.push_back(a);
+				buffer->Indices.push_back(c);
+				buffer->Indices.push_back(d);
+				buffer->Indices.push_back(a);
+				buffer->Indices.push_back(d);
+				buffer->Indices.push_back(b);
+			}
+		}
+
+		// a skirt hangs from each edge to hide the gap to a coarser neighbour,
+		// wound both ways so it shows from either side
+		irr::u16 skirt = nx * nz;
+		auto hang = [&](irr::u16 p, irr::u16 q, irr::u16 ps, irr::u16 qs)
+		{
+			const irr::u16 quad[12] = { p, q, qs, p, qs, ps, p, qs, q, p, ps, qs };
+			for (int k = 0; k < 12; ++k)
+				buffer->Indices.push_back(quad[k]);
+		};
+
+		for (irr::u16 i = 0; i + 1 < nx; ++i)
+		{
+			hang(i, i + 1, skirt + i, skirt + i + 1);
+			hang((nz - 1) * nx + i, (nz - 1) * nx + i + 1, skirt + nx + i, skirt + nx + i + 1);
+		}
+
+		for (irr::u16 j = 0; j + 1 < nz; ++j)
+		{
+			hang(j * nx, (j + 1) * nx, skirt + 2 * nx + j, skirt + 2 * nx + j + 1);
+			hang(j * nx + nx - 1, (j + 1) * nx + nx - 1,
+				skirt + 2 * nx + nz + j, skirt + 2 * nx + nz + j + 1);
+		}
+
+		chunk.Lod[chunk.LodCount++] = buffer;
+	}
+
+	fillChunk(chunk);
+}
+
+void TerrainSceneNode::fillChunk(Chunk& chunk)
+{
+	std::vector<irr::u32> xs, zs;
+
+	for (irr::u32 lod = 0; lod < chunk.LodCount; ++lod)
+	{
+		irr::u32 step = 1 << lod;
+		axisSamples(chunk.X0, chunk.X1, step, xs);
+		axisSamples(chunk.Z0, chunk.Z1, step, zs);
+		irr::u32 nx = (irr::u32)xs.size();
+		irr::u32 nz = (irr::u32)zs.size();
+
+		irr::scene::SMeshBuffer* buffer = chunk.Lod[lod];
+		irr::video::S3DVertex* vertices = buffer->Vertices.pointer();
+
+		irr::core::aabbox3df box(getPosition(xs[0], zs[0]));
+		for (irr::u32 j = 0; j < nz; ++j)
+		{
+			for (irr::u32 i = 0; i < nx; ++i)
+			{
+				irr::video::S3DVertex& vertex = vertices[j * nx + i];
+				vertex.Pos = getPosition(xs[i], zs[j]);
+				vertex.Normal = m_Normals[zs[j] * m_Width + xs[i]];
+				vertex.Color.set(255, 255, 255, 255);
+				vertex.TCoords.set((irr::f32)xs[i] / (m_Width - 1), (irr::f32)zs[j] / (m_Depth - 1));
+				box.addInternalPoint(vertex.Pos);
+			}
+		}
+
+		// deep enough to cover the largest step between levels
+		irr::f32 depth = box.getExtent().Y + m_CellSize * step;
+		irr::u32 skirt = nx * nz;
+		for (irr::u32 i = 0; i < nx; ++i)
+		{
+			vertices[skirt + i] = vertices[i];
+			vertices[skirt + i].Pos.Y -= depth;
+			vertices[skirt + nx + i] = vertices[(nz - 1) * nx + i];
+			vertices[skirt + nx + i].Pos.Y -= depth;
+		}
+
+		for (irr::u32 j = 0; j < nz; ++j)
+		{
+			vertices[skirt + 2 * nx + j] = vertices[j * nx];
+			vertices[skirt + 2 * nx + j].Pos.Y -= depth;
+			vertices[skirt + 2 * nx + nz + j] = vertices[j * nx + nx - 1];
+			vertices[skirt + 2 * nx + nz + j].Pos.Y -= depth;
+		}
+
+		buffer->BoundingBox = box;
+		buffer->setDirty(irr::scene::EBT_VERTEX);
+
+		if (lod == 0)
+			chunk.Box = box;
+	}
+}
+
+void TerrainSceneNode::dropChunks(void)
+{
+	irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+
+	for (size_t i = 0; i < m_Chunks.size(); ++i)
+	{
+		for (irr::u32 lod = 0; lod < m_Chunks[i].LodCount; ++lod)
+		{
+			if (driver)
+				driver->removeHardwareBuffer(m_Chunks[i].Lod[lod]);
+			m_Chunks[i].Lod[lod]->drop();
+		}
+	}
+
+	m_Chunks.clear();
+}
+
+irr::core::vector3df TerrainSceneNode::getPosition(irr::u32 x, irr::u32 z) const
+{
+	return irr::core::vector3df(x * m_CellSize, getHeight(x, z), z * m_CellSize);
+}
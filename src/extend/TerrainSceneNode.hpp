@@ -0,0 +1,140 @@
+/*
+* ManifoldEngine
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+#include <vector>
+
+#define ESNT_CHUNKTERRAIN MAKE_IRR_ID('t', 'e', 'r', 'n')
+
+//! Heightfield terrain split into square chunks. Each chunk keeps a mesh
+//! buffer per level of detail and picks one for every camera it's drawn by,
+//! so the views of the same map can each use their own detail. The chunks are
+//! built across all cores and an edit only rebuilds the chunks it touches.
+class TerrainSceneNode : public irr::scene::ISceneNode
+{
+public:
+	enum { MAX_LOD = 5 };
+
+private:
+	struct Chunk
+	{
+		irr::u32 X0, Z0, X1, Z1; // vertex range, inclusive
+		irr::core::aabbox3df Box;
+		irr::scene::SMeshBuffer* Lod[MAX_LOD];
+		irr::u32 LodCount;
+	};
+
+	irr::core::stringc m_Heightmap;
+	irr::core::dimension2du m_Size;  // vertices, when there's no heightmap
+	irr::f32 m_CellSize;
+	irr::f32 m_HeightScale;
+	irr::u32 m_ChunkSize;            // cells along a chunk's side
+	irr::f32 m_LodDistance;          // distance covered by each level
+
+	irr::u32 m_Width, m_Depth;       // vertices in the heightfield
+	std::vector<irr::f32> m_Heights;
+	std::vector<irr::core::vector3df> m_Normals;
+
+	irr::u32 m_ChunksX, m_ChunksZ;
+	std::vector<Chunk> m_Chunks;
+
+	irr::video::SMaterial m_Material;
+	irr::core::aabbox3df m_Box;
+	bool m_Modified;
+
+public:
+	TerrainSceneNode(irr::scene::ISceneNode* parent,
+		irr::scene::ISceneManager* mgr, irr::s32 id,
+		const irr::core::vector3df& position = irr::core::vector3df(0, 0, 0),
+		const irr::core::vector3df& rotation = irr::core::vector3df(0, 0, 0),
+		const irr::core::vector3df& scale = irr::core::vector3df(1.0f, 1.0f, 1.0f));
+	virtual ~TerrainSceneNode(void);
+
+	virtual void OnRegisterSceneNode(void);
+
+	//! renders the node, choosing each chunk's detail for the active camera
+	virtual void render(void);
+
+	//! returns the axis aligned bounding box of this node
+	virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox(void) const;
+
+	virtual irr::video::SMaterial& getMaterial(irr::u32 i);
+	virtual irr::u32 getMaterialCount(void) const;
+
+	//! Returns type of the scene node
+	virtual irr::scene::ESCENE_NODE_TYPE getType(void) const { return (irr::scene::ESCENE_NODE_TYPE)ESNT_CHUNKTERRAIN; }
+
+	//! Writes attributes of the scene node.
+	virtual void serializeAttributes(irr::io::IAttributes* out, irr::io::SAttributeReadWriteOptions* options = 0) const;
+
+	//! Reads attributes of the scene node, rebuilding only if the heightfield changed.
+	virtual void deserializeAttributes(irr::io::IAttributes* in, irr::io::SAttributeReadWriteOptions* options = 0);
+
+	//! Creates a clone of this scene node and its children.
+	virtual irr::scene::ISceneNode* clone(ISceneNode* newParent = 0, irr::scene::ISceneManager* newManager = 0);
+
+	//! Creates a selector that answers queries from the heightfield, without a
+	//! copy of its triangles
+	irr::scene::ITriangleSelector* createTriangleSelector(void);
+
+	//! Every triangle of the heightfield in world space. The selector caps its
+	//! count, so this is for whoever needs the whole terrain.
+	void getTriangles(std::vector<irr::core::triangle3df>& triangles) const;
+
+	irr::u32 getWidth(void) const { return m_Width; }
+	irr::u32 getDepth(void) const { return m_Depth; }
+	irr::f32 getCellSize(void) const { return m_CellSize; }
+	irr::f32 getHeight(irr::u32 x, irr::u32 z) const { return m_Heights[z * m_Width + x]; }
+
+	//! Raises (or lowers, with a negative strength) the heightfield around a
+	//! point in world space. Returns the vertices changed.
+	irr::core::recti sculpt(const irr::core::vector3df& point, irr::f32 radius, irr::f32 strength);
+
+	//! The vertices a brush at the point would change
+	irr::core::recti getBrushRect(const irr::core::vector3df& point, irr::f32 radius) const;
+
+	//! Copies heights in and out of a vertex rectangle, inclusive
+	void getHeights(const irr::core::recti& rect, std::vector<irr::f32>& heights) const;
+	void setHeights(const irr::core::recti& rect, const std::vector<irr::f32>& heights);
+
+	//! Copies the whole heightfield in and out, with its size and whether it
+	//! was edited, so it survives a reload
+	void getHeightfield(irr::u32& width, irr::u32& depth, std::vector<irr::f32>& heights, bool& modified) const;
+	void setHeightfield(irr::u32 width, irr::u32 depth, const std::vector<irr::f32>& heights, bool modified);
+
+	//! The chunks are the unit of an edit
+	irr::u32 getChunkCount(void) const { return (irr::u32)m_Chunks.size(); }
+	irr::core::recti getChunkRect(irr::u32 chunk) const;
+	void getChunksInRect(const irr::core::recti& rect, std::vector<irr::u32>& chunks) const;
+
+	//! Edited since it was loaded; the heights are then saved with writeHeights
+	bool isModified(void) const { return m_Modified; }
+
+	//! Writes the heightfield and makes it the node's heightmap
+	bool writeHeights(irr::io::IWriteFile* file);
+
+	//! The node's heightmap becomes the file just written
+	void setHeightmapName(const irr::c8* heightmap) { m_Heightmap = heightmap; m_Modified = false; }
+
+private:
+	void load(void);
+	bool readHeights(irr::io::IReadFile* file);
+	void build(void);
+
+	void updateNormals(const irr::core::recti& rect);
+	void updateRegion(const irr::core::recti& rect);
+
+	void buildChunk(Chunk& chunk);
+	void fillChunk(Chunk& chunk);
+	void dropChunks(void);
+
+	irr::core::vector3df getPosition(irr::u32 x, irr::u32 z) const;
+	void getBrush(const irr::core::vector3df& point, irr::f32 radius,
+		irr::f32& cx, irr::f32& cz, irr::f32& r) const;
+};
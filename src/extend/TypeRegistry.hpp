@@ -0,0 +1,151 @@
+/*
+* ManifoldEngine
+*
+* Copyright (c) 2023 James Kinnaird
+*/
+
+#pragma once
+
+#include "irrlicht.h"
+
+// Open-addressing hash table with linear probing, keyed by a 32-bit type id,
+// name hash or entity handle. Meant for registries that are looked up for
+// every node and animator on load/save, far more often than they change.
+template <typename T>
+class TypeRegistry
+{
+private:
+	struct Slot
+	{
+		irr::u32 Key;
+		T Value;
+		bool Used;
+
+		Slot(void) : Key(0), Value(), Used(false) {}
+	};
+
+	irr::core::array<Slot> m_Slots; // size is always a power of two
+	irr::u32 m_Count;
+
+public:
+	TypeRegistry(void)
+		: m_Count(0)
+	{
+	}
+
+	irr::u32 size(void) const
+	{
+		return m_Count;
+	}
+
+	void clear(void)
+	{
+		m_Slots.clear();
+		m_Count = 0;
+	}
+
+	// Adds or replaces the value stored for the key
+	void insert(irr::u32 key, const T& value)
+	{
+		// keep the load factor at or below a half so probes stay short
+		if ((m_Count + 1) * 2 > m_Slots.size())
+			grow();
+
+		Slot& slot = m_Slots[probe(key)];
+		if (!slot.Used)
+		{
+			slot.Key = key;
+			slot.Used = true;
+			++m_Count;
+		}
+
+		slot.Value = value;
+	}
+
+	// Returns the value stored for the key, or null
+	const T* find(irr::u32 key) const
+	{
+		if (m_Slots.empty())
+			return 0;
+
+		const Slot& slot = m_Slots[probe(key)];
+		return slot.Used ? &slot.Value : 0;
+	}
+
+	// Removes the key, if present
+	void erase(irr::u32 key)
+	{
+		if (m_Slots.empty())
+			return;
+
+		irr::u32 hole = probe(key);
+		if (!m_Slots[hole].Used)
+			return;
+
+		m_Slots[hole] = Slot();
+		--m_Count;
+
+		// pull back later keys in the run that could no longer be reached
+		irr::u32 mask = m_Slots.size() - 1;
+		irr::u32 index = (hole + 1) & mask;
+		while (m_Slots[index].Used)
+		{
+			irr::u32 home = homeSlot(m_Slots[index].Key);
+			bool reachable = hole <= index ?
+				(home > hole && home <= index) :
+				(home > hole || home <= index);
+			if (!reachable)
+			{
+				m_Slots[hole] = m_Slots[index];
+				m_Slots[index] = Slot();
+				hole = index;
+			}
+
+			index = (index + 1) & mask;
+		}
+	}
+
+	// FNV-1a, the same hash ComponentFactory uses to make component type ids
+	static irr::u32 hashName(const irr::c8* name)
+	{
+		irr::u32 hash = 0x811c9dc5;
+		while (*name)
+			hash = ((irr::u8)*name++ ^ hash) * 0x01000193;
+		return hash;
+	}
+
+private:
+	// type ids and handles are often small sequential values, so mix them first
+	irr::u32 homeSlot(irr::u32 key) const
+	{
+		return (key * 0x9E3779B1u) & (m_Slots.size() - 1);
+	}
+
+	// the slot holding the key, or the empty slot where it would go
+	irr::u32 probe(irr::u32 key) const
+	{
+		irr::u32 mask = m_Slots.size() - 1;
+		irr::u32 index = homeSlot(key);
+		while (m_Slots[index].Used && m_Slots[index].Key != key)
+			index = (index + 1) & mask;
+
+		return index;
+	}
+
+	void grow(void)
+	{
+		irr::core::array<Slot> old(m_Slots);
+
+		irr::u32 capacity = old.size() ? old.size() * 2 : 16;
+		m_Slots.clear();
+		m_Slots.reallocate(capacity);
+		for (irr::u32 i = 0; i < capacity; ++i)
+			m_Slots.push_back(Slot());
+
+		for (irr::u32 i = 0; i < old.size(); ++i)
+		{
+			if (old[i].Used)
+				m_Slots[probe(old[i].Key)] = old[i];
+		}
+	}
+};
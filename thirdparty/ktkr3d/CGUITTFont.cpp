@@ -256,7 +256,7 @@ CGUITTFont* CGUITTFont::create(IrrlichtDevice *device, const io::path& filename,
 //! Constructor.
 CGUITTFont::CGUITTFont(IGUIEnvironment *env)
 : use_monochrome(false), use_transparency(true), use_hinting(true), use_auto_hinting(true),
-batch_load_size(1), Device(0), Environment(env), Driver(0), GlobalKerningWidth(0), GlobalKerningHeight(0)
+batch_load_size(1), Device(0), Environment(env), Driver(0), batching(false), GlobalKerningWidth(0), GlobalKerningHeight(0)
 {
 	#ifdef _DEBUG
 	setDebugName("CGUITTFont");
@@ -428,6 +428,10 @@ void CGUITTFont::reset_images()
 		delete Glyph_Pages[i];
 	Glyph_Pages.clear();
 
+	// The runs point at the pages.
+	Glyph_Runs.clear();
+	Text_Batches.clear();
+
 	// Always update the internal FreeType loading flags after resetting.
 	update_load_flags();
 }
@@ -528,36 +532,60 @@ void CGUITTFont::draw(const core::stringw& text, const core::rect<s32>& position
 	if (!Driver)
 		return;
 
-	// Clear the glyph pages of their render information.
-	for (u32 i = 0; i < Glyph_Pages.size(); ++i)
-	{
-		Glyph_Pages[i]->render_positions.clear();
-		Glyph_Pages[i]->render_source_rects.clear();
-	}
+	const SGUITTGlyphRun& run = getGlyphRun(text);
 
-	// Set up some variables.
-	core::dimension2d<s32> textDimension;
+	// Determine offset positions.
 	core::position2d<s32> offset = position.UpperLeftCorner;
+	if (hcenter)
+		offset.X += (position.getWidth() - run.dimension.Width) >> 1;
+	if (vcenter)
+		offset.Y += (position.getHeight() - run.dimension.Height) >> 1;
 
-	// Determine offset positions.
-	if (hcenter || vcenter)
+	if (!use_transparency) color.color |= 0xff000000;
+
+	// Add the glyphs to the quad lists of their pages.
+	for (u32 i = 0; i < run.pages.size(); ++i)
 	{
-		textDimension = getDimension(text.c_str());
+		SGUITTTextBatch& batch = getTextBatch(run.pages[i], color, clip);
+		batch.positions.push_back(run.positions[i] + offset);
+		batch.source_rects.push_back(run.source_rects[i]);
+	}
 
-		if (hcenter)
-			offset.X = ((position.getWidth() - textDimension.Width) >> 1) + offset.X;
+	if (!batching)
+		flushTextBatches();
+}
 
-		if (vcenter)
-			offset.Y = ((position.getHeight() - textDimension.Height) >> 1) + offset.Y;
-	}
+void CGUITTFont::beginBatch()
+{
+	batching = true;
+}
+
+void CGUITTFont::endBatch()
+{
+	batching = false;
+	flushTextBatches();
+}
+
+const SGUITTGlyphRun& CGUITTFont::getGlyphRun(const core::stringw& text)
+{
+	core::map<core::stringw, SGUITTGlyphRun>::Node* node = Glyph_Runs.find(text);
+	if (node)
+		return node->getValue();
+
+	// Labels that change every frame would otherwise grow the cache forever.
+	if (Glyph_Runs.size() >= MAX_GLYPH_RUNS)
+		Glyph_Runs.clear();
+
+	SGUITTGlyphRun run;
+	core::dimension2d<u32> textDimension = getDimension(text.c_str());
+	run.dimension.Width = (s32)textDimension.Width;
+	run.dimension.Height = (s32)textDimension.Height;
 
 	// Convert to a unicode string.
 	core::ustring utext(text);
 
-	// Set up our render map.
-	core::map<u32, CGUITTGlyphPage*> Render_Map;
-
 	// Start parsing characters.
+	core::position2d<s32> offset(0, 0);
 	u32 n;
 	uchar32_t previousChar = 0;
 	core::ustring::const_iterator iter(utext);
@@ -584,10 +612,7 @@ void CGUITTFont::draw(const core::stringw& text, const core::rect<s32>& position
 			{
 				previousChar = 0;
 				offset.Y += font_metrics.ascender / 64;
-				offset.X = position.UpperLeftCorner.X;
-
-				if (hcenter)
-					offset.X += (position.getWidth() - textDimension.Width) >> 1;
+				offset.X = 0;
 				++iter;
 				continue;
 			}
@@ -603,10 +628,9 @@ void CGUITTFont::draw(const core::stringw& text, const core::rect<s32>& position
 
 			// Determine rendering information.
 			SGUITTGlyph& glyph = Glyphs[n-1];
-			CGUITTGlyphPage* const page = Glyph_Pages[glyph.glyph_page];
-			page->render_positions.push_back(core::position2di(offset.X + offx, offset.Y + offy));
-			page->render_source_rects.push_back(glyph.source_rect);
-			Render_Map.set(glyph.glyph_page, page);
+			run.pages.push_back(glyph.glyph_page);
+			run.positions.push_back(core::position2di(offset.X + offx, offset.Y + offy));
+			run.source_rects.push_back(glyph.source_rect);
 		}
 		offset.X += getWidthFromCharacter(currentChar);
 
@@ -614,19 +638,62 @@ void CGUITTFont::draw(const core::stringw& text, const core::rect<s32>& position
 		++iter;
 	}
 
-	// Draw now.
+	Glyph_Runs.insert(text, run);
+	return Glyph_Runs.find(text)->getValue();
+}
+
+SGUITTTextBatch& CGUITTFont::getTextBatch(u32 page, video::SColor color, const core::rect<s32>* clip)
+{
+	// There are only ever a handful, one per page and color in use.
+	for (u32 i = 0; i < Text_Batches.size(); ++i)
+	{
+		SGUITTTextBatch& batch = Text_Batches[i];
+		if (batch.page == page && batch.color == color && batch.clipped == (clip != 0) &&
+			(!clip || batch.clip == *clip))
+			return batch;
+	}
+
+	// Reuse an emptied batch before adding another.
+	for (u32 i = 0; i < Text_Batches.size(); ++i)
+	{
+		SGUITTTextBatch& batch = Text_Batches[i];
+		if (batch.positions.empty())
+		{
+			batch.page = page;
+			batch.color = color;
+			batch.clipped = (clip != 0);
+			batch.clip = clip ? *clip : core::recti();
+			return batch;
+		}
+	}
+
+	SGUITTTextBatch batch;
+	batch.page = page;
+	batch.color = color;
+	batch.clipped = (clip != 0);
+	batch.clip = clip ? *clip : core::recti();
+	Text_Batches.push_back(batch);
+	return Text_Batches.getLast();
+}
+
+void CGUITTFont::flushTextBatches()
+{
+	// New glyphs have to be on the pages first.
 	update_glyph_pages();
-	core::map<u32, CGUITTGlyphPage*>::Iterator j = Render_Map.getIterator();
-	while (!j.atEnd())
+
+	for (u32 i = 0; i < Text_Batches.size(); ++i)
 	{
-		core::map<u32, CGUITTGlyphPage*>::Node* n = j.getNode();
-		j++;
-		if (n == 0) continue;
+		SGUITTTextBatch& batch = Text_Batches[i];
+		if (batch.positions.empty())
+			continue;
 
-		CGUITTGlyphPage* page = n->getValue();
+		if (batch.page < Glyph_Pages.size())
+			Driver->draw2DImageBatch(Glyph_Pages[batch.page]->texture, batch.positions, batch.source_rects,
+				batch.clipped ? &batch.clip : 0, batch.color, true);
 
-		if (!use_transparency) color.color |= 0xff000000;
-		Driver->draw2DImageBatch(page->texture, page->render_positions, page->render_source_rects, clip, color, true);
+		// Keep the memory for the next frame.
+		batch.positions.set_used(0);
+		batch.source_rects.set_used(0);
 	}
 }
 
@@ -829,11 +896,13 @@ s32 CGUITTFont::getCharacterFromPos(const core::ustring& text, s32 pixel_x) cons
 void CGUITTFont::setKerningWidth(s32 kerning)
 {
 	GlobalKerningWidth = kerning;
+	Glyph_Runs.clear();
 }
 
 void CGUITTFont::setKerningHeight(s32 kerning)
 {
 	GlobalKerningHeight = kerning;
+	Glyph_Runs.clear();
 }
 
 s32 CGUITTFont::getKerningWidth(const wchar_t* thisLetter, const wchar_t* previousLetter) const
@@ -902,11 +971,13 @@ void CGUITTFont::setInvisibleCharacters(const wchar_t *s)
 {
 	core::ustring us(s);
 	Invisible = us;
+	Glyph_Runs.clear();
 }
 
 void CGUITTFont::setInvisibleCharacters(const core::ustring& s)
 {
 	Invisible = s;
+	Glyph_Runs.clear();
 }
 
 video::IImage* CGUITTFont::createTextureFromChar(const uchar32_t& ch)
@@ -26,6 +26,10 @@
 
    John Norman
    john@suckerfreegames.com
+
+   Modified for ManifoldEditor: laid out strings are cached as glyph runs,
+   and text can be collected into one quad list per glyph page between
+   beginBatch() and endBatch().
 */
 
 #ifndef __C_GUI_TTFONT_H_INCLUDED__
@@ -187,15 +191,32 @@ namespace gui
 			u32 used_slots;
 			bool dirty;
 
-			core::array<core::vector2di> render_positions;
-			core::array<core::recti> render_source_rects;
-
 		private:
 			core::array<const SGUITTGlyph*> glyph_to_be_paged;
 			video::IVideoDriver* driver;
 			io::path name;
 	};
 
+	//! A string laid out from the origin, kept so repeated text skips the layout.
+	struct SGUITTGlyphRun
+	{
+		core::dimension2d<s32> dimension;
+		core::array<u32> pages;
+		core::array<core::position2di> positions;
+		core::array<core::recti> source_rects;
+	};
+
+	//! Glyphs waiting to be drawn with the same page, color and clipping.
+	struct SGUITTTextBatch
+	{
+		u32 page;
+		video::SColor color;
+		core::recti clip;
+		bool clipped;
+		core::array<core::position2di> positions;
+		core::array<core::recti> source_rects;
+	};
+
 	//! Class representing a TrueType font.
 	class CGUITTFont : public IGUIFont
 	{
@@ -259,6 +280,12 @@ namespace gui
 				video::SColor color, bool hcenter=false, bool vcenter=false,
 				const core::rect<s32>* clip=0);
 
+			//! Collects everything drawn until endBatch() into one list of quads per glyph page.
+			virtual void beginBatch();
+
+			//! Draws the text collected since beginBatch().
+			virtual void endBatch();
+
 			//! Returns the dimension of a character produced by this font.
 			virtual core::dimension2d<u32> getCharDimension(const wchar_t ch) const;
 
@@ -314,6 +341,9 @@ namespace gui
 				 const video::SColor& color = video::SColor(255, 0, 0, 0), bool center = false );
 
 		protected:
+			//! Laid out strings kept before the cache starts over.
+			enum { MAX_GLYPH_RUNS = 1024 };
+
 			bool use_monochrome;
 			bool use_transparency;
 			bool use_hinting;
@@ -334,6 +364,9 @@ namespace gui
 			bool load(const io::path& filename, const u32 size, const bool antialias, const bool transparency);
 			void reset_images();
 			void update_glyph_pages() const;
+			const SGUITTGlyphRun& getGlyphRun(const core::stringw& text);
+			SGUITTTextBatch& getTextBatch(u32 page, video::SColor color, const core::rect<s32>* clip);
+			void flushTextBatches();
 			void update_load_flags()
 			{
 				// Set up our loading flags.
@@ -366,6 +399,10 @@ namespace gui
 			mutable core::array<CGUITTGlyphPage*> Glyph_Pages;
 			mutable core::array<SGUITTGlyph> Glyphs;
 
+			core::map<core::stringw, SGUITTGlyphRun> Glyph_Runs;
+			core::array<SGUITTTextBatch> Text_Batches;
+			bool batching;
+
 			s32 GlobalKerningWidth;
 			s32 GlobalKerningHeight;
 			core::ustring Invisible;